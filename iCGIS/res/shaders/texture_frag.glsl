@@ -3,9 +3,54 @@ out vec4 FragColor;
 
 in vec2 texCoord;
 
+// The raw values: a band alone in red, or red, green, blue (alpha)
 uniform sampler2D ourTexture;
+// Equalization of the red, green, blue bands over [low, high]
+uniform sampler2D lutTexture;
+// Color ramp of a band alone
+uniform sampler2D rampTexture;
+
+// [low, high] of each band mapped to [0, 1], alpha: [0, maximum]
+uniform vec4 u_stretchLow;
+uniform vec4 u_stretchHigh;
+uniform bool u_equalize;
+// 1: color ramp, 3: RGB, 4: RGBA
+uniform int u_bandsCount;
+
+// GeoRasterStretch::kLutSize, GeoRasterColorRamp::kLutSize
+const float lutSize = 4096.0;
+const float rampSize = 256.0;
+
+// The center of the entry of `value`
+vec2 lutCoord(float value, float size)
+{
+	return vec2((value * (size - 1.0) + 0.5) / size, 0.5);
+}
 
 void main()
 {
-	FragColor = texture(ourTexture, texCoord);
+	vec4 value = texture(ourTexture, texCoord);
+	// nodata (NaN)
+	if (isnan(value.r) || (u_bandsCount >= 3 && (isnan(value.g) || isnan(value.b))))
+		discard;
+
+	// Linear stretch, high == low: a step at high
+	vec4 range = u_stretchHigh - u_stretchLow;
+	vec4 linear = clamp((value - u_stretchLow) / max(range, vec4(1e-30)), 0.0, 1.0);
+	vec4 t = mix(step(u_stretchHigh, value), linear, greaterThan(range, vec4(0.0)));
+
+	// transparent in the alpha band
+	if (u_bandsCount == 4 && (isnan(value.a) || t.a < 0.5))
+		discard;
+
+	if (u_equalize) {
+		t.r = texture(lutTexture, lutCoord(t.r, lutSize)).r;
+		t.g = texture(lutTexture, lutCoord(t.g, lutSize)).g;
+		t.b = texture(lutTexture, lutCoord(t.b, lutSize)).b;
+	}
+
+	if (u_bandsCount == 1)
+		FragColor = vec4(texture(rampTexture, lutCoord(t.r, rampSize)).rgb, 1.0);
+	else
+		FragColor = vec4(t.rgb, 1.0);
 }
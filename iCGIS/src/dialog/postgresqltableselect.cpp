@@ -2,6 +2,7 @@
 #include "dialog/headerviewwithcheckbox.h"
 
 #include "geo/map/geomap.h"
+#include "geo/utility/filereader.h"
 #include "geo/utility/geo_convert.h"
 #include "geo/utility/geo_utility.h"
 #include "util/logger.h"
@@ -64,6 +65,29 @@ void PostgresqlTableSelect::setupLayout()
     layersList->setColumnWidth(3, 100);
     layersList->setShowGrid(false);
 
+    // filters (run by the server) and fetch
+    comboExtentMode = new QComboBox();
+    comboExtentMode->addItems(QStringList() << "All" << "Current view" << "Extent");
+    lineEditExtent = new QLineEdit();
+    lineEditExtent->setPlaceholderText("minX minY maxX maxY");
+    lineEditExtent->setEnabled(false);
+    connect(comboExtentMode, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(onExtentModeChanged(int)));
+    lineEditWhere = new QLineEdit();
+    lineEditWhere->setPlaceholderText("e.g. population > 10000");
+    spinBatchSize = new QSpinBox();
+    spinBatchSize->setRange(100, 1000000);
+    spinBatchSize->setSingleStep(1000);
+    spinBatchSize->setValue(10000);
+
+    QHBoxLayout* extentLayout = new QHBoxLayout();
+    extentLayout->addWidget(comboExtentMode);
+    extentLayout->addWidget(lineEditExtent);
+    formLayout = new QFormLayout();
+    formLayout->addRow("Extent:", extentLayout);
+    formLayout->addRow("Where:", lineEditWhere);
+    formLayout->addRow("Rows per fetch:", spinBatchSize);
+
     // push button
     btnImportLayers = new QPushButton("Import");
     btnCancel = new QPushButton("Cancel");
@@ -88,9 +112,21 @@ void PostgresqlTableSelect::setupLayout()
     verticalLayout = new QVBoxLayout(this);
     verticalLayout->setSpacing(6);
     verticalLayout->addWidget(layersList);
+    verticalLayout->addLayout(formLayout);
     verticalLayout->addLayout(horizontalLayout);
 }
 
+void PostgresqlTableSelect::setViewExtent(const GeoExtent& extent)
+{
+    viewExtent = extent;
+    hasViewExtent = true;
+}
+
+void PostgresqlTableSelect::onExtentModeChanged(int index)
+{
+    lineEditExtent->setEnabled(index == 2);
+}
+
 // Get all tables' info
 // And show in QTableWidget
 void PostgresqlTableSelect::onConnectPostgresql(const QString& ip, int port, const QString& username, const QString& password, const QString& database)
@@ -126,6 +162,7 @@ void PostgresqlTableSelect::onConnectPostgresql(const QString& ip, int port, con
     }
 
     LInfo("Connect to postgresql successfully:{0}", filepathForLog);
+    connection = filepath;
 
     // Get layers count
     int layerCount = poDS->GetLayerCount();
@@ -201,6 +238,44 @@ void PostgresqlTableSelect::onImportLayers()
         return;
     }
 
+    // Extent
+    GeoExtent extent;
+    bool filterExtent = false;
+    switch (comboExtentMode->currentIndex()) {
+    default:
+        break;
+    case 1:
+        if (!hasViewExtent || map->isEmpty()) {
+            QMessageBox::critical(this, "Error", "There is no view yet", QMessageBox::Ok);
+            return;
+        }
+        extent = viewExtent;
+        filterExtent = true;
+        break;
+    case 2:
+    {
+        QStringList values = lineEditExtent->text().split(' ', QString::SkipEmptyParts);
+        bool ok = (values.size() == 4);
+        double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+        if (ok) {
+            bool okMinX, okMinY, okMaxX, okMaxY;
+            minX = values[0].toDouble(&okMinX);
+            minY = values[1].toDouble(&okMinY);
+            maxX = values[2].toDouble(&okMaxX);
+            maxY = values[3].toDouble(&okMaxY);
+            ok = okMinX && okMinY && okMaxX && okMaxY && minX < maxX && minY < maxY;
+        }
+        if (!ok) {
+            QMessageBox::critical(this, "Error", "Invalid extent, expected: minX minY maxX maxY", QMessageBox::Ok);
+            return;
+        }
+        extent = GeoExtent(minX, maxX, minY, maxY);
+        filterExtent = true;
+        break;
+    }
+    }
+
+    std::vector<std::string> tables;
     for (int i = 0; i < rowCount; ++i) {
         if (!layersList->cellWidget(i, 0))
             continue;
@@ -210,22 +285,20 @@ void PostgresqlTableSelect::onImportLayers()
             continue;
 
         QTableWidgetItem* item = layersList->item(i, 1);
-        QByteArray byteArray = item->text().toLocal8Bit();
-        const char* layerName = byteArray.constData();
-
-        // read layer's data and add to map
-        GeoFeatureLayer* geoLayer = new GeoFeatureLayer();
-        geoLayer->setName(layerName);
-        if (!convertOGRLayer(poDS->GetLayerByName(layerName), geoLayer)) {
-            delete geoLayer;
-            continue;
-        }
-        map->addLayer(geoLayer);
-        emit sigAddNewLayerToLayersTree(geoLayer);
-        emit sigSendLayerToGPU(geoLayer);
+        tables.push_back(std::string(item->text().toLocal8Bit().constData()));
     } // end for
+    if (tables.empty())
+        return;
 
+    // The tables are read by a connection of their own
     GDALClose(poDS);
+    poDS = nullptr;
+
+    std::shared_ptr<LayerLoader> loader = FileReader::loadPostgisTables(
+        connection, tables, filterExtent ? &extent : nullptr, lineEditWhere->text().trimmed(),
+        spinBatchSize->value());
+    emit sigLoadLayers(loader);
+
     this->close();
 }
 
@@ -233,6 +306,7 @@ void PostgresqlTableSelect::onCancel()
 {
     if (poDS)
         GDALClose(poDS);
+    poDS = nullptr;
     this->close();
 }
 
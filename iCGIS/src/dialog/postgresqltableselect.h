@@ -2,22 +2,34 @@
 ** class name:  PostgresqlTableSelect
 **
 ** descriptio:  Selcte layer(s) in postgresql to import to the map
+**              The extent and the attribute filter are sent to the
+**                server, the rows are fetched in batches by a
+**                LayerLoader while the map can be used
 **
-** last change: 2020-01-02
+** last change: 2020-04-09
 **********************************************************************/
 #pragma once
 
+#include <QComboBox>
 #include <QDialog>
+#include <QFormLayout>
 #include <QHBoxLayout>
+#include <QLineEdit>
 #include <QPushButton>
 #include <QSpacerItem>
+#include <QSpinBox>
 #include <QTableWidget>
 #include <QTableWidgetItem>
 #include <QVBoxLayout>
 
+#include <memory>
+
+#include "geo/geo_base.hpp"
+
 class GeoMap;
 class GeoLayer;
 class GDALDataset;
+class LayerLoader;
 
 
 class PostgresqlTableSelect : public QDialog
@@ -30,7 +42,12 @@ public:
 public:
     void setupLayout();
 
+    // Allows "Current view" as the extent of the import
+    void setViewExtent(const GeoExtent& extent);
+
 signals:
+    // The tables are being read, the layers are taken from the loader
+    void sigLoadLayers(std::shared_ptr<LayerLoader> loader);
     void updateCheckState(Qt::CheckState checkState);
     void sigAddNewLayerToLayersTree(GeoLayer* layer);
     void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
@@ -42,6 +59,7 @@ public slots:
     void onCancel();
     void updateCheckStateFromHeader(Qt::CheckState checkState);
     void cellCheckboxChanged();
+    void onExtentModeChanged(int index);
 
 public:
     // layout
@@ -56,10 +74,23 @@ public:
     QSpacerItem* horizontalSpacer_2;
     QSpacerItem* horizontalSpacer_3;
 
+    // filters and fetch
+    QFormLayout* formLayout;
+    QComboBox* comboExtentMode;     // All, Current view, Extent
+    QLineEdit* lineEditExtent;      // minX minY maxX maxY
+    QLineEdit* lineEditWhere;       // SQL WHERE of the tables
+    QSpinBox* spinBatchSize;        // rows per fetch
+
     // push button
     QPushButton* btnImportLayers;
     QPushButton* btnCancel;
 
     GDALDataset* poDS = nullptr;
     GeoMap*& map;
+
+private:
+    // "PG:dbname=..." of the connection
+    QString connection;
+    GeoExtent viewExtent;
+    bool hasViewExtent = false;
 };
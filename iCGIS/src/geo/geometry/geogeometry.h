@@ -167,6 +167,13 @@ public:
     void addPoint(const GeoRawPoint& rawPoint);
     void addPoint(double xx, double yy);
 
+    // replace all points, copied at once
+    void setPoints(const GeoRawPoint* rawPoints, int count)
+        { points.assign(rawPoints, rawPoints + count); }
+    // replace all points with `count` packed (x, y) doubles at any
+    //  alignment (e.g. inside a WKB buffer), copied at once
+    void setPackedPoints(const void* xy, int count);
+
     // reserve memory to store points
     void reserveNumPoints(int count);
 
@@ -1,6 +1,8 @@
 #include "geogeometry.h"
 #include "geo/utility/geo_math.h"
 
+#include <cstring>
+
 GeoLineString::GeoLineString(const GeoLineString& rhs) :
     points(rhs.points)
 {
@@ -61,6 +63,13 @@ void GeoLineString::reserveNumPoints(int count)
     this->points.reserve(count);
 }
 
+void GeoLineString::setPackedPoints(const void* xy, int count)
+{
+    points.resize(count);
+    if (count > 0)
+        memcpy(&points[0], xy, count * sizeof(GeoRawPoint));
+}
+
 
 /* Overrider */
 
@@ -27,6 +27,7 @@ public:
 
     // Get the number of grids
     int getNumGrids() const { return grids.size(); }
+    Grid* getGrid(int idx) const { return grids[idx]; }
 
     // Query grid
     // Get the grid which contains the point
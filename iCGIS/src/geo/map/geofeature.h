@@ -47,6 +47,8 @@ public:
     // The minimum enclosing rectangle
     void updateExtent() { extent = geom->getExtent(); }
     const GeoExtent& getExtent() const { return extent; }
+    // Extent already known (e.g. saved in a snapshot)
+    void setExtent(const GeoExtent& extentIn) { extent = extentIn; }
 
 
     /********************************************
@@ -116,11 +118,13 @@ public:
     void setColor(unsigned int colorIn, bool bUpdate = false);
     void setColor(int r, int g, int b, bool bUpdate = false);
     void getColorF(float&r, float &g, float& b);
+    QRgb getColor() const { return color; }
 
     // Border color, only for polygon features
     void setBorderColor(int colorIn, bool bUpdate = false);
     void setBorderColor(int r, int g, int b, bool bUpdate = false);
     void getBorderColorF(float& r, float& g, float& b);
+    QRgb getBorderColor() const { return borderColor; }
 
 private:
     bool checkFieldName(const QString& name) const;
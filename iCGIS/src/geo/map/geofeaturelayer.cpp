@@ -1,6 +1,8 @@
 #include "geo/map/geolayer.h"
 #include "geo/utility/geo_math.h"
+#include "geo/utility/layerloader.h"
 
+#include <algorithm>
 #include <cmath>
 
 GeoLayer::~GeoLayer() {}
@@ -27,7 +29,7 @@ GeoFeatureLayer::GeoFeatureLayer(int nLID, GeometryType type)
 }
 
 GeoFeatureLayer::GeoFeatureLayer(const GeoFeatureLayer& rhs) :
-    currentFID(rhs.currentFID), properties(rhs.properties)
+    currentFID(rhs.currentFID), properties(rhs.properties), triangleCache(rhs.triangleCache)
 {
     // Field definitions
     int count = rhs.fieldDefns->size();
@@ -57,6 +59,10 @@ GeoFeatureLayer::~GeoFeatureLayer()
 {
     // Notice the order of destruction
 
+    // The worker may still read the fields and the features
+    if (loader)
+        loader->stopLayer(this);
+
     // Destruct the feature
     for (auto& pFeature : features)
         delete pFeature;
@@ -216,19 +222,109 @@ void GeoFeatureLayer::updateExtent()
     }
 }
 
+// Take an index already built
+void GeoFeatureLayer::setGridIndex(GridIndex* gridIndexIn)
+{
+    if (gridIndex)
+        delete gridIndex;
+    gridIndex = gridIndexIn;
+}
+
 // Create grid index
 bool GeoFeatureLayer::createGridIndex()
 {
     if (isEmpty())
         return false;
 
-    GeoExtent layerExtent = this->getExtent();
+    setGridIndex(buildGridIndex(features, this->getExtent()));
+    return true;
+}
+
+namespace {
+
+// Whether the feature (its extent intersects the grid) intersects the grid
+bool isFeatureInGrid(GeoFeature* feature, const GeoExtent& gridExtent)
+{
+    switch (feature->getGeometryType()) {
+    default:
+        break;
+    case kPoint:
+    {
+        GeoPoint* point = feature->getGeometry()->toPoint();
+        if (gridExtent.contain(point->getX(), point->getY())) {
+            return true;
+        }
+        break;
+    }
+    case kMultiPoint:
+    {
+        GeoMultiPoint* multiPoint = feature->getGeometry()->toMultiPoint();
+        int pointsCount = multiPoint->getNumGeometries();
+        for (int iPoint = 0; iPoint < pointsCount; ++iPoint) {
+            GeoPoint* point = multiPoint->getPoint(iPoint);
+            if (gridExtent.contain(point->getX(), point->getY())) {
+                return true;
+            }
+        }
+        break;
+    }
+    case kLineString:
+    {
+        GeoLineString* lineString = feature->getGeometry()->toLineString();
+        if (gm::isLineStringRectIntersect(lineString, gridExtent)) {
+            return true;
+        }
+        break;
+    }
+    case kMultiLineString:
+    {
+        GeoMultiLineString* multiLineString = feature->getGeometry()->toMultiLineString();
+        int linesCount = multiLineString->getNumGeometries();
+        for (int i = 0; i < linesCount; ++i) {
+            if (gm::isLineStringRectIntersect(multiLineString->getGeometry(i)->toLineString(), gridExtent)) {
+                return true;
+            }
+        }
+        break;
+    }
+    case kPolygon:
+    {
+        GeoPolygon* polygon = feature->getGeometry()->toPolygon();
+        if (gm::isPolygonRectIntersect(polygon, gridExtent)) {
+            return true;
+        }
+        break;
+    }
+    case kMultiPolygon:
+    {
+        GeoMultiPolygon* multiPolygon = feature->getGeometry()->toMultiPolygon();
+        int polygonsCount = multiPolygon->getNumGeometries();
+        for (int i = 0; i < polygonsCount; ++i) {
+            //GeoExtent extent = multiPolygon->getGeometry(i)->toPolygon()->getExtent();
+            if (gm::isPolygonRectIntersect(multiPolygon->getGeometry(i)->toPolygon(), gridExtent)) {
+                return true;
+            }
+        }
+        break;
+    }
+    } // end switch geometry type
+
+    return false;
+}
+
+} // namespace
+
+// Only reads the features, may run on any thread
+GridIndex* GeoFeatureLayer::buildGridIndex(const std::vector<GeoFeature*>& features, const GeoExtent& layerExtent)
+{
+    if (features.empty())
+        return nullptr;
 
     // Grid's size is 3 times the average size of the enclosing rectangle
     //  of all features int the layer
     double gridWidth = 0;
     double gridHeight = 0;
-    int featuresCount = features.size();
+    int featuresCount = int(features.size());
     for (int i = 0; i < featuresCount; ++i) {
         const GeoExtent& extent = features[i]->getExtent();
         gridWidth += extent.width();
@@ -266,9 +362,7 @@ bool GeoFeatureLayer::createGridIndex()
         gridHeight = layerExtent.height() / rows;
     }
 
-    if (gridIndex)
-        delete gridIndex;
-    gridIndex = new GridIndex();
+    GridIndex* gridIndex = new GridIndex();
     gridIndex->reserve(rows * cols);
 
     // Add grids
@@ -279,85 +373,46 @@ bool GeoFeatureLayer::createGridIndex()
             GeoExtent gridExtent(layerExtent.minX + j * gridWidth, layerExtent.minX + (j + 1) * gridWidth,
                                  layerExtent.minY + i * gridHeight, layerExtent.minY + (i + 1) * gridHeight);
             grid->setExtent(gridExtent);
-            for (int k = 0; k < featuresCount; ++k) {
-                GeoFeature* feature = features[k];
+        }
+    }
+
+    // Each feature is tested against the grids around its extent only
+    //  (one more on each side, the test is the exact one), in the order
+    //  of the features, so each grid lists them in the same order
+    auto gridRange = [](double minValue, double maxValue, double origin, double size, int count,
+                        int& begin, int& end) {
+        begin = 0;
+        end = count - 1;
+        if (!(size > 0.0))
+            return;    // flat layer, all the grids have the same extent
+        double first = (minValue - origin) / size - 1;
+        double last = (maxValue - origin) / size + 1;
+        if (first > 0.0)
+            begin = first >= count - 1 ? count - 1 : int(first);
+        if (!(last < count - 1))
+            return;
+        end = last > 0.0 ? int(last) : 0;
+    };
+    for (int k = 0; k < featuresCount; ++k) {
+        GeoFeature* feature = features[k];
+        const GeoExtent& featureExtent = feature->getExtent();
+        int colBegin, colEnd, rowBegin, rowEnd;
+        gridRange(featureExtent.minX, featureExtent.maxX, layerExtent.minX, gridWidth, cols, colBegin, colEnd);
+        gridRange(featureExtent.minY, featureExtent.maxY, layerExtent.minY, gridHeight, rows, rowBegin, rowEnd);
+        for (int i = rowBegin; i <= rowEnd; ++i) {
+            for (int j = colBegin; j <= colEnd; ++j) {
+                Grid* grid = gridIndex->getGrid(i * cols + j);
                 // If the feature's extent dose not intersect the grid,
                 //   the feature dose not intersec the grid
-                if (!gridExtent.isIntersect(feature->getExtent())) {
+                if (!grid->getExtent().isIntersect(featureExtent))
                     continue;
-                }
-                switch (feature->getGeometryType()) {
-                default:
-                    break;
-                case kPoint:
-                {
-                    GeoPoint* point = feature->getGeometry()->toPoint();
-                    if (gridExtent.contain(point->getX(), point->getY())) {
-                        grid->addFeature(feature);
-                    }
-                    break;
-                }
-                case kMultiPoint:
-                {
-                    GeoMultiPoint* multiPoint = feature->getGeometry()->toMultiPoint();
-                    int pointsCount = multiPoint->getNumGeometries();
-                    for (int iPoint = 0; iPoint < pointsCount; ++iPoint) {
-                        GeoPoint* point = multiPoint->getPoint(iPoint);
-                        if (gridExtent.contain(point->getX(), point->getY())) {
-                            grid->addFeature(feature);
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case kLineString:
-                {
-                    GeoLineString* lineString = feature->getGeometry()->toLineString();
-                    if (gm::isLineStringRectIntersect(lineString, gridExtent)) {
-                        grid->addFeature(feature);
-                    }
-                    break;
-                }
-                case kMultiLineString:
-                {
-                    GeoMultiLineString* multiLineString = feature->getGeometry()->toMultiLineString();
-                    int linesCount = multiLineString->getNumGeometries();
-                    for (int i = 0; i < linesCount; ++i) {
-                        if (gm::isLineStringRectIntersect(multiLineString->getGeometry(i)->toLineString(), gridExtent)) {
-                            grid->addFeature(feature);
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case kPolygon:
-                {
-                    GeoPolygon* polygon = feature->getGeometry()->toPolygon();
-                    if (gm::isPolygonRectIntersect(polygon, gridExtent)) {
-                        grid->addFeature(feature);
-                    }
-                    break;
-                }
-                case kMultiPolygon:
-                {
-                    GeoMultiPolygon* multiPolygon = feature->getGeometry()->toMultiPolygon();
-                    int polygonsCount = multiPolygon->getNumGeometries();
-                    for (int i = 0; i < polygonsCount; ++i) {
-                        //GeoExtent extent = multiPolygon->getGeometry(i)->toPolygon()->getExtent();
-                        if (gm::isPolygonRectIntersect(multiPolygon->getGeometry(i)->toPolygon(), gridExtent)) {
-                            grid->addFeature(feature);
-                            break;
-                        }
-                    }
-                    break;
-                }
-                } // end switch geometry type
-            } // end for k
-        } // end for j
-    } // end for i
-
+                if (isFeatureInGrid(feature, grid->getExtent()))
+                    grid->addFeature(feature);
+            }
+        }
+    }
 
-    return true;
+    return gridIndex;
 }
 
 
@@ -565,17 +620,17 @@ void GeoFeatureLayer::deleteFeatures(const std::vector<GeoFeature*>& fs, bool so
         // set not-selected flag
         for (auto& feature : selectedFetures)
             feature->setSelected(false);
-        // remove
-        for (auto iter = features.begin(); iter != features.end(); ) {
-            auto findIt = std::find(fs.begin(), fs.end(), *iter);
-            if (findIt != fs.end()) {
-                delete (*iter);
-                iter = features.erase(iter);
-            }
-            else {
-                ++iter;
-            }
-        }
+        // remove, the vector is compacted once (a virtual layer drops
+        //  thousands of features at a time)
+        std::vector<GeoFeature*> sortedFs(fs);
+        std::sort(sortedFs.begin(), sortedFs.end());
+        auto last = std::remove_if(features.begin(), features.end(), [&sortedFs](GeoFeature* feature) {
+            if (!std::binary_search(sortedFs.begin(), sortedFs.end(), feature))
+                return false;
+            delete feature;
+            return true;
+        });
+        features.erase(last, features.end());
         // clear selected features
         std::vector<GeoFeature*>().swap(selectedFetures);
     }
@@ -4,21 +4,25 @@
 ** sub classes: GeoFeatureLayer
 **				GeoRasterLayer
 **
-** last change: 2020-03-26
+** last change: 2020-04-09
 *****************************************************************/
 #pragma once
 
 #include "geo/map/geofeature.h"
 #include "geo/map/geofeaturelayerproperty.h"
 #include "geo/map/georasterlayerproperty.h"
+#include "geo/map/geotrianglecache.h"
 #include "geo/index/gridindex.h"
 #include "geo/raster/georasterdata.h"
 
+#include <memory>
 #include <vector>
 #include <QStringList>
 
 class GeoRasterLayer;
 class GeoFeatureLayer;
+class VirtualLayerSource;
+class LayerLoader;
 
 enum LayerType {
     kRasterLayer   = 0,
@@ -154,6 +158,12 @@ public:
     ** Spatial Index
     ******************************/
     bool createGridIndex();
+    // The index of `features` in `layerExtent`, the layer is not changed
+    //  (e.g. built on a loading thread), nullptr if there is no feature
+    static GridIndex* buildGridIndex(const std::vector<GeoFeature*>& features, const GeoExtent& layerExtent);
+    // Take an index already built (e.g. loaded from a snapshot)
+    void setGridIndex(GridIndex* gridIndexIn);
+    GridIndex* getGridIndex() const { return gridIndex; }
     void queryFeatures(double x, double y, double halfEdge, GeoFeature*& featureOut) const;
     void queryFeatures(const GeoExtent& extent, std::vector<GeoFeature*>& featuresOut) const;
 
@@ -194,6 +204,30 @@ public:
     void rotateSelectedFeatures(double angle);
     void rotateFeatures(const std::vector<GeoFeature*>& fs, double angle);
 
+    /*********************************
+    **  Triangles of the polygons
+    **    loaded from a snapshot, earcut is not run again
+    *********************************/
+    const GeoTriangleCache* getTriangleCache() const { return triangleCache.get(); }
+    void setTriangleCache(std::shared_ptr<const GeoTriangleCache> cache) { triangleCache = cache; }
+
+    /*********************************
+    **  Virtual layer
+    **    the features are read from the source as the view moves,
+    **    a copy of the layer keeps the features and not the source
+    *********************************/
+    bool isVirtual() const { return bool(virtualSource); }
+    VirtualLayerSource* getVirtualSource() const { return virtualSource.get(); }
+    void setVirtualSource(std::shared_ptr<VirtualLayerSource> source) { virtualSource = source; }
+
+    /*********************************
+    **  Loading
+    **    the features are still read by a LayerLoader and the layer
+    **    has no index yet, destroying the layer stops the loader
+    *********************************/
+    bool isLoading() const { return bool(loader); }
+    void setLoader(std::shared_ptr<LayerLoader> loaderIn) { loader = loaderIn; }
+
 private:
     /* The id of the next feature to be added */
     /* Automatically increase */
@@ -208,6 +242,15 @@ private:
     // Index
     // grid index
     GridIndex* gridIndex = nullptr;
+
+    // Shared by the copies, the FIDs are kept when copying
+    std::shared_ptr<const GeoTriangleCache> triangleCache;
+
+    // Destroyed after the features, which it does not own
+    std::shared_ptr<VirtualLayerSource> virtualSource;
+
+    // Not copied, the copy has the features read so far
+    std::shared_ptr<LayerLoader> loader;
 };
 
 
@@ -237,6 +280,10 @@ public:
     void setData(GeoRasterData* pDataIn);
     GeoRasterData* getData() const { return pData; }
 
+    // The file read, saved in the project
+    QString getSourcePath() const { return properties.sourcePath; }
+    void setSourcePath(const QString& path) { properties.sourcePath = path; }
+
 
     /************************
     * Property
@@ -107,6 +107,15 @@ int GeoMap::addLayer(GeoLayer* layerIn)
 }
 
 // Remove layer by layer's unique ID
+bool GeoMap::isLoading() const
+{
+    for (GeoLayer* layer : layers) {
+        if (layer->getLayerType() == kFeatureLayer && layer->toFeatureLayer()->isLoading())
+            return true;
+    }
+    return false;
+}
+
 bool GeoMap::removeLayerByLID(int nLID)
 {
     int idx = getLayerIndexByLID(nLID);
@@ -179,6 +188,26 @@ void GeoMap::updateExtent()
     }
 }
 
+QString GeoMap::getSpatialRef() const
+{
+    for (GeoLayer* layer : layers) {
+        if (layer->getLayerType() == kFeatureLayer) {
+            QString spatialRef = layer->toFeatureLayer()->getSpatialRef();
+            if (!spatialRef.isEmpty())
+                return spatialRef;
+        }
+        else if (layer->getLayerType() == kRasterLayer) {
+            GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+            if (rasterData && rasterData->getBandsCount() > 0 && rasterData->getBand(0)->isTiled()) {
+                const std::string& projection = rasterData->getBand(0)->getSource()->getProjection();
+                if (!projection.empty())
+                    return QString::fromStdString(projection);
+            }
+        }
+    }
+    return QString();
+}
+
 
 /************************************************
 **
@@ -37,6 +37,8 @@ public:
     **  GeoLayer
     *****************************/
     bool isEmpty() const { return layers.empty(); }
+    // A feature layer is still read by a LayerLoader
+    bool isLoading() const;
     int getNumLayers() const { return layers.size(); }
     GeoLayer* getLayerByOrder(int order) const;
     GeoLayer* getLayerById(int idx) const { return layers[idx]; }
@@ -69,6 +71,10 @@ public:
     void setName(const QString& nameIn) { properties.name = nameIn; }
     void updateExtent();
 
+    // The coordinate system (WKT) of the first layer added which has one,
+    //  the rasters of other systems are warped to it; empty if none
+    QString getSpatialRef() const;
+
     /************************************************
     **  Spatial query (DO NOT use spatial index)
     ************************************************/
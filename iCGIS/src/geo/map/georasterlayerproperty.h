@@ -21,4 +21,5 @@ public:
     int id = 0;
     QString name;
     GeoExtent extent;
+    QString sourcePath;
 };
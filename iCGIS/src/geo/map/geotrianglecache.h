@@ -0,0 +1,43 @@
+/*******************************************************
+** class name:  GeoTriangleCache
+**
+** description: Triangles of the polygons of a layer
+**
+**              Loaded from a snapshot, so the polygons are
+**                sent to GPU without running earcut again.
+**              A feature is found by its FID, a polygon of a
+**                multipolygon by its index (part), the indices
+**                refer to the points of the part: exterior ring
+**                first, then the interior rings.
+**
+**              The triangles don't change when the features
+**                are moved or rotated.
+**
+** last change: 2020-04-09
+*******************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+class GeoTriangleCache {
+public:
+    // nullptr if the polygon isn't cached
+    const unsigned int* getTriangles(int nFID, int part, int& indicesCount) const {
+        if (nFID < 0 || size_t(nFID) + 1 >= featureParts.size())
+            return nullptr;
+        uint64_t iPart = featureParts[nFID] + part;
+        if (part < 0 || iPart >= featureParts[nFID + 1])
+            return nullptr;
+        indicesCount = int(partOffsets[iPart + 1] - partOffsets[iPart]);
+        return indices.data() + partOffsets[iPart];
+    }
+
+public:
+    // featureParts[FID] is the first part of the feature, size: FIDs + 1
+    std::vector<uint64_t> featureParts;
+    // partOffsets[part] is the first index of the part, size: parts + 1
+    std::vector<uint64_t> partOffsets;
+    std::vector<unsigned int> indices;
+};
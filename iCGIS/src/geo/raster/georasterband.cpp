@@ -1,40 +1,118 @@
 #include "geo/raster/georasterband.h"
-#include "util/env.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+namespace {
+
+utils::DataType convertGDALDataType(GDALDataType type)
+{
+    switch (type) {
+    default:            return utils::kUnknown;
+    case GDT_Byte:      return utils::kByte;
+    case GDT_Int16:     return utils::kInt16;
+    case GDT_UInt16:    return utils::kUInt16;
+    case GDT_Int32:     return utils::kInt;
+    case GDT_UInt32:    return utils::kUInt;
+    case GDT_Float32:   return utils::kFloat;
+    case GDT_Float64:   return utils::kDouble;
+    }
+}
+
+// Calls func(T()) with the C++ type of the pixels, false if unknown
+template<typename Func>
+bool visitDataType(utils::DataType type, Func&& func)
+{
+    switch (type) {
+    default:                return false;
+    case utils::kByte:      func((unsigned char)0); return true;
+    case utils::kInt16:     func((short)0); return true;
+    case utils::kUInt16:    func((unsigned short)0); return true;
+    case utils::kInt:       func((int)0); return true;
+    case utils::kUInt:      func((unsigned int)0); return true;
+    case utils::kFloat:     func((float)0); return true;
+    case utils::kDouble:    func((double)0); return true;
+    }
+}
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+// Blocks of a band in memory
+const int kMemoryBlockSize = 256;
+
+// The pixels of `row` at `columns`, NaN for nodata
+template<typename T>
+void sampleRow(const T* row, const std::vector<int>& columns, float* out,
+               bool hasNoData, double noDataValue)
+{
+    int count = int(columns.size());
+    for (int i = 0; i < count; ++i) {
+        T value = row[columns[i]];
+        out[i] = (hasNoData && double(value) == noDataValue) ? kNaN : float(value);
+    }
+}
+
+// false if all the pixels are nodata
+template<typename T>
+bool computeMinMax(const T* data, size_t count, bool hasNoData, double noDataValue,
+                   double& minValue, double& maxValue)
+{
+    bool found = false;
+    for (size_t i = 0; i < count; ++i) {
+        double value = double(data[i]);
+        if ((hasNoData && value == noDataValue) || std::isnan(value))
+            continue;
+        if (!found) {
+            minValue = maxValue = value;
+            found = true;
+        }
+        else if (value < minValue) {
+            minValue = value;
+        }
+        else if (value > maxValue) {
+            maxValue = value;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+
+GeoRasterBand::GeoRasterBand(std::shared_ptr<GeoRasterSource> sourceIn, int iSourceBand)
+    : width(sourceIn->getWidth()), height(sourceIn->getHeight()),
+      dataType(convertGDALDataType(sourceIn->getDataType(iSourceBand))),
+      source(sourceIn), iSourceBand(iSourceBand)
+{
+    source->getGeoTransform(geoTransform);
+    hasNoData = source->getNoDataValue(iSourceBand, noDataValue);
+}
 
 // Copy constructor (deep copy)
 GeoRasterBand::GeoRasterBand(const GeoRasterBand& rhs)
+    : width(rhs.width), height(rhs.height), dataType(rhs.dataType),
+      source(rhs.source), iSourceBand(rhs.iSourceBand),
+      hasMinMax(rhs.hasMinMax), minValue(rhs.minValue), maxValue(rhs.maxValue),
+      hasNoData(rhs.hasNoData), noDataValue(rhs.noDataValue), stats(rhs.stats)
 {
     // Transform parameters
     for (int i = 0; i < 6; ++i)
         geoTransform[i] = rhs.geoTransform[i];
 
     // copy data
-    int pixCount = width * height;
-    switch (dataType) {
-    case utils::kByte:
-        pData = new char[pixCount];
-        memcpy(pData, rhs.pData, pixCount);
-        break;
-    case utils::kInt:
-        pData = new int[pixCount];
-        memcpy(pData, rhs.pData, pixCount * sizeof(int));
-        break;
-    case utils::kUInt:
-        pData = new unsigned int[pixCount];
-        memcpy(pData, rhs.pData, pixCount * sizeof(unsigned int));
-        break;
-    case utils::kFloat:
-        pData = new float[pixCount];
-        memcpy(pData, rhs.pData, pixCount * sizeof(float));
-        break;
-    case utils::kDouble:
-        pData = new double[pixCount];
-        memcpy(pData, rhs.pData, pixCount * sizeof(double));
-        break;
-    case utils::kUnknown:
-        break;
-    }
+    if (!rhs.pData)
+        return;
+    size_t pixCount = size_t(width) * height;
+    visitDataType(dataType, [&](auto zero) {
+        using T = decltype(zero);
+        T* data = new T[pixCount];
+        memcpy(data, rhs.pData, pixCount * sizeof(T));
+        pData = data;
+    });
 }
 
 GeoRasterBand::~GeoRasterBand()
@@ -46,26 +124,10 @@ void GeoRasterBand::destroyData() {
     if (!pData)
         return;
 
-    switch (dataType) {
-    case utils::kByte:
-        delete[] (char*)pData;
-        break;
-    case utils::kInt:
-        delete[] (int*)pData;
-        break;
-    case utils::kUInt:
-        delete[] (unsigned int*)pData;
-        break;
-    case utils::kFloat:
-        delete[] (float*)pData;
-        break;
-    case utils::kDouble:
-        delete[] (double*)pData;
-        break;
-    case utils::kUnknown:
-    default:
-        break;
-    }
+    visitDataType(dataType, [&](auto zero) {
+        using T = decltype(zero);
+        delete[] (T*)pData;
+    });
     pData = nullptr;
 }
 
@@ -74,6 +136,204 @@ void GeoRasterBand::setData(void* pDataIn, utils::DataType dataTypeIn)
     destroyData();
     pData = pDataIn;
     dataType = dataTypeIn;
+    hasMinMax = false;
+    stats.reset();
+}
+
+void GeoRasterBand::setNoDataValue(double value)
+{
+    hasNoData = true;
+    noDataValue = value;
+    hasMinMax = false;
+    stats.reset();
+}
+
+bool GeoRasterBand::readWindow(int xOff, int yOff, int xSize, int ySize,
+                               float* buffer, int bufXSize, int bufYSize, int level /*= 0*/) const
+{
+    if (!buffer || xSize <= 0 || ySize <= 0 || bufXSize <= 0 || bufYSize <= 0
+        || xOff < 0 || yOff < 0 || xOff + xSize > width || yOff + ySize > height
+        || level < 0 || level >= getLevelsCount())
+        return false;
+
+    // Size of the level, the full resolution in memory
+    int levelWidth = width;
+    int levelHeight = height;
+    if (isTiled()) {
+        levelWidth = source->getLevel(level).width;
+        levelHeight = source->getLevel(level).height;
+    }
+
+    // The pixel of the level at the center of each pixel of the buffer
+    std::vector<int> columns(bufXSize);
+    for (int i = 0; i < bufXSize; ++i) {
+        double x = xOff + (i + 0.5) * xSize / bufXSize;
+        columns[i] = std::min(levelWidth - 1, int(x * levelWidth / width));
+    }
+    auto rowOf = [&](int j) {
+        double y = yOff + (j + 0.5) * ySize / bufYSize;
+        return std::min(levelHeight - 1, int(y * levelHeight / height));
+    };
+
+    if (!isTiled()) {
+        if (!pData)
+            return false;
+        for (int j = 0; j < bufYSize; ++j) {
+            size_t rowOffset = size_t(rowOf(j)) * width;
+            float* out = buffer + size_t(j) * bufXSize;
+            bool known = visitDataType(dataType, [&](auto zero) {
+                using T = decltype(zero);
+                sampleRow((const T*)pData + rowOffset, columns, out, hasNoData, noDataValue);
+            });
+            if (!known)
+                return false;
+        }
+        return true;
+    }
+
+    // Tiled: the blocks of a block row are read when first needed and
+    //  kept until the buffer leaves the block row
+    int blockXSize = source->getLevel(level).blockXSize;
+    int blockYSize = source->getLevel(level).blockYSize;
+    int firstBlockX = columns.front() / blockXSize;
+    int lastBlockX = columns.back() / blockXSize;
+    std::vector<std::shared_ptr<const GeoRasterBlock>> blocks(lastBlockX - firstBlockX + 1);
+    std::vector<float> blockRow(blockXSize);
+    int currentBlockY = -1;
+    // Nodata in float, as the pixels converted
+    float noDataFloat = float(noDataValue);
+
+    for (int j = 0; j < bufYSize; ++j) {
+        int y = rowOf(j);
+        int blockY = y / blockYSize;
+        if (blockY != currentBlockY) {
+            for (auto& block : blocks)
+                block.reset();
+            currentBlockY = blockY;
+        }
+
+        float* out = buffer + size_t(j) * bufXSize;
+        int i = 0;
+        while (i < bufXSize) {
+            int blockX = columns[i] / blockXSize;
+            auto& block = blocks[blockX - firstBlockX];
+            if (!block) {
+                block = source->getBlock(iSourceBand, level, blockX, blockY);
+                if (!block)
+                    return false;
+            }
+            // The row of the block in float, any data type
+            GDALCopyWords(block->getRow(y - blockY * blockYSize), block->dataType,
+                          GDALGetDataTypeSizeBytes(block->dataType),
+                          blockRow.data(), GDT_Float32, sizeof(float), block->width);
+            int blockX0 = blockX * blockXSize;
+            for (; i < bufXSize && columns[i] < blockX0 + block->width; ++i) {
+                float value = blockRow[columns[i] - blockX0];
+                out[i] = (hasNoData && value == noDataFloat) ? kNaN : value;
+            }
+        }
+    }
+
+    return true;
+}
+
+int GeoRasterBand::getLevelForScale(double pixelsPerSample) const
+{
+    int levelsCount = getLevelsCount();
+    for (int level = levelsCount - 1; level > 0; --level) {
+        double factor = double(width) / source->getLevel(level).width;
+        if (factor <= pixelsPerSample)
+            return level;
+    }
+    return 0;
+}
+
+GeoRasterSource::Level GeoRasterBand::getLevel(int level) const
+{
+    if (isTiled())
+        return source->getLevel(level);
+
+    GeoRasterSource::Level levelInfo;
+    levelInfo.width = width;
+    levelInfo.height = height;
+    levelInfo.blockXSize = std::max(1, std::min(kMemoryBlockSize, width));
+    levelInfo.blockYSize = std::max(1, std::min(kMemoryBlockSize, height));
+    return levelInfo;
+}
+
+bool GeoRasterBand::readBlock(int level, int blockX, int blockY, std::vector<float>& pixels,
+                              int& blockWidth, int& blockHeight, bool keep /*= true*/) const
+{
+    if (level < 0 || level >= getLevelsCount())
+        return false;
+    GeoRasterSource::Level levelInfo = getLevel(level);
+    if (blockX < 0 || blockX >= levelInfo.getBlocksX() || blockY < 0 || blockY >= levelInfo.getBlocksY())
+        return false;
+
+    if (isTiled()) {
+        std::shared_ptr<const GeoRasterBlock> block = source->getBlock(iSourceBand, level, blockX, blockY, keep);
+        if (!block)
+            return false;
+        blockWidth = block->width;
+        blockHeight = block->height;
+        size_t count = size_t(blockWidth) * blockHeight;
+        pixels.resize(count);
+        GDALCopyWords(block->data.data(), block->dataType, GDALGetDataTypeSizeBytes(block->dataType),
+                      pixels.data(), GDT_Float32, sizeof(float), int(count));
+        if (hasNoData) {
+            float noDataFloat = float(noDataValue);
+            for (float& pixel : pixels) {
+                if (pixel == noDataFloat)
+                    pixel = kNaN;
+            }
+        }
+        return true;
+    }
+
+    if (!pData)
+        return false;
+    int xOff = blockX * levelInfo.blockXSize;
+    int yOff = blockY * levelInfo.blockYSize;
+    blockWidth = std::min(levelInfo.blockXSize, width - xOff);
+    blockHeight = std::min(levelInfo.blockYSize, height - yOff);
+    pixels.resize(size_t(blockWidth) * blockHeight);
+    std::vector<int> columns(blockWidth);
+    for (int i = 0; i < blockWidth; ++i)
+        columns[i] = xOff + i;
+    return visitDataType(dataType, [&](auto zero) {
+        using T = decltype(zero);
+        for (int j = 0; j < blockHeight; ++j) {
+            sampleRow((const T*)pData + size_t(yOff + j) * width, columns,
+                      pixels.data() + size_t(j) * blockWidth, hasNoData, noDataValue);
+        }
+    });
+}
+
+std::shared_ptr<const GeoRasterStats> GeoRasterBand::getStats(bool approx /*= true*/) const
+{
+    if (!stats || (!approx && stats->approx))
+        stats = GeoRasterStats::compute(this, approx);
+    return stats;
+}
+
+bool GeoRasterBand::getMinMax(double& minValueOut, double& maxValueOut) const
+{
+    if (!hasMinMax) {
+        if (isTiled()) {
+            hasMinMax = source->getMinMax(iSourceBand, minValue, maxValue);
+        }
+        else if (pData && width > 0 && height > 0) {
+            size_t count = size_t(width) * height;
+            visitDataType(dataType, [&](auto zero) {
+                using T = decltype(zero);
+                hasMinMax = computeMinMax((const T*)pData, count, hasNoData, noDataValue,
+                                          minValue, maxValue);
+            });
+        }
+    }
+    minValueOut = minValue;
+    maxValueOut = maxValue;
+    return hasMinMax;
 }
 
 GeoExtent GeoRasterBand::getExtent() const
@@ -93,14 +353,3 @@ GeoRawPoint GeoRasterBand::getGeoXY(int pixelX, int pixelY) const
     double geoY = geoTransform[3] + pixelY * geoTransform[5];
     return { geoX, geoY };
 }
-
-void GeoRasterBand::setOpenglRasterDescriptor(OpenglRasterDescriptor* desc) {
-    if (openglRasterDesc)
-        delete openglRasterDesc;
-    openglRasterDesc = desc;
-}
-
-void GeoRasterBand::Draw() const {
-    Env::renderer.DrawTexture(openglRasterDesc->vao, openglRasterDesc->ibo,
-                              openglRasterDesc->texs, Env::textureShader);
-}
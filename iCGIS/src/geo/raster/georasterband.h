@@ -3,14 +3,24 @@
 **
 ** description: A band of raster data
 **
-** last change: 2020-01-04
+**              In memory (pData), or tiled: read by blocks from a
+**                GeoRasterSource when a window of it is needed
+**              Any data type: Byte, (U)Int16, (U)Int32, Float32/64
+**              The pixels equal to the nodata value are masked:
+**                NaN in the windows read, skipped by the statistics
+**
+** last change: 2020-04-09
 *******************************************************/
 #pragma once
 
 #include "util/utility.h"
 #include "util/memoryleakdetect.h"
 #include "geo/geo_base.hpp"
-#include "opengl/openglrasterdescriptor.h"
+#include "geo/raster/georastersource.h"
+#include "geo/raster/georasterstats.h"
+
+#include <memory>
+#include <vector>
 
 
 class GeoRasterBand {
@@ -18,6 +28,9 @@ public:
     GeoRasterBand() {}
     GeoRasterBand(int width, int height)
         : width(width), height(height) {}
+    // Tiled, iSourceBand: 1-based
+    GeoRasterBand(std::shared_ptr<GeoRasterSource> sourceIn, int iSourceBand);
+    // The copy of a tiled band shares the source
     GeoRasterBand(const GeoRasterBand& rhs);
     ~GeoRasterBand();
 
@@ -32,9 +45,40 @@ public:
 
     utils::DataType getDataType() const { return dataType; }
 
-    void setOpenglRasterDescriptor(OpenglRasterDescriptor* desc);
+    bool getNoDataValue(double& value) const { value = noDataValue; return hasNoData; }
+    void setNoDataValue(double value);
+
+    bool isTiled() const { return bool(source); }
+    GeoRasterSource* getSource() const { return source.get(); }
+    int getSourceBand() const { return iSourceBand; }
+
+    // The pixels of [xOff, xOff + xSize) x [yOff, yOff + ySize), resampled
+    //  (nearest) to bufXSize x bufYSize, row by row, top row first
+    // Nodata: NaN
+    // The window is in pixels of the full resolution, read from `level`
+    // Tiled: only the blocks touched are read
+    bool readWindow(int xOff, int yOff, int xSize, int ySize,
+                    float* buffer, int bufXSize, int bufYSize, int level = 0) const;
+
+    // 1 + the overviews of a tiled band, 1 in memory
+    int getLevelsCount() const { return isTiled() ? source->getLevelsCount() : 1; }
+    // Size and blocks of a level, blocks of 256 x 256 in memory
+    GeoRasterSource::Level getLevel(int level) const;
 
-    void Draw() const;
+    // The pixels of a block of a level, row by row, nodata: NaN
+    // keep: false for a pass over the whole band (see GeoRasterSource)
+    bool readBlock(int level, int blockX, int blockY, std::vector<float>& pixels,
+                   int& blockWidth, int& blockHeight, bool keep = true) const;
+    // The coarsest level with at most `pixelsPerSample` pixels of the full
+    //  resolution per pixel, to read a window shrunk by that factor
+    int getLevelForScale(double pixelsPerSample) const;
+
+    // Minimum and maximum, approximate for a large tiled band
+    bool getMinMax(double& minValue, double& maxValue) const;
+
+    // Statistics and histogram, computed once then cached
+    // approx: from an overview or a sample of the blocks
+    std::shared_ptr<const GeoRasterStats> getStats(bool approx = true) const;
 
 private:
     void destroyData();
@@ -42,10 +86,21 @@ private:
 public:
     void* pData = nullptr;
     double geoTransform[6];
-    int width;
-    int height;
-    utils::DataType dataType;
+    int width = 0;
+    int height = 0;
+    utils::DataType dataType = utils::kUnknown;
 
 private:
-    OpenglRasterDescriptor* openglRasterDesc = nullptr;
+    std::shared_ptr<GeoRasterSource> source;
+    int iSourceBand = 1;
+
+    mutable bool hasMinMax = false;
+    mutable double minValue = 0.0;
+    mutable double maxValue = 0.0;
+
+    bool hasNoData = false;
+    double noDataValue = 0.0;
+
+    // The exact statistics replace the approximate ones
+    mutable std::shared_ptr<const GeoRasterStats> stats;
 };
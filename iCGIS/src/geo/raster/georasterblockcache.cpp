@@ -0,0 +1,67 @@
+#include "geo/raster/georasterblockcache.h"
+
+
+GeoRasterBlockCache* GeoRasterBlockCache::getInstance()
+{
+    static GeoRasterBlockCache instance;
+    return &instance;
+}
+
+std::shared_ptr<const GeoRasterBlock> GeoRasterBlockCache::get(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto findIt = blocks.find(key);
+    if (findIt == blocks.end())
+        return nullptr;
+    lruBlocks.splice(lruBlocks.begin(), lruBlocks, findIt->second);
+    return findIt->second->block;
+}
+
+void GeoRasterBlockCache::put(const Key& key, std::shared_ptr<const GeoRasterBlock> block)
+{
+    if (!block)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Read by two threads at once
+    if (blocks.find(key) != blocks.end())
+        return;
+
+    lruBlocks.push_front({ key, block });
+    blocks[key] = lruBlocks.begin();
+    bytes += block->data.size();
+    evict();
+}
+
+void GeoRasterBlockCache::removeSource(int sourceID)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto iter = lruBlocks.begin(); iter != lruBlocks.end();) {
+        if (iter->key.sourceID == sourceID) {
+            bytes -= iter->block->data.size();
+            blocks.erase(iter->key);
+            iter = lruBlocks.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+}
+
+void GeoRasterBlockCache::setMaxBytes(size_t bytesIn)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    maxBytes = bytesIn;
+    evict();
+}
+
+// The most recently used block is kept, even if larger than the limit
+void GeoRasterBlockCache::evict()
+{
+    while (bytes > maxBytes && lruBlocks.size() > 1) {
+        Entry& entry = lruBlocks.back();
+        bytes -= entry.block->data.size();
+        blocks.erase(entry.key);
+        lruBlocks.pop_back();
+    }
+}
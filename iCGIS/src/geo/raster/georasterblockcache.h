@@ -0,0 +1,102 @@
+/*************************************************************
+** class name:  GeoRasterBlockCache
+**
+** description: Blocks of the tiled rasters, shared by all the
+**                raster layers
+**
+**              At most `maxBytes` of pixels are kept, the least
+**                recently used blocks are dropped first. A block
+**                is held by a shared_ptr, so one being read stays
+**                valid after it is dropped
+**              Thread-safe
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <gdal/gdal.h>
+
+
+// Pixels of one block, in the data type of the band
+struct GeoRasterBlock {
+    int width = 0;
+    int height = 0;
+    GDALDataType dataType = GDT_Unknown;
+    std::vector<unsigned char> data;
+
+    const void* getRow(int y) const
+        { return data.data() + size_t(y) * width * GDALGetDataTypeSizeBytes(dataType); }
+};
+
+
+class GeoRasterBlockCache {
+public:
+    struct Key {
+        int sourceID;
+        int band;           // 1-based, as GDAL
+        int level;          // 0: full resolution, then the overviews
+        int blockX;
+        int blockY;
+
+        bool operator==(const Key& rhs) const {
+            return sourceID == rhs.sourceID && band == rhs.band && level == rhs.level
+                && blockX == rhs.blockX && blockY == rhs.blockY;
+        }
+    };
+
+public:
+    static GeoRasterBlockCache* getInstance();
+
+    // A new ID for the blocks of a source (a file, a warped raster...)
+    int newSourceID() { return nextSourceID++; }
+
+    // nullptr if not cached, the block becomes the most recently used
+    std::shared_ptr<const GeoRasterBlock> get(const Key& key);
+    // Keep a block just read, drop the least recently used ones
+    void put(const Key& key, std::shared_ptr<const GeoRasterBlock> block);
+    // Drop the blocks of a source being closed
+    void removeSource(int sourceID);
+
+    void setMaxBytes(size_t bytes);
+    size_t getMaxBytes() const { return maxBytes; }
+    size_t getBytes() const { return bytes; }
+
+private:
+    GeoRasterBlockCache() {}
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t h = size_t(key.sourceID);
+            h = h * 31 + size_t(key.band);
+            h = h * 31 + size_t(key.level);
+            h = h * 1000003 + size_t(key.blockX);
+            h = h * 1000003 + size_t(key.blockY);
+            return h;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<const GeoRasterBlock> block;
+    };
+
+    void evict();
+
+private:
+    std::mutex mutex;
+    std::atomic<int> nextSourceID{ 1 };
+    size_t maxBytes = size_t(512) * 1024 * 1024;
+    size_t bytes = 0;
+
+    // Most recently used at the front
+    std::list<Entry> lruBlocks;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> blocks;
+};
@@ -0,0 +1,525 @@
+#include "geo/raster/georastercalculator.h"
+
+#include "geo/raster/georasterband.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+
+namespace {
+
+// Pixels computed by one pass of the program, small enough for the
+//  registers of all the stack levels to stay in the cache
+const int kChunkSize = 1024;
+// Depth of the stack of the program
+const int kMaxStackSize = 64;
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+// Plain loops over a chunk, vectorized by the compiler
+template<typename Func>
+inline void unaryLoop(const float* a, float* out, int n, Func func)
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = func(a[i]);
+}
+
+template<typename Func>
+inline void binaryLoop(const float* a, const float* b, float* out, int n, Func func)
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = func(a[i], b[i]);
+}
+
+bool sameTransform(const double* lhs, const double* rhs)
+{
+    for (int i = 0; i < 6; ++i) {
+        if (std::abs(lhs[i] - rhs[i]) > 1e-9 * std::max(1.0, std::abs(lhs[i])))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+/*************************************************/
+/*                                               */
+/*              Parser                           */
+/*                                               */
+/*************************************************/
+
+bool GeoRasterCalculator::compile(const std::string& expression)
+{
+    text = expression;
+    pos = 0;
+    error.clear();
+    program.clear();
+    bandsUsed.clear();
+    stackSize = 0;
+
+    skipSpaces();
+    if (pos == text.size())
+        return fail("Empty expression");
+    if (!parseTernary())
+        return false;
+    skipSpaces();
+    if (pos != text.size())
+        return fail("Unexpected '" + text.substr(pos, 1) + "'");
+
+    // The depth of the stack at each instruction
+    int depth = 0;
+    for (const auto& instruction : program) {
+        switch (instruction.op) {
+        case kLoadBand:
+        case kConstant:
+            ++depth;
+            break;
+        case kNot: case kNeg: case kAbs: case kSqrt: case kExp: case kLog: case kLog10:
+        case kSin: case kCos: case kTan: case kFloor: case kCeil:
+            break;
+        case kSelect:
+            depth -= 2;
+            break;
+        default:
+            --depth;
+            break;
+        }
+        stackSize = std::max(stackSize, depth);
+    }
+    if (stackSize > kMaxStackSize) {
+        program.clear();
+        error = "Expression too complex";
+        return false;
+    }
+    return true;
+}
+
+bool GeoRasterCalculator::fail(const std::string& message)
+{
+    if (error.empty())
+        error = message + " (at " + std::to_string(pos + 1) + ")";
+    return false;
+}
+
+void GeoRasterCalculator::emit(OpCode op, int band /*= 0*/, float value /*= 0.0f*/)
+{
+    program.push_back({ op, band, value });
+}
+
+void GeoRasterCalculator::skipSpaces()
+{
+    while (pos < text.size() && std::isspace((unsigned char)text[pos]))
+        ++pos;
+}
+
+// The operator `token`, consumed if found
+bool GeoRasterCalculator::match(const char* token)
+{
+    skipSpaces();
+    size_t len = strlen(token);
+    if (text.compare(pos, len, token) != 0)
+        return false;
+    // "<" is not the start of "<=", "!" not of "!="
+    if (len == 1 && pos + 1 < text.size() && text[pos + 1] == '='
+        && (token[0] == '<' || token[0] == '>' || token[0] == '!' || token[0] == '='))
+        return false;
+    pos += len;
+    return true;
+}
+
+// c ? a : b
+bool GeoRasterCalculator::parseTernary()
+{
+    if (!parseOr())
+        return false;
+    if (!match("?"))
+        return true;
+    if (!parseTernary())
+        return false;
+    if (!match(":"))
+        return fail("Expected ':'");
+    if (!parseTernary())
+        return false;
+    emit(kSelect);
+    return true;
+}
+
+bool GeoRasterCalculator::parseOr()
+{
+    if (!parseAnd())
+        return false;
+    while (match("||")) {
+        if (!parseAnd())
+            return false;
+        emit(kOr);
+    }
+    return true;
+}
+
+bool GeoRasterCalculator::parseAnd()
+{
+    if (!parseComparison())
+        return false;
+    while (match("&&")) {
+        if (!parseComparison())
+            return false;
+        emit(kAnd);
+    }
+    return true;
+}
+
+bool GeoRasterCalculator::parseComparison()
+{
+    if (!parseAdditive())
+        return false;
+    for (;;) {
+        OpCode op;
+        if (match("<="))        op = kLessEqual;
+        else if (match(">="))   op = kGreaterEqual;
+        else if (match("=="))   op = kEqual;
+        else if (match("!="))   op = kNotEqual;
+        else if (match("<"))    op = kLess;
+        else if (match(">"))    op = kGreater;
+        else                    return true;
+        if (!parseAdditive())
+            return false;
+        emit(op);
+    }
+}
+
+bool GeoRasterCalculator::parseAdditive()
+{
+    if (!parseMultiplicative())
+        return false;
+    for (;;) {
+        OpCode op;
+        if (match("+"))         op = kAdd;
+        else if (match("-"))    op = kSub;
+        else                    return true;
+        if (!parseMultiplicative())
+            return false;
+        emit(op);
+    }
+}
+
+bool GeoRasterCalculator::parseMultiplicative()
+{
+    if (!parseUnary())
+        return false;
+    for (;;) {
+        OpCode op;
+        if (match("*"))         op = kMul;
+        else if (match("/"))    op = kDiv;
+        else                    return true;
+        if (!parseUnary())
+            return false;
+        emit(op);
+    }
+}
+
+bool GeoRasterCalculator::parseUnary()
+{
+    if (match("-")) {
+        if (!parseUnary())
+            return false;
+        emit(kNeg);
+        return true;
+    }
+    if (match("!")) {
+        if (!parseUnary())
+            return false;
+        emit(kNot);
+        return true;
+    }
+    if (match("+"))
+        return parseUnary();
+    return parsePower();
+}
+
+// a ^ b, right associative: 2 ^ 3 ^ 2 = 2 ^ 9
+bool GeoRasterCalculator::parsePower()
+{
+    if (!parsePrimary())
+        return false;
+    if (match("^")) {
+        if (!parseUnary())
+            return false;
+        emit(kPow);
+    }
+    return true;
+}
+
+bool GeoRasterCalculator::parsePrimary()
+{
+    skipSpaces();
+    if (pos == text.size())
+        return fail("Unexpected end");
+
+    // (expression)
+    if (match("(")) {
+        if (!parseTernary())
+            return false;
+        if (!match(")"))
+            return fail("Expected ')'");
+        return true;
+    }
+
+    // Number
+    char c = text[pos];
+    if (std::isdigit((unsigned char)c) || c == '.') {
+        const char* start = text.c_str() + pos;
+        char* end = nullptr;
+        double value = std::strtod(start, &end);
+        if (end == start)
+            return fail("Invalid number");
+        pos += size_t(end - start);
+        emit(kConstant, 0, float(value));
+        return true;
+    }
+
+    // Band or function
+    if (!std::isalpha((unsigned char)c))
+        return fail("Unexpected '" + text.substr(pos, 1) + "'");
+    size_t start = pos;
+    while (pos < text.size() && (std::isalnum((unsigned char)text[pos]) || text[pos] == '_'))
+        ++pos;
+    std::string name = text.substr(start, pos - start);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch) { return char(std::tolower(ch)); });
+
+    // b1, b2...
+    if (name.size() > 1 && name[0] == 'b'
+        && std::all_of(name.begin() + 1, name.end(), [](unsigned char ch) { return std::isdigit(ch); }))
+    {
+        int band = std::atoi(name.c_str() + 1);
+        if (band < 1 || band > int(bands.size())) {
+            pos = start;
+            return fail("No band " + name);
+        }
+        auto findIt = std::find(bandsUsed.begin(), bandsUsed.end(), band - 1);
+        int input = int(findIt - bandsUsed.begin());
+        if (findIt == bandsUsed.end())
+            bandsUsed.push_back(band - 1);
+        emit(kLoadBand, input);
+        return true;
+    }
+
+    static const struct { const char* name; int argsCount; OpCode op; } functions[] = {
+        { "abs", 1, kAbs }, { "sqrt", 1, kSqrt }, { "exp", 1, kExp }, { "log", 1, kLog },
+        { "log10", 1, kLog10 }, { "sin", 1, kSin }, { "cos", 1, kCos }, { "tan", 1, kTan },
+        { "floor", 1, kFloor }, { "ceil", 1, kCeil },
+        { "min", 2, kMin }, { "max", 2, kMax }, { "pow", 2, kPow },
+        { "if", 3, kSelect }
+    };
+    for (const auto& function : functions) {
+        if (name != function.name)
+            continue;
+        if (!match("("))
+            return fail("Expected '(' after " + name);
+        for (int i = 0; i < function.argsCount; ++i) {
+            if (i > 0 && !match(","))
+                return fail("Expected ',' in " + name);
+            if (!parseTernary())
+                return false;
+        }
+        if (!match(")"))
+            return fail("Expected ')' after the arguments of " + name);
+        emit(function.op);
+        return true;
+    }
+
+    pos = start;
+    return fail("Unknown name " + name);
+}
+
+
+/*************************************************/
+/*                                               */
+/*              Evaluation                       */
+/*                                               */
+/*************************************************/
+
+void GeoRasterCalculator::runProgram(const std::vector<const float*>& inputs, int n, float* out,
+                                     std::vector<float>& registers) const
+{
+    // The values at each depth of the stack: an input band, or the
+    //  register of the depth
+    const float* stack[kMaxStackSize];
+    int depth = 0;
+    auto reg = [&](int d) { return registers.data() + size_t(d) * kChunkSize; };
+
+    for (const auto& instruction : program) {
+        switch (instruction.op) {
+        case kLoadBand:
+            stack[depth++] = inputs[instruction.band];
+            break;
+        case kConstant: {
+            float* o = reg(depth);
+            std::fill(o, o + n, instruction.value);
+            stack[depth++] = o;
+            break;
+        }
+        case kSelect: {
+            float* o = reg(depth - 3);
+            const float* c = stack[depth - 3];
+            const float* a = stack[depth - 2];
+            const float* b = stack[depth - 1];
+            for (int i = 0; i < n; ++i)
+                o[i] = c[i] != 0.0f ? a[i] : b[i];
+            depth -= 2;
+            stack[depth - 1] = o;
+            break;
+        }
+        case kNot: case kNeg: case kAbs: case kSqrt: case kExp: case kLog: case kLog10:
+        case kSin: case kCos: case kTan: case kFloor: case kCeil: {
+            float* o = reg(depth - 1);
+            const float* a = stack[depth - 1];
+            switch (instruction.op) {
+            default: break;
+            case kNot:   unaryLoop(a, o, n, [](float x) { return x == 0.0f ? 1.0f : 0.0f; }); break;
+            case kNeg:   unaryLoop(a, o, n, [](float x) { return -x; }); break;
+            case kAbs:   unaryLoop(a, o, n, [](float x) { return std::abs(x); }); break;
+            case kSqrt:  unaryLoop(a, o, n, [](float x) { return std::sqrt(x); }); break;
+            case kExp:   unaryLoop(a, o, n, [](float x) { return std::exp(x); }); break;
+            case kLog:   unaryLoop(a, o, n, [](float x) { return std::log(x); }); break;
+            case kLog10: unaryLoop(a, o, n, [](float x) { return std::log10(x); }); break;
+            case kSin:   unaryLoop(a, o, n, [](float x) { return std::sin(x); }); break;
+            case kCos:   unaryLoop(a, o, n, [](float x) { return std::cos(x); }); break;
+            case kTan:   unaryLoop(a, o, n, [](float x) { return std::tan(x); }); break;
+            case kFloor: unaryLoop(a, o, n, [](float x) { return std::floor(x); }); break;
+            case kCeil:  unaryLoop(a, o, n, [](float x) { return std::ceil(x); }); break;
+            }
+            stack[depth - 1] = o;
+            break;
+        }
+        default: {
+            float* o = reg(depth - 2);
+            const float* a = stack[depth - 2];
+            const float* b = stack[depth - 1];
+            switch (instruction.op) {
+            default: break;
+            case kAdd:          binaryLoop(a, b, o, n, [](float x, float y) { return x + y; }); break;
+            case kSub:          binaryLoop(a, b, o, n, [](float x, float y) { return x - y; }); break;
+            case kMul:          binaryLoop(a, b, o, n, [](float x, float y) { return x * y; }); break;
+            case kDiv:          binaryLoop(a, b, o, n, [](float x, float y) { return x / y; }); break;
+            case kPow:          binaryLoop(a, b, o, n, [](float x, float y) { return std::pow(x, y); }); break;
+            case kMin:          binaryLoop(a, b, o, n, [](float x, float y) { return std::min(x, y); }); break;
+            case kMax:          binaryLoop(a, b, o, n, [](float x, float y) { return std::max(x, y); }); break;
+            case kLess:         binaryLoop(a, b, o, n, [](float x, float y) { return float(x < y); }); break;
+            case kLessEqual:    binaryLoop(a, b, o, n, [](float x, float y) { return float(x <= y); }); break;
+            case kGreater:      binaryLoop(a, b, o, n, [](float x, float y) { return float(x > y); }); break;
+            case kGreaterEqual: binaryLoop(a, b, o, n, [](float x, float y) { return float(x >= y); }); break;
+            case kEqual:        binaryLoop(a, b, o, n, [](float x, float y) { return float(x == y); }); break;
+            case kNotEqual:     binaryLoop(a, b, o, n, [](float x, float y) { return float(x != y); }); break;
+            case kAnd:          binaryLoop(a, b, o, n, [](float x, float y) { return float(x != 0.0f && y != 0.0f); }); break;
+            case kOr:           binaryLoop(a, b, o, n, [](float x, float y) { return float(x != 0.0f || y != 0.0f); }); break;
+            }
+            --depth;
+            stack[depth - 1] = o;
+            break;
+        }
+        }
+    }
+
+    if (stack[0] != out)
+        std::copy(stack[0], stack[0] + n, out);
+}
+
+bool GeoRasterCalculator::evaluate(int xOff, int yOff, int width, int height, float* out) const
+{
+    size_t count = size_t(width) * height;
+
+    // The tile of each band used
+    int inputsCount = int(bandsUsed.size());
+    std::vector<std::vector<float>> tiles(inputsCount, std::vector<float>(count));
+    for (int i = 0; i < inputsCount; ++i) {
+        if (!bands[bandsUsed[i]]->readWindow(xOff, yOff, width, height, tiles[i].data(), width, height))
+            return false;
+    }
+
+    std::vector<float> registers(size_t(std::max(stackSize, 1)) * kChunkSize);
+    std::vector<const float*> inputs(inputsCount);
+    for (size_t first = 0; first < count; first += kChunkSize) {
+        int n = int(std::min(count - first, size_t(kChunkSize)));
+        for (int i = 0; i < inputsCount; ++i)
+            inputs[i] = tiles[i].data() + first;
+        runProgram(inputs, n, out + first, registers);
+    }
+
+    // Nodata in a band used, or no result
+    for (size_t k = 0; k < count; ++k) {
+        if (!std::isfinite(out[k]))
+            out[k] = kNaN;
+    }
+    for (const auto& tile : tiles) {
+        for (size_t k = 0; k < count; ++k) {
+            if (std::isnan(tile[k]))
+                out[k] = kNaN;
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<GeoRasterWriter> GeoRasterCalculator::createWriter(const std::string& outputPath /*= ""*/)
+{
+    if (program.empty() || bands.empty()) {
+        error = "Nothing to calculate";
+        return nullptr;
+    }
+
+    // The grid of the output
+    const GeoRasterBand* refBand = bands[bandsUsed.empty() ? 0 : bandsUsed[0]];
+    for (int idx : bandsUsed) {
+        const GeoRasterBand* band = bands[idx];
+        if (band->width != refBand->width || band->height != refBand->height
+            || !sameTransform(band->geoTransform, refBand->geoTransform))
+        {
+            error = "The bands are not aligned (size or transform differ)";
+            return nullptr;
+        }
+    }
+
+    if (outputPath.empty())
+        return std::unique_ptr<GeoRasterWriter>(
+            new GeoRasterWriter(refBand->width, refBand->height, 1, refBand->geoTransform));
+    std::string projection;
+    if (refBand->isTiled())
+        projection = refBand->getSource()->getProjection();
+    return std::unique_ptr<GeoRasterWriter>(
+        new GeoRasterWriter(outputPath, refBand->width, refBand->height, 1, refBand->geoTransform, projection));
+}
+
+bool GeoRasterCalculator::run(GeoRasterWriter& writer,
+                              GDALProgressFunc progress /*= nullptr*/, void* progressArg /*= nullptr*/)
+{
+    if (program.empty()) {
+        error = "Nothing to calculate";
+        return false;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    bool ok = writer.write([this](int xOff, int yOff, int width, int height,
+                                  std::vector<std::vector<float>>& bandsPixels) {
+        return evaluate(xOff, yOff, width, height, bandsPixels[0].data());
+    }, progress, progressArg);
+    if (!ok) {
+        error = writer.getError();
+        LError("Raster calculator: {0}", error);
+        return false;
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("Raster calculator: {0} -> {1} ({2}x{3}) in {4} ms", text,
+          writer.isInMemory() ? std::string("memory") : writer.getOutputPath(),
+          writer.getWidth(), writer.getHeight(),
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+    return true;
+}
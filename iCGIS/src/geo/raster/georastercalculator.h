@@ -0,0 +1,106 @@
+/*************************************************************
+** class name:  GeoRasterCalculator
+**
+** description: Map algebra over aligned raster bands
+**
+**              An expression such as (b4 - b3) / (b4 + b3), or
+**                b1 > 100 ? 1 : 0, is compiled to a small stack
+**                program. It is run over the pixels in chunks:
+**                every instruction is one loop over a chunk, the
+**                intermediate values only hold a chunk, nothing
+**                the size of the raster is allocated
+**              The output goes through GeoRasterWriter, to a cloud
+**                optimized GeoTIFF or to a band in memory, the tiles
+**                of a block row are computed in parallel
+**              Nodata: where a band of the expression is nodata, or
+**                the result is not finite (e.g. 0 / 0)
+**
+**              Syntax: b1, b2... the bands, numbers,
+**                + - * / ^, < <= > >= == !=, && || !, c ? a : b,
+**                abs sqrt exp log log10 sin cos tan floor ceil,
+**                min(a, b) max(a, b) pow(a, b) if(c, a, b)
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gdal/gdal.h>
+
+#include "geo/raster/georasterwriter.h"
+
+
+class GeoRasterBand;
+
+class GeoRasterCalculator {
+public:
+    // bands: b1, b2... in the expression
+    GeoRasterCalculator(const std::vector<const GeoRasterBand*>& bands) : bands(bands) {}
+
+    // false if the expression is invalid, see getError()
+    bool compile(const std::string& expression);
+    const std::string& getError() const { return error; }
+
+    // The output, on the grid of the bands used (after compile()), to
+    //  `outputPath`, or in memory if it is empty
+    // nullptr if the bands used have not the same size and transform
+    std::unique_ptr<GeoRasterWriter> createWriter(const std::string& outputPath = "");
+
+    // Canceled if the progress returns FALSE
+    bool run(GeoRasterWriter& writer,
+             GDALProgressFunc progress = nullptr, void* progressArg = nullptr);
+
+    // The values of a tile, `out` has `width` x `height` pixels, nodata: NaN
+    // Thread-safe
+    bool evaluate(int xOff, int yOff, int width, int height, float* out) const;
+
+private:
+    enum OpCode {
+        kLoadBand, kConstant,
+        kAdd, kSub, kMul, kDiv, kPow, kMin, kMax,
+        kLess, kLessEqual, kGreater, kGreaterEqual, kEqual, kNotEqual,
+        kAnd, kOr, kNot, kNeg,
+        kAbs, kSqrt, kExp, kLog, kLog10, kSin, kCos, kTan, kFloor, kCeil,
+        kSelect
+    };
+
+    struct Instruction {
+        OpCode op;
+        int band;       // kLoadBand, 0-based
+        float value;    // kConstant
+    };
+
+    // The parser, recursive descent, appends to `program`
+    bool parseTernary();
+    bool parseOr();
+    bool parseAnd();
+    bool parseComparison();
+    bool parseAdditive();
+    bool parseMultiplicative();
+    bool parseUnary();
+    bool parsePower();
+    bool parsePrimary();
+    void skipSpaces();
+    bool match(const char* token);
+    bool fail(const std::string& message);
+    void emit(OpCode op, int band = 0, float value = 0.0f);
+
+    // The chunk of n pixels of `inputs` (one per band used)
+    void runProgram(const std::vector<const float*>& inputs, int n, float* out,
+                    std::vector<float>& registers) const;
+
+private:
+    std::vector<const GeoRasterBand*> bands;
+    std::string error;
+
+    // Parsing
+    std::string text;
+    size_t pos = 0;
+
+    std::vector<Instruction> program;
+    int stackSize = 0;
+    std::vector<int> bandsUsed;      // 0-based, in the order of the inputs
+};
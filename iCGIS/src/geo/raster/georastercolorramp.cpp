@@ -0,0 +1,67 @@
+#include "geo/raster/georastercolorramp.h"
+
+#include <algorithm>
+
+
+namespace {
+
+struct ColorStop {
+    float position;
+    unsigned char r, g, b;
+};
+
+const std::vector<std::vector<ColorStop>>& getPresetStops()
+{
+    // In the order of GeoRasterColorRamp::Preset
+    static const std::vector<std::vector<ColorStop>> stops = {
+        { { 0.0f, 0, 0, 0 }, { 1.0f, 255, 255, 255 } },
+        { { 0.0f, 0, 97, 71 }, { 0.15f, 16, 122, 47 }, { 0.35f, 232, 215, 125 },
+          { 0.6f, 161, 67, 0 }, { 0.85f, 130, 30, 30 }, { 1.0f, 255, 255, 255 } },
+        { { 0.0f, 43, 131, 186 }, { 0.25f, 171, 221, 164 }, { 0.5f, 255, 255, 191 },
+          { 0.75f, 253, 174, 97 }, { 1.0f, 215, 25, 28 } },
+        { { 0.0f, 68, 1, 84 }, { 0.25f, 59, 82, 139 }, { 0.5f, 33, 145, 140 },
+          { 0.75f, 94, 201, 98 }, { 1.0f, 253, 231, 37 } },
+        { { 0.0f, 0, 0, 0 }, { 0.4f, 230, 0, 0 }, { 0.8f, 255, 210, 0 }, { 1.0f, 255, 255, 255 } },
+        { { 0.0f, 5, 48, 97 }, { 0.25f, 67, 147, 195 }, { 0.5f, 247, 247, 247 },
+          { 0.75f, 214, 96, 77 }, { 1.0f, 103, 0, 31 } }
+    };
+    return stops;
+}
+
+} // namespace
+
+
+const std::vector<const char*>& GeoRasterColorRamp::getPresetNames()
+{
+    static const std::vector<const char*> names = {
+        "Gray", "Terrain", "Spectral", "Viridis", "Heat", "Blue - Red"
+    };
+    return names;
+}
+
+void GeoRasterColorRamp::buildLut(std::vector<unsigned char>& rgbaLut) const
+{
+    rgbaLut.assign(size_t(kLutSize) * 4, 255);
+
+    const auto& presets = getPresetStops();
+    const std::vector<ColorStop>& stops = presets[std::min(int(preset), int(presets.size()) - 1)];
+
+    for (int i = 0; i < kLutSize; ++i) {
+        float t = float(i) / (kLutSize - 1);
+        if (inverted)
+            t = 1.0f - t;
+        // The stops around t
+        size_t iStop = 0;
+        while (iStop + 2 < stops.size() && stops[iStop + 1].position < t)
+            ++iStop;
+        const ColorStop& s0 = stops[iStop];
+        const ColorStop& s1 = stops[iStop + 1];
+        float f = (t - s0.position) / (s1.position - s0.position);
+        f = std::min(1.0f, std::max(0.0f, f));
+
+        unsigned char* out = &rgbaLut[size_t(i) * 4];
+        out[0] = (unsigned char)(s0.r + (s1.r - s0.r) * f + 0.5f);
+        out[1] = (unsigned char)(s0.g + (s1.g - s0.g) * f + 0.5f);
+        out[2] = (unsigned char)(s0.b + (s1.b - s0.b) * f + 0.5f);
+    }
+}
@@ -0,0 +1,47 @@
+/*************************************************************
+** class name:  GeoRasterColorRamp
+**
+** description: The colors of a band drawn alone (pseudocolor)
+**
+**              The stretched value in [0, 1] picks the color in a
+**                lookup table of kLutSize entries, interpolated
+**                between a few stops. The table is a small texture
+**                sampled by the shader, changing the ramp replaces
+**                only it
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <vector>
+
+
+class GeoRasterColorRamp {
+public:
+    enum Preset {
+        kGray       = 0,    // black to white
+        kTerrain    = 1,    // green, yellow, brown, white
+        kSpectral   = 2,    // blue, green, yellow, red
+        kViridis    = 3,    // purple, blue, green, yellow
+        kHeat       = 4,    // black, red, yellow, white
+        kBlueRed    = 5     // diverging, blue, white, red
+    };
+
+    // Entries of the lookup table
+    static const int kLutSize = 256;
+
+public:
+    GeoRasterColorRamp() {}
+    GeoRasterColorRamp(Preset preset, bool inverted = false)
+        : preset(preset), inverted(inverted) {}
+
+    // The names of the presets, in the order of Preset
+    static const std::vector<const char*>& getPresetNames();
+
+    // kLutSize RGBA pixels, entry i for the value i / (kLutSize - 1)
+    void buildLut(std::vector<unsigned char>& rgbaLut) const;
+
+public:
+    Preset preset = kGray;
+    bool inverted = false;
+};
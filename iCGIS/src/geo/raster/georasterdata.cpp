@@ -1,6 +1,9 @@
 #include "geo/raster/georasterdata.h"
+#include "util/env.h"
 
-GeoRasterData::GeoRasterData(const GeoRasterData& rhs) {
+GeoRasterData::GeoRasterData(const GeoRasterData& rhs)
+    : renderBands(rhs.renderBands), stretch(rhs.stretch), colorRamp(rhs.colorRamp)
+{
     int count = rhs.bands.size();
     bands.reserve(count);
     for (int i = 0; i < count; ++i) {
@@ -12,6 +15,8 @@ GeoRasterData::~GeoRasterData()
 {
     for (auto& band : bands)
         delete band;
+    if (openglRasterDesc)
+        delete openglRasterDesc;
 }
 
 GeoExtent GeoRasterData::getExtent() const
@@ -26,10 +31,113 @@ GeoExtent GeoRasterData::getExtent() const
 void GeoRasterData::addBand(GeoRasterBand* band)
 {
     bands.emplace_back(band);
+    resetRenderBands();
 }
 
-void GeoRasterData::Draw() const {
-    for (auto& band : bands) {
-        band->Draw();
+bool GeoRasterData::setRenderBands(const std::vector<int>& bandsIn)
+{
+    int count = int(bandsIn.size());
+    if (count != 1 && count != 3 && count != 4)
+        return false;
+    for (int idx : bandsIn) {
+        if (idx < 0 || idx >= int(bands.size()))
+            return false;
     }
+    renderBands = bandsIn;
+    return true;
+}
+
+void GeoRasterData::resetRenderBands()
+{
+    renderBands.clear();
+    if (bands.empty())
+        return;
+
+    int red = -1, green = -1, blue = -1, alpha = -1;
+    int count = int(bands.size());
+    for (int i = 0; i < count; ++i) {
+        if (!bands[i]->isTiled())
+            continue;
+        GDALColorInterp interp = bands[i]->getSource()->getColorInterpretation(bands[i]->getSourceBand());
+        if (interp == GCI_RedBand && red < 0)
+            red = i;
+        else if (interp == GCI_GreenBand && green < 0)
+            green = i;
+        else if (interp == GCI_BlueBand && blue < 0)
+            blue = i;
+        else if (interp == GCI_AlphaBand && alpha < 0)
+            alpha = i;
+    }
+
+    if (red >= 0 && green >= 0 && blue >= 0) {
+        renderBands = { red, green, blue };
+        if (alpha >= 0)
+            renderBands.push_back(alpha);
+    }
+    else if (count >= 3) {
+        renderBands = { 0, 1, 2 };
+    }
+    else {
+        renderBands = { 0 };
+    }
+}
+
+bool GeoRasterData::getStretchRanges(std::vector<double>& lowHighs) const
+{
+    lowHighs.clear();
+    int count = int(renderBands.size());
+    for (int i = 0; i < count; ++i) {
+        std::shared_ptr<const GeoRasterStats> stats = bands[renderBands[i]]->getStats();
+        if (!stats)
+            return false;
+        double low = 0.0, high = stats->maxValue;
+        if (i != 3)
+            stretch.getRange(*stats, low, high);
+        lowHighs.push_back(low);
+        lowHighs.push_back(high);
+    }
+    return count > 0;
+}
+
+bool GeoRasterData::buildEqualizeLut(std::vector<unsigned char>& rgbaLut) const
+{
+    if (renderBands.empty())
+        return false;
+    const int lutSize = GeoRasterStretch::kLutSize;
+    rgbaLut.assign(size_t(lutSize) * 4, 255);
+
+    GeoRasterStretch equalize(GeoRasterStretch::kEqualize);
+    std::vector<float> lut;
+    for (int channel = 0; channel < 3; ++channel) {
+        int idx = renderBands.size() == 1 ? renderBands[0] : renderBands[channel];
+        std::shared_ptr<const GeoRasterStats> stats = bands[idx]->getStats();
+        if (!stats)
+            return false;
+        equalize.buildLut(*stats, lut);
+        for (int i = 0; i < lutSize; ++i)
+            rgbaLut[size_t(i) * 4 + channel] = (unsigned char)(lut[i] * 255.0f + 0.5f);
+    }
+    return true;
+}
+
+void GeoRasterData::setOpenglRasterDescriptor(OpenglRasterDescriptor* desc) {
+    if (openglRasterDesc)
+        delete openglRasterDesc;
+    openglRasterDesc = desc;
+}
+
+void GeoRasterData::Draw() const {
+    // No window of the raster in the view yet
+    if (!openglRasterDesc || openglRasterDesc->texs.empty())
+        return;
+    // The stretch of this raster, the shader is shared
+    const float* low = openglRasterDesc->stretchLow;
+    const float* high = openglRasterDesc->stretchHigh;
+    Env::textureShader.Bind();
+    Env::textureShader.SetUniform4f("u_stretchLow", low[0], low[1], low[2], low[3]);
+    Env::textureShader.SetUniform4f("u_stretchHigh", high[0], high[1], high[2], high[3]);
+    Env::textureShader.SetUniform1i("u_equalize", openglRasterDesc->equalize ? 1 : 0);
+    Env::textureShader.SetUniform1i("u_bandsCount", int(openglRasterDesc->bands.size()));
+    Env::renderer.DrawTexture(openglRasterDesc->vao, openglRasterDesc->ibo,
+                              openglRasterDesc->texs, Env::textureShader);
 }
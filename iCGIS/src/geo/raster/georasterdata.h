@@ -3,11 +3,19 @@
 **
 ** description: Raster data
 **
-** last change: 2020-03-25
+**              Drawn as one float texture of the raw values: a band
+**                alone through a color ramp, or three bands packed in
+**                red, green, blue (and a fourth in alpha)
+**              Stretched on the GPU, nodata (NaN) transparent
+**
+** last change: 2020-04-09
 *************************************************************************/
 #pragma once
 
 #include "geo/raster/georasterband.h"
+#include "geo/raster/georastercolorramp.h"
+#include "geo/raster/georasterstretch.h"
+#include "opengl/openglrasterdescriptor.h"
 #include <vector>
 
 
@@ -23,6 +31,33 @@ public:
 
     void addBand(GeoRasterBand* band);
 
+    // The bands drawn (0-based): 1 gray, 3 RGB, 4 RGBA
+    const std::vector<int>& getRenderBands() const { return renderBands; }
+    bool setRenderBands(const std::vector<int>& bandsIn);
+    // From the color interpretation of the bands: the red, green, blue
+    //  (and alpha) bands, else the first three bands, else the first band
+    void resetRenderBands();
+
+    const GeoRasterStretch& getStretch() const { return stretch; }
+    void setStretch(const GeoRasterStretch& stretchIn) { stretch = stretchIn; ++styleVersion; }
+    // The colors of a band drawn alone
+    const GeoRasterColorRamp& getColorRamp() const { return colorRamp; }
+    void setColorRamp(const GeoRasterColorRamp& rampIn) { colorRamp = rampIn; ++styleVersion; }
+    // Changes with the stretch and the color ramp, the uniforms and the
+    //  table of the ramp are sent again, never the pixels
+    int getStyleVersion() const { return styleVersion; }
+
+    // [low, high] of the stretch of each band drawn, mapped to [0, 1] by
+    //  the shader (alpha: [0, maximum])
+    bool getStretchRanges(std::vector<double>& lowHighs) const;
+    // The equalization tables of the bands drawn, GeoRasterStretch::kLutSize
+    //  RGBA pixels over [minimum, maximum] of each band: the red band in
+    //  red... (gray: the band in all three)
+    bool buildEqualizeLut(std::vector<unsigned char>& rgbaLut) const;
+
+    void setOpenglRasterDescriptor(OpenglRasterDescriptor* desc);
+    OpenglRasterDescriptor* getOpenglRasterDescriptor() const { return openglRasterDesc; }
+
     void Draw() const;
 
     std::vector<GeoRasterBand*>::iterator begin() { return bands.begin(); }
@@ -30,6 +65,10 @@ public:
 
 private:
     std::vector<GeoRasterBand*> bands;
-};
-
+    std::vector<int> renderBands;
+    GeoRasterStretch stretch;
+    GeoRasterColorRamp colorRamp;
+    int styleVersion = 0;
 
+    OpenglRasterDescriptor* openglRasterDesc = nullptr;
+};
@@ -0,0 +1,264 @@
+#include "geo/raster/georastersource.h"
+
+#include "util/logger.h"
+
+#include <algorithm>
+#include <climits>
+
+
+namespace {
+
+// Size of the blocks of a striped file
+const int kStripBlockSize = 256;
+
+} // namespace
+
+
+GeoRasterSource::~GeoRasterSource()
+{
+    GeoRasterBlockCache::getInstance()->removeSource(id);
+    if (poDS)
+        GDALClose(poDS);
+}
+
+std::shared_ptr<GeoRasterSource> GeoRasterSource::open(const std::string& path)
+{
+    GDALAllRegister();
+    GDALDataset* poDS = (GDALDataset*)GDALOpenEx(path.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY,
+                                                 nullptr, nullptr, nullptr);
+    if (!poDS) {
+        LError("Open raster {0} error", path);
+        return nullptr;
+    }
+    if (poDS->GetRasterCount() < 1) {
+        LError("No band in {0}", path);
+        GDALClose(poDS);
+        return nullptr;
+    }
+
+    std::shared_ptr<GeoRasterSource> source(new GeoRasterSource());
+    source->id = GeoRasterBlockCache::getInstance()->newSourceID();
+    source->path = path;
+    source->poDS = poDS;
+    source->bandsCount = poDS->GetRasterCount();
+    source->initLevels();
+    if (poDS->GetGeoTransform(source->geoTransform) != CE_None) {
+        // Pixel coordinates, north up
+        double pixelTransform[6] = { 0.0, 1.0, 0.0, double(source->getHeight()), 0.0, -1.0 };
+        std::copy(pixelTransform, pixelTransform + 6, source->geoTransform);
+    }
+    const char* pszProjection = poDS->GetProjectionRef();
+    if (pszProjection)
+        source->projection = pszProjection;
+
+    const Level& level0 = source->levels[0];
+    LInfo("Raster {0}: {1}x{2}, {3} band(s), blocks {4}x{5}, {6} overview(s)", path,
+          level0.width, level0.height, source->bandsCount, level0.blockXSize, level0.blockYSize,
+          source->levels.size() - 1);
+
+    return source;
+}
+
+bool GeoRasterSource::reopen()
+{
+    GDALDataset* poNewDS = (GDALDataset*)GDALOpenEx(path.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY,
+                                                    nullptr, nullptr, nullptr);
+    if (!poNewDS) {
+        LError("Reopen raster {0} error", path);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        GDALClose(poDS);
+        poDS = poNewDS;
+        initLevels();
+    }
+    // The blocks of the levels which changed
+    GeoRasterBlockCache::getInstance()->removeSource(id);
+
+    LInfo("Raster {0} reopened, {1} overview(s)", path, levels.size() - 1);
+    return true;
+}
+
+bool GeoRasterSource::buildOverviews(const std::string& path, const char* resampling,
+                                     GDALProgressFunc progress /*= nullptr*/, void* progressArg /*= nullptr*/)
+{
+    GDALAllRegister();
+    // Read-only: the overviews go to a *.ovr sidecar, the file is not touched
+    GDALDataset* poDS = (GDALDataset*)GDALOpenEx(path.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY,
+                                                 nullptr, nullptr, nullptr);
+    if (!poDS) {
+        LError("Open raster {0} error", path);
+        return false;
+    }
+
+    // Halved until the coarsest fits in a block
+    std::vector<int> factors;
+    int maxSize = std::max(poDS->GetRasterXSize(), poDS->GetRasterYSize());
+    for (int factor = 2; maxSize / (factor / 2) > kStripBlockSize; factor *= 2)
+        factors.push_back(factor);
+    if (factors.empty()) {
+        LInfo("Raster {0} is small, no overview needed", path);
+        GDALClose(poDS);
+        return true;
+    }
+
+    // The blocks of the sidecar are compressed by several threads
+    CPLSetThreadLocalConfigOption("GDAL_NUM_THREADS", "ALL_CPUS");
+    CPLSetThreadLocalConfigOption("COMPRESS_OVERVIEW", "DEFLATE");
+    CPLErr err = poDS->BuildOverviews(resampling, int(factors.size()), factors.data(),
+                                      0, nullptr, progress, progressArg);
+    CPLSetThreadLocalConfigOption("GDAL_NUM_THREADS", nullptr);
+    CPLSetThreadLocalConfigOption("COMPRESS_OVERVIEW", nullptr);
+    GDALClose(poDS);
+
+    if (err != CE_None) {
+        LError("Build overviews of {0} error", path);
+        return false;
+    }
+    LInfo("Built {0} overview(s) of {1} ({2})", factors.size(), path, resampling);
+    return true;
+}
+
+void GeoRasterSource::initLevels()
+{
+    // The overviews present in all the bands
+    int overviewsCount = INT_MAX;
+    for (int iBand = 1; iBand <= bandsCount; ++iBand)
+        overviewsCount = std::min(overviewsCount, poDS->GetRasterBand(iBand)->GetOverviewCount());
+
+    levels.clear();
+    for (int iLevel = 0; iLevel <= overviewsCount; ++iLevel) {
+        GDALRasterBand* poBand = getGDALBand(1, iLevel);
+        if (!poBand)
+            break;
+
+        Level level;
+        level.width = poBand->GetXSize();
+        level.height = poBand->GetYSize();
+        if (level.width < 1 || level.height < 1)
+            break;
+
+        // The natural blocks of the first band, the same for the others
+        //  in most files
+        int naturalXSize = 0, naturalYSize = 0;
+        poBand->GetBlockSize(&naturalXSize, &naturalYSize);
+        naturalXSize = std::max(1, naturalXSize);
+        naturalYSize = std::max(1, naturalYSize);
+        if (naturalXSize >= level.width && naturalYSize < kStripBlockSize) {
+            // Strips: whole strips in height, so each strip is read by one block row
+            level.blockXSize = std::min(level.width, kStripBlockSize);
+            level.blockYSize = (kStripBlockSize + naturalYSize - 1) / naturalYSize * naturalYSize;
+        }
+        else {
+            level.blockXSize = naturalXSize;
+            level.blockYSize = naturalYSize;
+        }
+        level.blockXSize = std::min(level.blockXSize, level.width);
+        level.blockYSize = std::min(level.blockYSize, level.height);
+        levels.push_back(level);
+    }
+
+    dataTypes.clear();
+    hasNoData.clear();
+    noDataValues.clear();
+    colorInterps.clear();
+    for (int iBand = 1; iBand <= bandsCount; ++iBand) {
+        GDALRasterBand* poBand = poDS->GetRasterBand(iBand);
+        int bHasNoData = FALSE;
+        double noDataValue = poBand->GetNoDataValue(&bHasNoData);
+        dataTypes.push_back(poBand->GetRasterDataType());
+        hasNoData.push_back(bHasNoData);
+        noDataValues.push_back(noDataValue);
+        colorInterps.push_back(poBand->GetColorInterpretation());
+    }
+}
+
+GDALRasterBand* GeoRasterSource::getGDALBand(int iBand, int level) const
+{
+    GDALRasterBand* poBand = poDS->GetRasterBand(iBand);
+    if (poBand && level > 0)
+        return poBand->GetOverview(level - 1);
+    return poBand;
+}
+
+void GeoRasterSource::getGeoTransform(double geoTransformOut[6]) const
+{
+    std::copy(geoTransform, geoTransform + 6, geoTransformOut);
+}
+
+GDALDataType GeoRasterSource::getDataType(int iBand) const
+{
+    if (iBand < 1 || iBand > bandsCount)
+        return GDT_Unknown;
+    return dataTypes[iBand - 1];
+}
+
+bool GeoRasterSource::getNoDataValue(int iBand, double& noDataValue) const
+{
+    if (iBand < 1 || iBand > bandsCount || !hasNoData[iBand - 1])
+        return false;
+    noDataValue = noDataValues[iBand - 1];
+    return true;
+}
+
+GDALColorInterp GeoRasterSource::getColorInterpretation(int iBand) const
+{
+    if (iBand < 1 || iBand > bandsCount)
+        return GCI_Undefined;
+    return colorInterps[iBand - 1];
+}
+
+std::shared_ptr<const GeoRasterBlock> GeoRasterSource::getBlock(int iBand, int level, int blockX, int blockY,
+                                                               bool keep /*= true*/)
+{
+    if (iBand < 1 || iBand > bandsCount || level < 0 || level >= int(levels.size()))
+        return nullptr;
+    const Level& levelInfo = levels[level];
+    if (blockX < 0 || blockX >= levelInfo.getBlocksX() || blockY < 0 || blockY >= levelInfo.getBlocksY())
+        return nullptr;
+
+    GeoRasterBlockCache* cache = GeoRasterBlockCache::getInstance();
+    GeoRasterBlockCache::Key key = { id, iBand, level, blockX, blockY };
+    std::shared_ptr<const GeoRasterBlock> cached = cache->get(key);
+    if (cached)
+        return cached;
+
+    int xOff = blockX * levelInfo.blockXSize;
+    int yOff = blockY * levelInfo.blockYSize;
+    std::shared_ptr<GeoRasterBlock> block = std::make_shared<GeoRasterBlock>();
+    block->width = std::min(levelInfo.blockXSize, levelInfo.width - xOff);
+    block->height = std::min(levelInfo.blockYSize, levelInfo.height - yOff);
+    block->dataType = getDataType(iBand);
+    block->data.resize(size_t(block->width) * block->height * GDALGetDataTypeSizeBytes(block->dataType));
+
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        GDALRasterBand* poBand = getGDALBand(iBand, level);
+        CPLErr err = poBand ? poBand->RasterIO(GF_Read, xOff, yOff, block->width, block->height,
+                                               block->data.data(), block->width, block->height,
+                                               block->dataType, 0, 0)
+                            : CE_Failure;
+        if (err != CE_None) {
+            LError("Read block ({0}, {1}) of level {2} of band {3} of {4} error",
+                   blockX, blockY, level, iBand, path);
+            return nullptr;
+        }
+    }
+
+    if (keep)
+        cache->put(key, block);
+    return block;
+}
+
+bool GeoRasterSource::getMinMax(int iBand, double& minValue, double& maxValue)
+{
+    if (iBand < 1 || iBand > bandsCount)
+        return false;
+
+    std::lock_guard<std::mutex> lock(ioMutex);
+    double mean, stdDev;
+    CPLErr err = poDS->GetRasterBand(iBand)->GetStatistics(TRUE, TRUE, &minValue, &maxValue, &mean, &stdDev);
+    return err == CE_None;
+}
@@ -0,0 +1,111 @@
+/*************************************************************
+** class name:  GeoRasterSource
+**
+** description: A raster file opened through GDAL, read by
+**                blocks on demand
+**
+**              The blocks are aligned to the natural blocks of
+**                the file (tiles of a tiled GeoTIFF). The strips
+**                of a striped file are grouped into blocks about
+**                256 x 256
+**              A block is read by one windowed RasterIO and kept
+**                in GeoRasterBlockCache
+**              Levels: 0 is the full resolution, then the overviews
+**                of the file (internal, or a *.ovr sidecar), from the
+**                finest to the coarsest. A zoomed out view reads a
+**                coarse level, so a few blocks
+**              Shared by the bands of the file (and by the copies
+**                of the layer), GDAL handles are not thread-safe:
+**                the reads are serialized
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gdal/gdal_priv.h>
+
+#include "geo/raster/georasterblockcache.h"
+
+
+class GeoRasterSource {
+public:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        int blockXSize = 256;
+        int blockYSize = 256;
+
+        int getBlocksX() const { return (width + blockXSize - 1) / blockXSize; }
+        int getBlocksY() const { return (height + blockYSize - 1) / blockYSize; }
+    };
+
+public:
+    ~GeoRasterSource();
+
+    // nullptr if it could not be opened or has no band
+    static std::shared_ptr<GeoRasterSource> open(const std::string& path);
+
+    // Build the overviews of a file in a *.ovr sidecar (or in the file if
+    //  it can be updated), halving the size down to about 256 pixels
+    // resampling: "AVERAGE", "MODE", "NEAREST"...
+    // The sources of the file must be reopened to see them
+    static bool buildOverviews(const std::string& path, const char* resampling,
+                               GDALProgressFunc progress = nullptr, void* progressArg = nullptr);
+    // Open the file again, e.g. after its overviews were built
+    bool reopen();
+
+    int getID() const { return id; }
+    const std::string& getPath() const { return path; }
+    int getWidth() const { return levels[0].width; }
+    int getHeight() const { return levels[0].height; }
+    int getBandsCount() const { return bandsCount; }
+    int getLevelsCount() const { return int(levels.size()); }
+    const Level& getLevel(int level) const { return levels[level]; }
+    void getGeoTransform(double geoTransformOut[6]) const;
+    // WKT, empty if unknown
+    const std::string& getProjection() const { return projection; }
+
+    // iBand: 1-based, as GDAL
+    GDALDataType getDataType(int iBand) const;
+    // false if the band has no nodata value
+    bool getNoDataValue(int iBand, double& noDataValue) const;
+    // Red, green, blue, alpha... to compose the bands by default
+    GDALColorInterp getColorInterpretation(int iBand) const;
+
+    // From the cache, read if missing, nullptr on error
+    // The blocks on the right and bottom edges are smaller
+    // keep: false for a pass over the whole band, the block read is not
+    //  kept in the cache (the view's blocks stay)
+    std::shared_ptr<const GeoRasterBlock> getBlock(int iBand, int level, int blockX, int blockY,
+                                                   bool keep = true);
+
+    // Minimum and maximum of a band (approximate if the file is large)
+    bool getMinMax(int iBand, double& minValue, double& maxValue);
+
+private:
+    GeoRasterSource() {}
+
+    // The levels and the bands of the dataset, poDS is set
+    void initLevels();
+    GDALRasterBand* getGDALBand(int iBand, int level) const;
+
+private:
+    int id = 0;
+    std::string path;
+    GDALDataset* poDS = nullptr;
+    std::mutex ioMutex;
+
+    int bandsCount = 0;
+    std::vector<Level> levels;
+    std::vector<GDALDataType> dataTypes;
+    std::vector<int> hasNoData;
+    std::vector<double> noDataValues;
+    std::vector<GDALColorInterp> colorInterps;
+    double geoTransform[6] = { 0.0, 1.0, 0.0, 0.0, 0.0, -1.0 };
+    std::string projection;
+};
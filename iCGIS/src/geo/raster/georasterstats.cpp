@@ -0,0 +1,189 @@
+#include "geo/raster/georasterstats.h"
+
+#include "geo/raster/georasterband.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+namespace {
+
+const int kHistogramBins = 1024;
+// Pixels read for approximate statistics
+const double kApproxPixels = 4.0 * 1024 * 1024;
+
+// The sums of a range of blocks
+struct PartialStats {
+    size_t count = 0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;            // sum of the squared differences to the mean
+    std::vector<size_t> histogram;
+    bool ok = true;
+};
+
+// Chan et al., the variance of the union of two sets
+void mergeStats(PartialStats& to, const PartialStats& from)
+{
+    if (from.count == 0)
+        return;
+    if (to.count == 0) {
+        to.count = from.count;
+        to.minValue = from.minValue;
+        to.maxValue = from.maxValue;
+        to.mean = from.mean;
+        to.m2 = from.m2;
+    }
+    else {
+        double n = double(to.count + from.count);
+        double delta = from.mean - to.mean;
+        to.mean += delta * from.count / n;
+        to.m2 += from.m2 + delta * delta * double(to.count) * double(from.count) / n;
+        to.count += from.count;
+        to.minValue = std::min(to.minValue, from.minValue);
+        to.maxValue = std::max(to.maxValue, from.maxValue);
+    }
+    for (size_t i = 0; i < to.histogram.size(); ++i)
+        to.histogram[i] += from.histogram[i];
+}
+
+} // namespace
+
+
+std::shared_ptr<GeoRasterStats> GeoRasterStats::compute(const GeoRasterBand* band, bool approx)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    // The range of the histogram
+    double histMin = 0.0, histMax = 0.0;
+    if (!band->getMinMax(histMin, histMax))
+        return nullptr;
+    if (histMax <= histMin)
+        histMax = histMin + 1.0;
+
+    // The level read, and one block out of `blockStep`
+    int level = 0;
+    int blockStep = 1;
+    if (approx) {
+        int levelsCount = band->getLevelsCount();
+        while (level + 1 < levelsCount) {
+            GeoRasterSource::Level levelInfo = band->getLevel(level);
+            if (double(levelInfo.width) * levelInfo.height <= kApproxPixels)
+                break;
+            ++level;
+        }
+        GeoRasterSource::Level levelInfo = band->getLevel(level);
+        blockStep = std::max(1, int(double(levelInfo.width) * levelInfo.height / kApproxPixels));
+    }
+    GeoRasterSource::Level levelInfo = band->getLevel(level);
+    int blocksX = levelInfo.getBlocksX();
+    int blocksCount = blocksX * levelInfo.getBlocksY();
+    int blocksRead = (blocksCount + blockStep - 1) / blockStep;
+
+    // Contiguous ranges of blocks, several per thread to balance them
+    int chunksCount = std::min(blocksRead, utils::getNumThreads() * 4);
+    std::vector<PartialStats> partials(chunksCount);
+    double binScale = kHistogramBins / (histMax - histMin);
+
+    utils::parallelFor(0, chunksCount, [&](int chunk) {
+        PartialStats& partial = partials[chunk];
+        partial.histogram.assign(kHistogramBins, 0);
+        std::vector<float> pixels;
+        int first = int(size_t(blocksRead) * chunk / chunksCount);
+        int last = int(size_t(blocksRead) * (chunk + 1) / chunksCount);
+        for (int i = first; i < last && partial.ok; ++i) {
+            int blockIndex = i * blockStep;
+            int blockWidth = 0, blockHeight = 0;
+            if (!band->readBlock(level, blockIndex % blocksX, blockIndex / blocksX,
+                                 pixels, blockWidth, blockHeight, false)) {
+                partial.ok = false;
+                break;
+            }
+            for (float pixel : pixels) {
+                if (std::isnan(pixel))
+                    continue;
+                double value = pixel;
+                // Welford
+                ++partial.count;
+                double delta = value - partial.mean;
+                partial.mean += delta / double(partial.count);
+                partial.m2 += delta * (value - partial.mean);
+                if (partial.count == 1) {
+                    partial.minValue = partial.maxValue = value;
+                }
+                else {
+                    partial.minValue = std::min(partial.minValue, value);
+                    partial.maxValue = std::max(partial.maxValue, value);
+                }
+                int bin = int((value - histMin) * binScale);
+                ++partial.histogram[std::min(kHistogramBins - 1, std::max(0, bin))];
+            }
+        }
+    }, 1);
+
+    PartialStats total;
+    total.histogram.assign(kHistogramBins, 0);
+    for (const auto& partial : partials) {
+        if (!partial.ok) {
+            LError("Read the blocks of the raster band error");
+            return nullptr;
+        }
+        mergeStats(total, partial);
+    }
+    if (total.count == 0)
+        return nullptr;
+
+    std::shared_ptr<GeoRasterStats> stats = std::make_shared<GeoRasterStats>();
+    stats->approx = approx && (level > 0 || blockStep > 1);
+    stats->count = total.count;
+    stats->minValue = total.minValue;
+    stats->maxValue = total.maxValue;
+    stats->mean = total.mean;
+    stats->stdDev = std::sqrt(total.m2 / double(total.count));
+    stats->histMin = histMin;
+    stats->histMax = histMax;
+    stats->histogram = std::move(total.histogram);
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("Raster statistics{0}: {1} pixels of level {2} in {3} ms", stats->approx ? " (approx)" : "",
+          stats->count, level,
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+
+    return stats;
+}
+
+double GeoRasterStats::getPercentile(double percent) const
+{
+    double target = std::min(100.0, std::max(0.0, percent)) / 100.0 * double(count);
+    double binWidth = getBinWidth();
+    double cumulative = 0.0;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        double next = cumulative + double(histogram[i]);
+        if (next >= target && histogram[i] > 0) {
+            double value = histMin + (i + (target - cumulative) / double(histogram[i])) * binWidth;
+            return std::min(maxValue, std::max(minValue, value));
+        }
+        cumulative = next;
+    }
+    return maxValue;
+}
+
+double GeoRasterStats::getCumulative(double value) const
+{
+    if (count == 0)
+        return 0.0;
+    double pos = (value - histMin) / getBinWidth();
+    if (pos <= 0.0)
+        return 0.0;
+    size_t bin = std::min(histogram.size(), size_t(pos));
+    double cumulative = 0.0;
+    for (size_t i = 0; i < bin; ++i)
+        cumulative += double(histogram[i]);
+    if (bin < histogram.size())
+        cumulative += (pos - double(bin)) * double(histogram[bin]);
+    return cumulative / double(count);
+}
@@ -0,0 +1,53 @@
+/*************************************************************
+** class name:  GeoRasterStats
+**
+** description: Statistics and histogram of a raster band
+**
+**              Computed in one pass over the blocks of the band:
+**                the blocks are shared out between threads, each
+**                sums its blocks (count, mean, variance, histogram)
+**                and the sums are merged at the end
+**              The histogram spans the minimum and maximum known
+**                before the pass (the GDAL statistics of a file),
+**                the pixels outside fall in the first or last bin
+**              Nodata pixels are not counted
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+class GeoRasterBand;
+
+class GeoRasterStats {
+public:
+    // nullptr if the band could not be read or has only nodata
+    // approx: the finest level of at most a few million pixels, one
+    //  block out of n if there is no such overview
+    static std::shared_ptr<GeoRasterStats> compute(const GeoRasterBand* band, bool approx);
+
+    // The value below which `percent` (0 - 100) of the pixels are,
+    //  interpolated in the bin
+    double getPercentile(double percent) const;
+    // Fraction (0 - 1) of the pixels below `value`
+    double getCumulative(double value) const;
+
+    // Width of a bin of the histogram
+    double getBinWidth() const { return (histMax - histMin) / histogram.size(); }
+
+public:
+    bool approx = false;
+    size_t count = 0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+    double mean = 0.0;
+    double stdDev = 0.0;
+
+    double histMin = 0.0;
+    double histMax = 0.0;
+    std::vector<size_t> histogram;
+};
@@ -0,0 +1,35 @@
+#include "geo/raster/georasterstretch.h"
+
+#include <algorithm>
+
+
+void GeoRasterStretch::getRange(const GeoRasterStats& stats, double& low, double& high) const
+{
+    low = stats.minValue;
+    high = stats.maxValue;
+    if (mode == kPercentile) {
+        low = stats.getPercentile(lowPercent);
+        high = stats.getPercentile(highPercent);
+    }
+}
+
+void GeoRasterStretch::buildLut(const GeoRasterStats& stats, std::vector<float>& lut) const
+{
+    lut.resize(kLutSize);
+
+    double low, high;
+    getRange(stats, low, high);
+
+    double range = stats.maxValue - stats.minValue;
+    for (int i = 0; i < kLutSize; ++i) {
+        double value = stats.minValue + range * i / (kLutSize - 1);
+        double out = 0.0;
+        if (mode == kEqualize)
+            out = stats.getCumulative(value);
+        else if (high > low)
+            out = (value - low) / (high - low);
+        else
+            out = value >= high ? 1.0 : 0.0;
+        lut[i] = float(std::min(1.0, std::max(0.0, out)));
+    }
+}
@@ -0,0 +1,50 @@
+/*************************************************************
+** class name:  GeoRasterStretch
+**
+** description: How the values of a band are mapped to colors
+**
+**              The texture holds the raw values, the shader maps
+**                [low, high] to [0, 1] (uniforms), so changing the
+**                stretch uploads nothing
+**              Histogram equalization is a lookup table over
+**                [minimum, maximum] of the statistics, built with the
+**                texture, and applied after the linear mapping
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include "geo/raster/georasterstats.h"
+
+#include <vector>
+
+
+class GeoRasterStretch {
+public:
+    enum Mode {
+        kMinMax         = 0,    // linear between the minimum and maximum
+        kPercentile     = 1,    // linear between two percentiles
+        kEqualize       = 2     // histogram equalization
+    };
+
+    // Entries of the lookup table
+    static const int kLutSize = 4096;
+
+public:
+    GeoRasterStretch() {}
+    GeoRasterStretch(Mode mode, double lowPercent = 2.0, double highPercent = 98.0)
+        : mode(mode), lowPercent(lowPercent), highPercent(highPercent) {}
+
+    // The values mapped to 0 and 1: the minimum and maximum, the
+    //  percentiles, or the whole range for the equalization
+    void getRange(const GeoRasterStats& stats, double& low, double& high) const;
+
+    // kLutSize values in [0, 1]: entry i for the value at i / (kLutSize - 1)
+    //  of [stats.minValue, stats.maxValue]
+    void buildLut(const GeoRasterStats& stats, std::vector<float>& lut) const;
+
+public:
+    Mode mode = kMinMax;
+    double lowPercent = 2.0;
+    double highPercent = 98.0;
+};
@@ -0,0 +1,189 @@
+#include "geo/raster/georasterterrain.h"
+
+#include "geo/raster/georasterband.h"
+#include "util/logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+namespace {
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+const float kRadToDeg = float(180.0 / 3.14159265358979323846);
+const double kDegToRad = 3.14159265358979323846 / 180.0;
+
+const char* productName(GeoRasterTerrain::Product product)
+{
+    switch (product) {
+    default:                            return "";
+    case GeoRasterTerrain::kSlope:      return "slope";
+    case GeoRasterTerrain::kAspect:     return "aspect";
+    case GeoRasterTerrain::kHillshade:  return "hillshade";
+    case GeoRasterTerrain::kCurvature:  return "curvature";
+    }
+}
+
+// The window of a pixel of a row: r0, r1, r2 are the rows above, at and
+//  below it, the pixel is at i + 1
+//   a b c
+//   d e f
+//   g h k
+// Gradient (Horn): p toward the east, q toward the north
+template<typename Func>
+inline void kernelRow(const float* r0, const float* r1, const float* r2, float* out, int n,
+                      float kx, float ky, Func func)
+{
+    for (int i = 0; i < n; ++i) {
+        float a = r0[i], b = r0[i + 1], c = r0[i + 2];
+        float d = r1[i], e = r1[i + 1], f = r1[i + 2];
+        float g = r2[i], h = r2[i + 1], k = r2[i + 2];
+        float p = ((c + 2.0f * f + k) - (a + 2.0f * d + g)) * kx;
+        float q = ((a + 2.0f * b + c) - (g + 2.0f * h + k)) * ky;
+        out[i] = func(p, q, b, d, e, f, h);
+    }
+}
+
+} // namespace
+
+
+bool GeoRasterTerrain::computeTile(int xOff, int yOff, int width, int height, float* out) const
+{
+    int demWidth = dem->width;
+    int demHeight = dem->height;
+
+    // The window with its halo, inside the DEM
+    int x0 = std::max(0, xOff - 1);
+    int y0 = std::max(0, yOff - 1);
+    int x1 = std::min(demWidth, xOff + width + 1);
+    int y1 = std::min(demHeight, yOff + height + 1);
+    int windowWidth = x1 - x0;
+    int windowHeight = y1 - y0;
+    std::vector<float> window(size_t(windowWidth) * windowHeight);
+    if (!dem->readWindow(x0, y0, windowWidth, windowHeight, window.data(), windowWidth, windowHeight))
+        return false;
+
+    // The tile with the halo, out of the DEM: its edge replicated
+    int paddedWidth = width + 2;
+    std::vector<float> padded(size_t(paddedWidth) * (height + 2));
+    for (int j = 0; j < height + 2; ++j) {
+        int row = std::min(std::max(yOff - 1 + j, 0), demHeight - 1) - y0;
+        const float* src = window.data() + size_t(row) * windowWidth;
+        float* dst = padded.data() + size_t(j) * paddedWidth;
+        for (int i = 0; i < paddedWidth; ++i) {
+            int col = std::min(std::max(xOff - 1 + i, 0), demWidth - 1) - x0;
+            dst[i] = src[col];
+        }
+    }
+
+    // The size of a pixel in z units, the rows go south if the transform
+    //  is north up
+    const double* gt = dem->geoTransform;
+    double xRes = std::abs(gt[1]) * scale;
+    double yRes = std::abs(gt[5]) * scale;
+    float kx = float(zFactor / (8.0 * xRes) * (gt[1] > 0.0 ? 1.0 : -1.0));
+    float ky = float(zFactor / (8.0 * yRes) * (gt[5] < 0.0 ? 1.0 : -1.0));
+
+    // Hillshade: the light, (east, north, up)
+    float lightX = float(std::cos(altitude * kDegToRad) * std::sin(azimuth * kDegToRad));
+    float lightY = float(std::cos(altitude * kDegToRad) * std::cos(azimuth * kDegToRad));
+    float lightZ = float(std::sin(altitude * kDegToRad));
+    // Curvature
+    float cx = float(zFactor / (xRes * xRes));
+    float cy = float(zFactor / (yRes * yRes));
+
+    for (int j = 0; j < height; ++j) {
+        const float* r0 = padded.data() + size_t(j) * paddedWidth;
+        const float* r1 = r0 + paddedWidth;
+        const float* r2 = r1 + paddedWidth;
+        float* o = out + size_t(j) * width;
+
+        switch (product) {
+        case kSlope:
+            kernelRow(r0, r1, r2, o, width, kx, ky,
+                [](float p, float q, float, float, float, float, float) {
+                    return std::atan(std::sqrt(p * p + q * q)) * kRadToDeg;
+                });
+            break;
+        case kAspect:
+            kernelRow(r0, r1, r2, o, width, kx, ky,
+                [](float p, float q, float, float, float, float, float) {
+                    // The direction of the steepest descent, -(p, q)
+                    float angle = std::atan2(-p, -q) * kRadToDeg;
+                    angle = angle < 0.0f ? angle + 360.0f : angle;
+                    return (p == 0.0f && q == 0.0f) ? kNaN : angle;
+                });
+            break;
+        case kHillshade:
+            kernelRow(r0, r1, r2, o, width, kx, ky,
+                [=](float p, float q, float, float, float, float, float) {
+                    // The normal (-p, -q, 1) . the light
+                    float shade = (lightZ - p * lightX - q * lightY) / std::sqrt(1.0f + p * p + q * q);
+                    return 255.0f * std::max(shade, 0.0f);
+                });
+            break;
+        case kCurvature:
+            kernelRow(r0, r1, r2, o, width, kx, ky,
+                [=](float, float, float b, float d, float e, float f, float h) {
+                    float curvatureX = ((d + f) * 0.5f - e) * cx;
+                    float curvatureY = ((b + h) * 0.5f - e) * cy;
+                    return -200.0f * (curvatureX + curvatureY);
+                });
+            break;
+        }
+    }
+
+    // A nodata pixel in the window: NaN above, NaN if it was -inf...
+    size_t count = size_t(width) * height;
+    for (size_t k = 0; k < count; ++k) {
+        if (!std::isfinite(out[k]))
+            out[k] = kNaN;
+    }
+    return true;
+}
+
+std::unique_ptr<GeoRasterWriter> GeoRasterTerrain::createWriter(const std::string& outputPath /*= ""*/)
+{
+    if (!dem || dem->width <= 0 || dem->height <= 0) {
+        error = "No DEM";
+        return nullptr;
+    }
+    if (outputPath.empty())
+        return std::unique_ptr<GeoRasterWriter>(new GeoRasterWriter(dem->width, dem->height, 1, dem->geoTransform));
+    std::string projection;
+    if (dem->isTiled())
+        projection = dem->getSource()->getProjection();
+    return std::unique_ptr<GeoRasterWriter>(
+        new GeoRasterWriter(outputPath, dem->width, dem->height, 1, dem->geoTransform, projection));
+}
+
+bool GeoRasterTerrain::run(GeoRasterWriter& writer,
+                           GDALProgressFunc progress /*= nullptr*/, void* progressArg /*= nullptr*/)
+{
+    if (!dem || writer.getWidth() != dem->width || writer.getHeight() != dem->height) {
+        error = "No DEM";
+        return false;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    bool ok = writer.write([this](int xOff, int yOff, int width, int height,
+                                  std::vector<std::vector<float>>& bandsPixels) {
+        return computeTile(xOff, yOff, width, height, bandsPixels[0].data());
+    }, progress, progressArg);
+    if (!ok) {
+        error = writer.getError();
+        LError("Terrain {0}: {1}", productName(product), error);
+        return false;
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("Terrain {0}: {1} ({2}x{3}) in {4} ms", productName(product),
+          writer.isInMemory() ? std::string("memory") : writer.getOutputPath(),
+          dem->width, dem->height,
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+    return true;
+}
@@ -0,0 +1,81 @@
+/*************************************************************
+** class name:  GeoRasterTerrain
+**
+** description: Slope, aspect, hillshade and curvature of a DEM
+**
+**              3 x 3 kernels (Horn's gradient, Zevenbergen and
+**                Thorne's curvature) over tiles of 256 x 256. A
+**                tile reads its window with a halo of one pixel,
+**                from the blocks cached (so shared with the tiles
+**                around), the edges of the DEM are replicated
+**              A kernel is one plain loop over a row of the tile,
+**                without branch, vectorized by the compiler
+**              The tiles of a block row are computed in parallel,
+**                and go through GeoRasterWriter: to a cloud optimized
+**                GeoTIFF, or to a band in memory
+**              Nodata: where a pixel of the 3 x 3 window is nodata,
+**                the aspect of a flat pixel
+**
+**              Slope: degrees. Aspect: degrees clockwise from the
+**                north, the direction the slope faces. Hillshade:
+**                0 - 255. Curvature: 1/100 z unit, < 0 convex
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <gdal/gdal.h>
+
+#include "geo/raster/georasterwriter.h"
+
+
+class GeoRasterBand;
+
+class GeoRasterTerrain {
+public:
+    enum Product {
+        kSlope,
+        kAspect,
+        kHillshade,
+        kCurvature
+    };
+
+public:
+    GeoRasterTerrain(const GeoRasterBand* dem, Product product)
+        : dem(dem), product(product) {}
+
+    // Vertical exaggeration
+    void setZFactor(double zFactorIn) { zFactor = zFactorIn; }
+    // Vertical units per horizontal unit, e.g. 111120 for a DEM in
+    //  degrees with the elevations in meters
+    void setScale(double scaleIn) { scale = scaleIn; }
+    // The light of the hillshade, in degrees: the azimuth clockwise from
+    //  the north, the altitude above the horizon
+    void setLight(double azimuthIn, double altitudeIn) { azimuth = azimuthIn; altitude = altitudeIn; }
+
+    const std::string& getError() const { return error; }
+
+    // The values of a tile, `out` has `width` x `height` pixels, nodata: NaN
+    // Thread-safe
+    bool computeTile(int xOff, int yOff, int width, int height, float* out) const;
+
+    // The output, on the grid of the DEM, to `outputPath`, or in memory
+    //  if it is empty
+    std::unique_ptr<GeoRasterWriter> createWriter(const std::string& outputPath = "");
+
+    // Canceled if the progress returns FALSE
+    bool run(GeoRasterWriter& writer,
+             GDALProgressFunc progress = nullptr, void* progressArg = nullptr);
+
+private:
+    const GeoRasterBand* dem;
+    Product product;
+    double zFactor = 1.0;
+    double scale = 1.0;
+    double azimuth = 315.0;
+    double altitude = 45.0;
+    std::string error;
+};
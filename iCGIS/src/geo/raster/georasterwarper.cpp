@@ -0,0 +1,520 @@
+#include "geo/raster/georasterwarper.h"
+
+#include "geo/raster/georasterband.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+
+#include <gdal/gdal_priv.h>
+#include <gdal/cpl_conv.h>
+#include <gdal/ogr_spatialref.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+
+// Output pixels between the points transformed exactly
+const int kApproxStep = 16;
+// Largest error of an interpolated source pixel, in pixels
+const double kMaxApproxError = 0.125;
+// Points per side of the grid over the source, to find the output extent
+const int kExtentSamples = 21;
+// Largest window read from the source for one tile (a tile over a
+//  pole or the antimeridian may cover the whole source)
+const int kMaxReadSize = 2048;
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+struct TransformationDeleter {
+    void operator()(OGRCoordinateTransformation* poCT) const
+        { OGRCoordinateTransformation::DestroyCT(poCT); }
+};
+using TransformationPtr = std::unique_ptr<OGRCoordinateTransformation, TransformationDeleter>;
+
+// One per thread, a transformation is not thread-safe
+// nullptr if a coordinate system is invalid
+TransformationPtr createTransformation(const std::string& fromWkt, const std::string& toWkt)
+{
+    OGRSpatialReference fromSRS;
+    OGRSpatialReference toSRS;
+    if (fromWkt.empty() || toWkt.empty()
+        || fromSRS.SetFromUserInput(fromWkt.c_str()) != OGRERR_NONE
+        || toSRS.SetFromUserInput(toWkt.c_str()) != OGRERR_NONE)
+        return nullptr;
+#if GDAL_VERSION_MAJOR >= 3
+    // x: easting / longitude, as the geotransforms
+    fromSRS.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+    toSRS.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+#endif
+    return TransformationPtr(OGRCreateCoordinateTransformation(&fromSRS, &toSRS));
+}
+
+// Cubic convolution (Keys, a = -0.5)
+inline double cubicWeight(double t)
+{
+    t = std::abs(t);
+    if (t < 1.0)
+        return (1.5 * t - 2.5) * t * t + 1.0;
+    if (t < 2.0)
+        return ((-0.5 * t + 2.5) * t - 4.0) * t + 2.0;
+    return 0.0;
+}
+
+// The pixels read from the source for a tile, sampled at coordinates
+//  of the window (the center of its pixel (i, j) is (i + 0.5, j + 0.5))
+// Out of the window: the pixels of the edge
+// Nodata (NaN) pixels are skipped, NaN if all are
+struct SourceWindow {
+    const float* pixels;
+    int width;
+    int height;
+
+    float at(int x, int y) const {
+        x = std::min(std::max(x, 0), width - 1);
+        y = std::min(std::max(y, 0), height - 1);
+        return pixels[size_t(y) * width + x];
+    }
+
+    float nearest(double x, double y) const {
+        return at(int(std::floor(x)), int(std::floor(y)));
+    }
+
+    float bilinear(double x, double y) const {
+        x -= 0.5;
+        y -= 0.5;
+        int x0 = int(std::floor(x));
+        int y0 = int(std::floor(y));
+        double fx = x - x0;
+        double fy = y - y0;
+        double weights[4] = { (1.0 - fx) * (1.0 - fy), fx * (1.0 - fy), (1.0 - fx) * fy, fx * fy };
+        float values[4] = { at(x0, y0), at(x0 + 1, y0), at(x0, y0 + 1), at(x0 + 1, y0 + 1) };
+        double sum = 0.0;
+        double weightSum = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            if (!std::isnan(values[k])) {
+                sum += weights[k] * values[k];
+                weightSum += weights[k];
+            }
+        }
+        return weightSum > 0.0 ? float(sum / weightSum) : kNaN;
+    }
+
+    // Bilinear next to a nodata pixel
+    float cubic(double x, double y) const {
+        double cx = x - 0.5;
+        double cy = y - 0.5;
+        int x0 = int(std::floor(cx));
+        int y0 = int(std::floor(cy));
+        double wx[4], wy[4];
+        for (int k = 0; k < 4; ++k) {
+            wx[k] = cubicWeight(cx - (x0 - 1 + k));
+            wy[k] = cubicWeight(cy - (y0 - 1 + k));
+        }
+        double sum = 0.0;
+        for (int j = 0; j < 4; ++j) {
+            double rowSum = 0.0;
+            for (int i = 0; i < 4; ++i) {
+                float value = at(x0 - 1 + i, y0 - 1 + j);
+                if (std::isnan(value))
+                    return bilinear(x, y);
+                rowSum += wx[i] * value;
+            }
+            sum += wy[j] * rowSum;
+        }
+        return float(sum);
+    }
+};
+
+// The positions of the grid over [0, size), the last pixel included
+std::vector<int> gridPositions(int size, int step)
+{
+    std::vector<int> positions;
+    for (int pos = 0; pos < size - 1; pos += step)
+        positions.push_back(pos);
+    positions.push_back(size - 1);
+    return positions;
+}
+
+} // namespace
+
+
+GeoRasterWarper::GeoRasterWarper(const std::vector<const GeoRasterBand*>& bands, const std::string& srcWkt)
+    : bands(bands), srcWkt(srcWkt)
+{
+    std::fill(srcInvTransform, srcInvTransform + 6, 0.0);
+    if (!bands.empty()) {
+        srcWidth = bands[0]->width;
+        srcHeight = bands[0]->height;
+        if (!GDALInvGeoTransform(const_cast<double*>(bands[0]->geoTransform), srcInvTransform))
+            srcWidth = srcHeight = 0;
+    }
+}
+
+GeoRasterWarper::~GeoRasterWarper()
+{
+}
+
+void GeoRasterWarper::getGeoTransform(double geoTransformOut[6]) const
+{
+    std::copy(geoTransform, geoTransform + 6, geoTransformOut);
+}
+
+bool GeoRasterWarper::setTarget(const std::string& dstWktIn, Resampling resamplingIn, double resolution /*= 0.0*/)
+{
+    width = height = 0;
+
+    if (bands.empty() || srcWidth <= 0 || srcHeight <= 0) {
+        error = "No band, or its transform can't be inverted";
+        return false;
+    }
+    TransformationPtr poCT = createTransformation(srcWkt, dstWktIn);
+    if (!poCT) {
+        error = srcWkt.empty() ? "The coordinate system of the raster is unknown"
+                               : "Invalid coordinate system, or no transformation to it";
+        return false;
+    }
+
+    // A grid over the source, edges included: the output covers all of
+    //  it (a pole inside the source too)
+    const double* srcTransform = bands[0]->geoTransform;
+    std::vector<double> xs, ys;
+    for (int j = 0; j < kExtentSamples; ++j) {
+        double py = double(srcHeight) * j / (kExtentSamples - 1);
+        for (int i = 0; i < kExtentSamples; ++i) {
+            double px = double(srcWidth) * i / (kExtentSamples - 1);
+            xs.push_back(srcTransform[0] + px * srcTransform[1] + py * srcTransform[2]);
+            ys.push_back(srcTransform[3] + px * srcTransform[4] + py * srcTransform[5]);
+        }
+    }
+    int pointsCount = int(xs.size());
+    std::vector<int> success(pointsCount, FALSE);
+    poCT->TransformEx(pointsCount, xs.data(), ys.data(), nullptr, success.data());
+
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+    for (int k = 0; k < pointsCount; ++k) {
+        if (!success[k] || !std::isfinite(xs[k]) || !std::isfinite(ys[k]))
+            continue;
+        minX = std::min(minX, xs[k]);
+        maxX = std::max(maxX, xs[k]);
+        minY = std::min(minY, ys[k]);
+        maxY = std::max(maxY, ys[k]);
+    }
+    if (minX >= maxX || minY >= maxY) {
+        error = "The raster can't be transformed to this coordinate system";
+        return false;
+    }
+
+    // About the pixels of the source along the diagonal
+    if (resolution <= 0.0)
+        resolution = std::hypot(maxX - minX, maxY - minY) / std::hypot(srcWidth, srcHeight);
+    double outWidth = std::ceil((maxX - minX) / resolution);
+    double outHeight = std::ceil((maxY - minY) / resolution);
+    if (!(outWidth >= 1.0 && outHeight >= 1.0) || outWidth > INT_MAX / 2 || outHeight > INT_MAX / 2) {
+        error = "Invalid resolution, the output would be too large";
+        return false;
+    }
+
+    width = int(outWidth);
+    height = int(outHeight);
+    double outTransform[6] = { minX, resolution, 0.0, maxY, 0.0, -resolution };
+    std::copy(outTransform, outTransform + 6, geoTransform);
+    dstWkt = dstWktIn;
+    resampling = resamplingIn;
+
+    LInfo("Warp {0}x{1} -> {2}x{3}, resolution {4}", srcWidth, srcHeight, width, height, resolution);
+    return true;
+}
+
+bool GeoRasterWarper::mapWindow(int xOff, int yOff, int windowWidth, int windowHeight,
+                                std::vector<double>& srcX, std::vector<double>& srcY) const
+{
+    TransformationPtr poCT = createTransformation(dstWkt, srcWkt);
+    if (!poCT)
+        return false;
+
+    // Pixels of the window in, pixels of the source out (NaN if failed)
+    auto transform = [&](std::vector<double>& xs, std::vector<double>& ys) {
+        int count = int(xs.size());
+        if (count == 0)
+            return;
+        for (int k = 0; k < count; ++k) {
+            xs[k] = geoTransform[0] + (xOff + xs[k] + 0.5) * geoTransform[1];
+            ys[k] = geoTransform[3] + (yOff + ys[k] + 0.5) * geoTransform[5];
+        }
+        std::vector<int> success(count, FALSE);
+        poCT->TransformEx(count, xs.data(), ys.data(), nullptr, success.data());
+        for (int k = 0; k < count; ++k) {
+            double x = xs[k];
+            double y = ys[k];
+            if (!success[k] || !std::isfinite(x) || !std::isfinite(y)) {
+                xs[k] = ys[k] = std::numeric_limits<double>::quiet_NaN();
+                continue;
+            }
+            xs[k] = srcInvTransform[0] + x * srcInvTransform[1] + y * srcInvTransform[2];
+            ys[k] = srcInvTransform[3] + x * srcInvTransform[4] + y * srcInvTransform[5];
+        }
+    };
+
+    size_t pixelsCount = size_t(windowWidth) * windowHeight;
+    srcX.assign(pixelsCount, std::numeric_limits<double>::quiet_NaN());
+    srcY.assign(pixelsCount, std::numeric_limits<double>::quiet_NaN());
+
+    // The pixels transformed exactly
+    std::vector<size_t> exactPixels;
+    auto transformExact = [&]() {
+        std::vector<double> xs(exactPixels.size());
+        std::vector<double> ys(exactPixels.size());
+        for (size_t k = 0; k < exactPixels.size(); ++k) {
+            xs[k] = double(exactPixels[k] % windowWidth);
+            ys[k] = double(exactPixels[k] / windowWidth);
+        }
+        transform(xs, ys);
+        for (size_t k = 0; k < exactPixels.size(); ++k) {
+            srcX[exactPixels[k]] = xs[k];
+            srcY[exactPixels[k]] = ys[k];
+        }
+    };
+
+    for (int step = kApproxStep; step > 1 && windowWidth > 1 && windowHeight > 1; step /= 2) {
+        std::vector<int> cols = gridPositions(windowWidth, step);
+        std::vector<int> rows = gridPositions(windowHeight, step);
+        int gridWidth = int(cols.size());
+        int gridHeight = int(rows.size());
+        int cellsCount = (gridWidth - 1) * (gridHeight - 1);
+
+        // The points of the grid, then the middles of its cells
+        std::vector<double> xs, ys;
+        xs.reserve(gridWidth * gridHeight + cellsCount);
+        ys.reserve(gridWidth * gridHeight + cellsCount);
+        for (int r = 0; r < gridHeight; ++r) {
+            for (int c = 0; c < gridWidth; ++c) {
+                xs.push_back(cols[c]);
+                ys.push_back(rows[r]);
+            }
+        }
+        for (int r = 0; r + 1 < gridHeight; ++r) {
+            for (int c = 0; c + 1 < gridWidth; ++c) {
+                xs.push_back(0.5 * (cols[c] + cols[c + 1]));
+                ys.push_back(0.5 * (rows[r] + rows[r + 1]));
+            }
+        }
+        transform(xs, ys);
+
+        // The middles interpolated from the corners
+        bool accurate = true;
+        for (int r = 0; r + 1 < gridHeight && accurate; ++r) {
+            for (int c = 0; c + 1 < gridWidth; ++c) {
+                int corner = r * gridWidth + c;
+                int corners[4] = { corner, corner + 1, corner + gridWidth, corner + gridWidth + 1 };
+                int middle = gridWidth * gridHeight + r * (gridWidth - 1) + c;
+                double x = 0.0, y = 0.0;
+                for (int k : corners) {
+                    x += 0.25 * xs[k];
+                    y += 0.25 * ys[k];
+                }
+                // Not comparable, transformed exactly below
+                if (std::isnan(x) || std::isnan(xs[middle]))
+                    continue;
+                if (std::hypot(x - xs[middle], y - ys[middle]) > kMaxApproxError) {
+                    accurate = false;
+                    break;
+                }
+            }
+        }
+        if (!accurate)
+            continue;
+
+        for (int r = 0; r + 1 < gridHeight; ++r) {
+            int y0 = rows[r], y1 = rows[r + 1];
+            // The last row and column of the window belong to the last cells
+            int yEnd = (r + 2 == gridHeight) ? y1 : y1 - 1;
+            for (int c = 0; c + 1 < gridWidth; ++c) {
+                int x0 = cols[c], x1 = cols[c + 1];
+                int xEnd = (c + 2 == gridWidth) ? x1 : x1 - 1;
+                int corner = r * gridWidth + c;
+                double ax = xs[corner], bx = xs[corner + 1];
+                double cx = xs[corner + gridWidth], dx = xs[corner + gridWidth + 1];
+                double ay = ys[corner], by = ys[corner + 1];
+                double cy = ys[corner + gridWidth], dy = ys[corner + gridWidth + 1];
+                bool cornersOk = !std::isnan(ax) && !std::isnan(bx) && !std::isnan(cx) && !std::isnan(dx);
+
+                for (int y = y0; y <= yEnd; ++y) {
+                    double fy = double(y - y0) / (y1 - y0);
+                    for (int x = x0; x <= xEnd; ++x) {
+                        size_t k = size_t(y) * windowWidth + x;
+                        if (!cornersOk) {
+                            exactPixels.push_back(k);
+                            continue;
+                        }
+                        double fx = double(x - x0) / (x1 - x0);
+                        srcX[k] = (ax * (1.0 - fx) + bx * fx) * (1.0 - fy) + (cx * (1.0 - fx) + dx * fx) * fy;
+                        srcY[k] = (ay * (1.0 - fx) + by * fx) * (1.0 - fy) + (cy * (1.0 - fx) + dy * fx) * fy;
+                    }
+                }
+            }
+        }
+        transformExact();
+        return true;
+    }
+
+    // Too distorted to interpolate, all exactly
+    exactPixels.resize(pixelsCount);
+    for (size_t k = 0; k < pixelsCount; ++k)
+        exactPixels[k] = k;
+    transformExact();
+    return true;
+}
+
+bool GeoRasterWarper::warpTile(int tileX, int tileY, std::vector<std::vector<float>>& bandsPixels,
+                               int& tileWidth, int& tileHeight) const
+{
+    if (bands.empty() || width <= 0 || tileX < 0 || tileY < 0 || tileX >= getTilesX() || tileY >= getTilesY())
+        return false;
+
+    int xOff = tileX * kTileSize;
+    int yOff = tileY * kTileSize;
+    tileWidth = std::min(kTileSize, width - xOff);
+    tileHeight = std::min(kTileSize, height - yOff);
+    size_t pixelsCount = size_t(tileWidth) * tileHeight;
+    bandsPixels.resize(bands.size());
+    for (auto& pixels : bandsPixels)
+        pixels.assign(pixelsCount, kNaN);
+
+    std::vector<double> srcX, srcY;
+    if (!mapWindow(xOff, yOff, tileWidth, tileHeight, srcX, srcY))
+        return false;
+
+    // The source pixels covered
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+    for (size_t k = 0; k < pixelsCount; ++k) {
+        // NaN fails too
+        if (!(srcX[k] >= 0.0 && srcX[k] < srcWidth && srcY[k] >= 0.0 && srcY[k] < srcHeight)) {
+            srcX[k] = std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+        minX = std::min(minX, srcX[k]);
+        maxX = std::max(maxX, srcX[k]);
+        minY = std::min(minY, srcY[k]);
+        maxY = std::max(maxY, srcY[k]);
+    }
+    // Out of the source
+    if (minX > maxX)
+        return true;
+
+    // Source pixels per output pixel, from the neighbours of a sample
+    //  of the pixels, to read the level of about that resolution
+    double scaleSum = 0.0;
+    int scalesCount = 0;
+    for (int j = 0; j + 1 < tileHeight; j += kApproxStep) {
+        for (int i = 0; i + 1 < tileWidth; i += kApproxStep) {
+            size_t k = size_t(j) * tileWidth + i;
+            if (std::isnan(srcX[k]) || std::isnan(srcX[k + 1]) || std::isnan(srcX[k + tileWidth]))
+                continue;
+            double scaleX = std::hypot(srcX[k + 1] - srcX[k], srcY[k + 1] - srcY[k]);
+            double scaleY = std::hypot(srcX[k + tileWidth] - srcX[k], srcY[k + tileWidth] - srcY[k]);
+            scaleSum += std::min(scaleX, scaleY);
+            ++scalesCount;
+        }
+    }
+    double scale = scalesCount > 0 ? scaleSum / scalesCount : 1.0;
+
+    // The window read, with room for the kernel
+    int margin = resampling == kNearest ? 1 : 2;
+    int x0 = std::max(0, int(std::floor(minX)) - margin);
+    int y0 = std::max(0, int(std::floor(minY)) - margin);
+    int x1 = std::min(srcWidth, int(std::ceil(maxX)) + margin);
+    int y1 = std::min(srcHeight, int(std::ceil(maxY)) + margin);
+    int windowWidth = x1 - x0;
+    int windowHeight = y1 - y0;
+
+    std::vector<float> buffer;
+    for (size_t b = 0; b < bands.size(); ++b) {
+        const GeoRasterBand* band = bands[b];
+        int level = band->getLevelForScale(scale);
+        GeoRasterSource::Level levelInfo = band->getLevel(level);
+        int bufWidth = int(std::ceil(double(windowWidth) * levelInfo.width / srcWidth));
+        int bufHeight = int(std::ceil(double(windowHeight) * levelInfo.height / srcHeight));
+        bufWidth = std::min(kMaxReadSize, std::max(1, bufWidth));
+        bufHeight = std::min(kMaxReadSize, std::max(1, bufHeight));
+        buffer.resize(size_t(bufWidth) * bufHeight);
+        if (!band->readWindow(x0, y0, windowWidth, windowHeight, buffer.data(), bufWidth, bufHeight, level))
+            return false;
+
+        SourceWindow window = { buffer.data(), bufWidth, bufHeight };
+        double toBufferX = double(bufWidth) / windowWidth;
+        double toBufferY = double(bufHeight) / windowHeight;
+        float* out = bandsPixels[b].data();
+        for (size_t k = 0; k < pixelsCount; ++k) {
+            if (std::isnan(srcX[k]))
+                continue;
+            double x = (srcX[k] - x0) * toBufferX;
+            double y = (srcY[k] - y0) * toBufferY;
+            switch (resampling) {
+            case kNearest:
+                out[k] = window.nearest(x, y);
+                break;
+            case kBilinear:
+                out[k] = window.bilinear(x, y);
+                break;
+            case kCubic:
+                out[k] = window.cubic(x, y);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<GeoRasterWriter> GeoRasterWarper::createWriter(const std::string& outputPath /*= ""*/)
+{
+    if (width <= 0 || height <= 0) {
+        error = "No target, see setTarget()";
+        return nullptr;
+    }
+    int bandsCount = int(bands.size());
+    if (outputPath.empty())
+        return std::unique_ptr<GeoRasterWriter>(new GeoRasterWriter(width, height, bandsCount, geoTransform));
+    return std::unique_ptr<GeoRasterWriter>(
+        new GeoRasterWriter(outputPath, width, height, bandsCount, geoTransform, dstWkt));
+}
+
+bool GeoRasterWarper::run(GeoRasterWriter& writer,
+                          GDALProgressFunc progress /*= nullptr*/, void* progressArg /*= nullptr*/)
+{
+    if (width <= 0 || height <= 0 || writer.getWidth() != width || writer.getHeight() != height) {
+        error = "No target, see setTarget()";
+        return false;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // The tiles of the writer are the tiles of the warper
+    static_assert(GeoRasterWriter::kTileSize == kTileSize, "Tiles of the writer and of the warper differ");
+    bool ok = writer.write([this](int xOff, int yOff, int, int,
+                                  std::vector<std::vector<float>>& bandsPixels) {
+        int tileWidth = 0, tileHeight = 0;
+        return warpTile(xOff / kTileSize, yOff / kTileSize, bandsPixels, tileWidth, tileHeight);
+    }, progress, progressArg);
+    if (!ok) {
+        error = writer.getError();
+        LError("Warp: {0}", error);
+        return false;
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("Warp: {0} ({1} band(s), {2}x{3}) in {4} ms",
+          writer.isInMemory() ? std::string("memory") : writer.getOutputPath(),
+          bands.size(), width, height,
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+    return true;
+}
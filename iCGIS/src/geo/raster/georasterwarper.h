@@ -0,0 +1,109 @@
+/*************************************************************
+** class name:  GeoRasterWarper
+**
+** description: Reprojection and resampling of the bands of a
+**                raster into another coordinate system
+**
+**              The output grid covers the source once transformed,
+**                at about the same number of pixels (or a given
+**                resolution). It is split in tiles of 256 x 256,
+**                warped independently, so in parallel
+**              For a tile, only a coarse grid of its pixels is
+**                transformed by OGR (every 16 pixels), the source
+**                pixel of the others is interpolated between them.
+**                The grid is refined where the error is more than
+**                0.125 pixel (near a pole, a strong distortion...)
+**              The source is read from the level of about the
+**                output resolution, the overview when zoomed out
+**              Resampling: nearest, bilinear, cubic. The nodata
+**                pixels are skipped, the output nodata is NaN
+**
+**              The tiles go to a GeoRasterWriter (run): a cloud
+**                optimized GeoTIFF, or bands in memory
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gdal/gdal.h>
+
+#include "geo/raster/georasterwriter.h"
+
+
+class GeoRasterBand;
+
+class GeoRasterWarper {
+public:
+    enum Resampling {
+        kNearest,
+        kBilinear,
+        kCubic
+    };
+
+    static const int kTileSize = 256;
+
+public:
+    // bands: aligned, e.g. the bands of one raster
+    // srcWkt: their coordinate system
+    GeoRasterWarper(const std::vector<const GeoRasterBand*>& bands, const std::string& srcWkt);
+    ~GeoRasterWarper();
+
+    // The output grid, in the coordinate system `dstWkt`
+    // resolution: size of an output pixel, 0 to keep about the number
+    //  of pixels of the source
+    // false if a coordinate system is invalid or the source can't be
+    //  transformed, see getError()
+    bool setTarget(const std::string& dstWkt, Resampling resampling, double resolution = 0.0);
+    const std::string& getError() const { return error; }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getBandsCount() const { return int(bands.size()); }
+    int getTilesX() const { return (width + kTileSize - 1) / kTileSize; }
+    int getTilesY() const { return (height + kTileSize - 1) / kTileSize; }
+    void getGeoTransform(double geoTransformOut[6]) const;
+    const std::string& getProjection() const { return dstWkt; }
+
+    // The pixels of a tile of all the bands, row by row, nodata: NaN
+    // The tiles on the right and bottom edges are smaller
+    // Thread-safe
+    bool warpTile(int tileX, int tileY, std::vector<std::vector<float>>& bandsPixels,
+                  int& tileWidth, int& tileHeight) const;
+
+    // The output, on the target grid (after setTarget()), to `outputPath`,
+    //  or in memory if it is empty
+    std::unique_ptr<GeoRasterWriter> createWriter(const std::string& outputPath = "");
+
+    // Write all the tiles, a block row at a time, the tiles of a row
+    //  warped in parallel
+    // Canceled if the progress returns FALSE
+    bool run(GeoRasterWriter& writer,
+             GDALProgressFunc progress = nullptr, void* progressArg = nullptr);
+
+private:
+    // The source pixel (full resolution) at the center of each pixel of
+    //  the output window, NaN if it can't be transformed
+    bool mapWindow(int xOff, int yOff, int windowWidth, int windowHeight,
+                   std::vector<double>& srcX, std::vector<double>& srcY) const;
+
+private:
+    std::vector<const GeoRasterBand*> bands;
+    std::string srcWkt;
+    std::string dstWkt;
+    Resampling resampling = kNearest;
+    std::string error;
+
+    // Source
+    int srcWidth = 0;
+    int srcHeight = 0;
+    double srcInvTransform[6];
+
+    // Output
+    int width = 0;
+    int height = 0;
+    double geoTransform[6] = { 0.0, 1.0, 0.0, 0.0, 0.0, -1.0 };
+};
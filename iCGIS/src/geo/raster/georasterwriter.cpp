@@ -0,0 +1,299 @@
+#include "geo/raster/georasterwriter.h"
+
+#include "geo/raster/georasterband.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+
+#include <gdal/gdal_priv.h>
+#include <gdal/cpl_conv.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+
+const double GeoRasterWriter::kNoDataValue = -3.4028234663852886e+38;   // -FLT_MAX
+
+namespace {
+
+// Share of the progress of the tiles, the rest is the overviews and
+//  the copy
+const double kTilesProgress = 0.8;
+const double kOverviewsProgress = 0.9;
+
+// A stage of the progress: [from, to] of the caller's
+struct ProgressRange {
+    GDALProgressFunc progress;
+    void* progressArg;
+    double from;
+    double to;
+    bool canceled;
+};
+
+int CPL_STDCALL rangeProgress(double complete, const char* message, void* arg)
+{
+    ProgressRange* range = static_cast<ProgressRange*>(arg);
+    if (!range->progress)
+        return TRUE;
+    if (!range->progress(range->from + complete * (range->to - range->from), message, range->progressArg)) {
+        range->canceled = true;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// ZSTD if this GDAL was built with it
+const char* getCompression(GDALDriver* poDriver)
+{
+    const char* pszOptions = poDriver->GetMetadataItem(GDAL_DMD_CREATIONOPTIONLIST);
+    return (pszOptions && strstr(pszOptions, "ZSTD")) ? "ZSTD" : "DEFLATE";
+}
+
+} // namespace
+
+
+GeoRasterWriter::GeoRasterWriter(const std::string& outputPath, int width, int height, int bandsCount,
+                                 const double geoTransform[6], const std::string& projection)
+    : outputPath(outputPath), tempPath(outputPath + ".tmp.tif"),
+      width(width), height(height), bandsCount(bandsCount), projection(projection)
+{
+    std::copy(geoTransform, geoTransform + 6, this->geoTransform);
+}
+
+GeoRasterWriter::GeoRasterWriter(int width, int height, int bandsCount, const double geoTransform[6])
+    : width(width), height(height), bandsCount(bandsCount)
+{
+    std::copy(geoTransform, geoTransform + 6, this->geoTransform);
+}
+
+GeoRasterWriter::~GeoRasterWriter()
+{
+    if (tempDs) {
+        GDALClose(tempDs);
+        VSIUnlink(tempPath.c_str());
+    }
+    for (float* data : bandsData)
+        delete[] data;
+}
+
+bool GeoRasterWriter::write(const TileFunc& computeTile,
+                            GDALProgressFunc progress /*= nullptr*/, void* progressArg /*= nullptr*/)
+{
+    if (width <= 0 || height <= 0 || bandsCount <= 0) {
+        error = "Empty output";
+        return false;
+    }
+
+    if (isInMemory()) {
+        for (int b = 0; b < bandsCount; ++b) {
+            float* data = new (std::nothrow) float[size_t(width) * height];
+            if (!data) {
+                error = "Not enough memory, output to a file";
+                discard();
+                return false;
+            }
+            bandsData.push_back(data);
+        }
+        if (!writeTiles(computeTile, progress, progressArg)) {
+            discard();
+            return false;
+        }
+        return true;
+    }
+
+    ProgressRange tilesRange = { progress, progressArg, 0.0, kTilesProgress, false };
+    if (!createTemporary() || !writeTiles(computeTile, rangeProgress, &tilesRange)
+        || !finish(progress, progressArg))
+    {
+        discard();
+        return false;
+    }
+    return true;
+}
+
+std::vector<GeoRasterBand*> GeoRasterWriter::takeBands()
+{
+    std::vector<GeoRasterBand*> bands;
+    for (float* data : bandsData) {
+        GeoRasterBand* band = new GeoRasterBand(width, height);
+        std::copy(geoTransform, geoTransform + 6, band->geoTransform);
+        band->setData(data, utils::kFloat);
+        bands.push_back(band);
+    }
+    bandsData.clear();
+    return bands;
+}
+
+bool GeoRasterWriter::createTemporary()
+{
+    GDALAllRegister();
+    GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    if (!poDriver) {
+        error = "No GTiff driver";
+        return false;
+    }
+
+    // Only read again by the copy: fast compression
+    const char* compression = getCompression(poDriver);
+    char** papszOptions = nullptr;
+    papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+    papszOptions = CSLSetNameValue(papszOptions, "BLOCKXSIZE", std::to_string(kTileSize).c_str());
+    papszOptions = CSLSetNameValue(papszOptions, "BLOCKYSIZE", std::to_string(kTileSize).c_str());
+    papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", compression);
+    papszOptions = CSLSetNameValue(papszOptions, strcmp(compression, "ZSTD") == 0 ? "ZSTD_LEVEL" : "ZLEVEL", "1");
+    papszOptions = CSLSetNameValue(papszOptions, "NUM_THREADS", "ALL_CPUS");
+    papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+    if (bandsCount > 1)
+        papszOptions = CSLSetNameValue(papszOptions, "INTERLEAVE", "BAND");
+    tempDs = poDriver->Create(tempPath.c_str(), width, height, bandsCount, GDT_Float32, papszOptions);
+    CSLDestroy(papszOptions);
+    if (!tempDs) {
+        error = "Create " + tempPath + " failed";
+        return false;
+    }
+
+    tempDs->SetGeoTransform(geoTransform);
+    if (!projection.empty())
+        tempDs->SetProjection(projection.c_str());
+    for (int iBand = 1; iBand <= bandsCount; ++iBand)
+        tempDs->GetRasterBand(iBand)->SetNoDataValue(kNoDataValue);
+    return true;
+}
+
+bool GeoRasterWriter::writeTiles(const TileFunc& computeTile, GDALProgressFunc progress, void* progressArg)
+{
+    bool inMemory = isInMemory();
+
+    // A block row at a time: its tiles in parallel, then written at once
+    int tilesX = (width + kTileSize - 1) / kTileSize;
+    int tilesY = (height + kTileSize - 1) / kTileSize;
+    std::vector<std::vector<float>> rowBuffers(inMemory ? 0 : bandsCount);
+    for (int tileY = 0; tileY < tilesY; ++tileY) {
+        int yOff = tileY * kTileSize;
+        int rowHeight = std::min(kTileSize, height - yOff);
+        for (auto& rowBuffer : rowBuffers)
+            rowBuffer.resize(size_t(width) * rowHeight);
+
+        std::vector<char> tilesOk(tilesX, 0);
+        utils::parallelFor(0, tilesX, [&](int tileX) {
+            int xOff = tileX * kTileSize;
+            int tileWidth = std::min(kTileSize, width - xOff);
+            size_t tilePixels = size_t(tileWidth) * rowHeight;
+            std::vector<std::vector<float>> bandsPixels(bandsCount, std::vector<float>(tilePixels));
+            if (!computeTile(xOff, yOff, tileWidth, rowHeight, bandsPixels)
+                || int(bandsPixels.size()) < bandsCount)
+                return;
+            for (int b = 0; b < bandsCount; ++b) {
+                if (bandsPixels[b].size() < tilePixels)
+                    return;
+                for (int j = 0; j < rowHeight; ++j) {
+                    const float* src = bandsPixels[b].data() + size_t(j) * tileWidth;
+                    // In memory: the tiles do not overlap, copied in place
+                    if (inMemory) {
+                        std::copy(src, src + tileWidth, bandsData[b] + size_t(yOff + j) * width + xOff);
+                        continue;
+                    }
+                    float* dst = rowBuffers[b].data() + size_t(j) * width + xOff;
+                    for (int i = 0; i < tileWidth; ++i)
+                        dst[i] = std::isnan(src[i]) ? float(kNoDataValue) : src[i];
+                }
+            }
+            tilesOk[tileX] = 1;
+        }, 1);
+        if (std::find(tilesOk.begin(), tilesOk.end(), 0) != tilesOk.end()) {
+            error = "Compute a tile of the output failed";
+            return false;
+        }
+
+        for (int b = 0; b < int(rowBuffers.size()); ++b) {
+            CPLErr err = tempDs->GetRasterBand(b + 1)->RasterIO(GF_Write, 0, yOff, width, rowHeight,
+                                                                rowBuffers[b].data(), width, rowHeight,
+                                                                GDT_Float32, 0, 0);
+            if (err != CE_None) {
+                error = "Write " + tempPath + " failed";
+                return false;
+            }
+        }
+        if (progress && !progress(double(tileY + 1) / tilesY, "", progressArg)) {
+            error = "Canceled";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GeoRasterWriter::finish(GDALProgressFunc progress, void* progressArg)
+{
+    // Halved until the coarsest fits in a tile
+    std::vector<int> factors;
+    int maxSize = std::max(width, height);
+    for (int factor = 2; maxSize / (factor / 2) > kTileSize; factor *= 2)
+        factors.push_back(factor);
+
+    ProgressRange overviewsRange = { progress, progressArg, kTilesProgress, kOverviewsProgress, false };
+    if (!factors.empty()) {
+        CPLSetThreadLocalConfigOption("GDAL_NUM_THREADS", "ALL_CPUS");
+        CPLSetThreadLocalConfigOption("GDAL_TIFF_OVR_BLOCKSIZE", std::to_string(kTileSize).c_str());
+        CPLErr err = tempDs->BuildOverviews(resampling.c_str(), int(factors.size()), factors.data(),
+                                            0, nullptr, rangeProgress, &overviewsRange);
+        CPLSetThreadLocalConfigOption("GDAL_NUM_THREADS", nullptr);
+        CPLSetThreadLocalConfigOption("GDAL_TIFF_OVR_BLOCKSIZE", nullptr);
+        if (err != CE_None) {
+            error = overviewsRange.canceled ? "Canceled" : "Build the overviews failed";
+            return false;
+        }
+    }
+    tempDs->FlushCache();
+
+    // The overviews first, then the full resolution
+    GDALDriver* poDriver = tempDs->GetDriver();
+    const char* compression = getCompression(poDriver);
+    char** papszOptions = nullptr;
+    papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+    papszOptions = CSLSetNameValue(papszOptions, "BLOCKXSIZE", std::to_string(kTileSize).c_str());
+    papszOptions = CSLSetNameValue(papszOptions, "BLOCKYSIZE", std::to_string(kTileSize).c_str());
+    papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", compression);
+    papszOptions = CSLSetNameValue(papszOptions, "PREDICTOR", "3");     // floating point
+    papszOptions = CSLSetNameValue(papszOptions, "COPY_SRC_OVERVIEWS", "YES");
+    papszOptions = CSLSetNameValue(papszOptions, "NUM_THREADS", "ALL_CPUS");
+    papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+    if (bandsCount > 1)
+        papszOptions = CSLSetNameValue(papszOptions, "INTERLEAVE", "BAND");
+    ProgressRange copyRange = { progress, progressArg, kOverviewsProgress, 1.0, false };
+    outputStarted = true;
+    GDALDataset* outDs = poDriver->CreateCopy(outputPath.c_str(), tempDs, FALSE, papszOptions,
+                                              rangeProgress, &copyRange);
+    CSLDestroy(papszOptions);
+    if (!outDs) {
+        error = copyRange.canceled ? "Canceled" : "Write " + outputPath + " failed";
+        return false;
+    }
+    GDALClose(outDs);
+
+    GDALClose(tempDs);
+    tempDs = nullptr;
+    VSIUnlink(tempPath.c_str());
+
+    LInfo("Cloud optimized GeoTIFF {0}: {1}, {2} overview(s)", outputPath, compression, factors.size());
+    return true;
+}
+
+void GeoRasterWriter::discard()
+{
+    if (tempDs) {
+        GDALClose(tempDs);
+        tempDs = nullptr;
+    }
+    // Also left by a failed Create()
+    if (!isInMemory())
+        VSIUnlink(tempPath.c_str());
+    // A file already at the output path is only replaced by the copy
+    if (outputStarted) {
+        VSIUnlink(outputPath.c_str());
+        outputStarted = false;
+    }
+    for (float* data : bandsData)
+        delete[] data;
+    bandsData.clear();
+}
@@ -0,0 +1,97 @@
+/*************************************************************
+** class name:  GeoRasterWriter
+**
+** description: The output of the raster tools, Float32, to a
+**                cloud optimized GeoTIFF or to bands in memory
+**
+**              The producer gives the pixels of a tile of 256 x 256
+**                (all its bands), the tiles of a block row are
+**                computed in parallel
+**              GeoTIFF: the rows go to a temporary tiled file, its
+**                overviews are built (halved down to one tile), then
+**                it is copied with them to the output: tiles of
+**                256 x 256, ZSTD (DEFLATE if GDAL has no ZSTD) with
+**                the floating point predictor, the overviews before
+**                the full resolution, the tiles compressed by all
+**                the cores. Nodata: kNoDataValue
+**              Memory: the tiles are copied in the bands, nodata is
+**                NaN, no file is written or read
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <gdal/gdal.h>
+
+
+class GDALDataset;
+class GeoRasterBand;
+
+class GeoRasterWriter {
+public:
+    // The value of the nodata pixels of a GeoTIFF
+    static const double kNoDataValue;
+    static const int kTileSize = 256;
+
+    // The pixels of the tile [xOff, xOff + width) x [yOff, yOff + height)
+    //  of every band: bandsPixels[iBand] has width x height pixels, row by
+    //  row, nodata: NaN. Called from several threads
+    using TileFunc = std::function<bool(int xOff, int yOff, int width, int height,
+                                        std::vector<std::vector<float>>& bandsPixels)>;
+
+public:
+    // To a cloud optimized GeoTIFF
+    GeoRasterWriter(const std::string& outputPath, int width, int height, int bandsCount,
+                    const double geoTransform[6], const std::string& projection);
+    // To bands in memory, see takeBands()
+    GeoRasterWriter(int width, int height, int bandsCount, const double geoTransform[6]);
+    ~GeoRasterWriter();
+
+    GeoRasterWriter(const GeoRasterWriter&) = delete;
+    GeoRasterWriter& operator=(const GeoRasterWriter&) = delete;
+
+    bool isInMemory() const { return outputPath.empty(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const std::string& getOutputPath() const { return outputPath; }
+    const std::string& getError() const { return error; }
+
+    // "AVERAGE" by default, "NEAREST" or "MODE" for classes
+    void setOverviewResampling(const std::string& resamplingIn) { resampling = resamplingIn; }
+
+    // Every tile of the output, then the overviews and the final copy
+    // Canceled if the progress returns FALSE, nothing is left on disk
+    //  on error or if canceled
+    bool write(const TileFunc& computeTile,
+               GDALProgressFunc progress = nullptr, void* progressArg = nullptr);
+
+    // In memory, after write(): the bands, owned by the caller
+    std::vector<GeoRasterBand*> takeBands();
+
+private:
+    bool createTemporary();
+    bool writeTiles(const TileFunc& computeTile, GDALProgressFunc progress, void* progressArg);
+    // The overviews of the temporary file, and the copy to the output
+    bool finish(GDALProgressFunc progress, void* progressArg);
+    // The temporary file, the output, the bands in memory
+    void discard();
+
+private:
+    std::string outputPath;
+    std::string tempPath;
+    int width;
+    int height;
+    int bandsCount;
+    double geoTransform[6];
+    std::string projection;
+    std::string resampling = "AVERAGE";
+
+    GDALDataset* tempDs = nullptr;
+    bool outputStarted = false;         // CreateCopy writes the output
+    std::vector<float*> bandsData;      // in memory
+    std::string error;
+};
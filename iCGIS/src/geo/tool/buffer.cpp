@@ -0,0 +1,236 @@
+#include "buffer.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+#include "util/memoryleakdetect.h"
+#include "geo/utility/geo_buffer.h"
+#include "geo/utility/geo_measure.h"
+#include "geo/utility/geo_overlay.h"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+BufferTool::BufferTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Buffer"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(350, 420);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &BufferTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &BufferTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+BufferTool::~BufferTool()
+{
+}
+
+void BufferTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input features"));
+    comboInputFeatures = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputFeatures);
+    connect(comboInputFeatures, &QComboBox::currentTextChanged,
+            this, &BufferTool::onChangeInputFeatures);
+
+    QLabel* label2 = new QLabel(tr("Distance (negative: shrink polygons)"));
+    lineEditDistance = new QLineEdit();
+    lineEditDistance->setAlignment(Qt::AlignRight);
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(lineEditDistance);
+
+    QLabel* label3 = new QLabel(tr("Segments per quarter circle"));
+    lineEditSegments = new QLineEdit("8");
+    lineEditSegments->setAlignment(Qt::AlignRight);
+    mainLayout->addWidget(label3);
+    mainLayout->addWidget(lineEditSegments);
+
+    // The same order as gm::BufferJoinStyle
+    QLabel* label4 = new QLabel(tr("Join style"));
+    comboJoinStyle = new QComboBox();
+    comboJoinStyle->addItem(tr("Round"));
+    comboJoinStyle->addItem(tr("Miter"));
+    comboJoinStyle->addItem(tr("Bevel"));
+    mainLayout->addWidget(label4);
+    mainLayout->addWidget(comboJoinStyle);
+
+    // The same order as gm::BufferCapStyle
+    QLabel* label5 = new QLabel(tr("End cap style"));
+    comboCapStyle = new QComboBox();
+    comboCapStyle->addItem(tr("Round"));
+    comboCapStyle->addItem(tr("Square"));
+    comboCapStyle->addItem(tr("Flat"));
+    mainLayout->addWidget(label5);
+    mainLayout->addWidget(comboCapStyle);
+
+    QLabel* label6 = new QLabel(tr("Dissolve"));
+    comboDissolve = new QComboBox();
+    comboDissolve->addItem(tr("None"));
+    comboDissolve->addItem(tr("All"));
+    mainLayout->addWidget(label6);
+    mainLayout->addWidget(comboDissolve);
+
+    QLabel* label7 = new QLabel(tr("Output layer name"));
+    lineEditOutputLayer = new QLineEdit();
+    mainLayout->addWidget(label7);
+    mainLayout->addWidget(lineEditOutputLayer);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout = new QHBoxLayout();
+    hLayout->addItem(spacerItem1);
+    hLayout->addWidget(btnOK);
+    hLayout->addItem(spacerItem2);
+    hLayout->addWidget(btnCancel);
+    hLayout->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnOK, &QPushButton::clicked, this, &BufferTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &BufferTool::close);
+}
+
+/* Fill with default values */
+void BufferTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kFeatureLayer) {
+            comboInputFeatures->addItem(layer->getName());
+        }
+    }
+}
+
+/* Change input feature layer */
+void BufferTool::onChangeInputFeatures(const QString& name)
+{
+    lineEditOutputLayer->setText(name + "_Buffer");
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       Buffer each feature            */
+/*       Output a new polygon layer     */
+/*                                      */
+/****************************************/
+void BufferTool::onBtnOKClicked()
+{
+    GeoLayer* inputLayer = map->getLayerByName(comboInputFeatures->currentText());
+    if (!inputLayer) {
+        QMessageBox::critical(this, "Error", "Input features can't be empty");
+        return;
+    }
+    GeoFeatureLayer* layer = inputLayer->toFeatureLayer();
+    if (layer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
+
+    bool ok = false;
+    gm::BufferParams params;
+    params.distance = lineEditDistance->text().toDouble(&ok);
+    if (!ok || params.distance == 0.0) {
+        QMessageBox::critical(this, "Error", "Distance must be a non-zero number");
+        return;
+    }
+    params.quadrantSegments = lineEditSegments->text().toInt(&ok);
+    if (!ok || params.quadrantSegments < 1 || params.quadrantSegments > 90) {
+        QMessageBox::critical(this, "Error", "Segments per quarter circle must be in [1, 90]");
+        return;
+    }
+    params.joinStyle = gm::BufferJoinStyle(comboJoinStyle->currentIndex());
+    params.capStyle = gm::BufferCapStyle(comboCapStyle->currentIndex());
+
+    QString outputName = lineEditOutputLayer->text();
+    if (outputName.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Output layer name can't be empty");
+        return;
+    }
+    if (map->getLayerByName(outputName)) {
+        QMessageBox::critical(this, "Error", "Layer already exists: " + outputName);
+        return;
+    }
+
+    DissolveOption dissolve = DissolveOption(comboDissolve->currentIndex());
+
+    // Buffer of each feature, in parallel
+    std::vector<GeoFeature*> features(layer->begin(), layer->end());
+    int featuresCount = features.size();
+    std::vector<GeoGeometry*> buffers(featuresCount, nullptr);
+    utils::parallelFor(0, featuresCount, [&](int i) {
+        if (!features[i]->isDeleted())
+            buffers[i] = gm::buffer(features[i]->getGeometry(), params);
+    }, 16);
+
+    // Dissolve: union of all the buffers
+    if (dissolve == kDissolveAll) {
+        GeoGeometry* merged = gm::unionPolygons(buffers);
+        for (auto& geom : buffers)
+            delete geom;
+        buffers.assign(1, merged);
+    }
+
+    // Output layer
+    GeoFeatureLayer* outputLayer = new GeoFeatureLayer();
+    outputLayer->setName(outputName);
+    outputLayer->setGeometryType(kPolygon);
+    int origFIDIdx = -1;
+    if (dissolve == kDissolveNone)
+        origFIDIdx = outputLayer->addField("ORIG_FID", 10, kFieldInt);
+    int areaIdx = outputLayer->addField("AREA", 20, kFieldDouble);
+
+    unsigned int color = utils::getRandomColor();
+    int buffersCount = buffers.size();
+    for (int i = 0; i < buffersCount; ++i) {
+        if (!buffers[i])
+            continue;
+        GeoFeature* feature = new GeoFeature(outputLayer);
+        feature->setGeometry(buffers[i]);
+        feature->updateExtent();
+        feature->setColor(color, false);
+        if (origFIDIdx != -1)
+            feature->setField(origFIDIdx, features[i]->getFID());
+        feature->setField(areaIdx, gm::area(buffers[i]));
+        outputLayer->addFeature(feature);
+    }
+
+    if (outputLayer->isEmpty()) {
+        delete outputLayer;
+        QMessageBox::critical(this, "Error", "The buffer is empty");
+        return;
+    }
+
+    outputLayer->createGridIndex();
+    map->addLayer(outputLayer);
+    LInfo("Buffer: {0} features", outputLayer->getFeatureCount());
+
+    emit sigAddNewLayerToLayersTree(outputLayer);
+    emit sigSendLayerToGPU(outputLayer);
+
+    this->close();
+}
@@ -0,0 +1,55 @@
+/**************************************************************
+** class name:  BufferTool
+**
+** description: Buffer of points, lines or polygons
+**                distance, segments per quarter circle,
+**                join style, cap style
+**              Each feature is buffered in parallel, the buffers
+**              can be dissolved into one polygon.
+**              Output a new polygon layer.
+**
+** last change: 2020-04-06
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+
+
+class BufferTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    BufferTool(QWidget* parent = nullptr);
+    ~BufferTool();
+
+    enum DissolveOption {
+        kDissolveNone   = 0,
+        kDissolveAll    = 1
+    };
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputFeatures(const QString& name);
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputFeatures;
+    QLineEdit* lineEditDistance;
+    QLineEdit* lineEditSegments;
+    QComboBox* comboJoinStyle;
+    QComboBox* comboCapStyle;
+    QComboBox* comboDissolve;
+    QLineEdit* lineEditOutputLayer;
+};
@@ -0,0 +1,198 @@
+#include "delaunay_triangulation.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+#include "util/memoryleakdetect.h"
+#include "geo/utility/geo_delaunay.h"
+#include "geo/utility/geo_hull.h"
+#include "geo/utility/geo_measure.h"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+DelaunayTriangulationTool::DelaunayTriangulationTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Delaunay Triangulation"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(350, 180);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &DelaunayTriangulationTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &DelaunayTriangulationTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+DelaunayTriangulationTool::~DelaunayTriangulationTool()
+{
+}
+
+void DelaunayTriangulationTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input point features"));
+    comboInputFeatures = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputFeatures);
+    connect(comboInputFeatures, &QComboBox::currentTextChanged,
+            this, &DelaunayTriangulationTool::onChangeInputFeatures);
+
+    QLabel* label2 = new QLabel(tr("Output layer name"));
+    lineEditOutputLayer = new QLineEdit();
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(lineEditOutputLayer);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout = new QHBoxLayout();
+    hLayout->addItem(spacerItem1);
+    hLayout->addWidget(btnOK);
+    hLayout->addItem(spacerItem2);
+    hLayout->addWidget(btnCancel);
+    hLayout->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnOK, &QPushButton::clicked, this, &DelaunayTriangulationTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &DelaunayTriangulationTool::close);
+}
+
+/* Fill with default values */
+void DelaunayTriangulationTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kFeatureLayer) {
+            GeometryType geomType = layer->toFeatureLayer()->getGeometryType();
+            if (geomType == kPoint || geomType == kMultiPoint)
+                comboInputFeatures->addItem(layer->getName());
+        }
+    }
+}
+
+/* Change input feature layer */
+void DelaunayTriangulationTool::onChangeInputFeatures(const QString& name)
+{
+    lineEditOutputLayer->setText(name + "_TIN");
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       Triangulate the points         */
+/*       Output a new polygon layer     */
+/*                                      */
+/****************************************/
+void DelaunayTriangulationTool::onBtnOKClicked()
+{
+    GeoLayer* inputLayer = map->getLayerByName(comboInputFeatures->currentText());
+    if (!inputLayer) {
+        QMessageBox::critical(this, "Error", "Input features can't be empty");
+        return;
+    }
+    GeoFeatureLayer* layer = inputLayer->toFeatureLayer();
+    if (layer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
+
+    QString outputName = lineEditOutputLayer->text();
+    if (outputName.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Output layer name can't be empty");
+        return;
+    }
+    if (map->getLayerByName(outputName)) {
+        QMessageBox::critical(this, "Error", "Layer already exists: " + outputName);
+        return;
+    }
+
+    // Input points, and the FID of the feature each point belongs to
+    std::vector<GeoRawPoint> points;
+    std::vector<int> pointFIDs;
+    points.reserve(layer->getFeatureCount());
+    pointFIDs.reserve(layer->getFeatureCount());
+    for (auto& feature : *layer) {
+        if (feature->isDeleted())
+            continue;
+        gm::collectPoints(feature->getGeometry(), points);
+        pointFIDs.resize(points.size(), feature->getFID());
+    }
+
+    gm::Delaunay delaunay(points);
+    if (!delaunay.isValid()) {
+        QMessageBox::critical(this, "Error", "Triangulation failed (less than 3 distinct points or all collinear)");
+        return;
+    }
+
+    // Output layer
+    GeoFeatureLayer* outputLayer = new GeoFeatureLayer();
+    outputLayer->setName(outputName);
+    outputLayer->setGeometryType(kPolygon);
+    int node1Idx = outputLayer->addField("NODE1", 10, kFieldInt);
+    int node2Idx = outputLayer->addField("NODE2", 10, kFieldInt);
+    int node3Idx = outputLayer->addField("NODE3", 10, kFieldInt);
+    int areaIdx = outputLayer->addField("AREA", 20, kFieldDouble);
+
+    // Build the features in parallel, add them in order
+    // The triangles are clockwise, reversed to counterclockwise
+    const std::vector<int>& triangles = delaunay.getTriangles();
+    int trianglesCount = delaunay.getNumTriangles();
+    unsigned int color = utils::getRandomColor();
+    std::vector<GeoFeature*> newFeatures(trianglesCount);
+    utils::parallelFor(0, trianglesCount, [&](int t) {
+        int a = triangles[3 * t];
+        int b = triangles[3 * t + 2];
+        int c = triangles[3 * t + 1];
+
+        GeoLinearRing* ring = new GeoLinearRing();
+        ring->reserveNumPoints(4);
+        ring->addPoint(points[a]);
+        ring->addPoint(points[b]);
+        ring->addPoint(points[c]);
+        ring->closeRings();
+        GeoPolygon* polygon = new GeoPolygon();
+        polygon->setExteriorRing(ring);
+
+        GeoFeature* feature = new GeoFeature(outputLayer);
+        feature->setGeometry(polygon);
+        feature->updateExtent();
+        feature->setColor(color, false);
+        feature->setField(node1Idx, pointFIDs[a]);
+        feature->setField(node2Idx, pointFIDs[b]);
+        feature->setField(node3Idx, pointFIDs[c]);
+        feature->setField(areaIdx, gm::area(polygon));
+        newFeatures[t] = feature;
+    }, 1024);
+
+    for (auto& feature : newFeatures)
+        outputLayer->addFeature(feature);
+
+    outputLayer->createGridIndex();
+    map->addLayer(outputLayer);
+    LInfo("Delaunay triangulation: {0} points, {1} triangles", points.size(), trianglesCount);
+
+    emit sigAddNewLayerToLayersTree(outputLayer);
+    emit sigSendLayerToGPU(outputLayer);
+
+    this->close();
+}
@@ -0,0 +1,42 @@
+/**************************************************************
+** class name:  DelaunayTriangulationTool
+**
+** description: Delaunay triangulation of a point layer.
+**              Output a new polygon layer of triangles (TIN),
+**              with the FIDs of the three vertices.
+**
+** last change: 2020-04-05
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+
+
+class DelaunayTriangulationTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    DelaunayTriangulationTool(QWidget* parent = nullptr);
+    ~DelaunayTriangulationTool();
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputFeatures(const QString& name);
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputFeatures;
+    QLineEdit* lineEditOutputLayer;
+};
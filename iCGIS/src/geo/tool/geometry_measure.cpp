@@ -0,0 +1,195 @@
+#include "geometry_measure.h"
+
+#include "util/logger.h"
+#include "util/memoryleakdetect.h"
+#include "geo/utility/geo_measure.h"
+
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+GeometryMeasureTool::GeometryMeasureTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Geometry Measures"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(350, 380);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+}
+
+GeometryMeasureTool::~GeometryMeasureTool()
+{
+}
+
+void GeometryMeasureTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input features"));
+    comboInputFeatures = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputFeatures);
+    connect(comboInputFeatures, &QComboBox::currentTextChanged,
+            this, &GeometryMeasureTool::onChangeInputFeatures);
+
+    QLabel* label2 = new QLabel(tr("Method"));
+    comboMethod = new QComboBox();
+    comboMethod->addItem(tr("Planar"));
+    comboMethod->addItem(tr("Geodesic (degrees to meters)"));
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(comboMethod);
+
+    QLabel* label3 = new QLabel(tr("Measures"));
+    checkArea = new QCheckBox(tr("Area"));
+    checkLength = new QCheckBox(tr("Length / Perimeter"));
+    checkCentroid = new QCheckBox(tr("Centroid"));
+    checkDistance = new QCheckBox(tr("Distance to point"));
+    checkArea->setChecked(true);
+    checkLength->setChecked(true);
+    mainLayout->addWidget(label3);
+    mainLayout->addWidget(checkArea);
+    mainLayout->addWidget(checkLength);
+    mainLayout->addWidget(checkCentroid);
+    mainLayout->addWidget(checkDistance);
+
+    QLabel* label4 = new QLabel(tr("Reference point (X, Y)"));
+    lineEditRefX = new QLineEdit();
+    lineEditRefY = new QLineEdit();
+    lineEditRefX->setAlignment(Qt::AlignRight);
+    lineEditRefY->setAlignment(Qt::AlignRight);
+    lineEditRefX->setEnabled(false);
+    lineEditRefY->setEnabled(false);
+    QHBoxLayout* hLayout1 = new QHBoxLayout();
+    hLayout1->addWidget(lineEditRefX);
+    hLayout1->addWidget(lineEditRefY);
+    mainLayout->addWidget(label4);
+    mainLayout->addLayout(hLayout1);
+    connect(checkDistance, &QCheckBox::toggled, lineEditRefX, &QLineEdit::setEnabled);
+    connect(checkDistance, &QCheckBox::toggled, lineEditRefY, &QLineEdit::setEnabled);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout2 = new QHBoxLayout();
+    hLayout2->addItem(spacerItem1);
+    hLayout2->addWidget(btnOK);
+    hLayout2->addItem(spacerItem2);
+    hLayout2->addWidget(btnCancel);
+    hLayout2->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout2);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnOK, &QPushButton::clicked, this, &GeometryMeasureTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &GeometryMeasureTool::close);
+}
+
+/* Fill with default values */
+void GeometryMeasureTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kFeatureLayer) {
+            comboInputFeatures->addItem(layer->getName());
+        }
+    }
+}
+
+/* Change input feature layer */
+void GeometryMeasureTool::onChangeInputFeatures(const QString& name)
+{
+    GeoLayer* layer = map->getLayerByName(name);
+    if (!layer)
+        return;
+    GeoFeatureLayer* featureLayer = layer->toFeatureLayer();
+
+    // Area is meaningful only for polygons
+    GeometryType type = featureLayer->getGeometryType();
+    bool isPolygon = (type == kPolygon || type == kMultiPolygon);
+    checkArea->setEnabled(isPolygon);
+    checkArea->setChecked(isPolygon);
+    checkLength->setText(isPolygon ? tr("Perimeter") : tr("Length"));
+
+    // Geographic coordinates
+    GeoExtent extent = featureLayer->getExtent();
+    bool isLonLat = extent.minX >= -180.0 && extent.maxX <= 180.0
+        && extent.minY >= -90.0 && extent.maxY <= 90.0;
+    comboMethod->setCurrentIndex(isLonLat ? 1 : 0);
+
+    // Default reference point: center of the layer
+    lineEditRefX->setText(QString::number(extent.centerX(), 'f', 6));
+    lineEditRefY->setText(QString::number(extent.centerY(), 'f', 6));
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       Measure all features           */
+/*       Write to attribute table       */
+/*                                      */
+/****************************************/
+void GeometryMeasureTool::onBtnOKClicked()
+{
+    GeoLayer* layer = map->getLayerByName(comboInputFeatures->currentText());
+    if (!layer) {
+        QMessageBox::critical(this, "Error", "Input features can't be empty");
+        return;
+    }
+    GeoFeatureLayer* featureLayer = layer->toFeatureLayer();
+    if (featureLayer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
+
+    int measureTypes = 0;
+    if (checkArea->isEnabled() && checkArea->isChecked())
+        measureTypes |= gm::kMeasureArea;
+    if (checkLength->isChecked())
+        measureTypes |= gm::kMeasureLength;
+    if (checkCentroid->isChecked())
+        measureTypes |= gm::kMeasureCentroid;
+
+    GeoRawPoint refPoint;
+    if (checkDistance->isChecked()) {
+        bool okX = false, okY = false;
+        refPoint.x = lineEditRefX->text().toDouble(&okX);
+        refPoint.y = lineEditRefY->text().toDouble(&okY);
+        if (!okX || !okY) {
+            QMessageBox::critical(this, "Error", "Invalid reference point");
+            return;
+        }
+        measureTypes |= gm::kMeasureDistance;
+    }
+
+    if (measureTypes == 0) {
+        QMessageBox::critical(this, "Error", "Select at least one measure");
+        return;
+    }
+
+    bool geodesic = comboMethod->currentIndex() == 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    int count = gm::measureLayer(featureLayer, measureTypes, geodesic, refPoint);
+    LInfo("Measure {} features in {} ms", count, timer.elapsed());
+
+    QMessageBox::information(this, tr("Geometry Measures"),
+        tr("Measured %1 features, results are written to the attribute table").arg(count));
+
+    this->close();
+}
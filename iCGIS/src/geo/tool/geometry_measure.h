@@ -0,0 +1,45 @@
+/**************************************************************
+** class name:  GeometryMeasureTool
+**
+** description: Calculate area, length(perimeter), centroid and
+**              distance to a point of all features in a layer,
+**              write the results to new attribute fields
+**
+** last change: 2020-04-02
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+
+
+class GeometryMeasureTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    GeometryMeasureTool(QWidget* parent = nullptr);
+    ~GeometryMeasureTool();
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputFeatures(const QString& name);
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputFeatures;
+    QComboBox* comboMethod;
+    QCheckBox* checkArea;
+    QCheckBox* checkLength;
+    QCheckBox* checkCentroid;
+    QCheckBox* checkDistance;
+    QLineEdit* lineEditRefX;
+    QLineEdit* lineEditRefY;
+};
@@ -1,6 +1,12 @@
 #include "geo/tool/geotool.h"
+#include "geo/raster/georasterwriter.h"
+#include "geo/raster/geotiff.h"
+#include "geo/utility/filereader.h"
 #include "util/env.h"
 
+#include <QApplication>
+#include <QMessageBox>
+
 GeoTool::GeoTool(QWidget* parent)
     : QDialog(parent), map(Env::map) {
 
@@ -9,3 +15,45 @@ GeoTool::GeoTool(QWidget* parent)
 GeoTool::~GeoTool() {
 
 }
+
+int CPL_STDCALL GeoTool::dialogProgress(double complete, const char*, void* arg)
+{
+    QProgressDialog* progressDlg = static_cast<QProgressDialog*>(arg);
+    progressDlg->setValue(int(complete * 100));
+    QApplication::processEvents();
+    return progressDlg->wasCanceled() ? FALSE : TRUE;
+}
+
+QProgressDialog* GeoTool::createProgressDialog(QWidget* parent, const QString& title, const QString& label)
+{
+    QProgressDialog* progressDlg = new QProgressDialog(parent);
+    progressDlg->setAttribute(Qt::WA_DeleteOnClose, true);
+    progressDlg->setOrientation(Qt::Horizontal);
+    progressDlg->setWindowModality(Qt::WindowModal);
+    progressDlg->setWindowTitle(title);
+    progressDlg->setLabelText(label);
+    progressDlg->setCancelButtonText(tr("Cancel"));
+    progressDlg->setMinimumDuration(0);
+    progressDlg->setRange(0, 100);
+    return progressDlg;
+}
+
+GeoRasterLayer* GeoTool::addOutputRaster(GeoRasterWriter& writer, const QString& layerName)
+{
+    if (writer.isInMemory()) {
+        GeoRasterLayer* rasterLayer = new GeoRasterLayer();
+        rasterLayer->setName(layerName);
+        GeoTiff* tiff = new GeoTiff();
+        for (GeoRasterBand* band : writer.takeBands())
+            tiff->addBand(band);
+        rasterLayer->setData(tiff);
+        map->addLayer(rasterLayer);
+        return rasterLayer;
+    }
+
+    // Ask users whether add the output image to current map
+    auto reply = QMessageBox::question(this, tr("Option"), tr("Impot to the map?"), QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes)
+        return nullptr;
+    return FileReader::readTiff(QString::fromLocal8Bit(writer.getOutputPath().c_str()), map);
+}
@@ -3,14 +3,19 @@
 **
 ** description: Tool class (base class of all tools)
 **
-** last change: 2020-01-02
+** last change: 2020-04-09
 *******************************************************/
 #pragma once
 
 #include <QDialog>
+#include <QProgressDialog>
 #include "geo/map/geomap.h"
 #include "util/memoryleakdetect.h"
 
+#include <gdal/cpl_port.h>
+
+
+class GeoRasterWriter;
 
 class GeoTool : public QDialog
 {
@@ -19,6 +24,20 @@ public:
     GeoTool(QWidget* parent = nullptr);
     virtual ~GeoTool();
 
+public:
+    // GDAL progress -> the progress dialog `arg`, false to cancel
+    static int CPL_STDCALL dialogProgress(double complete, const char* message, void* arg);
+
+    // A modal progress dialog of [0, 100] with a Cancel button, for
+    //  dialogProgress, deleted when closed
+    static QProgressDialog* createProgressDialog(QWidget* parent, const QString& title, const QString& label);
+
+protected:
+    // The raster written by a tool, to the map: the bands in memory as a
+    //  new layer, or the file if the user wants to import it
+    // nullptr if not added
+    GeoRasterLayer* addOutputRaster(GeoRasterWriter& writer, const QString& layerName);
+
 protected:
     GeoMap*& map;
 };
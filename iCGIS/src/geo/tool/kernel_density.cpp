@@ -4,11 +4,12 @@
 #include "util/logger.h"
 #include "util/appevent.h"
 #include "util/memoryleakdetect.h"
-#include "geo/utility/filereader.h"
+#include "geo/raster/georasterwriter.h"
 
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <memory>
 
 #include <QDebug>
 #include <QFileDialog>
@@ -25,13 +26,14 @@
 
 #include <thread>
 
+
 KernelDensityTool::KernelDensityTool(QWidget* parent /*= nullptr*/)
     : GeoTool(parent)
 {
     this->setWindowTitle(tr("Kernel Density"));
     this->setWindowIcon(QIcon("res/icons/tool.ico"));
     this->setAttribute(Qt::WA_DeleteOnClose, true);
-    this->setFixedSize(350, 400);
+    this->setFixedSize(350, 430);
     this->setModal(true);
 
     setupLayout();
@@ -63,9 +65,13 @@ void KernelDensityTool::setupLayout()
     mainLayout->addWidget(label2);
     mainLayout->addWidget(comboPopiField);
 
+    checkInMemory = new QCheckBox(tr("Add to the map in memory (no file)"));
+    mainLayout->addWidget(checkInMemory);
+    connect(checkInMemory, &QCheckBox::toggled, this, &KernelDensityTool::onToggleInMemory);
+
     QLabel* label3 = new QLabel(tr("Output raster"));
     lineEditOutputRaster = new QLineEdit();
-    QPushButton* btnSelectFile = new QPushButton();
+    btnSelectFile = new QPushButton();
     btnSelectFile->setIcon(QIcon("res/icons/open.ico"));
     QHBoxLayout* hLayout1 = new QHBoxLayout();
     hLayout1->addWidget(lineEditOutputRaster);
@@ -159,6 +165,12 @@ void KernelDensityTool::onChangeInputFeatures(const QString& name)
     }
 }
 
+void KernelDensityTool::onToggleInMemory(bool checked)
+{
+    lineEditOutputRaster->setEnabled(!checked);
+    btnSelectFile->setEnabled(!checked);
+}
+
 /* Change output file */
 void KernelDensityTool::onSetOutputRaster()
 {
@@ -170,7 +182,7 @@ void KernelDensityTool::onSetOutputRaster()
 /*                                      */
 /*     Run                              */
 /*       Calculate kernel density       */
-/*       Output a geoTiff file          */
+/*       Output a COG or in memory      */
 /*                                      */
 /****************************************/
 void KernelDensityTool::onBtnOKClicked()
@@ -183,6 +195,10 @@ void KernelDensityTool::onBtnOKClicked()
         QMessageBox::critical(this, "Error", "Input features are not point");
         return;
     }
+    if (layer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
 
     // popiField
     //GeoFieldDefn* popiFieldDefn = nullptr;
@@ -191,8 +207,9 @@ void KernelDensityTool::onBtnOKClicked()
     //}
 
     // outputRaster
+    bool inMemory = checkInMemory->isChecked();
     QString outputRasterFile = lineEditOutputRaster->text();
-    if (outputRasterFile.isEmpty()) {
+    if (!inMemory && outputRasterFile.isEmpty()) {
         QMessageBox::critical(this, "Error", "Ouput raster file can't be empty");
         return;
     }
@@ -213,11 +230,12 @@ void KernelDensityTool::onBtnOKClicked()
 
     /***********************************  Calculate KED  ****************************************/
 
-    // Cache points
+    // Cache points, read by the tiles from several threads
     int pointsCount = layer->getFeatureCount();
-    GeoPoint** geoPoints = new GeoPoint*[pointsCount];
+    std::vector<GeoRawPoint> points(pointsCount);
     for (int i = 0; i < pointsCount; ++i) {
-        geoPoints[i] = layer->getFeature(i)->getGeometry()->toPoint();
+        GeoPoint* geoPoint = layer->getFeature(i)->getGeometry()->toPoint();
+        points[i] = GeoRawPoint(geoPoint->getX(), geoPoint->getY());
     }
 
     // Rows and columns of output image
@@ -225,91 +243,6 @@ void KernelDensityTool::onBtnOKClicked()
     int row = int(layerExtent.height() / cellSize + 1);
     int col = int(layerExtent.width() / cellSize + 1);
 
-    QByteArray bytes = outputRasterFile.toLocal8Bit();
-    const char* outputFile = bytes.constData();
-
-    // Pixels data
-    float* outData = new float[row * col];
-    int index = 0;
-
-    // Current grid's central point
-    GeoRawPoint currPos(layerExtent.minX + cellSize / 2.0, layerExtent.maxY - cellSize / 2.0);
-    double x = 0.0, y = 0.0;
-    double searchRadiusSqure = searchRadius * searchRadius;
-
-    // Progress bar
-    QProgressDialog* progressDlg = new QProgressDialog(this);
-    progressDlg->setAttribute(Qt::WA_DeleteOnClose, true);
-    progressDlg->setOrientation(Qt::Horizontal);
-    progressDlg->setWindowModality(Qt::WindowModal);
-    progressDlg->setWindowTitle(tr("Kernel Density"));
-    progressDlg->setLabelText(tr("Calculating......"));
-    progressDlg->setCancelButtonText(tr("Cancel"));
-    progressDlg->setMinimumDuration(0);
-    progressDlg->setRange(0, row);
-
-    // Hide the tool dialot
-    // Show progress bar
-    this->hide();
-
-    // Calculate from TopLeft to BottomRight
-    for (int i = 0; i < row; ++i) {
-        for (int j = 0; j < col; ++j) {
-            double density = 0.0;
-            for (int k = 0; k < pointsCount; ++k) {
-                // Judge if the point in the enclosing squre of search area(a circle)
-                x = geoPoints[k]->getX();
-                y = geoPoints[k]->getY();
-                if (fabs(x - currPos.x) < searchRadius && fabs(y - currPos.y) < searchRadius) {
-                    double disSqure = DIS_SQURE(x, y, currPos.x, currPos.y);
-                    if (disSqure < searchRadiusSqure) {
-                        density += pow(1 - disSqure / searchRadiusSqure, 2);
-                    }
-                }
-            }
-            currPos.x += cellSize;
-            density = density * 3.0 / (PI * searchRadiusSqure);
-            outData[index++] = density;
-        }
-        currPos.x = layerExtent.minX + cellSize / 2.0;
-        currPos.y -= cellSize;
-        // update progress bar
-        progressDlg->setValue(i + 1);
-        // whether stop progress
-        if (progressDlg->wasCanceled()) {
-            delete[] outData;
-            delete[] geoPoints;
-            this->show();
-            return;
-        }
-    }
-
-    progressDlg->close();
-
-    // Open tiff file
-    GDALAllRegister();
-    GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
-    if (!poDriver) {
-        delete[] outData;
-        delete[] geoPoints;
-        return;
-    }
-
-    char** papszOptions = nullptr;
-    papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
-    papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", "PACKBITS");
-    GDALDataset* outDs = poDriver->Create(outputFile, col, row, 1, GDT_Float32, papszOptions);
-    CPLFree(papszOptions);
-
-    // Set projection
-    OGRSpatialReference oSRS;
-    char* pszSRS_WKT = nullptr;
-    oSRS.SetWellKnownGeogCS("WGS84");
-    oSRS.SetUTM(int((layerExtent.centerX() + 180) / 6), true);	// UTM
-    oSRS.exportToWkt(&pszSRS_WKT);
-    outDs->SetProjection(pszSRS_WKT);
-    CPLFree(pszSRS_WKT);
-
     // Affine transform
     /*
 [0]  top left x
@@ -323,31 +256,77 @@ void KernelDensityTool::onBtnOKClicked()
         layerExtent.minX + cellSize / 2.0, cellSize, 0,
         layerExtent.maxY - cellSize / 2.0, 0, -cellSize  // Attention! minus sign!
     };
-    outDs->SetGeoTransform(adfGeoTransform);
 
-    // Write to tiff
-    GDALRasterBand* outBand = outDs->GetRasterBand(1);
-    CPLErr err = outBand->RasterIO(GF_Write, 0, 0, col, row, outData, col, row, GDT_Float32, 0, 0);
+    std::unique_ptr<GeoRasterWriter> writer;
+    if (inMemory) {
+        writer.reset(new GeoRasterWriter(col, row, 1, adfGeoTransform));
+    }
+    else {
+        // Set projection
+        OGRSpatialReference oSRS;
+        char* pszSRS_WKT = nullptr;
+        oSRS.SetWellKnownGeogCS("WGS84");
+        oSRS.SetUTM(int((layerExtent.centerX() + 180) / 6), true);	// UTM
+        oSRS.exportToWkt(&pszSRS_WKT);
+        std::string projection = pszSRS_WKT ? pszSRS_WKT : "";
+        CPLFree(pszSRS_WKT);
+
+        QByteArray bytes = outputRasterFile.toLocal8Bit();
+        writer.reset(new GeoRasterWriter(bytes.constData(), col, row, 1, adfGeoTransform, projection));
+    }
 
-    delete[] geoPoints;
-    delete[] outData;
-    GDALClose(outDs);
-
-    // Write to image failed
-    if (err != CPLErr::CE_None) {
-        QMessageBox::critical(this, "Error", "Error occured when writing image.",
-                              QMessageBox::Close);
-        LError("Calculate KED: write image to file failed");
-        this->close();
+    // Progress bar
+    QProgressDialog* progressDlg = createProgressDialog(this, tr("Kernel Density"), tr("Calculating......"));
+
+    // Hide the tool dialot
+    // Show progress bar
+    this->hide();
+
+    // Density of every grid's central point, a tile at a time
+    double searchRadiusSqure = searchRadius * searchRadius;
+    auto computeTile = [&](int xOff, int yOff, int width, int height,
+                           std::vector<std::vector<float>>& bandsPixels)
+    {
+        float* outData = bandsPixels[0].data();
+        for (int i = 0; i < height; ++i) {
+            double currY = adfGeoTransform[3] - (yOff + i) * cellSize;
+            for (int j = 0; j < width; ++j) {
+                double currX = adfGeoTransform[0] + (xOff + j) * cellSize;
+                double density = 0.0;
+                for (const GeoRawPoint& point : points) {
+                    // Judge if the point in the enclosing squre of search area(a circle)
+                    if (fabs(point.x - currX) < searchRadius && fabs(point.y - currY) < searchRadius) {
+                        double disSqure = DIS_SQURE(point.x, point.y, currX, currY);
+                        if (disSqure < searchRadiusSqure) {
+                            density += pow(1 - disSqure / searchRadiusSqure, 2);
+                        }
+                    }
+                }
+                density = density * 3.0 / (PI * searchRadiusSqure);
+                *outData++ = float(density);
+            }
+        }
+        return true;
+    };
+
+    bool ok = writer->write(computeTile, dialogProgress, progressDlg);
+    bool canceled = progressDlg->wasCanceled();
+    progressDlg->close();
+
+    if (!ok) {
+        if (!canceled) {
+            QMessageBox::critical(this, "Error", QString::fromStdString(writer->getError()),
+                                  QMessageBox::Close);
+            LError("Calculate KED: {0}", writer->getError());
+        }
+        this->show();
         return;
     }
 
     LInfo("Calculate KED successfully");
 
-    // Ask users whether add the output image to current map
-    auto reply = QMessageBox::question(this, tr("Option"), tr("Impot to the map?"), QMessageBox::Yes | QMessageBox::No);
-    if (reply == QMessageBox::Yes) {
-        GeoRasterLayer* rasterLayer = FileReader::readTiff(outputRasterFile, map);
+    GeoRasterLayer* rasterLayer = addOutputRaster(*writer, layer->getName() + "_kde");
+    if (rasterLayer) {
         emit sigAddNewLayerToLayersTree(rasterLayer);
         emit sigSendLayerToGPU(rasterLayer);
     }
@@ -2,17 +2,21 @@
 ** class name:  KernelDensityTool
 **
 ** description: KDE
+**              Output a cloud optimized GeoTIFF, or a raster layer
+**                in memory (see GeoRasterWriter)
 **
-** last change: 2020-01-02
+** last change: 2020-04-09
 **************************************************************/
 #pragma once
 
 #include "geo/tool/geotool.h"
 
+#include <QCheckBox>
 #include <QComboBox>
 #include <QDialog>
 #include <QLineEdit>
 #include <QObject>
+#include <QPushButton>
 
 
 class KernelDensityTool : public GeoTool
@@ -34,13 +38,16 @@ private:
 
 public slots:
     void onChangeInputFeatures(const QString& name);
+    void onToggleInMemory(bool checked);
     void onSetOutputRaster();
     void onBtnOKClicked();
 
 private:
     QComboBox* comboInputFeatures;
     QComboBox* comboPopiField;
+    QCheckBox* checkInMemory;
     QLineEdit* lineEditOutputRaster;
+    QPushButton* btnSelectFile;
     QLineEdit* lineEditOutputCellSize;
     QLineEdit* lineEditSearchRadius;
     QComboBox* comboAreaUnits;
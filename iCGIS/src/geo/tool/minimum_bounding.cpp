@@ -0,0 +1,273 @@
+#include "minimum_bounding.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+#include "util/memoryleakdetect.h"
+#include "geo/utility/geo_hull.h"
+#include "geo/utility/geo_measure.h"
+
+#include <cmath>
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+MinimumBoundingTool::MinimumBoundingTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Minimum Bounding Geometry"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(350, 300);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &MinimumBoundingTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &MinimumBoundingTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+MinimumBoundingTool::~MinimumBoundingTool()
+{
+}
+
+void MinimumBoundingTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input features"));
+    comboInputFeatures = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputFeatures);
+    connect(comboInputFeatures, &QComboBox::currentTextChanged,
+            this, &MinimumBoundingTool::onChangeInputFeatures);
+
+    QLabel* label2 = new QLabel(tr("Geometry type"));
+    comboGeometryType = new QComboBox();
+    comboGeometryType->addItem(tr("Convex hull"));
+    comboGeometryType->addItem(tr("Rectangle by area"));
+    comboGeometryType->addItem(tr("Circle"));
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(comboGeometryType);
+
+    QLabel* label3 = new QLabel(tr("Group option"));
+    comboGroupOption = new QComboBox();
+    comboGroupOption->addItem(tr("Each feature"));
+    comboGroupOption->addItem(tr("Selected features"));
+    comboGroupOption->addItem(tr("All features"));
+    mainLayout->addWidget(label3);
+    mainLayout->addWidget(comboGroupOption);
+
+    QLabel* label4 = new QLabel(tr("Output layer name"));
+    lineEditOutputLayer = new QLineEdit();
+    mainLayout->addWidget(label4);
+    mainLayout->addWidget(lineEditOutputLayer);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout = new QHBoxLayout();
+    hLayout->addItem(spacerItem1);
+    hLayout->addWidget(btnOK);
+    hLayout->addItem(spacerItem2);
+    hLayout->addWidget(btnCancel);
+    hLayout->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnOK, &QPushButton::clicked, this, &MinimumBoundingTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &MinimumBoundingTool::close);
+}
+
+/* Fill with default values */
+void MinimumBoundingTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kFeatureLayer) {
+            comboInputFeatures->addItem(layer->getName());
+        }
+    }
+}
+
+/* Change input feature layer */
+void MinimumBoundingTool::onChangeInputFeatures(const QString& name)
+{
+    lineEditOutputLayer->setText(name + "_MBG");
+}
+
+/* Bounding polygon of the points, nullptr if degenerate */
+GeoPolygon* MinimumBoundingTool::createBoundingPolygon(std::vector<GeoRawPoint>& points, BoundingType type)
+{
+    std::vector<GeoRawPoint> hull;
+    gm::convexHull(points, hull);
+
+    GeoLinearRing* ring = new GeoLinearRing();
+    switch (type) {
+    case kConvexHull:
+        if (hull.size() >= 3) {
+            ring->reserveNumPoints(hull.size() + 1);
+            for (auto& pt : hull)
+                ring->addPoint(pt);
+        }
+        break;
+    case kRectangle: {
+        GeoRawPoint corners[4];
+        if (hull.size() >= 3 && gm::minAreaRect(hull, corners)) {
+            ring->reserveNumPoints(5);
+            for (auto& pt : corners)
+                ring->addPoint(pt);
+        }
+        break;
+    }
+    case kCircle: {
+        GeoRawPoint center;
+        double radius = 0.0;
+        if (gm::minEnclosingCircle(hull, center, radius) && radius > 0.0) {
+            const int segmentsCount = 72;
+            ring->reserveNumPoints(segmentsCount + 1);
+            for (int i = 0; i < segmentsCount; ++i) {
+                double angle = 2 * 3.14159265358979323846 * i / segmentsCount;
+                ring->addPoint(center.x + radius * cos(angle), center.y + radius * sin(angle));
+            }
+        }
+        break;
+    }
+    }
+
+    if (ring->isEmpty()) {
+        delete ring;
+        return nullptr;
+    }
+
+    ring->closeRings();
+    GeoPolygon* polygon = new GeoPolygon();
+    polygon->setExteriorRing(ring);
+    return polygon;
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       Calculate bounding geometries  */
+/*       Output a new polygon layer     */
+/*                                      */
+/****************************************/
+void MinimumBoundingTool::onBtnOKClicked()
+{
+    GeoLayer* inputLayer = map->getLayerByName(comboInputFeatures->currentText());
+    if (!inputLayer) {
+        QMessageBox::critical(this, "Error", "Input features can't be empty");
+        return;
+    }
+    GeoFeatureLayer* layer = inputLayer->toFeatureLayer();
+    if (layer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
+
+    QString outputName = lineEditOutputLayer->text();
+    if (outputName.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Output layer name can't be empty");
+        return;
+    }
+    if (map->getLayerByName(outputName)) {
+        QMessageBox::critical(this, "Error", "Layer already exists: " + outputName);
+        return;
+    }
+
+    BoundingType type = BoundingType(comboGeometryType->currentIndex());
+    GroupOption group = GroupOption(comboGroupOption->currentIndex());
+
+    // Input features
+    std::vector<GeoFeature*> features;
+    if (group == kSelectedFeatures) {
+        features = layer->getSelectedFeatures();
+        if (features.empty()) {
+            QMessageBox::critical(this, "Error", "No features selected");
+            return;
+        }
+    }
+    else {
+        features.assign(layer->begin(), layer->end());
+    }
+    int featuresCount = features.size();
+
+    // Calculate bounding polygons
+    //   each feature: in parallel
+    //   grouped: the hull itself is calculated in parallel
+    std::vector<GeoPolygon*> polygons;
+    if (group == kEachFeature) {
+        polygons.resize(featuresCount, nullptr);
+        utils::parallelFor(0, featuresCount, [&](int i) {
+            if (features[i]->isDeleted())
+                return;
+            std::vector<GeoRawPoint> points;
+            gm::collectPoints(features[i]->getGeometry(), points);
+            polygons[i] = createBoundingPolygon(points, type);
+        });
+    }
+    else {
+        std::vector<GeoRawPoint> points;
+        points.reserve(featuresCount);
+        for (auto& feature : features) {
+            if (!feature->isDeleted())
+                gm::collectPoints(feature->getGeometry(), points);
+        }
+        polygons.push_back(createBoundingPolygon(points, type));
+    }
+
+    // Output layer
+    GeoFeatureLayer* outputLayer = new GeoFeatureLayer();
+    outputLayer->setName(outputName);
+    outputLayer->setGeometryType(kPolygon);
+    int origFIDIdx = -1;
+    if (group == kEachFeature)
+        origFIDIdx = outputLayer->addField("ORIG_FID", 10, kFieldInt);
+    int areaIdx = outputLayer->addField("AREA", 20, kFieldDouble);
+
+    unsigned int color = utils::getRandomColor();
+    int polygonsCount = polygons.size();
+    for (int i = 0; i < polygonsCount; ++i) {
+        if (!polygons[i])
+            continue;
+        GeoFeature* feature = new GeoFeature(outputLayer);
+        feature->setGeometry(polygons[i]);
+        feature->updateExtent();
+        feature->setColor(color, false);
+        if (origFIDIdx != -1)
+            feature->setField(origFIDIdx, features[i]->getFID());
+        feature->setField(areaIdx, gm::area(polygons[i]));
+        outputLayer->addFeature(feature);
+    }
+
+    if (outputLayer->isEmpty()) {
+        delete outputLayer;
+        QMessageBox::critical(this, "Error", "No valid bounding geometry (too few distinct points)");
+        return;
+    }
+
+    outputLayer->createGridIndex();
+    map->addLayer(outputLayer);
+    LInfo("Minimum bounding geometry: {0} polygons", outputLayer->getFeatureCount());
+
+    emit sigAddNewLayerToLayersTree(outputLayer);
+    emit sigSendLayerToGPU(outputLayer);
+
+    this->close();
+}
@@ -0,0 +1,58 @@
+/**************************************************************
+** class name:  MinimumBoundingTool
+**
+** description: Minimum bounding geometry
+**                convex hull, rectangle by area, circle
+**              of each feature, the selected features or the
+**              whole layer. Output a new polygon layer.
+**
+** last change: 2020-04-04
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+
+
+class MinimumBoundingTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    MinimumBoundingTool(QWidget* parent = nullptr);
+    ~MinimumBoundingTool();
+
+    enum BoundingType {
+        kConvexHull     = 0,
+        kRectangle      = 1,
+        kCircle         = 2
+    };
+
+    enum GroupOption {
+        kEachFeature        = 0,
+        kSelectedFeatures   = 1,
+        kAllFeatures        = 2
+    };
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+    GeoPolygon* createBoundingPolygon(std::vector<GeoRawPoint>& points, BoundingType type);
+
+public slots:
+    void onChangeInputFeatures(const QString& name);
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputFeatures;
+    QComboBox* comboGeometryType;
+    QComboBox* comboGroupOption;
+    QLineEdit* lineEditOutputLayer;
+};
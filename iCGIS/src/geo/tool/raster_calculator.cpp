@@ -0,0 +1,187 @@
+#include "raster_calculator.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/memoryleakdetect.h"
+#include "geo/raster/georastercalculator.h"
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+RasterCalculatorTool::RasterCalculatorTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Raster Calculator"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(400, 450);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &RasterCalculatorTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &RasterCalculatorTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+RasterCalculatorTool::~RasterCalculatorTool()
+{
+}
+
+void RasterCalculatorTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Bands (double click to insert)"));
+    listBands = new QListWidget();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(listBands);
+    connect(listBands, &QListWidget::itemDoubleClicked,
+            this, &RasterCalculatorTool::onInsertBand);
+
+    QLabel* label2 = new QLabel(tr("Expression, e.g. (b4 - b3) / (b4 + b3), b1 > 100 ? 1 : 0"));
+    lineEditExpression = new QLineEdit();
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(lineEditExpression);
+
+    checkInMemory = new QCheckBox(tr("Add to the map in memory (no file)"));
+    mainLayout->addWidget(checkInMemory);
+    connect(checkInMemory, &QCheckBox::toggled, this, &RasterCalculatorTool::onToggleInMemory);
+
+    QLabel* label3 = new QLabel(tr("Output raster"));
+    lineEditOutputRaster = new QLineEdit();
+    btnSelectFile = new QPushButton();
+    btnSelectFile->setIcon(QIcon("res/icons/open.ico"));
+    QHBoxLayout* hLayout1 = new QHBoxLayout();
+    hLayout1->addWidget(lineEditOutputRaster);
+    hLayout1->addWidget(btnSelectFile);
+    mainLayout->addWidget(label3);
+    mainLayout->addLayout(hLayout1);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout2 = new QHBoxLayout();
+    hLayout2->addItem(spacerItem1);
+    hLayout2->addWidget(btnOK);
+    hLayout2->addItem(spacerItem2);
+    hLayout2->addWidget(btnCancel);
+    hLayout2->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout2);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnSelectFile, &QPushButton::clicked, this, &RasterCalculatorTool::onSetOutputRaster);
+    connect(btnOK, &QPushButton::clicked, this, &RasterCalculatorTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &RasterCalculatorTool::close);
+}
+
+/* List the bands of all the raster layers */
+void RasterCalculatorTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() != kRasterLayer)
+            continue;
+        GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+        if (!rasterData)
+            continue;
+        int bandsCount = rasterData->getBandsCount();
+        for (int iBand = 0; iBand < bandsCount; ++iBand) {
+            GeoRasterBand* band = rasterData->getBand(iBand);
+            bands.push_back(band);
+            listBands->addItem(QString("b%1: %2 - band %3 (%4 x %5)")
+                               .arg(bands.size()).arg(layer->getName()).arg(iBand + 1)
+                               .arg(band->width).arg(band->height));
+        }
+    }
+}
+
+void RasterCalculatorTool::onInsertBand(QListWidgetItem* item)
+{
+    int idx = listBands->row(item);
+    lineEditExpression->insert(QString("b%1").arg(idx + 1));
+    lineEditExpression->setFocus();
+}
+
+void RasterCalculatorTool::onToggleInMemory(bool checked)
+{
+    lineEditOutputRaster->setEnabled(!checked);
+    btnSelectFile->setEnabled(!checked);
+}
+
+/* Change output file */
+void RasterCalculatorTool::onSetOutputRaster()
+{
+    QString filepath = QFileDialog::getSaveFileName(this, tr("Set output raster file"), ".", "TIFF File(*.tif)");
+    lineEditOutputRaster->setText(filepath);
+}
+
+void RasterCalculatorTool::onBtnOKClicked()
+{
+    if (bands.empty()) {
+        QMessageBox::critical(this, "Error", "No raster layer");
+        return;
+    }
+
+    GeoRasterCalculator calculator(bands);
+    QByteArray expressionBytes = lineEditExpression->text().toLocal8Bit();
+    if (!calculator.compile(expressionBytes.constData())) {
+        QMessageBox::critical(this, "Error", "Invalid expression: " + QString::fromStdString(calculator.getError()));
+        return;
+    }
+
+    bool inMemory = checkInMemory->isChecked();
+    QString outputRasterFile = lineEditOutputRaster->text();
+    if (!inMemory && outputRasterFile.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Ouput raster file can't be empty");
+        return;
+    }
+
+    // Empty path: in memory
+    QByteArray outputBytes = inMemory ? QByteArray() : outputRasterFile.toLocal8Bit();
+    std::unique_ptr<GeoRasterWriter> writer = calculator.createWriter(outputBytes.constData());
+    if (!writer) {
+        QMessageBox::critical(this, "Error", QString::fromStdString(calculator.getError()));
+        return;
+    }
+
+    // Progress bar
+    QProgressDialog* progressDlg = createProgressDialog(this, tr("Raster Calculator"), tr("Calculating......"));
+
+    this->hide();
+
+    bool ok = calculator.run(*writer, dialogProgress, progressDlg);
+    bool canceled = progressDlg->wasCanceled();
+    progressDlg->close();
+
+    if (!ok) {
+        if (!canceled)
+            QMessageBox::critical(this, "Error", QString::fromStdString(calculator.getError()), QMessageBox::Close);
+        this->show();
+        return;
+    }
+
+    GeoRasterLayer* rasterLayer = addOutputRaster(*writer, lineEditExpression->text().trimmed());
+    if (rasterLayer) {
+        emit sigAddNewLayerToLayersTree(rasterLayer);
+        emit sigSendLayerToGPU(rasterLayer);
+    }
+
+    this->close();
+}
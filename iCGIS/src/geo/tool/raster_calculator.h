@@ -0,0 +1,57 @@
+/**************************************************************
+** class name:  RasterCalculatorTool
+**
+** description: Map algebra over the bands of the raster layers,
+**                e.g. (b4 - b3) / (b4 + b3)
+**              The bands of all the raster layers are b1, b2...
+**                in the order listed, those used must be aligned
+**              Output a cloud optimized GeoTIFF, or a raster layer
+**                in memory (see GeoRasterCalculator)
+**
+** last change: 2020-04-09
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QCheckBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QObject>
+#include <QPushButton>
+
+#include <vector>
+
+
+class RasterCalculatorTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    RasterCalculatorTool(QWidget* parent = nullptr);
+    ~RasterCalculatorTool();
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onInsertBand(QListWidgetItem* item);
+    void onToggleInMemory(bool checked);
+    void onSetOutputRaster();
+    void onBtnOKClicked();
+
+private:
+    QListWidget* listBands;
+    QLineEdit* lineEditExpression;
+    QCheckBox* checkInMemory;
+    QLineEdit* lineEditOutputRaster;
+    QPushButton* btnSelectFile;
+
+    // b1, b2...
+    std::vector<const GeoRasterBand*> bands;
+};
@@ -0,0 +1,265 @@
+#include "reproject_raster.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/memoryleakdetect.h"
+#include "geo/raster/georasterwarper.h"
+
+#include <gdal/ogr_spatialref.h>
+#include <gdal/cpl_conv.h>
+
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+namespace {
+
+// "EPSG:4326", a WKT, a PROJ string... -> WKT, empty if invalid
+std::string toWkt(const QString& userInput)
+{
+    OGRSpatialReference oSRS;
+    QByteArray bytes = userInput.toLocal8Bit();
+    if (bytes.isEmpty() || oSRS.SetFromUserInput(bytes.constData()) != OGRERR_NONE)
+        return std::string();
+    char* pszWkt = nullptr;
+    std::string wkt;
+    if (oSRS.exportToWkt(&pszWkt) == OGRERR_NONE && pszWkt)
+        wkt = pszWkt;
+    CPLFree(pszWkt);
+    return wkt;
+}
+
+// "EPSG:xxxx" if the WKT has an authority code, else the WKT
+QString toUserInput(const QString& wkt)
+{
+    OGRSpatialReference oSRS;
+    QByteArray bytes = wkt.toLocal8Bit();
+    if (bytes.isEmpty() || oSRS.SetFromUserInput(bytes.constData()) != OGRERR_NONE)
+        return wkt;
+    const char* pszName = oSRS.GetAuthorityName(nullptr);
+    const char* pszCode = oSRS.GetAuthorityCode(nullptr);
+    if (pszName && pszCode)
+        return QString("%1:%2").arg(pszName).arg(pszCode);
+    return wkt;
+}
+
+} // namespace
+
+
+ReprojectRasterTool::ReprojectRasterTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Reproject Raster"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(400, 370);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &ReprojectRasterTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &ReprojectRasterTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+ReprojectRasterTool::~ReprojectRasterTool()
+{
+}
+
+void ReprojectRasterTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input raster"));
+    comboInputRaster = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputRaster);
+    connect(comboInputRaster, &QComboBox::currentTextChanged,
+            this, &ReprojectRasterTool::onChangeInputRaster);
+
+    QLabel* label2 = new QLabel(tr("Target coordinate system (EPSG:4326, WKT or PROJ)"));
+    lineEditTargetSRS = new QLineEdit();
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(lineEditTargetSRS);
+
+    QLabel* label3 = new QLabel(tr("Resampling"));
+    comboResampling = new QComboBox();
+    comboResampling->addItem(tr("Nearest"));
+    comboResampling->addItem(tr("Bilinear"));
+    comboResampling->addItem(tr("Cubic"));
+    mainLayout->addWidget(label3);
+    mainLayout->addWidget(comboResampling);
+
+    QLabel* label4 = new QLabel(tr("Resolution (empty: about the input's)"));
+    lineEditResolution = new QLineEdit();
+    mainLayout->addWidget(label4);
+    mainLayout->addWidget(lineEditResolution);
+
+    checkInMemory = new QCheckBox(tr("Add to the map in memory (no file)"));
+    mainLayout->addWidget(checkInMemory);
+    connect(checkInMemory, &QCheckBox::toggled, this, &ReprojectRasterTool::onToggleInMemory);
+
+    QLabel* label5 = new QLabel(tr("Output raster"));
+    lineEditOutputRaster = new QLineEdit();
+    btnSelectFile = new QPushButton();
+    btnSelectFile->setIcon(QIcon("res/icons/open.ico"));
+    QHBoxLayout* hLayout1 = new QHBoxLayout();
+    hLayout1->addWidget(lineEditOutputRaster);
+    hLayout1->addWidget(btnSelectFile);
+    mainLayout->addWidget(label5);
+    mainLayout->addLayout(hLayout1);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout2 = new QHBoxLayout();
+    hLayout2->addItem(spacerItem1);
+    hLayout2->addWidget(btnOK);
+    hLayout2->addItem(spacerItem2);
+    hLayout2->addWidget(btnCancel);
+    hLayout2->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout2);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnSelectFile, &QPushButton::clicked, this, &ReprojectRasterTool::onSetOutputRaster);
+    connect(btnOK, &QPushButton::clicked, this, &ReprojectRasterTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &ReprojectRasterTool::close);
+}
+
+/* The raster layers, the map's coordinate system */
+void ReprojectRasterTool::initializeFill()
+{
+    lineEditTargetSRS->setText(toUserInput(map->getSpatialRef()));
+
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kRasterLayer)
+            comboInputRaster->addItem(layer->getName());
+    }
+}
+
+/* Change input raster layer */
+void ReprojectRasterTool::onChangeInputRaster(const QString& name)
+{
+    GeoLayer* layer = map->getLayerByName(name);
+    if (!layer)
+        return;
+    QString sourcePath = layer->toRasterLayer()->getSourcePath();
+    if (!sourcePath.isEmpty()) {
+        QFileInfo info(sourcePath);
+        lineEditOutputRaster->setText(info.absolutePath() + "/" + info.completeBaseName() + "_warped.tif");
+    }
+}
+
+void ReprojectRasterTool::onToggleInMemory(bool checked)
+{
+    lineEditOutputRaster->setEnabled(!checked);
+    btnSelectFile->setEnabled(!checked);
+}
+
+/* Change output file */
+void ReprojectRasterTool::onSetOutputRaster()
+{
+    QString filepath = QFileDialog::getSaveFileName(this, tr("Set output raster file"), ".", "TIFF File(*.tif)");
+    lineEditOutputRaster->setText(filepath);
+}
+
+void ReprojectRasterTool::onBtnOKClicked()
+{
+    GeoLayer* inputLayer = map->getLayerByName(comboInputRaster->currentText());
+    GeoRasterData* rasterData = inputLayer ? inputLayer->toRasterLayer()->getData() : nullptr;
+    if (!rasterData || rasterData->getBandsCount() == 0) {
+        QMessageBox::critical(this, "Error", "Input raster can't be empty");
+        return;
+    }
+
+    // The coordinate system of the raster is the one of its file
+    std::string srcWkt;
+    if (rasterData->getBand(0)->isTiled())
+        srcWkt = rasterData->getBand(0)->getSource()->getProjection();
+    if (srcWkt.empty()) {
+        QMessageBox::critical(this, "Error", "The coordinate system of the input raster is unknown");
+        return;
+    }
+
+    std::string dstWkt = toWkt(lineEditTargetSRS->text().trimmed());
+    if (dstWkt.empty()) {
+        QMessageBox::critical(this, "Error", "Invalid target coordinate system");
+        return;
+    }
+
+    double resolution = 0.0;
+    if (!lineEditResolution->text().trimmed().isEmpty()) {
+        bool ok = false;
+        resolution = lineEditResolution->text().toDouble(&ok);
+        if (!ok || resolution <= 0.0) {
+            QMessageBox::critical(this, "Error", "Invalid resolution");
+            return;
+        }
+    }
+
+    bool inMemory = checkInMemory->isChecked();
+    QString outputRasterFile = lineEditOutputRaster->text();
+    if (!inMemory && outputRasterFile.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Ouput raster file can't be empty");
+        return;
+    }
+
+    std::vector<const GeoRasterBand*> bands;
+    for (int iBand = 0; iBand < rasterData->getBandsCount(); ++iBand)
+        bands.push_back(rasterData->getBand(iBand));
+    GeoRasterWarper warper(bands, srcWkt);
+    auto resampling = GeoRasterWarper::Resampling(comboResampling->currentIndex());
+    if (!warper.setTarget(dstWkt, resampling, resolution)) {
+        QMessageBox::critical(this, "Error", QString::fromStdString(warper.getError()));
+        return;
+    }
+
+    // Empty path: in memory
+    QByteArray outputBytes = inMemory ? QByteArray() : outputRasterFile.toLocal8Bit();
+    std::unique_ptr<GeoRasterWriter> writer = warper.createWriter(outputBytes.constData());
+    if (!writer) {
+        QMessageBox::critical(this, "Error", QString::fromStdString(warper.getError()));
+        return;
+    }
+
+    // Progress bar
+    QProgressDialog* progressDlg = createProgressDialog(this, tr("Reproject Raster"), tr("Warping......"));
+
+    this->hide();
+
+    bool ok = warper.run(*writer, dialogProgress, progressDlg);
+    bool canceled = progressDlg->wasCanceled();
+    progressDlg->close();
+
+    if (!ok) {
+        if (!canceled)
+            QMessageBox::critical(this, "Error", QString::fromStdString(warper.getError()), QMessageBox::Close);
+        this->show();
+        return;
+    }
+
+    GeoRasterLayer* rasterLayer = addOutputRaster(*writer, inputLayer->getName() + "_warped");
+    if (rasterLayer) {
+        emit sigAddNewLayerToLayersTree(rasterLayer);
+        emit sigSendLayerToGPU(rasterLayer);
+    }
+
+    this->close();
+}
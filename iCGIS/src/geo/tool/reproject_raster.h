@@ -0,0 +1,53 @@
+/**************************************************************
+** class name:  ReprojectRasterTool
+**
+** description: Warp a raster layer into another coordinate
+**                system (the map's by default), resampled by
+**                nearest, bilinear or cubic
+**              Output a cloud optimized GeoTIFF, or a raster layer
+**                in memory (see GeoRasterWarper)
+**
+** last change: 2020-04-09
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+#include <QPushButton>
+
+
+class ReprojectRasterTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    ReprojectRasterTool(QWidget* parent = nullptr);
+    ~ReprojectRasterTool();
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputRaster(const QString& name);
+    void onToggleInMemory(bool checked);
+    void onSetOutputRaster();
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputRaster;
+    QLineEdit* lineEditTargetSRS;
+    QComboBox* comboResampling;
+    QLineEdit* lineEditResolution;
+    QCheckBox* checkInMemory;
+    QLineEdit* lineEditOutputRaster;
+    QPushButton* btnSelectFile;
+};
@@ -0,0 +1,300 @@
+#include "terrain_analysis.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/memoryleakdetect.h"
+#include "geo/raster/georasterband.h"
+#include "geo/raster/georasterterrain.h"
+
+#include <gdal/ogr_spatialref.h>
+
+#include <cstring>
+
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+namespace {
+
+// Meters per degree, at the equator
+const double kMetersPerDegree = 111120.0;
+
+// A DEM in degrees: from its coordinate system, else guessed from its extent
+bool isGeographic(const GeoRasterBand* band, const GeoExtent& extent)
+{
+    if (band->isTiled() && !band->getSource()->getProjection().empty()) {
+        OGRSpatialReference oSRS;
+        if (oSRS.SetFromUserInput(band->getSource()->getProjection().c_str()) == OGRERR_NONE)
+            return oSRS.IsGeographic();
+    }
+    return extent.minX >= -180.0 && extent.maxX <= 360.0
+        && extent.minY >= -90.0 && extent.maxY <= 90.0;
+}
+
+const char* suffixes[] = { "_slope", "_aspect", "_hillshade", "_curvature" };
+
+} // namespace
+
+
+TerrainAnalysisTool::TerrainAnalysisTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Terrain Analysis"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(400, 450);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &TerrainAnalysisTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &TerrainAnalysisTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+TerrainAnalysisTool::~TerrainAnalysisTool()
+{
+}
+
+void TerrainAnalysisTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input DEM"));
+    comboInputRaster = new QComboBox();
+    comboBand = new QComboBox();
+    QHBoxLayout* hLayout1 = new QHBoxLayout();
+    hLayout1->addWidget(comboInputRaster, 1);
+    hLayout1->addWidget(comboBand);
+    mainLayout->addWidget(label1);
+    mainLayout->addLayout(hLayout1);
+    connect(comboInputRaster, &QComboBox::currentTextChanged,
+            this, &TerrainAnalysisTool::onChangeInputRaster);
+
+    // Same order as GeoRasterTerrain::Product
+    QLabel* label2 = new QLabel(tr("Output"));
+    comboProduct = new QComboBox();
+    comboProduct->addItem(tr("Slope (degrees)"));
+    comboProduct->addItem(tr("Aspect (degrees)"));
+    comboProduct->addItem(tr("Hillshade"));
+    comboProduct->addItem(tr("Curvature"));
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(comboProduct);
+    connect(comboProduct, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &TerrainAnalysisTool::onChangeProduct);
+
+    QLabel* label3 = new QLabel(tr("Z factor"));
+    lineEditZFactor = new QLineEdit("1");
+    QLabel* label4 = new QLabel(tr("Z units per XY unit"));
+    lineEditScale = new QLineEdit("1");
+    QHBoxLayout* hLayout2 = new QHBoxLayout();
+    hLayout2->addWidget(label3);
+    hLayout2->addWidget(lineEditZFactor);
+    hLayout2->addWidget(label4);
+    hLayout2->addWidget(lineEditScale);
+    mainLayout->addLayout(hLayout2);
+
+    QLabel* label5 = new QLabel(tr("Light: azimuth"));
+    lineEditAzimuth = new QLineEdit("315");
+    QLabel* label6 = new QLabel(tr("altitude"));
+    lineEditAltitude = new QLineEdit("45");
+    QHBoxLayout* hLayout3 = new QHBoxLayout();
+    hLayout3->addWidget(label5);
+    hLayout3->addWidget(lineEditAzimuth);
+    hLayout3->addWidget(label6);
+    hLayout3->addWidget(lineEditAltitude);
+    mainLayout->addLayout(hLayout3);
+
+    checkInMemory = new QCheckBox(tr("Add to the map in memory (no file)"));
+    mainLayout->addWidget(checkInMemory);
+    connect(checkInMemory, &QCheckBox::toggled, this, &TerrainAnalysisTool::onToggleInMemory);
+
+    QLabel* label7 = new QLabel(tr("Output raster"));
+    lineEditOutputRaster = new QLineEdit();
+    btnSelectFile = new QPushButton();
+    btnSelectFile->setIcon(QIcon("res/icons/open.ico"));
+    QHBoxLayout* hLayout4 = new QHBoxLayout();
+    hLayout4->addWidget(lineEditOutputRaster);
+    hLayout4->addWidget(btnSelectFile);
+    mainLayout->addWidget(label7);
+    mainLayout->addLayout(hLayout4);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout5 = new QHBoxLayout();
+    hLayout5->addItem(spacerItem1);
+    hLayout5->addWidget(btnOK);
+    hLayout5->addItem(spacerItem2);
+    hLayout5->addWidget(btnCancel);
+    hLayout5->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout5);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnSelectFile, &QPushButton::clicked, this, &TerrainAnalysisTool::onSetOutputRaster);
+    connect(btnOK, &QPushButton::clicked, this, &TerrainAnalysisTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &TerrainAnalysisTool::close);
+}
+
+/* The raster layers */
+void TerrainAnalysisTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kRasterLayer)
+            comboInputRaster->addItem(layer->getName());
+    }
+    onChangeProduct(comboProduct->currentIndex());
+}
+
+/* The bands of the DEM, its scale, the output file */
+void TerrainAnalysisTool::onChangeInputRaster(const QString& name)
+{
+    comboBand->clear();
+    GeoLayer* layer = map->getLayerByName(name);
+    if (!layer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    int bandsCount = rasterData ? rasterData->getBandsCount() : 0;
+    for (int iBand = 0; iBand < bandsCount; ++iBand)
+        comboBand->addItem(tr("Band %1").arg(iBand + 1));
+
+    if (bandsCount > 0) {
+        bool geographic = isGeographic(rasterData->getBand(0), rasterData->getExtent());
+        lineEditScale->setText(QString::number(geographic ? kMetersPerDegree : 1.0));
+    }
+
+    QString sourcePath = layer->toRasterLayer()->getSourcePath();
+    if (!sourcePath.isEmpty()) {
+        QFileInfo info(sourcePath);
+        lineEditOutputRaster->setText(info.absolutePath() + "/" + info.completeBaseName()
+                                      + suffixes[comboProduct->currentIndex()] + ".tif");
+    }
+}
+
+/* The light is only for the hillshade */
+void TerrainAnalysisTool::onChangeProduct(int index)
+{
+    bool hillshade = index == GeoRasterTerrain::kHillshade;
+    lineEditAzimuth->setEnabled(hillshade);
+    lineEditAltitude->setEnabled(hillshade);
+
+    QString filepath = lineEditOutputRaster->text();
+    if (!filepath.isEmpty() && index >= 0) {
+        QFileInfo info(filepath);
+        QString baseName = info.completeBaseName();
+        for (const char* suffix : suffixes) {
+            if (baseName.endsWith(suffix)) {
+                baseName.chop(int(strlen(suffix)));
+                break;
+            }
+        }
+        lineEditOutputRaster->setText(info.absolutePath() + "/" + baseName + suffixes[index] + ".tif");
+    }
+}
+
+void TerrainAnalysisTool::onToggleInMemory(bool checked)
+{
+    lineEditOutputRaster->setEnabled(!checked);
+    btnSelectFile->setEnabled(!checked);
+}
+
+/* Change output file */
+void TerrainAnalysisTool::onSetOutputRaster()
+{
+    QString filepath = QFileDialog::getSaveFileName(this, tr("Set output raster file"), ".", "TIFF File(*.tif)");
+    lineEditOutputRaster->setText(filepath);
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       3 x 3 kernels over the DEM     */
+/*       To a file, or to a layer       */
+/*                                      */
+/****************************************/
+void TerrainAnalysisTool::onBtnOKClicked()
+{
+    GeoLayer* inputLayer = map->getLayerByName(comboInputRaster->currentText());
+    GeoRasterData* rasterData = inputLayer ? inputLayer->toRasterLayer()->getData() : nullptr;
+    int iBand = comboBand->currentIndex();
+    if (!rasterData || iBand < 0 || iBand >= rasterData->getBandsCount()) {
+        QMessageBox::critical(this, "Error", "Input DEM can't be empty");
+        return;
+    }
+
+    bool ok1 = false, ok2 = false, ok3 = false, ok4 = false;
+    double zFactor = lineEditZFactor->text().toDouble(&ok1);
+    double scale = lineEditScale->text().toDouble(&ok2);
+    double azimuth = lineEditAzimuth->text().toDouble(&ok3);
+    double altitude = lineEditAltitude->text().toDouble(&ok4);
+    if (!ok1 || !ok2 || zFactor == 0.0 || scale <= 0.0) {
+        QMessageBox::critical(this, "Error", "Invalid z factor or z units");
+        return;
+    }
+    auto product = GeoRasterTerrain::Product(comboProduct->currentIndex());
+    if (product == GeoRasterTerrain::kHillshade && (!ok3 || !ok4 || altitude < 0.0 || altitude > 90.0)) {
+        QMessageBox::critical(this, "Error", "Invalid light, the altitude is in [0, 90]");
+        return;
+    }
+
+    bool inMemory = checkInMemory->isChecked();
+    QString outputRasterFile = lineEditOutputRaster->text();
+    if (!inMemory && outputRasterFile.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Ouput raster file can't be empty");
+        return;
+    }
+
+    const GeoRasterBand* dem = rasterData->getBand(iBand);
+    GeoRasterTerrain terrain(dem, product);
+    terrain.setZFactor(zFactor);
+    terrain.setScale(scale);
+    terrain.setLight(azimuth, altitude);
+
+    // Empty path: in memory
+    QByteArray outputBytes = inMemory ? QByteArray() : outputRasterFile.toLocal8Bit();
+    std::unique_ptr<GeoRasterWriter> writer = terrain.createWriter(outputBytes.constData());
+    if (!writer) {
+        QMessageBox::critical(this, "Error", QString::fromStdString(terrain.getError()));
+        return;
+    }
+
+    // Progress bar
+    QProgressDialog* progressDlg = createProgressDialog(this, tr("Terrain Analysis"), tr("Calculating......"));
+
+    this->hide();
+
+    bool ok = terrain.run(*writer, dialogProgress, progressDlg);
+    bool canceled = progressDlg->wasCanceled();
+    progressDlg->close();
+
+    if (!ok) {
+        if (!canceled)
+            QMessageBox::critical(this, "Error", QString::fromStdString(terrain.getError()), QMessageBox::Close);
+        this->show();
+        return;
+    }
+
+    GeoRasterLayer* rasterLayer = addOutputRaster(*writer, inputLayer->getName() + suffixes[product]);
+    if (rasterLayer) {
+        emit sigAddNewLayerToLayersTree(rasterLayer);
+        emit sigSendLayerToGPU(rasterLayer);
+    }
+
+    this->close();
+}
@@ -0,0 +1,56 @@
+/**************************************************************
+** class name:  TerrainAnalysisTool
+**
+** description: Slope, aspect, hillshade or curvature of a DEM
+**                band (see GeoRasterTerrain)
+**              Output a cloud optimized GeoTIFF, or a raster layer in
+**                memory added to the map
+**
+** last change: 2020-04-09
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+#include <QPushButton>
+
+
+class TerrainAnalysisTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    TerrainAnalysisTool(QWidget* parent = nullptr);
+    ~TerrainAnalysisTool();
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputRaster(const QString& name);
+    void onChangeProduct(int index);
+    void onToggleInMemory(bool checked);
+    void onSetOutputRaster();
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputRaster;
+    QComboBox* comboBand;
+    QComboBox* comboProduct;
+    QLineEdit* lineEditZFactor;
+    QLineEdit* lineEditScale;
+    QLineEdit* lineEditAzimuth;
+    QLineEdit* lineEditAltitude;
+    QCheckBox* checkInMemory;
+    QLineEdit* lineEditOutputRaster;
+    QPushButton* btnSelectFile;
+};
@@ -0,0 +1,200 @@
+#include "voronoi_diagram.h"
+
+#include "util/appevent.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+#include "util/memoryleakdetect.h"
+#include "geo/utility/geo_delaunay.h"
+#include "geo/utility/geo_hull.h"
+#include "geo/utility/geo_measure.h"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+VoronoiDiagramTool::VoronoiDiagramTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Voronoi Diagram"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(350, 180);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+
+    connect(this, &VoronoiDiagramTool::sigAddNewLayerToLayersTree,
+            AppEvent::getInstance(), &AppEvent::onAddNewLayerToLayersTree);
+    connect(this, &VoronoiDiagramTool::sigSendLayerToGPU,
+            AppEvent::getInstance(), &AppEvent::onSendLayerToGPU);
+}
+
+VoronoiDiagramTool::~VoronoiDiagramTool()
+{
+}
+
+void VoronoiDiagramTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input point features"));
+    comboInputFeatures = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputFeatures);
+    connect(comboInputFeatures, &QComboBox::currentTextChanged,
+            this, &VoronoiDiagramTool::onChangeInputFeatures);
+
+    QLabel* label2 = new QLabel(tr("Output layer name"));
+    lineEditOutputLayer = new QLineEdit();
+    mainLayout->addWidget(label2);
+    mainLayout->addWidget(lineEditOutputLayer);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout = new QHBoxLayout();
+    hLayout->addItem(spacerItem1);
+    hLayout->addWidget(btnOK);
+    hLayout->addItem(spacerItem2);
+    hLayout->addWidget(btnCancel);
+    hLayout->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnOK, &QPushButton::clicked, this, &VoronoiDiagramTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &VoronoiDiagramTool::close);
+}
+
+/* Fill with default values */
+void VoronoiDiagramTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kFeatureLayer) {
+            GeometryType geomType = layer->toFeatureLayer()->getGeometryType();
+            if (geomType == kPoint || geomType == kMultiPoint)
+                comboInputFeatures->addItem(layer->getName());
+        }
+    }
+}
+
+/* Change input feature layer */
+void VoronoiDiagramTool::onChangeInputFeatures(const QString& name)
+{
+    lineEditOutputLayer->setText(name + "_Voronoi");
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       Voronoi cells of the points    */
+/*       Output a new polygon layer     */
+/*                                      */
+/****************************************/
+void VoronoiDiagramTool::onBtnOKClicked()
+{
+    GeoLayer* inputLayer = map->getLayerByName(comboInputFeatures->currentText());
+    if (!inputLayer) {
+        QMessageBox::critical(this, "Error", "Input features can't be empty");
+        return;
+    }
+    GeoFeatureLayer* layer = inputLayer->toFeatureLayer();
+    if (layer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
+
+    QString outputName = lineEditOutputLayer->text();
+    if (outputName.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Output layer name can't be empty");
+        return;
+    }
+    if (map->getLayerByName(outputName)) {
+        QMessageBox::critical(this, "Error", "Layer already exists: " + outputName);
+        return;
+    }
+
+    // Input points, and the FID of the feature each point belongs to
+    std::vector<GeoRawPoint> points;
+    std::vector<int> pointFIDs;
+    points.reserve(layer->getFeatureCount());
+    pointFIDs.reserve(layer->getFeatureCount());
+    for (auto& feature : *layer) {
+        if (feature->isDeleted())
+            continue;
+        gm::collectPoints(feature->getGeometry(), points);
+        pointFIDs.resize(points.size(), feature->getFID());
+    }
+
+    std::vector<std::vector<GeoRawPoint>> cells;
+    if (!gm::voronoiCells(points, layer->getExtent(), cells)) {
+        QMessageBox::critical(this, "Error", "Voronoi diagram failed (too few distinct points)");
+        return;
+    }
+
+    // Output layer
+    GeoFeatureLayer* outputLayer = new GeoFeatureLayer();
+    outputLayer->setName(outputName);
+    outputLayer->setGeometryType(kPolygon);
+    int origFIDIdx = outputLayer->addField("ORIG_FID", 10, kFieldInt);
+    int areaIdx = outputLayer->addField("AREA", 20, kFieldDouble);
+
+    // Build the features in parallel, add them in order
+    int cellsCount = cells.size();
+    unsigned int color = utils::getRandomColor();
+    std::vector<GeoFeature*> newFeatures(cellsCount, nullptr);
+    utils::parallelFor(0, cellsCount, [&](int i) {
+        std::vector<GeoRawPoint>& cell = cells[i];
+        if (cell.empty())
+            return;     // duplicated point
+
+        GeoLinearRing* ring = new GeoLinearRing();
+        ring->reserveNumPoints(cell.size() + 1);
+        for (auto& pt : cell)
+            ring->addPoint(pt);
+        ring->closeRings();
+        GeoPolygon* polygon = new GeoPolygon();
+        polygon->setExteriorRing(ring);
+        std::vector<GeoRawPoint>().swap(cell);
+
+        GeoFeature* feature = new GeoFeature(outputLayer);
+        feature->setGeometry(polygon);
+        feature->updateExtent();
+        feature->setColor(color, false);
+        feature->setField(origFIDIdx, pointFIDs[i]);
+        feature->setField(areaIdx, gm::area(polygon));
+        newFeatures[i] = feature;
+    }, 1024);
+
+    for (auto& feature : newFeatures) {
+        if (feature)
+            outputLayer->addFeature(feature);
+    }
+
+    if (outputLayer->isEmpty()) {
+        delete outputLayer;
+        QMessageBox::critical(this, "Error", "No valid Voronoi cell (the extent of the layer is empty)");
+        return;
+    }
+
+    outputLayer->createGridIndex();
+    map->addLayer(outputLayer);
+    LInfo("Voronoi diagram: {0} cells", outputLayer->getFeatureCount());
+
+    emit sigAddNewLayerToLayersTree(outputLayer);
+    emit sigSendLayerToGPU(outputLayer);
+
+    this->close();
+}
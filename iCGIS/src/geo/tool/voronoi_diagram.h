@@ -0,0 +1,42 @@
+/**************************************************************
+** class name:  VoronoiDiagramTool
+**
+** description: Voronoi diagram (Thiessen polygons) of a point
+**              layer, clipped to the extent of the layer.
+**              Output a new polygon layer, one cell per point.
+**
+** last change: 2020-04-05
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+
+
+class VoronoiDiagramTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    VoronoiDiagramTool(QWidget* parent = nullptr);
+    ~VoronoiDiagramTool();
+
+signals:
+    void sigSendLayerToGPU(GeoLayer* layer, bool bUpdate = true);
+    void sigAddNewLayerToLayersTree(GeoLayer* layer, bool bUpdate = true);
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputFeatures(const QString& name);
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputFeatures;
+    QLineEdit* lineEditOutputLayer;
+};
@@ -0,0 +1,202 @@
+#include "zonal_statistics.h"
+
+#include "util/logger.h"
+#include "util/memoryleakdetect.h"
+#include "geo/utility/geo_zonal.h"
+
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QVBoxLayout>
+
+
+ZonalStatisticsTool::ZonalStatisticsTool(QWidget* parent /*= nullptr*/)
+    : GeoTool(parent)
+{
+    this->setWindowTitle(tr("Zonal Statistics"));
+    this->setWindowIcon(QIcon("res/icons/tool.ico"));
+    this->setAttribute(Qt::WA_DeleteOnClose, true);
+    this->setFixedSize(350, 380);
+    this->setModal(true);
+
+    setupLayout();
+    initializeFill();
+}
+
+ZonalStatisticsTool::~ZonalStatisticsTool()
+{
+}
+
+void ZonalStatisticsTool::setupLayout()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    QLabel* label1 = new QLabel(tr("Input polygons (zones)"));
+    comboInputFeatures = new QComboBox();
+    mainLayout->addWidget(label1);
+    mainLayout->addWidget(comboInputFeatures);
+
+    QLabel* label2 = new QLabel(tr("Input raster"));
+    comboInputRaster = new QComboBox();
+    comboBand = new QComboBox();
+    QHBoxLayout* hLayout1 = new QHBoxLayout();
+    hLayout1->addWidget(comboInputRaster, 1);
+    hLayout1->addWidget(comboBand);
+    mainLayout->addWidget(label2);
+    mainLayout->addLayout(hLayout1);
+    connect(comboInputRaster, &QComboBox::currentTextChanged,
+            this, &ZonalStatisticsTool::onChangeInputRaster);
+
+    QLabel* label3 = new QLabel(tr("Statistics"));
+    checkCount = new QCheckBox(tr("Count"));
+    checkSum = new QCheckBox(tr("Sum"));
+    checkMean = new QCheckBox(tr("Mean"));
+    checkMin = new QCheckBox(tr("Minimum"));
+    checkMax = new QCheckBox(tr("Maximum"));
+    checkMajority = new QCheckBox(tr("Majority"));
+    checkCount->setChecked(true);
+    checkMean->setChecked(true);
+    QGridLayout* gridLayout = new QGridLayout();
+    gridLayout->addWidget(checkCount, 0, 0);
+    gridLayout->addWidget(checkSum, 0, 1);
+    gridLayout->addWidget(checkMean, 1, 0);
+    gridLayout->addWidget(checkMin, 1, 1);
+    gridLayout->addWidget(checkMax, 2, 0);
+    gridLayout->addWidget(checkMajority, 2, 1);
+    mainLayout->addWidget(label3);
+    mainLayout->addLayout(gridLayout);
+
+    QLabel* label4 = new QLabel(tr("Prefix of the fields"));
+    lineEditPrefix = new QLineEdit("ZS_");
+    mainLayout->addWidget(label4);
+    mainLayout->addWidget(lineEditPrefix);
+
+    QPushButton* btnOK = new QPushButton("OK");
+    QPushButton* btnCancel = new QPushButton(tr("Cancel"));
+    QSpacerItem* spacerItem1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QSpacerItem* spacerItem3 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
+    QHBoxLayout* hLayout2 = new QHBoxLayout();
+    hLayout2->addItem(spacerItem1);
+    hLayout2->addWidget(btnOK);
+    hLayout2->addItem(spacerItem2);
+    hLayout2->addWidget(btnCancel);
+    hLayout2->addItem(spacerItem3);
+    mainLayout->addLayout(hLayout2);
+
+    // Enter key
+    btnOK->setFocus();
+    btnOK->setDefault(true);
+
+    // Signals and slots
+    connect(btnOK, &QPushButton::clicked, this, &ZonalStatisticsTool::onBtnOKClicked);
+    connect(btnCancel, &QPushButton::clicked, this, &ZonalStatisticsTool::close);
+}
+
+/* The polygon layers and the raster layers */
+void ZonalStatisticsTool::initializeFill()
+{
+    int layersCount = map->getNumLayers();
+    for (int i = 0; i < layersCount; ++i) {
+        GeoLayer* layer = map->getLayerById(i);
+        if (layer->getLayerType() == kFeatureLayer) {
+            GeometryType geomType = layer->toFeatureLayer()->getGeometryType();
+            if (geomType == kPolygon || geomType == kMultiPolygon)
+                comboInputFeatures->addItem(layer->getName());
+        }
+        else if (layer->getLayerType() == kRasterLayer) {
+            comboInputRaster->addItem(layer->getName());
+        }
+    }
+}
+
+/* The bands of the raster */
+void ZonalStatisticsTool::onChangeInputRaster(const QString& name)
+{
+    comboBand->clear();
+    GeoLayer* layer = map->getLayerByName(name);
+    if (!layer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    int bandsCount = rasterData ? rasterData->getBandsCount() : 0;
+    for (int iBand = 0; iBand < bandsCount; ++iBand)
+        comboBand->addItem(tr("Band %1").arg(iBand + 1));
+}
+
+/****************************************/
+/*                                      */
+/*     Run                              */
+/*       Summarize the raster per zone  */
+/*       Write to attribute table       */
+/*                                      */
+/****************************************/
+void ZonalStatisticsTool::onBtnOKClicked()
+{
+    GeoLayer* featuresLayer = map->getLayerByName(comboInputFeatures->currentText());
+    if (!featuresLayer) {
+        QMessageBox::critical(this, "Error", "Input polygons can't be empty");
+        return;
+    }
+    GeoFeatureLayer* featureLayer = featuresLayer->toFeatureLayer();
+    if (featureLayer->isLoading()) {
+        QMessageBox::critical(this, "Error", "Input features are still loading");
+        return;
+    }
+
+    GeoLayer* rasterLayer = map->getLayerByName(comboInputRaster->currentText());
+    GeoRasterData* rasterData = rasterLayer ? rasterLayer->toRasterLayer()->getData() : nullptr;
+    int iBand = comboBand->currentIndex();
+    if (!rasterData || iBand < 0 || iBand >= rasterData->getBandsCount()) {
+        QMessageBox::critical(this, "Error", "Input raster can't be empty");
+        return;
+    }
+
+    int statistics = 0;
+    if (checkCount->isChecked())
+        statistics |= gm::kZonalCount;
+    if (checkSum->isChecked())
+        statistics |= gm::kZonalSum;
+    if (checkMean->isChecked())
+        statistics |= gm::kZonalMean;
+    if (checkMin->isChecked())
+        statistics |= gm::kZonalMin;
+    if (checkMax->isChecked())
+        statistics |= gm::kZonalMax;
+    if (checkMajority->isChecked())
+        statistics |= gm::kZonalMajority;
+    if (statistics == 0) {
+        QMessageBox::critical(this, "Error", "Select at least one statistic");
+        return;
+    }
+
+    // Progress bar
+    QProgressDialog* progressDlg = createProgressDialog(this, tr("Zonal Statistics"), tr("Calculating......"));
+
+    this->hide();
+
+    QElapsedTimer timer;
+    timer.start();
+    int count = gm::zonalStatistics(featureLayer, rasterData->getBand(iBand), statistics,
+                                    lineEditPrefix->text(), dialogProgress, progressDlg);
+    bool canceled = progressDlg->wasCanceled();
+    progressDlg->close();
+
+    if (count < 0) {
+        if (!canceled)
+            QMessageBox::critical(this, "Error", "Zonal statistics failed, see the log", QMessageBox::Close);
+        this->show();
+        return;
+    }
+    LInfo("Zonal statistics of {} features in {} ms", featureLayer->getFeatureCount(), timer.elapsed());
+
+    QMessageBox::information(this, tr("Zonal Statistics"),
+        tr("%1 of %2 polygons cover the raster, results are written to the attribute table")
+        .arg(count).arg(featureLayer->getFeatureCount()));
+
+    this->close();
+}
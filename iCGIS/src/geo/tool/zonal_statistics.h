@@ -0,0 +1,48 @@
+/**************************************************************
+** class name:  ZonalStatisticsTool
+**
+** description: Count, sum, mean, minimum, maximum and majority
+**                of the pixels of a raster band inside every
+**                polygon of a layer, written to new attribute
+**                fields (see gm::zonalStatistics)
+**
+** last change: 2020-04-09
+**************************************************************/
+#pragma once
+
+#include "geo/tool/geotool.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QLineEdit>
+#include <QObject>
+
+
+class ZonalStatisticsTool : public GeoTool
+{
+    Q_OBJECT
+public:
+    ZonalStatisticsTool(QWidget* parent = nullptr);
+    ~ZonalStatisticsTool();
+
+private:
+    void setupLayout();
+    void initializeFill();
+
+public slots:
+    void onChangeInputRaster(const QString& name);
+    void onBtnOKClicked();
+
+private:
+    QComboBox* comboInputFeatures;
+    QComboBox* comboInputRaster;
+    QComboBox* comboBand;
+    QCheckBox* checkCount;
+    QCheckBox* checkSum;
+    QCheckBox* checkMean;
+    QCheckBox* checkMin;
+    QCheckBox* checkMax;
+    QCheckBox* checkMajority;
+    QLineEdit* lineEditPrefix;
+};
@@ -2,12 +2,18 @@
 
 #include "geo/utility/geojson.h"
 #include "geo/utility/geo_convert.h"
+#include "geo/utility/flatgeobuf.h"
 #include "geo/utility/sld.h"
+#include "geo/utility/snapshot.h"
+#include "geo/utility/virtuallayer.h"
+#include "geo/raster/georastersource.h"
 #include "geo/raster/geotiff.h"
 #include "util/logger.h"
 
 #include <gdal/gdal_frmts.h>
 
+#include <QFileInfo>
+
 /*************************************************/
 /*                                               */
 /*          Read GeoJson (Using GDAL)            */
@@ -50,6 +56,8 @@ GeoFeatureLayer* FileReader::readGeoJsonMine(QString filepath, GeoMap* map)
     QByteArray bytes = filepath.toLocal8Bit();
     const char* path = bytes.data();
     GeoJson geoJson;
+    // Large files are often not yet in the page cache
+    geoJson.setPrefault(QFileInfo(filepath).size() >= GeoJson::kPrefaultThreshold);
     GeoFeatureLayer* layer = new GeoFeatureLayer();
     if (geoJson.parse(path, layer)) {
         layer->setName(utils::getFileName(filepath));
@@ -69,7 +77,8 @@ GeoFeatureLayer* FileReader::readGeoJsonMine(QString filepath, GeoMap* map)
 /*          Read Shapefile (Using GDAL)          */
 /*                                               */
 /*************************************************/
-GeoFeatureLayer* FileReader::readShapefile(QString filepath, GeoMap* map)
+GeoFeatureLayer* FileReader::readShapefile(QString filepath, GeoMap* map,
+                                           const GeoExtent* extent /*= nullptr*/, const QString& where /*= QString()*/)
 {
     QByteArray bytes = filepath.toLocal8Bit();
     const char* path = bytes.data();
@@ -83,7 +92,8 @@ GeoFeatureLayer* FileReader::readShapefile(QString filepath, GeoMap* map)
         return nullptr;
     }
 
-    if (!convertGDALDataset(poDS, map)) {
+    QByteArray whereBytes = where.toUtf8();
+    if (!convertGDALDataset(poDS, map, extent, where.isEmpty() ? nullptr : whereBytes.data())) {
         LError("Read shapefile:{0} error", path);
         GDALClose(poDS);
         return nullptr;
@@ -97,69 +107,154 @@ GeoFeatureLayer* FileReader::readShapefile(QString filepath, GeoMap* map)
 
 /*************************************************/
 /*                                               */
-/*          Read Tiff image (Using GDAL)         */
+/*          Read layer snapshot (*.icgl)         */
 /*                                               */
 /*************************************************/
-GeoRasterLayer* FileReader::readTiff(QString filepath, GeoMap* map)
+GeoFeatureLayer* FileReader::readSnapshot(QString filepath, GeoMap* map)
 {
     QByteArray bytes = filepath.toLocal8Bit();
     const char* path = bytes.data();
+    GeoFeatureLayer* layer = Snapshot::loadLayer(path);
+    if (!layer) {
+        LError("Read snapshot:{0} error", path);
+        return nullptr;
+    }
+
+    map->addLayer(layer);
+    return layer;
+}
+
+
+/*************************************************/
+/*                                               */
+/*          Read FlatGeobuf (*.fgb)              */
+/*                                               */
+/*************************************************/
+GeoFeatureLayer* FileReader::readFlatGeobuf(QString filepath, GeoMap* map, const GeoExtent* extent /*= nullptr*/)
+{
+    QByteArray bytes = filepath.toLocal8Bit();
+    const char* path = bytes.data();
+    GeoFeatureLayer* layer = extent ? FlatGeobuf::readLayer(path, *extent) : FlatGeobuf::readLayer(path);
+    if (!layer) {
+        LError("Read FlatGeobuf:{0} error", path);
+        return nullptr;
+    }
+    if (layer->getName().isEmpty())
+        layer->setName(utils::getFileName(filepath));
+
+    map->addLayer(layer);
+    return layer;
+}
+
+
+/*************************************************/
+/*                                               */
+/*       Read vector files (Using GDAL)          */
+/*                                               */
+/*************************************************/
+void FileReader::readVectorFiles(const QStringList& filepaths, GeoMap* map,
+                                 std::vector<std::vector<GeoFeatureLayer*>>& layersOut,
+                                 const GeoExtent* extent /*= nullptr*/, const QString& where /*= QString()*/)
+{
+    std::vector<std::string> paths;
+    paths.reserve(filepaths.size());
+    for (const QString& filepath : filepaths)
+        paths.push_back(std::string(filepath.toLocal8Bit().constData()));
+
+    // Before the worker threads start
     GDALAllRegister();
-    GDALDataset* poDS = nullptr;
     CPLSetConfigOption("GDAL_FILENAME_IS_UTF8", "NO");
-    poDS = (GDALDataset*)GDALOpenEx(path, GDAL_OF_RASTER, nullptr, nullptr, nullptr);
-    if (!poDS) {
-        LError("Open TIFF:{0} error", path);
+    CPLSetConfigOption("SHAPE_ENCODING", "");
+
+    QByteArray whereBytes = where.toUtf8();
+    convertOGRFiles(paths, map, layersOut, extent, where.isEmpty() ? nullptr : whereBytes.data());
+}
+
+std::shared_ptr<LayerLoader> FileReader::loadVectorFile(const QString& filepath,
+                                                        const GeoExtent* extent /*= nullptr*/,
+                                                        const QString& where /*= QString()*/)
+{
+    // Before the worker thread starts
+    GDALAllRegister();
+    CPLSetConfigOption("GDAL_FILENAME_IS_UTF8", "NO");
+    CPLSetConfigOption("SHAPE_ENCODING", "");
+
+    auto loader = std::make_shared<LayerLoader>(std::string(filepath.toLocal8Bit().constData()),
+                                                extent, std::string(where.toUtf8().constData()));
+    loader->start();
+    return loader;
+}
+
+std::shared_ptr<LayerLoader> FileReader::loadPostgisTables(const QString& connection,
+                                                           const std::vector<std::string>& tables,
+                                                           const GeoExtent* extent /*= nullptr*/,
+                                                           const QString& where /*= QString()*/,
+                                                           int batchSize /*= 10000*/)
+{
+    GDALAllRegister();
+
+    auto loader = std::make_shared<LayerLoader>(std::string(connection.toLocal8Bit().constData()),
+                                                extent, std::string(where.toUtf8().constData()));
+    loader->setLayerNames(tables);
+    loader->setBatchSize(batchSize);
+    loader->start();
+    return loader;
+}
+
+
+/*************************************************/
+/*                                               */
+/*       Read virtual layer (Using GDAL)         */
+/*                                               */
+/*************************************************/
+GeoFeatureLayer* FileReader::readVirtualLayer(QString filepath, GeoMap* map, const QString& where /*= QString()*/)
+{
+    QByteArray bytes = filepath.toLocal8Bit();
+    const char* path = bytes.data();
+    QByteArray whereBytes = where.toUtf8();
+    GeoFeatureLayer* layer = new GeoFeatureLayer();
+    VirtualLayerSource* source = VirtualLayerSource::open(path, layer, where.isEmpty() ? nullptr : whereBytes.data());
+    if (!source) {
+        LError("Open virtual layer:{0} error", path);
+        delete layer;
         return nullptr;
     }
+    layer->setVirtualSource(std::shared_ptr<VirtualLayerSource>(source));
+    if (layer->getName().isEmpty())
+        layer->setName(utils::getFileName(filepath));
 
-    int width = poDS->GetRasterXSize();
-    int height = poDS->GetRasterYSize();
-    int bandNum = poDS->GetRasterCount();
+    map->addLayer(layer);
+    return layer;
+}
 
-    if (bandNum < 1) {
-        GDALClose(poDS);
+
+/*************************************************/
+/*                                               */
+/*          Read Tiff image (Using GDAL)         */
+/*                                               */
+/*************************************************/
+GeoRasterLayer* FileReader::readTiff(QString filepath, GeoMap* map)
+{
+    CPLSetConfigOption("GDAL_FILENAME_IS_UTF8", "NO");
+
+    // Nothing is read yet, the blocks are read when drawn
+    std::shared_ptr<GeoRasterSource> source =
+        GeoRasterSource::open(std::string(filepath.toLocal8Bit().constData()));
+    if (!source)
         return nullptr;
-    }
 
     GeoRasterLayer* rasterLayer = new GeoRasterLayer();
     rasterLayer->setName(utils::getFileName(filepath));
+    rasterLayer->setSourcePath(filepath);
     GeoTiff* tiff = new GeoTiff();
 
-    for (int iBand = 0; iBand < bandNum; ++iBand) {
-        GDALRasterBand* gdalBand = poDS->GetRasterBand(iBand + 1);
-        GeoRasterBand* geoBand = new GeoRasterBand(width, height);
-
-        // Affine transform
-        poDS->GetGeoTransform(geoBand->geoTransform);
-
-        GDALDataType dataType = poDS->GetRasterBand(iBand + 1)->GetRasterDataType();
-
-        switch (dataType) {
-        default:
-            break;
-        case GDT_Float32:
-            float* pDataBuf = new float[width * height];
-            CPLErr err = gdalBand->RasterIO(GF_Read, 0, 0, width, height, pDataBuf,
-                                            width, height, GDT_Float32, 0, 0);
-            if (err != CPLErr::CE_None) {
-                QString errMsg = "Read raster data file failed: " + filepath;
-                LError(errMsg.toStdString());
-                for (int i = 0; i < width * height; ++i) {
-                    pDataBuf[i] = 0.0f;
-                }
-            }
-            geoBand->setData(pDataBuf, utils::DataType::kFloat);
-            break;
-        }
-
-        tiff->addBand(geoBand);
-    }
+    int bandNum = source->getBandsCount();
+    for (int iBand = 0; iBand < bandNum; ++iBand)
+        tiff->addBand(new GeoRasterBand(source, iBand + 1));
 
     rasterLayer->setData(tiff);
     map->addLayer(rasterLayer);
 
-    GDALClose(poDS);
     return rasterLayer;
 }
 
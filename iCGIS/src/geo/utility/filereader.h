@@ -1,13 +1,16 @@
 /*********************************************************************
 ** class name:  FileReader
 **
-** last change: 2020-01-02
+** last change: 2020-04-09
 *********************************************************************/
 #pragma once
 
 #include "geo/map/geomap.h"
+#include "geo/utility/layerloader.h"
 #include "geo/utility/sld.h"
 
+#include <memory>
+
 
 class FileReader {
 public:
@@ -18,7 +21,43 @@ public:
 
 	static GeoFeatureLayer* readGeoJsonMine(QString filepath, GeoMap* map);
 
-	static GeoFeatureLayer* readShapefile(QString filepath, GeoMap* map);
+	// extent: only the features intersecting it, nullptr: all the features
+	// where: attribute filter (OGR SQL), empty: all the features
+	static GeoFeatureLayer* readShapefile(QString filepath, GeoMap* map,
+	                                      const GeoExtent* extent = nullptr, const QString& where = QString());
+
+	// Several files (shapefile, GeoPackage, GeoJSON...) through GDAL, the
+	//  layers of all the files are read in parallel
+	// layersOut[i]: the layers of filepaths[i], empty if it failed
+	static void readVectorFiles(const QStringList& filepaths, GeoMap* map,
+	                            std::vector<std::vector<GeoFeatureLayer*>>& layersOut,
+	                            const GeoExtent* extent = nullptr, const QString& where = QString());
+
+	// The same on a background thread (see LayerLoader), the layers
+	//  are taken from the returned loader and added to the map by the
+	//  caller as they are read
+	static std::shared_ptr<LayerLoader> loadVectorFile(const QString& filepath,
+	                                                   const GeoExtent* extent = nullptr,
+	                                                   const QString& where = QString());
+
+	// Tables of PostGIS on a background thread
+	// connection: "PG:dbname=... host=..."
+	// The extent and the attribute filter are run by the server, the rows
+	//  are fetched through a cursor, `batchSize` rows at once
+	static std::shared_ptr<LayerLoader> loadPostgisTables(const QString& connection,
+	                                                      const std::vector<std::string>& tables,
+	                                                      const GeoExtent* extent = nullptr,
+	                                                      const QString& where = QString(),
+	                                                      int batchSize = 10000);
+
+	// Features read as the view moves (see VirtualLayerSource),
+	//  any vector format of GDAL
+	static GeoFeatureLayer* readVirtualLayer(QString filepath, GeoMap* map, const QString& where = QString());
+
+	static GeoFeatureLayer* readSnapshot(QString filepath, GeoMap* map);
+
+	// extent: only the features in it, nullptr: all the features
+	static GeoFeatureLayer* readFlatGeobuf(QString filepath, GeoMap* map, const GeoExtent* extent = nullptr);
 
 
 	/*********************
@@ -0,0 +1,1325 @@
+#include "geo/utility/flatgeobuf.h"
+#include "util/logger.h"
+#include "util/mappedfile.h"
+#include "util/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+/****************************************/
+/*                                      */
+/*     File layout                      */
+/*                                      */
+/****************************************/
+
+// "fgb", major version 3, "fgb", patch version
+const uint8_t kMagic[8] = { 'f', 'g', 'b', 3, 'f', 'g', 'b', 0 };
+
+enum FgbGeometryType : uint8_t {
+    kFgbUnknown = 0,
+    kFgbPoint,
+    kFgbLineString,
+    kFgbPolygon,
+    kFgbMultiPoint,
+    kFgbMultiLineString,
+    kFgbMultiPolygon
+};
+
+enum FgbColumnType : uint8_t {
+    kFgbByte = 0,
+    kFgbUByte,
+    kFgbBool,
+    kFgbShort,
+    kFgbUShort,
+    kFgbInt,
+    kFgbUInt,
+    kFgbLong,
+    kFgbULong,
+    kFgbFloat,
+    kFgbDouble,
+    kFgbString,
+    kFgbJson,
+    kFgbDateTime,
+    kFgbBinary
+};
+
+// Ids of the fields of the tables, in the order of the schema
+enum HeaderField {
+    kHeaderName = 0,
+    kHeaderEnvelope,            // [double] minX, minY, maxX, maxY
+    kHeaderGeometryType,        // ubyte
+    kHeaderHasZ,
+    kHeaderHasM,
+    kHeaderHasT,
+    kHeaderHasTM,
+    kHeaderColumns,             // [Column]
+    kHeaderFeaturesCount,       // ulong
+    kHeaderIndexNodeSize,       // ushort = 16
+    kHeaderCrs                  // Crs
+};
+enum ColumnField {
+    kColumnName = 0,
+    kColumnType,                // ubyte
+    kColumnTitle,
+    kColumnDescription,
+    kColumnWidth                // int = -1
+};
+enum CrsField {
+    kCrsOrg = 0,
+    kCrsCode,
+    kCrsName,
+    kCrsDescription,
+    kCrsWkt
+};
+enum GeometryField {
+    kGeometryEnds = 0,          // [uint] end of each ring/line (in points)
+    kGeometryXY,                // [double]
+    kGeometryZ,
+    kGeometryM,
+    kGeometryT,
+    kGeometryTM,
+    kGeometryType,              // ubyte, when the header's type is unknown
+    kGeometryParts              // [Geometry], multipolygon
+};
+enum FeatureField {
+    kFeatureGeometry = 0,
+    kFeatureProperties,         // [ubyte] (uint16 column, value)...
+    kFeatureColumns
+};
+
+// A node of the index, leaves: offset of the feature (from the first feature)
+//   other nodes: index of the first child
+struct NodeItem {
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+    uint64_t offset;
+};
+static_assert(sizeof(NodeItem) == 40, "NodeItem must be packed");
+
+const uint16_t kFgbDefaultNodeSize = 16;
+
+/* [begin, end) of the nodes of each level, from the leaves (level 0)
+**   to the root; the root is stored first, the leaves last */
+std::vector<std::pair<uint64_t, uint64_t>> levelBounds(uint64_t itemsCount, uint16_t nodeSize)
+{
+    std::vector<uint64_t> levelNodes;
+    uint64_t n = itemsCount;
+    uint64_t nodesCount = n;
+    levelNodes.push_back(n);
+    do {
+        n = (n + nodeSize - 1) / nodeSize;
+        nodesCount += n;
+        levelNodes.push_back(n);
+    } while (n != 1);
+
+    std::vector<std::pair<uint64_t, uint64_t>> bounds;
+    for (auto& count : levelNodes) {
+        nodesCount -= count;
+        bounds.emplace_back(nodesCount, nodesCount + count);
+    }
+    return bounds;
+}
+
+inline uint64_t indexSize(uint64_t itemsCount, uint16_t nodeSize)
+{
+    if (itemsCount == 0 || nodeSize < 2)
+        return 0;
+    return levelBounds(itemsCount, nodeSize).front().second * sizeof(NodeItem);
+}
+
+// Position of (x, y) on the Hilbert curve of order 16
+uint32_t hilbert(uint32_t x, uint32_t y)
+{
+    uint32_t a = x ^ y;
+    uint32_t b = 0xFFFF ^ a;
+    uint32_t c = 0xFFFF ^ (x | y);
+    uint32_t d = x & (y ^ 0xFFFF);
+
+    uint32_t A = a | (b >> 1);
+    uint32_t B = (a >> 1) ^ a;
+    uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+    uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+    a = A; b = B; c = C; d = D;
+    A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+    B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+    C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+    D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+    a = A; b = B; c = C; d = D;
+    A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+    B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+    C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+    D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+    a = A; b = B; c = C; d = D;
+    C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+    D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+    a = C ^ (C >> 1);
+    b = D ^ (D >> 1);
+
+    uint32_t i0 = x ^ y;
+    uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+    i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+    i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+    i0 = (i0 | (i0 << 2)) & 0x33333333;
+    i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+    i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+    i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+    i1 = (i1 | (i1 << 2)) & 0x33333333;
+    i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+    return (i1 << 1) | i0;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Write FlatBuffers                */
+/*                                      */
+/****************************************/
+
+/* Written from the front: a table, then the objects it refers to, so
+**   all the offsets point forward as FlatBuffers requires
+** The alignments are from the start of the size prefix */
+class FlatBufferWriter {
+public:
+    FlatBufferWriter() : bytes(8, 0) {}     // size prefix, offset of the root table
+
+    void align(size_t alignment) {
+        bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+    }
+
+    // The elements are appended after, with append()
+    size_t beginVector(size_t count, size_t elementSize) {
+        size_t alignment = std::max<size_t>(elementSize, 4);
+        while ((bytes.size() + 4) % alignment != 0)
+            bytes.push_back(0);
+        size_t position = bytes.size();
+        put<uint32_t>(uint32_t(count));
+        bytes.reserve(bytes.size() + count * elementSize);
+        return position;
+    }
+    template<typename T>
+    size_t writeVector(const T* values, size_t count) {
+        size_t position = beginVector(count, sizeof(T));
+        append(values, count * sizeof(T));
+        return position;
+    }
+    size_t writeString(const QString& str) {
+        QByteArray utf8 = str.toUtf8();
+        size_t position = beginVector(utf8.size(), 1);
+        append(utf8.constData(), utf8.size());
+        bytes.push_back(0);
+        return position;
+    }
+
+    void append(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        bytes.insert(bytes.end(), p, p + size);
+    }
+    template<typename T>
+    void put(T value) { append(&value, sizeof(T)); }
+
+    // `at` refers to the object at `target`
+    void setOffset(size_t at, size_t target) {
+        uint32_t offset = uint32_t(target - at);
+        memcpy(&bytes[at], &offset, sizeof(offset));
+    }
+    void setRoot(size_t tablePosition) { setOffset(4, tablePosition); }
+
+    // Size prefix, padded so the next buffer of the file stays aligned
+    std::vector<uint8_t>& finish() {
+        align(8);
+        uint32_t size = uint32_t(bytes.size() - 4);
+        memcpy(&bytes[0], &size, sizeof(size));
+        return bytes;
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+/* Add the fields, write() the vtable and the table, then set the
+**   offsets (at getPosition(id)) once the objects are written */
+class TableWriter {
+public:
+    template<typename T>
+    void add(int id, T value) {
+        Field field;
+        field.id = id;
+        field.size = sizeof(T);
+        memcpy(&field.value, &value, sizeof(T));
+        fields.push_back(field);
+    }
+    void addOffset(int id) { add<uint32_t>(id, 0); }
+
+    size_t write(FlatBufferWriter& writer);
+    size_t getPosition(int id) const;
+
+private:
+    struct Field {
+        int id;
+        int size;
+        uint64_t value = 0;
+        size_t position = 0;
+    };
+    std::vector<Field> fields;
+};
+
+size_t TableWriter::write(FlatBufferWriter& writer)
+{
+    // The largest fields first, each aligned on its size
+    std::stable_sort(fields.begin(), fields.end(), [](const Field& a, const Field& b) {
+        return a.size > b.size;
+    });
+    int idsCount = 0;
+    size_t tableAlignment = 4;
+    size_t tableSize = 4;       // offset of the vtable
+    std::vector<uint16_t> fieldOffsets;
+    for (auto& field : fields) {
+        idsCount = std::max(idsCount, field.id + 1);
+        tableAlignment = std::max<size_t>(tableAlignment, field.size);
+        tableSize = (tableSize + field.size - 1) / field.size * field.size;
+        field.position = tableSize;
+        tableSize += field.size;
+    }
+
+    writer.align(2);
+    size_t vtablePosition = writer.bytes.size();
+    std::vector<uint16_t> vtable(2 + idsCount, 0);
+    vtable[0] = uint16_t(vtable.size() * sizeof(uint16_t));
+    vtable[1] = uint16_t(tableSize);
+    for (auto& field : fields)
+        vtable[2 + field.id] = uint16_t(field.position);
+    writer.append(vtable.data(), vtable.size() * sizeof(uint16_t));
+
+    writer.align(tableAlignment);
+    size_t tablePosition = writer.bytes.size();
+    writer.bytes.resize(tablePosition + tableSize, 0);
+    int32_t vtableOffset = int32_t(tablePosition - vtablePosition);
+    memcpy(&writer.bytes[tablePosition], &vtableOffset, sizeof(vtableOffset));
+    for (auto& field : fields) {
+        field.position += tablePosition;
+        memcpy(&writer.bytes[field.position], &field.value, field.size);
+    }
+    return tablePosition;
+}
+
+size_t TableWriter::getPosition(int id) const
+{
+    for (auto& field : fields) {
+        if (field.id == id)
+            return field.position;
+    }
+    return 0;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Read FlatBuffers                 */
+/*                                      */
+/****************************************/
+
+/* A table in [data, data + size), every offset is checked
+** Nothing is aligned in the mapping, the values are copied out */
+class FlatTable {
+public:
+    bool initRoot(const uint8_t* dataIn, size_t sizeIn) {
+        if (sizeIn < 4)
+            return false;
+        data = dataIn;
+        size = sizeIn;
+        return init(read<uint32_t>(0));
+    }
+
+    template<typename T>
+    T get(int id, T defaultValue) const {
+        size_t position = getFieldPosition(id, sizeof(T));
+        return position ? read<T>(position) : defaultValue;
+    }
+
+    bool getTable(int id, FlatTable& table) const {
+        size_t position = getFieldPosition(id, 4);
+        return position && table.initAt(data, size, position);
+    }
+
+    // elements: the first element, count: number of elements
+    bool getVector(int id, size_t elementSize, const uint8_t*& elements, uint32_t& count) const {
+        size_t position = getFieldPosition(id, 4);
+        if (!position)
+            return false;
+        size_t vector = position + read<uint32_t>(position);
+        if (vector > size - 4)
+            return false;
+        count = read<uint32_t>(vector);
+        if (uint64_t(count) * elementSize > size - vector - 4)
+            return false;
+        elements = data + vector + 4;
+        return true;
+    }
+
+    bool getString(int id, QString& str) const {
+        const uint8_t* chars;
+        uint32_t length;
+        if (!getVector(id, 1, chars, length) || length > uint32_t(INT_MAX))
+            return false;
+        str = QString::fromUtf8(reinterpret_cast<const char*>(chars), int(length));
+        return true;
+    }
+
+    // The i-th table of a vector of tables
+    bool getTableAt(const uint8_t* elements, uint32_t i, FlatTable& table) const {
+        return table.initAt(data, size, (elements - data) + i * size_t(4));
+    }
+
+private:
+    // Table referred to by the offset at `position`
+    bool initAt(const uint8_t* dataIn, size_t sizeIn, size_t position) {
+        data = dataIn;
+        size = sizeIn;
+        return init(position + read<uint32_t>(position));
+    }
+
+    bool init(size_t tablePosition) {
+        if (tablePosition > size - 4)
+            return false;
+        int64_t vtablePosition = int64_t(tablePosition) - read<int32_t>(tablePosition);
+        if (vtablePosition < 0 || uint64_t(vtablePosition) > size - 4)
+            return false;
+        position = tablePosition;
+        vtable = size_t(vtablePosition);
+        vtableSize = read<uint16_t>(vtable);
+        tableSize = read<uint16_t>(vtable + 2);
+        return vtableSize >= 4 && vtableSize <= size - vtable && tableSize <= size - position;
+    }
+
+    // 0 if the field is absent
+    size_t getFieldPosition(int id, size_t fieldSize) const {
+        size_t entry = 4 + id * sizeof(uint16_t);
+        if (entry + sizeof(uint16_t) > vtableSize)
+            return 0;
+        uint16_t offset = read<uint16_t>(vtable + entry);
+        if (offset == 0 || offset + fieldSize > tableSize)
+            return 0;
+        return position + offset;
+    }
+
+    template<typename T>
+    T read(size_t at) const {
+        T value;
+        memcpy(&value, data + at, sizeof(T));
+        return value;
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    size_t vtable = 0;
+    uint16_t vtableSize = 0;
+    uint16_t tableSize = 0;
+};
+
+
+/****************************************/
+/*                                      */
+/*     Read                             */
+/*                                      */
+/****************************************/
+
+struct Column {
+    uint8_t type;
+    int fieldIndex;     // -1: not loaded
+};
+
+GeometryType toGeometryType(uint8_t type)
+{
+    switch (type) {
+    default:                    return kGeometryTypeUnknown;
+    case kFgbPoint:             return kPoint;
+    case kFgbLineString:        return kLineString;
+    case kFgbPolygon:           return kPolygon;
+    case kFgbMultiPoint:        return kMultiPoint;
+    case kFgbMultiLineString:   return kMultiLineString;
+    case kFgbMultiPolygon:      return kMultiPolygon;
+    }
+}
+
+uint8_t toFgbGeometryType(GeometryType type)
+{
+    switch (type) {
+    default:                return kFgbUnknown;
+    case kPoint:            return kFgbPoint;
+    case kLineString:       return kFgbLineString;
+    case kPolygon:          return kFgbPolygon;
+    case kMultiPoint:       return kFgbMultiPoint;
+    case kMultiLineString:  return kFgbMultiLineString;
+    case kMultiPolygon:     return kFgbMultiPolygon;
+    }
+}
+
+void setPoints(GeoLineString* lineString, const uint8_t* xy, uint32_t count)
+{
+    if (reinterpret_cast<uintptr_t>(xy) % alignof(GeoRawPoint) == 0) {
+        lineString->setPoints(reinterpret_cast<const GeoRawPoint*>(xy), int(count));
+        return;
+    }
+    lineString->reserveNumPoints(int(count));
+    for (uint32_t i = 0; i < count; ++i) {
+        GeoRawPoint point;
+        memcpy(&point, xy + i * sizeof(GeoRawPoint), sizeof(GeoRawPoint));
+        lineString->addPoint(point);
+    }
+}
+
+/* The coordinates split at `ends`, into lines (or rings)
+** false if `ends` doesn't fit the points */
+template<typename LineFunc>
+bool splitLines(const FlatTable& geometry, const uint8_t* xy, uint32_t pointsCount, LineFunc&& onLine)
+{
+    const uint8_t* ends;
+    uint32_t endsCount;
+    if (!geometry.getVector(kGeometryEnds, sizeof(uint32_t), ends, endsCount) || endsCount == 0)
+        return onLine(xy, pointsCount);
+
+    uint32_t begin = 0;
+    for (uint32_t i = 0; i < endsCount; ++i) {
+        uint32_t end;
+        memcpy(&end, ends + i * sizeof(uint32_t), sizeof(end));
+        if (end < begin || end > pointsCount)
+            return false;
+        if (!onLine(xy + begin * sizeof(GeoRawPoint), end - begin))
+            return false;
+        begin = end;
+    }
+    return true;
+}
+
+GeoPolygon* readPolygon(const FlatTable& geometry)
+{
+    const uint8_t* xy;
+    uint32_t count;
+    if (!geometry.getVector(kGeometryXY, sizeof(double), xy, count) || count == 0 || count % 2 != 0)
+        return nullptr;
+
+    GeoPolygon* polygon = new GeoPolygon();
+    bool ok = splitLines(geometry, xy, count / 2, [polygon](const uint8_t* points, uint32_t pointsCount) {
+        GeoLinearRing* ring = new GeoLinearRing();
+        if (polygon->isEmpty())
+            polygon->setExteriorRing(ring);
+        else
+            polygon->addInteriorRing(ring);
+        setPoints(ring, points, pointsCount);
+        return pointsCount > 0;
+    });
+    if (!ok) {
+        delete polygon;
+        return nullptr;
+    }
+    return polygon;
+}
+
+// nullptr if empty, invalid or not supported
+GeoGeometry* readGeometry(const FlatTable& geometry, uint8_t type)
+{
+    if (type == kFgbUnknown)
+        type = geometry.get<uint8_t>(kGeometryType, kFgbUnknown);
+
+    if (type == kFgbPolygon)
+        return readPolygon(geometry);
+
+    if (type == kFgbMultiPolygon) {
+        const uint8_t* parts;
+        uint32_t partsCount;
+        if (!geometry.getVector(kGeometryParts, 4, parts, partsCount) || partsCount == 0) {
+            // A single polygon, no parts
+            GeoPolygon* polygon = readPolygon(geometry);
+            if (!polygon)
+                return nullptr;
+            GeoMultiPolygon* multiPolygon = new GeoMultiPolygon();
+            multiPolygon->addPolygon(polygon);
+            return multiPolygon;
+        }
+        GeoMultiPolygon* multiPolygon = new GeoMultiPolygon();
+        multiPolygon->reserveNumGeoms(int(std::min<uint32_t>(partsCount, INT_MAX)));
+        for (uint32_t i = 0; i < partsCount; ++i) {
+            FlatTable part;
+            GeoPolygon* polygon = geometry.getTableAt(parts, i, part) ? readPolygon(part) : nullptr;
+            if (!polygon) {
+                delete multiPolygon;
+                return nullptr;
+            }
+            multiPolygon->addPolygon(polygon);
+        }
+        return multiPolygon;
+    }
+
+    const uint8_t* xy;
+    uint32_t count;
+    if (!geometry.getVector(kGeometryXY, sizeof(double), xy, count) || count == 0 || count % 2 != 0)
+        return nullptr;
+    uint32_t pointsCount = count / 2;
+
+    switch (type) {
+    default:
+        return nullptr;
+    case kFgbPoint: {
+        GeoRawPoint point;
+        memcpy(&point, xy, sizeof(point));
+        return new GeoPoint(point.x, point.y);
+    }
+    case kFgbMultiPoint: {
+        GeoMultiPoint* multiPoint = new GeoMultiPoint();
+        multiPoint->reserveNumGeoms(int(pointsCount));
+        for (uint32_t i = 0; i < pointsCount; ++i) {
+            GeoRawPoint point;
+            memcpy(&point, xy + i * sizeof(GeoRawPoint), sizeof(point));
+            multiPoint->addPoint(new GeoPoint(point.x, point.y));
+        }
+        return multiPoint;
+    }
+    case kFgbLineString: {
+        GeoLineString* lineString = new GeoLineString();
+        setPoints(lineString, xy, pointsCount);
+        return lineString;
+    }
+    case kFgbMultiLineString: {
+        GeoMultiLineString* multiLineString = new GeoMultiLineString();
+        bool ok = splitLines(geometry, xy, pointsCount,
+            [multiLineString](const uint8_t* points, uint32_t linePointsCount) {
+                GeoLineString* lineString = new GeoLineString();
+                setPoints(lineString, points, linePointsCount);
+                multiLineString->addLineString(lineString);
+                return linePointsCount > 0;
+            });
+        if (!ok) {
+            delete multiLineString;
+            return nullptr;
+        }
+        return multiLineString;
+    }
+    }
+}
+
+// false if the properties run out of the vector
+bool readProperties(const uint8_t* p, uint32_t size, const std::vector<Column>& columns, GeoFeature* feature)
+{
+    const uint8_t* end = p + size;
+    while (p < end) {
+        if (end - p < 2)
+            return false;
+        uint16_t iColumn;
+        memcpy(&iColumn, p, sizeof(iColumn));
+        p += sizeof(iColumn);
+        if (iColumn >= columns.size())
+            return false;
+        const Column& column = columns[iColumn];
+
+        // Fixed size, or uint32 length + bytes
+        size_t valueSize;
+        switch (column.type) {
+        default:
+            return false;
+        case kFgbByte: case kFgbUByte: case kFgbBool:
+            valueSize = 1;
+            break;
+        case kFgbShort: case kFgbUShort:
+            valueSize = 2;
+            break;
+        case kFgbInt: case kFgbUInt: case kFgbFloat:
+            valueSize = 4;
+            break;
+        case kFgbLong: case kFgbULong: case kFgbDouble:
+            valueSize = 8;
+            break;
+        case kFgbString: case kFgbJson: case kFgbDateTime: case kFgbBinary: {
+            if (end - p < 4)
+                return false;
+            uint32_t length;
+            memcpy(&length, p, sizeof(length));
+            p += sizeof(length);
+            valueSize = length;
+            break;
+        }
+        }
+        if (size_t(end - p) < valueSize)
+            return false;
+
+        if (column.fieldIndex >= 0) {
+            auto value = [p](auto v) {
+                memcpy(&v, p, sizeof(v));
+                return v;
+            };
+            int fieldIndex = column.fieldIndex;
+            switch (column.type) {
+            default:
+                break;
+            case kFgbByte:      feature->setField(fieldIndex, int(value(int8_t())));  break;
+            case kFgbUByte:     feature->setField(fieldIndex, int(value(uint8_t()))); break;
+            case kFgbBool:      feature->setField(fieldIndex, value(uint8_t()) ? 1 : 0); break;
+            case kFgbShort:     feature->setField(fieldIndex, int(value(int16_t()))); break;
+            case kFgbUShort:    feature->setField(fieldIndex, int(value(uint16_t()))); break;
+            case kFgbInt:       feature->setField(fieldIndex, int(value(int32_t()))); break;
+            case kFgbUInt:      feature->setField(fieldIndex, double(value(uint32_t()))); break;
+            case kFgbLong:      feature->setField(fieldIndex, double(value(int64_t()))); break;
+            case kFgbULong:     feature->setField(fieldIndex, double(value(uint64_t()))); break;
+            case kFgbFloat:     feature->setField(fieldIndex, double(value(float()))); break;
+            case kFgbDouble:    feature->setField(fieldIndex, value(double())); break;
+            case kFgbString:
+            case kFgbJson:
+            case kFgbDateTime:
+                feature->setField(fieldIndex, QString::fromUtf8(reinterpret_cast<const char*>(p), int(valueSize)));
+                break;
+            }
+        }
+        p += valueSize;
+    }
+    return true;
+}
+
+/* The offsets (from the first feature) of the features whose box
+**   intersects `extent`, the index is read level by level, forward */
+bool searchIndex(const uint8_t* index, uint64_t featuresCount, uint16_t nodeSize,
+                 uint64_t featuresSize, const GeoExtent& extent, std::vector<uint64_t>& offsetsOut)
+{
+    auto bounds = levelBounds(featuresCount, nodeSize);
+    std::vector<uint64_t> groups(1, 0);     // first node of each group of children
+    std::vector<uint64_t> nextGroups;
+    for (int level = int(bounds.size()) - 1; level >= 0 && !groups.empty(); --level) {
+        uint64_t levelEnd = bounds[level].second;
+        nextGroups.clear();
+        for (auto& first : groups) {
+            uint64_t last = std::min<uint64_t>(first + nodeSize, levelEnd);
+            for (uint64_t pos = first; pos < last; ++pos) {
+                NodeItem node;
+                memcpy(&node, index + pos * sizeof(NodeItem), sizeof(node));
+                if (node.minX > extent.maxX || node.maxX < extent.minX
+                    || node.minY > extent.maxY || node.maxY < extent.minY)
+                    continue;
+                if (level == 0) {
+                    if (node.offset >= featuresSize)
+                        return false;
+                    offsetsOut.push_back(node.offset);
+                }
+                else {
+                    if (node.offset < bounds[level - 1].first || node.offset >= bounds[level - 1].second)
+                        return false;
+                    nextGroups.push_back(node.offset);
+                }
+            }
+        }
+        groups.swap(nextGroups);
+    }
+
+    std::sort(offsetsOut.begin(), offsetsOut.end());
+    offsetsOut.erase(std::unique(offsetsOut.begin(), offsetsOut.end()), offsetsOut.end());
+    return true;
+}
+
+/* extent: nullptr to read all the features */
+GeoFeatureLayer* readFile(const std::string& filename, const GeoExtent* extent)
+{
+    MappedFile mappedFile;
+    if (!mappedFile.open(filename)) {
+        LError("Open FlatGeobuf error: {0}", filename);
+        return nullptr;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(mappedFile.data());
+    uint64_t size = mappedFile.size();
+
+    if (size < 12 || memcmp(data, kMagic, 3) != 0 || memcmp(data + 4, kMagic + 4, 3) != 0) {
+        LError("Invalid FlatGeobuf: {0}", filename);
+        return nullptr;
+    }
+    if (data[3] != kMagic[3]) {
+        LError("Unsupported FlatGeobuf: version {0}", int(data[3]));
+        return nullptr;
+    }
+
+    // Header
+    uint32_t headerSize;
+    memcpy(&headerSize, data + 8, sizeof(headerSize));
+    FlatTable header;
+    if (headerSize > size - 12 || !header.initRoot(data + 12, headerSize)) {
+        LError("Invalid FlatGeobuf: header");
+        return nullptr;
+    }
+    uint8_t geometryType = header.get<uint8_t>(kHeaderGeometryType, kFgbUnknown);
+    uint64_t featuresCount = header.get<uint64_t>(kHeaderFeaturesCount, 0);
+    uint16_t nodeSize = header.get<uint16_t>(kHeaderIndexNodeSize, kFgbDefaultNodeSize);
+    if (featuresCount > size) {
+        LError("Invalid FlatGeobuf: features count");
+        return nullptr;
+    }
+    uint64_t indexOffset = 12 + uint64_t(headerSize);
+    uint64_t indexBytes = indexSize(featuresCount, nodeSize);
+    if (indexBytes > size - indexOffset) {
+        LError("Invalid FlatGeobuf: index out of the file");
+        return nullptr;
+    }
+    uint64_t featuresOffset = indexOffset + indexBytes;
+    uint64_t featuresSize = size - featuresOffset;
+
+    GeoFeatureLayer* layer = new GeoFeatureLayer();
+    QString name;
+    if (header.getString(kHeaderName, name))
+        layer->setName(name);
+    FlatTable crs;
+    QString wkt;
+    if (header.getTable(kHeaderCrs, crs) && crs.getString(kCrsWkt, wkt))
+        layer->setSpatialRef(wkt);
+
+    // Columns
+    std::vector<Column> columns;
+    const uint8_t* columnTables;
+    uint32_t columnsCount;
+    if (header.getVector(kHeaderColumns, 4, columnTables, columnsCount)) {
+        for (uint32_t i = 0; i < columnsCount; ++i) {
+            FlatTable columnTable;
+            QString columnName;
+            if (!header.getTableAt(columnTables, i, columnTable) || !columnTable.getString(kColumnName, columnName)) {
+                LError("Invalid FlatGeobuf: column {0}", i);
+                delete layer;
+                return nullptr;
+            }
+            Column column;
+            column.type = columnTable.get<uint8_t>(kColumnType, kFgbByte);
+            column.fieldIndex = -1;
+            int width = std::max(columnTable.get<int32_t>(kColumnWidth, -1), 0);
+            switch (column.type) {
+            default:
+                break;
+            case kFgbByte: case kFgbUByte: case kFgbBool:
+            case kFgbShort: case kFgbUShort: case kFgbInt:
+                column.fieldIndex = layer->addField(new GeoFieldDefn(columnName, width, kFieldInt));
+                break;
+            case kFgbUInt: case kFgbLong: case kFgbULong:
+            case kFgbFloat: case kFgbDouble:
+                column.fieldIndex = layer->addField(new GeoFieldDefn(columnName, width, kFieldDouble));
+                break;
+            case kFgbString: case kFgbJson: case kFgbDateTime:
+                column.fieldIndex = layer->addField(new GeoFieldDefn(columnName, width > 0 ? width : 16, kFieldText));
+                break;
+            case kFgbBinary:
+                LWarn("Column {0} skipped, binary", columnName.toStdString());
+                break;
+            }
+            columns.push_back(column);
+        }
+    }
+
+    // Features to read: found in the index, or all of them
+    std::vector<uint64_t> offsets;
+    if (extent && indexBytes > 0) {
+        if (!searchIndex(data + indexOffset, featuresCount, nodeSize, featuresSize, *extent, offsets)) {
+            LError("Invalid FlatGeobuf: index");
+            delete layer;
+            return nullptr;
+        }
+    }
+    else {
+        mappedFile.adviseSequential();
+        offsets.reserve(size_t(featuresCount));
+        // The count may be unknown (0) when there is no index
+        uint64_t offset = 0;
+        while (featuresSize - offset >= 4 && (featuresCount == 0 || offsets.size() < featuresCount)) {
+            uint32_t featureSize;
+            memcpy(&featureSize, data + featuresOffset + offset, sizeof(featureSize));
+            offsets.push_back(offset);
+            offset += 4 + uint64_t(featureSize);
+            if (offset > featuresSize) {
+                LError("Invalid FlatGeobuf: feature {0} out of the file", offsets.size() - 1);
+                delete layer;
+                return nullptr;
+            }
+        }
+    }
+    if (offsets.size() > size_t(INT_MAX)) {
+        LError("Too many features: {0}", offsets.size());
+        delete layer;
+        return nullptr;
+    }
+
+    // Features, in parallel
+    int count = int(offsets.size());
+    std::vector<GeoFeature*> features(count, nullptr);
+    std::atomic<bool> failed(false);
+    std::atomic<int> skippedCount(0);
+    utils::parallelFor(0, count, [&](int i) {
+        if (failed)
+            return;
+        uint64_t offset = offsets[i];
+        if (featuresSize - offset < 4) {
+            failed = true;
+            return;
+        }
+        uint32_t featureSize;
+        memcpy(&featureSize, data + featuresOffset + offset, sizeof(featureSize));
+        if (featureSize > featuresSize - offset - 4) {
+            failed = true;
+            return;
+        }
+
+        FlatTable featureTable;
+        if (!featureTable.initRoot(data + featuresOffset + offset + 4, featureSize)) {
+            failed = true;
+            return;
+        }
+        FlatTable geometry;
+        GeoGeometry* geom = nullptr;
+        if (featureTable.getTable(kFeatureGeometry, geometry))
+            geom = readGeometry(geometry, geometryType);
+        if (!geom) {
+            ++skippedCount;
+            return;
+        }
+
+        // Without an index, all the features are read, then filtered
+        GeoExtent box = geom->getExtent();
+        if (extent && indexBytes == 0 && (box.minX > extent->maxX || box.maxX < extent->minX
+                                          || box.minY > extent->maxY || box.maxY < extent->minY))
+        {
+            delete geom;
+            return;
+        }
+
+        GeoFeature* feature = new GeoFeature(layer);
+        feature->setGeometry(geom);
+        feature->setExtent(box);
+        const uint8_t* properties;
+        uint32_t propertiesSize;
+        if (featureTable.getVector(kFeatureProperties, 1, properties, propertiesSize)
+            && !readProperties(properties, propertiesSize, columns, feature))
+        {
+            delete feature;
+            failed = true;
+            return;
+        }
+        features[i] = feature;
+    }, 256);
+
+    if (failed) {
+        LError("Invalid FlatGeobuf: features");
+        for (auto& feature : features)
+            delete feature;
+        delete layer;
+        return nullptr;
+    }
+
+    // In the order of the file, the FIDs are 0, 1, 2, ...
+    layer->setGeometryType(toGeometryType(geometryType));
+    layer->reserveFeatureCount(count);
+    for (auto& feature : features) {
+        if (feature)
+            layer->addFeature(feature);
+    }
+    if (skippedCount > 0)
+        LWarn("{0} features skipped, empty or unsupported geometry", skippedCount.load());
+
+    layer->createGridIndex();
+    return layer;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Write                            */
+/*                                      */
+/****************************************/
+
+// All the points of the line strings in one vector
+size_t writePoints(FlatBufferWriter& writer, const std::vector<GeoLineString*>& lines)
+{
+    size_t pointsCount = 0;
+    for (auto& line : lines)
+        pointsCount += line->getNumPoints();
+    size_t position = writer.beginVector(pointsCount * 2, sizeof(double));
+    for (auto& line : lines) {
+        if (line->getNumPoints() > 0)
+            writer.append(&(*line)[0], line->getNumPoints() * sizeof(GeoRawPoint));
+    }
+    return position;
+}
+
+// Rings of a polygon, or lines of a multi line string
+size_t writeLines(FlatBufferWriter& writer, const std::vector<GeoLineString*>& lines, uint8_t type, bool withType)
+{
+    TableWriter table;
+    table.addOffset(kGeometryXY);
+    if (lines.size() > 1)
+        table.addOffset(kGeometryEnds);
+    if (withType)
+        table.add<uint8_t>(kGeometryType, type);
+    size_t position = table.write(writer);
+
+    writer.setOffset(table.getPosition(kGeometryXY), writePoints(writer, lines));
+    if (lines.size() > 1) {
+        std::vector<uint32_t> ends;
+        uint32_t end = 0;
+        for (auto& line : lines) {
+            end += line->getNumPoints();
+            ends.push_back(end);
+        }
+        writer.setOffset(table.getPosition(kGeometryEnds), writer.writeVector(ends.data(), ends.size()));
+    }
+    return position;
+}
+
+std::vector<GeoLineString*> ringsOf(GeoPolygon* polygon)
+{
+    std::vector<GeoLineString*> rings;
+    if (polygon->isEmpty())
+        return rings;
+    rings.push_back(polygon->getExteriorRing());
+    int interiorRingsCount = polygon->getInteriorRingsCount();
+    for (int i = 0; i < interiorRingsCount; ++i)
+        rings.push_back(polygon->getInteriorRing(i));
+    return rings;
+}
+
+size_t writeGeometry(FlatBufferWriter& writer, GeoGeometry* geom, bool withType)
+{
+    uint8_t type = toFgbGeometryType(geom->getGeometryType());
+    switch (geom->getGeometryType()) {
+    default:
+        return 0;
+    case kPoint:
+    case kMultiPoint: {
+        std::vector<GeoRawPoint> points;
+        if (geom->getGeometryType() == kPoint) {
+            points.push_back(geom->toPoint()->getXY());
+        }
+        else {
+            GeoMultiPoint* multiPoint = geom->toMultiPoint();
+            int pointsCount = multiPoint->getNumGeometries();
+            for (int i = 0; i < pointsCount; ++i)
+                points.push_back(multiPoint->getPoint(i)->getXY());
+        }
+        TableWriter table;
+        table.addOffset(kGeometryXY);
+        if (withType)
+            table.add<uint8_t>(kGeometryType, type);
+        size_t position = table.write(writer);
+        const double* xy = points.empty() ? nullptr : &points[0].x;
+        writer.setOffset(table.getPosition(kGeometryXY), writer.writeVector(xy, points.size() * 2));
+        return position;
+    }
+    case kLineString:
+        return writeLines(writer, { geom->toLineString() }, type, withType);
+    case kPolygon:
+        return writeLines(writer, ringsOf(geom->toPolygon()), type, withType);
+    case kMultiLineString: {
+        GeoMultiLineString* multiLineString = geom->toMultiLineString();
+        std::vector<GeoLineString*> lines;
+        int linesCount = multiLineString->getNumGeometries();
+        for (int i = 0; i < linesCount; ++i)
+            lines.push_back(multiLineString->getLineString(i));
+        return writeLines(writer, lines, type, withType);
+    }
+    case kMultiPolygon: {
+        GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+        int polygonsCount = multiPolygon->getNumGeometries();
+        TableWriter table;
+        table.addOffset(kGeometryParts);
+        if (withType)
+            table.add<uint8_t>(kGeometryType, type);
+        size_t position = table.write(writer);
+
+        size_t parts = writer.beginVector(polygonsCount, 4);
+        writer.bytes.resize(writer.bytes.size() + polygonsCount * size_t(4), 0);
+        writer.setOffset(table.getPosition(kGeometryParts), parts);
+        for (int i = 0; i < polygonsCount; ++i) {
+            size_t part = writeLines(writer, ringsOf(multiPolygon->getPolygon(i)), kFgbPolygon, true);
+            writer.setOffset(parts + 4 + i * size_t(4), part);
+        }
+        return position;
+    }
+    }
+}
+
+std::vector<uint8_t> writeFeature(GeoFeature* feature, const std::vector<GeoFieldType>& fieldTypes, bool withType)
+{
+    FlatBufferWriter writer;
+    TableWriter table;
+    table.addOffset(kFeatureGeometry);
+    if (!fieldTypes.empty())
+        table.addOffset(kFeatureProperties);
+    size_t position = table.write(writer);
+    writer.setRoot(position);
+    writer.setOffset(table.getPosition(kFeatureGeometry), writeGeometry(writer, feature->getGeometry(), withType));
+
+    if (!fieldTypes.empty()) {
+        // (uint16 field, value) of every field
+        std::vector<uint8_t> properties;
+        auto put = [&properties](const void* p, size_t size) {
+            properties.insert(properties.end(), static_cast<const uint8_t*>(p), static_cast<const uint8_t*>(p) + size);
+        };
+        for (int i = 0; i < int(fieldTypes.size()); ++i) {
+            uint16_t iColumn = uint16_t(i);
+            put(&iColumn, sizeof(iColumn));
+            switch (fieldTypes[i]) {
+            default:
+                break;
+            case kFieldInt: {
+                int value;
+                feature->getField(i, &value);
+                int32_t value32 = value;
+                put(&value32, sizeof(value32));
+                break;
+            }
+            case kFieldDouble: {
+                double value;
+                feature->getField(i, &value);
+                put(&value, sizeof(value));
+                break;
+            }
+            case kFieldText: {
+                QString value;
+                feature->getField(i, &value);
+                QByteArray utf8 = value.toUtf8();
+                uint32_t length = uint32_t(utf8.size());
+                put(&length, sizeof(length));
+                put(utf8.constData(), utf8.size());
+                break;
+            }
+            }
+        }
+        writer.setOffset(table.getPosition(kFeatureProperties),
+                         writer.writeVector(properties.data(), properties.size()));
+    }
+
+    return std::move(writer.finish());
+}
+
+std::vector<uint8_t> writeHeader(GeoFeatureLayer* layer, uint8_t geometryType, uint64_t featuresCount,
+                                 const GeoExtent& extent, uint16_t nodeSize)
+{
+    FlatBufferWriter writer;
+    int fieldsCount = layer->getNumFields();
+    QString spatialRef = layer->getSpatialRef();
+
+    TableWriter table;
+    table.addOffset(kHeaderName);
+    if (featuresCount > 0)
+        table.addOffset(kHeaderEnvelope);
+    table.add<uint8_t>(kHeaderGeometryType, geometryType);
+    if (fieldsCount > 0)
+        table.addOffset(kHeaderColumns);
+    table.add<uint64_t>(kHeaderFeaturesCount, featuresCount);
+    table.add<uint16_t>(kHeaderIndexNodeSize, nodeSize);
+    if (!spatialRef.isEmpty())
+        table.addOffset(kHeaderCrs);
+    size_t position = table.write(writer);
+    writer.setRoot(position);
+
+    writer.setOffset(table.getPosition(kHeaderName), writer.writeString(layer->getName()));
+    if (featuresCount > 0) {
+        double envelope[4] = { extent.minX, extent.minY, extent.maxX, extent.maxY };
+        writer.setOffset(table.getPosition(kHeaderEnvelope), writer.writeVector(envelope, 4));
+    }
+
+    if (fieldsCount > 0) {
+        size_t columns = writer.beginVector(fieldsCount, 4);
+        writer.bytes.resize(writer.bytes.size() + fieldsCount * size_t(4), 0);
+        writer.setOffset(table.getPosition(kHeaderColumns), columns);
+        for (int i = 0; i < fieldsCount; ++i) {
+            GeoFieldDefn* fieldDefn = layer->getFieldDefn(i);
+            uint8_t type = fieldDefn->getType() == kFieldInt ? kFgbInt
+                : fieldDefn->getType() == kFieldDouble ? kFgbDouble : kFgbString;
+            TableWriter column;
+            column.addOffset(kColumnName);
+            column.add<uint8_t>(kColumnType, type);
+            if (fieldDefn->getWidth() > 0)
+                column.add<int32_t>(kColumnWidth, fieldDefn->getWidth());
+            size_t columnPosition = column.write(writer);
+            writer.setOffset(columns + 4 + i * size_t(4), columnPosition);
+            writer.setOffset(column.getPosition(kColumnName), writer.writeString(fieldDefn->getName()));
+        }
+    }
+
+    if (!spatialRef.isEmpty()) {
+        TableWriter crs;
+        crs.addOffset(kCrsWkt);
+        size_t crsPosition = crs.write(writer);
+        writer.setOffset(table.getPosition(kHeaderCrs), crsPosition);
+        writer.setOffset(crs.getPosition(kCrsWkt), writer.writeString(spatialRef));
+    }
+
+    return std::move(writer.finish());
+}
+
+/* The nodes above the leaves, each one the box of its children */
+void buildIndex(std::vector<NodeItem>& nodes, uint64_t itemsCount, uint16_t nodeSize)
+{
+    auto bounds = levelBounds(itemsCount, nodeSize);
+    for (size_t level = 0; level + 1 < bounds.size(); ++level) {
+        uint64_t pos = bounds[level].first;
+        uint64_t end = bounds[level].second;
+        uint64_t parent = bounds[level + 1].first;
+        while (pos < end) {
+            NodeItem node = { INFINITY, INFINITY, -INFINITY, -INFINITY, pos };
+            for (uint16_t k = 0; k < nodeSize && pos < end; ++k, ++pos) {
+                node.minX = std::min(node.minX, nodes[pos].minX);
+                node.minY = std::min(node.minY, nodes[pos].minY);
+                node.maxX = std::max(node.maxX, nodes[pos].maxX);
+                node.maxY = std::max(node.maxY, nodes[pos].maxY);
+            }
+            nodes[parent++] = node;
+        }
+    }
+}
+
+} // anonymous namespace
+
+
+/****************************************/
+/*                                      */
+/*     FlatGeobuf                       */
+/*                                      */
+/****************************************/
+
+GeoFeatureLayer* FlatGeobuf::readLayer(const std::string& filename)
+{
+    return readFile(filename, nullptr);
+}
+
+GeoFeatureLayer* FlatGeobuf::readLayer(const std::string& filename, const GeoExtent& extent)
+{
+    return readFile(filename, &extent);
+}
+
+bool FlatGeobuf::writeLayer(GeoFeatureLayer* layer, const std::string& filename, bool withIndex /*= true*/)
+{
+    if (!layer) {
+        LError("Input layer is null");
+        return false;
+    }
+
+    std::vector<GeoFeature*> features;
+    for (auto& feature : *layer) {
+        if (feature->isDeleted() || !feature->getGeometry())
+            continue;
+        if (toFgbGeometryType(feature->getGeometryType()) == kFgbUnknown) {
+            LWarn("Feature {0} not saved, unsupported geometry", feature->getFID());
+            continue;
+        }
+        // No extent to index
+        if (feature->getGeometry()->isEmpty()) {
+            LWarn("Feature {0} not saved, empty geometry", feature->getFID());
+            continue;
+        }
+        features.push_back(feature);
+    }
+
+    // One type in the header, or the type of each geometry
+    uint8_t geometryType = kFgbUnknown;
+    if (!features.empty()) {
+        GeometryType type = features[0]->getGeometryType();
+        bool sameType = std::all_of(features.begin(), features.end(), [type](GeoFeature* feature) {
+            return feature->getGeometryType() == type;
+        });
+        geometryType = sameType ? toFgbGeometryType(type) : kFgbUnknown;
+    }
+
+    GeoExtent extent;
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (i == 0)
+            extent = features[i]->getExtent();
+        else
+            extent.merge(features[i]->getExtent());
+    }
+
+    // Along the Hilbert curve, so close features are close in the file
+    uint64_t featuresCount = features.size();
+    withIndex = withIndex && featuresCount > 0;
+    if (withIndex) {
+        const double hilbertMax = double((1 << 16) - 1);
+        double width = extent.width();
+        double height = extent.height();
+        std::vector<std::pair<uint32_t, GeoFeature*>> sorted;
+        sorted.reserve(features.size());
+        for (auto& feature : features) {
+            const GeoExtent& box = feature->getExtent();
+            uint32_t x = width > 0.0 ? uint32_t(std::floor(hilbertMax * (box.centerX() - extent.minX) / width)) : 0;
+            uint32_t y = height > 0.0 ? uint32_t(std::floor(hilbertMax * (box.centerY() - extent.minY) / height)) : 0;
+            sorted.emplace_back(hilbert(x, y), feature);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, GeoFeature*>& a,
+                                                          const std::pair<uint32_t, GeoFeature*>& b) {
+            return a.first > b.first;
+        });
+        for (size_t i = 0; i < sorted.size(); ++i)
+            features[i] = sorted[i].second;
+    }
+
+    // Features, in parallel
+    std::vector<GeoFieldType> fieldTypes;
+    for (int i = 0; i < layer->getNumFields(); ++i)
+        fieldTypes.push_back(layer->getFieldDefn(i)->getType());
+    std::vector<std::vector<uint8_t>> buffers(features.size());
+    bool withType = geometryType == kFgbUnknown;
+    utils::parallelFor(0, int(features.size()), [&](int i) {
+        buffers[i] = writeFeature(features[i], fieldTypes, withType);
+    }, 256);
+
+    // Index: the leaves are the features, in the order of the file
+    std::vector<NodeItem> nodes;
+    if (withIndex) {
+        auto bounds = levelBounds(featuresCount, kFgbDefaultNodeSize);
+        nodes.resize(size_t(bounds.front().second));
+        uint64_t offset = 0;
+        for (size_t i = 0; i < features.size(); ++i) {
+            const GeoExtent& box = features[i]->getExtent();
+            nodes[size_t(bounds.front().first + i)] = { box.minX, box.minY, box.maxX, box.maxY, offset };
+            offset += buffers[i].size();
+        }
+        buildIndex(nodes, featuresCount, kFgbDefaultNodeSize);
+    }
+
+    std::vector<uint8_t> header = writeHeader(layer, geometryType, featuresCount, extent,
+                                              withIndex ? kFgbDefaultNodeSize : 0);
+
+    // Written to a temporary file first, the old file is kept if something goes wrong
+    std::string tempFilename = filename + ".tmp";
+    FILE* fp = fopen(tempFilename.c_str(), "wb");
+    if (!fp) {
+        LError("Open file to write error: {0}", tempFilename);
+        return false;
+    }
+    setvbuf(fp, nullptr, _IOFBF, 1 << 20);
+
+    bool ok = fwrite(kMagic, 1, sizeof(kMagic), fp) == sizeof(kMagic)
+        && fwrite(header.data(), 1, header.size(), fp) == header.size()
+        && fwrite(nodes.data(), sizeof(NodeItem), nodes.size(), fp) == nodes.size();
+    for (size_t i = 0; ok && i < buffers.size(); ++i)
+        ok = fwrite(buffers[i].data(), 1, buffers[i].size(), fp) == buffers[i].size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) {
+        LError("Write file error: {0}", tempFilename);
+        remove(tempFilename.c_str());
+        return false;
+    }
+
+    remove(filename.c_str());
+    if (rename(tempFilename.c_str(), filename.c_str()) != 0) {
+        LError("Rename {0} to {1} error", tempFilename, filename);
+        return false;
+    }
+    return true;
+}
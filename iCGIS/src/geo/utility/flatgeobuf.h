@@ -0,0 +1,48 @@
+/*************************************************************
+** class name:  FlatGeobuf
+**
+** description: Read and write FlatGeobuf files (*.fgb)
+**
+**              magic, header, packed Hilbert R-tree, features
+**                - the header and every feature are FlatBuffers
+**                  (size-prefixed), read in place from the
+**                  mapping, no FlatBuffers library is needed
+**                - the index is a static R-tree of the boxes of
+**                  the features, sorted along a Hilbert curve,
+**                  the leaves hold the offsets of the features
+**
+**              With an extent, only the nodes of the index that
+**                intersect it are visited, then only the features
+**                found are read, the rest of the file is never
+**                touched. Without an index every feature is read
+**                and those out of the extent are dropped.
+**
+**              Point, LineString, Polygon and their Multi types,
+**                in 2D (z and m are ignored). The columns of the
+**                header become the fields: integers up to 32 bits
+**                (int), larger or real numbers (double), text
+**                (string, json, date-time). Binary columns and
+**                the columns of single features are skipped.
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <string>
+
+#include "geo/map/geolayer.h"
+
+
+class FlatGeobuf {
+public:
+    /* All the features, in the order of the file */
+    static GeoFeatureLayer* readLayer(const std::string& filename);
+
+    /* Only the features whose box intersects `extent` */
+    static GeoFeatureLayer* readLayer(const std::string& filename, const GeoExtent& extent);
+
+    /* withIndex: sort the features along the Hilbert curve and build
+    **   the index, 16 children per node (GDAL reads no other size)
+    ** Without it, the features are kept in the order of the layer */
+    static bool writeLayer(GeoFeatureLayer* layer, const std::string& filename, bool withIndex = true);
+};
@@ -0,0 +1,257 @@
+#include "geo/utility/geo_buffer.h"
+#include "geo/utility/geo_overlay.h"
+#include "geo/utility/geo_predicates.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gm {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+inline GeoRawPoint offsetPoint(const GeoRawPoint& pt, double dx, double dy, double dist) {
+    return GeoRawPoint(pt.x + dx * dist, pt.y + dy * dist);
+}
+
+// Arc around the center, counterclockwise from angle `start` by `sweep`
+void addArc(const GeoRawPoint& center, double radius, double start, double sweep,
+            const BufferParams& params, std::vector<GeoRawPoint>& piece)
+{
+    int quadrantSegments = std::max(1, params.quadrantSegments);
+    int steps = std::max(1, int(ceil(sweep / (kPi / 2) * quadrantSegments - 1e-9)));
+    for (int k = 0; k <= steps; ++k) {
+        double angle = start + sweep * k / steps;
+        piece.emplace_back(center.x + radius * cos(angle), center.y + radius * sin(angle));
+    }
+}
+
+void addPointPieces(const GeoRawPoint& pt, const BufferParams& params, double dist, RingList& pieces)
+{
+    std::vector<GeoRawPoint> piece;
+    switch (params.capStyle) {
+    case kCapRound:
+        addArc(pt, dist, 0.0, 2 * kPi, params, piece);
+        piece.pop_back();   // the same as the first one
+        break;
+    case kCapSquare:
+        piece.emplace_back(pt.x - dist, pt.y - dist);
+        piece.emplace_back(pt.x + dist, pt.y - dist);
+        piece.emplace_back(pt.x + dist, pt.y + dist);
+        piece.emplace_back(pt.x - dist, pt.y + dist);
+        break;
+    case kCapFlat:
+        break;
+    }
+    if (!piece.empty())
+        pieces.push_back(std::move(piece));
+}
+
+/* Pieces of the buffer of a polyline (closed: a ring)
+**   rectangle along each segment
+**   wedge on the outer side of each turn (join)
+**   caps at both ends of an open line */
+void addLinePieces(const std::vector<GeoRawPoint>& points, bool isClosed,
+                   const BufferParams& params, double dist, RingList& pieces)
+{
+    int n = points.size();
+    if (n == 0)
+        return;
+    if (n == 1) {
+        addPointPieces(points[0], params, dist, pieces);
+        return;
+    }
+    if (isClosed && n < 3)
+        isClosed = false;
+
+    // Unit direction of each segment
+    int segsCount = isClosed ? n : n - 1;
+    std::vector<GeoRawPoint> dirs(segsCount);
+    for (int i = 0; i < segsCount; ++i) {
+        const GeoRawPoint& a = points[i];
+        const GeoRawPoint& b = points[(i + 1) % n];
+        double len = sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+        dirs[i] = GeoRawPoint((b.x - a.x) / len, (b.y - a.y) / len);
+    }
+
+    // Segments
+    for (int i = 0; i < segsCount; ++i) {
+        const GeoRawPoint& a = points[i];
+        const GeoRawPoint& b = points[(i + 1) % n];
+        double nx = -dirs[i].y, ny = dirs[i].x;     // left normal
+        pieces.push_back({ offsetPoint(a, -nx, -ny, dist), offsetPoint(b, -nx, -ny, dist),
+                           offsetPoint(b, nx, ny, dist), offsetPoint(a, nx, ny, dist) });
+    }
+
+    // Joins
+    int first = isClosed ? 0 : 1;
+    int last = isClosed ? n : n - 1;
+    for (int i = first; i < last; ++i) {
+        int prevSeg = (i + segsCount - 1) % segsCount;
+        int nextSeg = i % segsCount;
+        const GeoRawPoint& v = points[i];
+        const GeoRawPoint& u1 = dirs[prevSeg];
+        const GeoRawPoint& u2 = dirs[nextSeg];
+        double turn = orient2d(points[(i + n - 1) % n], v, points[(i + 1) % n]);
+        double dot = u1.x * u2.x + u1.y * u2.y;
+        if (turn == 0.0 && dot > 0.0)
+            continue;   // straight
+
+        // Outer side of the turn, the wedge goes counterclockwise
+        //   from `start` to `end`
+        GeoRawPoint start, end;
+        if (turn >= 0.0) {
+            // Left turn (or going back): outer side on the right
+            start = GeoRawPoint(u1.y, -u1.x);
+            end = GeoRawPoint(u2.y, -u2.x);
+        }
+        else {
+            start = GeoRawPoint(-u2.y, u2.x);
+            end = GeoRawPoint(-u1.y, u1.x);
+        }
+        double sweep = atan2(fabs(u1.x * u2.y - u1.y * u2.x), dot);
+        if (turn == 0.0)
+            sweep = kPi;
+
+        std::vector<GeoRawPoint> piece;
+        piece.push_back(v);
+        BufferJoinStyle joinStyle = params.joinStyle;
+        double miterRatio = 0.0;
+        if (joinStyle == kJoinMiter) {
+            double c = cos(sweep / 2);
+            miterRatio = c > 0.0 ? 1.0 / c : 0.0;
+            if (c <= 0.0 || miterRatio > params.miterLimit)
+                joinStyle = kJoinBevel;
+        }
+        switch (joinStyle) {
+        case kJoinRound:
+            addArc(v, dist, atan2(start.y, start.x), sweep, params, piece);
+            break;
+        case kJoinMiter: {
+            double mx = start.x + end.x, my = start.y + end.y;
+            double len = sqrt(mx * mx + my * my);
+            piece.push_back(offsetPoint(v, start.x, start.y, dist));
+            piece.push_back(offsetPoint(v, mx / len, my / len, dist * miterRatio));
+            piece.push_back(offsetPoint(v, end.x, end.y, dist));
+            break;
+        }
+        case kJoinBevel:
+            piece.push_back(offsetPoint(v, start.x, start.y, dist));
+            piece.push_back(offsetPoint(v, end.x, end.y, dist));
+            break;
+        }
+        pieces.push_back(std::move(piece));
+    }
+
+    // Caps
+    if (isClosed || params.capStyle == kCapFlat)
+        return;
+    const GeoRawPoint& a = points[0];
+    const GeoRawPoint& b = points[n - 1];
+    const GeoRawPoint& ua = dirs[0];
+    const GeoRawPoint& ub = dirs[segsCount - 1];
+    if (params.capStyle == kCapRound) {
+        std::vector<GeoRawPoint> pieceA, pieceB;
+        addArc(a, dist, atan2(ua.x, -ua.y), kPi, params, pieceA);      // from the left normal
+        addArc(b, dist, atan2(-ub.x, ub.y), kPi, params, pieceB);      // from the right normal
+        pieces.push_back(std::move(pieceA));
+        pieces.push_back(std::move(pieceB));
+    }
+    else {
+        double nx = -ua.y, ny = ua.x;
+        GeoRawPoint back = offsetPoint(a, -ua.x, -ua.y, dist);
+        pieces.push_back({ offsetPoint(back, -nx, -ny, dist), offsetPoint(a, -nx, -ny, dist),
+                           offsetPoint(a, nx, ny, dist), offsetPoint(back, nx, ny, dist) });
+        nx = -ub.y, ny = ub.x;
+        GeoRawPoint front = offsetPoint(b, ub.x, ub.y, dist);
+        pieces.push_back({ offsetPoint(b, -nx, -ny, dist), offsetPoint(front, -nx, -ny, dist),
+                           offsetPoint(front, nx, ny, dist), offsetPoint(b, nx, ny, dist) });
+    }
+}
+
+// Vertices without consecutive duplicates (and the closing point)
+void uniquePoints(GeoLineString* line, std::vector<GeoRawPoint>& points)
+{
+    points.clear();
+    points.reserve(line->getNumPoints());
+    for (auto& pt : *line) {
+        if (points.empty() || points.back().x != pt.x || points.back().y != pt.y)
+            points.push_back(pt);
+    }
+    if (points.size() > 1 && points.front().x == points.back().x && points.front().y == points.back().y)
+        points.pop_back();
+}
+
+// Pieces of the buffer of a geometry (the polygons themselves excluded)
+void addGeometryPieces(GeoGeometry* geom, const BufferParams& params, double dist,
+                       RingList& pieces, RingList& polygonRings)
+{
+    switch (geom->getGeometryType()) {
+    default:
+        break;
+    case kPoint:
+        addPointPieces(geom->toPoint()->getXY(), params, dist, pieces);
+        break;
+    case kLineString: {
+        GeoLineString* line = geom->toLineString();
+        int pointsCount = line->getNumPoints();
+        // An empty part of a multi line string
+        if (pointsCount == 0)
+            break;
+        const GeoRawPoint& first = (*line)[0];
+        const GeoRawPoint& last = (*line)[pointsCount - 1];
+        bool isClosed = pointsCount > 3 && first.x == last.x && first.y == last.y;
+        std::vector<GeoRawPoint> points;
+        uniquePoints(line, points);
+        if (!isClosed && points.size() > 1 && first.x == last.x && first.y == last.y)
+            points.push_back(last);     // open line ending where it starts
+        addLinePieces(points, isClosed, params, dist, pieces);
+        break;
+    }
+    case kPolygon: {
+        RingList rings;
+        collectRings(geom, rings);
+        for (auto& ring : rings)
+            addLinePieces(ring, true, params, dist, pieces);
+        polygonRings.insert(polygonRings.end(), rings.begin(), rings.end());
+        break;
+    }
+    case kMultiPoint:
+    case kMultiLineString:
+    case kMultiPolygon: {
+        GeoGeometryCollection* collection = utils::down_cast<GeoGeometryCollection*>(geom);
+        int geomsCount = collection->getNumGeometries();
+        for (int i = 0; i < geomsCount; ++i)
+            addGeometryPieces(collection->getGeometry(i), params, dist, pieces, polygonRings);
+        break;
+    }
+    }
+}
+
+} // anonymous namespace
+
+
+GeoGeometry* buffer(GeoGeometry* geom, const BufferParams& params)
+{
+    if (!geom || geom->isEmpty() || params.distance == 0.0)
+        return nullptr;
+
+    double dist = fabs(params.distance);
+    RingList pieces;
+    RingList polygonRings;
+    addGeometryPieces(geom, params, dist, pieces, polygonRings);
+
+    if (params.distance > 0.0) {
+        pieces.insert(pieces.end(), polygonRings.begin(), polygonRings.end());
+        return unionRings(pieces);
+    }
+    else {
+        // Negative: the band along the boundary is removed
+        if (polygonRings.empty())
+            return nullptr;
+        return overlayRings(polygonRings, pieces, kOverlayDifference);
+    }
+}
+
+} // namespace gm
@@ -0,0 +1,46 @@
+/*******************************************************
+** description: Buffer of points, lines and polygons
+**
+**              The buffer is built from simple convex pieces
+**                (a rectangle along each segment, a wedge at
+**                each turn, caps at the ends), and the pieces
+**                are merged by a self-union (geo_overlay.h).
+**
+**              A negative distance shrinks polygons (the band
+**                along the boundary is subtracted), points and
+**                lines have no negative buffer.
+**
+** last change: 2020-04-06
+*******************************************************/
+#pragma once
+
+#include "geo/geometry/geogeometry.h"
+
+
+namespace gm {
+
+enum BufferJoinStyle {
+    kJoinRound      = 0,
+    kJoinMiter      = 1,
+    kJoinBevel      = 2
+};
+
+enum BufferCapStyle {
+    kCapRound       = 0,
+    kCapSquare      = 1,
+    kCapFlat        = 2
+};
+
+struct BufferParams {
+    double distance = 0.0;
+    int quadrantSegments = 8;       // segments of a quarter circle
+    BufferJoinStyle joinStyle = kJoinRound;
+    BufferCapStyle capStyle = kCapRound;
+    double miterLimit = 5.0;        // miter length / distance, bevel if longer
+};
+
+/* Buffer of the geometry
+** Return a GeoPolygon or a GeoMultiPolygon, nullptr if empty */
+GeoGeometry* buffer(GeoGeometry* geom, const BufferParams& params);
+
+} // namespace gm
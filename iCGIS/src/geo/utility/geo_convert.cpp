@@ -1,8 +1,13 @@
 #include "geo_convert.h"
 
 #include "util/logger.h"
+#include "util/parallel.h"
 #include "geo/map/geomap.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 
 GeometryType convertOGRwkbGeometryType(OGRwkbGeometryType type)
 {
@@ -29,12 +34,86 @@ GeoFieldType convertOGRFieldType(OGRFieldType type)
     }
 }
 
+namespace {
+
+bool convertOGRLayerWithColor(OGRLayer* poLayerIn, GeoFeatureLayer* geoLayerOut,
+                              const GeoExtent* extent, const char* where, unsigned int color);
+
+// One layer, converted by a worker thread
+// GDAL handles are not thread-safe: the first layer of a dataset is read
+//  through the dataset handle, the others through handles of their own
+struct LayerTask {
+    GDALDataset* poDS = nullptr;        // handle of the dataset
+    bool ownHandle = false;             // open the dataset again for this task
+    int iLayer = 0;
+    unsigned int color = 0;             // picked before, rand() is per thread
+    GeoFeatureLayer* layer = nullptr;
+    bool ok = false;
+    bool retry = false;                 // the dataset could not be opened again
+};
+
+GDALDataset* openVectorDataset(const char* path)
+{
+    return (GDALDataset*)GDALOpenEx(path, GDAL_OF_VECTOR | GDAL_OF_READONLY, nullptr, nullptr, nullptr);
+}
+
+void runLayerTask(LayerTask& task, GDALDataset* poDS, const GeoExtent* extent, const char* where)
+{
+    OGRLayer* poLayer = poDS->GetLayer(task.iLayer);
+    task.layer = new GeoFeatureLayer();
+    if (!poLayer)
+        return;
+    task.layer->setGeometryType(convertOGRwkbGeometryType(poLayer->GetGeomType()));
+    task.ok = convertOGRLayerWithColor(poLayer, task.layer, extent, where, task.color);
+}
+
+// All the tasks on the worker threads, then the ones whose dataset could
+//  not be opened again one after another through the dataset handle
+void runLayerTasks(std::vector<LayerTask>& tasks, const GeoExtent* extent, const char* where)
+{
+    utils::parallelFor(0, int(tasks.size()), [&](int i) {
+        LayerTask& task = tasks[i];
+        if (!task.ownHandle) {
+            runLayerTask(task, task.poDS, extent, where);
+            return;
+        }
+        GDALDataset* poDS = openVectorDataset(task.poDS->GetDescription());
+        if (!poDS) {
+            task.retry = true;
+            return;
+        }
+        runLayerTask(task, poDS, extent, where);
+        GDALClose(poDS);
+    }, 1);
+
+    for (auto& task : tasks) {
+        if (task.retry)
+            runLayerTask(task, task.poDS, extent, where);
+    }
+}
+
+std::vector<LayerTask> createLayerTasks(GDALDataset* poDS)
+{
+    int layerCount = poDS->GetLayerCount();
+    std::vector<LayerTask> tasks(layerCount);
+    for (int i = 0; i < layerCount; ++i) {
+        tasks[i].poDS = poDS;
+        tasks[i].ownHandle = (i > 0);
+        tasks[i].iLayer = i;
+        tasks[i].color = utils::getRandomColor();
+    }
+    return tasks;
+}
+
+} // namespace
+
 /***********************************/
 /*                                 */
 /*       GDALDataset -> GeoMap     */
 /*	                               */
 /***********************************/
-bool convertGDALDataset(GDALDataset* poDsIn, GeoMap* geoMapOut)
+bool convertGDALDataset(GDALDataset* poDsIn, GeoMap* geoMapOut,
+                        const GeoExtent* extent /*= nullptr*/, const char* where /*= nullptr*/)
 {
     if (!poDsIn || !geoMapOut)
         return false;
@@ -45,20 +124,79 @@ bool convertGDALDataset(GDALDataset* poDsIn, GeoMap* geoMapOut)
         return true;
     }
 
-    for (int i = 0; i < layerCount; ++i) {
-        OGRLayer* poLayer = poDsIn->GetLayer(i);
-        GeoFeatureLayer* geoLayer = new GeoFeatureLayer();
-        geoLayer->setGeometryType(convertOGRwkbGeometryType(poLayer->GetGeomType()));
-        if (convertOGRLayer(poLayer, geoLayer)) {
-            geoMapOut->addLayer(geoLayer);
+    std::vector<LayerTask> tasks = createLayerTasks(poDsIn);
+    runLayerTasks(tasks, extent, where);
+
+    // In the order of the dataset, until the first error
+    bool ok = true;
+    for (auto& task : tasks) {
+        if (ok && task.ok) {
+            geoMapOut->addLayer(task.layer);
         }
         else {
-            delete geoLayer;
-            return false;
+            ok = false;
+            delete task.layer;
         }
     }
 
-    return true;
+    return ok;
+}
+
+/***********************************/
+/*                                 */
+/*       Files -> GeoMap           */
+/*	                               */
+/***********************************/
+void convertOGRFiles(const std::vector<std::string>& paths, GeoMap* geoMapOut,
+                     std::vector<std::vector<GeoFeatureLayer*>>& layersOut,
+                     const GeoExtent* extent /*= nullptr*/, const char* where /*= nullptr*/)
+{
+    int filesCount = int(paths.size());
+    layersOut.assign(filesCount, std::vector<GeoFeatureLayer*>());
+    if (!geoMapOut || filesCount == 0)
+        return;
+
+    // Opened in parallel too (a GeoPackage or a big *.dbf takes a while)
+    std::vector<GDALDataset*> datasets(filesCount, nullptr);
+    utils::parallelFor(0, filesCount, [&](int i) {
+        datasets[i] = openVectorDataset(paths[i].c_str());
+    }, 1);
+
+    // The layers of all the files at once
+    std::vector<LayerTask> tasks;
+    std::vector<int> tasksOfFile(filesCount + 1, 0);
+    for (int i = 0; i < filesCount; ++i) {
+        tasksOfFile[i] = int(tasks.size());
+        if (!datasets[i]) {
+            LError("Open {0} error", paths[i]);
+            continue;
+        }
+        std::vector<LayerTask> fileTasks = createLayerTasks(datasets[i]);
+        tasks.insert(tasks.end(), fileTasks.begin(), fileTasks.end());
+    }
+    tasksOfFile[filesCount] = int(tasks.size());
+
+    runLayerTasks(tasks, extent, where);
+
+    // In the order of the files, a file with a bad layer is dropped
+    for (int i = 0; i < filesCount; ++i) {
+        bool ok = true;
+        for (int k = tasksOfFile[i]; k < tasksOfFile[i + 1]; ++k)
+            ok = ok && tasks[k].ok;
+        if (!ok)
+            LError("Read {0} error", paths[i]);
+        for (int k = tasksOfFile[i]; k < tasksOfFile[i + 1]; ++k) {
+            if (ok) {
+                geoMapOut->addLayer(tasks[k].layer);
+                layersOut[i].push_back(tasks[k].layer);
+            }
+            else {
+                delete tasks[k].layer;
+            }
+        }
+        if (datasets[i])
+            GDALClose(datasets[i]);
+    }
 }
 
 /***********************************/
@@ -66,36 +204,97 @@ bool convertGDALDataset(GDALDataset* poDsIn, GeoMap* geoMapOut)
 /*       OGRLayer -> GeoFeatureLayer      */
 /*	                               */
 /***********************************/
-bool convertOGRLayer(OGRLayer* poLayerIn, GeoFeatureLayer* geoLayerOut)
+bool convertOGRLayer(OGRLayer* poLayerIn, GeoFeatureLayer* geoLayerOut,
+                     const GeoExtent* extent /*= nullptr*/, const char* where /*= nullptr*/)
+{
+    return convertOGRLayerWithColor(poLayerIn, geoLayerOut, extent, where, utils::getRandomColor());
+}
+
+namespace {
+
+// The features in one layer have the same color firstly
+bool convertOGRLayerWithColor(OGRLayer* poLayerIn, GeoFeatureLayer* geoLayerOut,
+                              const GeoExtent* extent, const char* where, unsigned int color)
 {
     if (!poLayerIn || !geoLayerOut)
         return false;
 
+    // The filters are applied by the driver (and its index, e.g. *.qix),
+    //  the features out of them are never converted
+    if (extent)
+        poLayerIn->SetSpatialFilterRect(extent->minX, extent->minY, extent->maxX, extent->maxY);
+    if (where && where[0] != '\0' && poLayerIn->SetAttributeFilter(where) != OGRERR_NONE) {
+        LError("Invalid attribute filter: {0}", where);
+        poLayerIn->SetSpatialFilter(nullptr);
+        return false;
+    }
+    bool filtered = extent || (where && where[0] != '\0');
+
     poLayerIn->ResetReading();
     //geoLayerOut->setName(QString::fromLocal8Bit(poLayerIn->GetName()));
     geoLayerOut->setName(poLayerIn->GetName());
 
-    //	// Projection info
-    //	char* spatialRef = nullptr;
-    //	OGRSpatialReference* ref = poLayerIn->GetSpatialRef();
-    //	ref->exportToWkt(&spatialRef);
-    //	geoLayerOut->setSpatialRef(spatialRef);
-    //	CPLFree(spatialRef);
-    //
-    int featureCount = poLayerIn->GetFeatureCount();
+    // Projection info, the rasters of the map are warped to it
+    OGRSpatialReference* poSRS = poLayerIn->GetSpatialRef();
+    if (poSRS) {
+        char* pszWkt = nullptr;
+        if (poSRS->exportToWkt(&pszWkt) == OGRERR_NONE && pszWkt)
+            geoLayerOut->setSpatialRef(pszWkt);
+        CPLFree(pszWkt);
+    }
+
+    // With a filter, counting may scan the whole layer: only when it is cheap
+    GIntBig featureCount = poLayerIn->GetFeatureCount(filtered ? FALSE : TRUE);
     if (featureCount == 0) {
         LInfo("No features in the layer");
+        poLayerIn->SetAttributeFilter(nullptr);
+        poLayerIn->SetSpatialFilter(nullptr);
         return true;
     }
-    geoLayerOut->reserveFeatureCount(featureCount);
+    if (featureCount > 0)
+        geoLayerOut->reserveFeatureCount(int(featureCount));
+
+    // Read header definition of attribute table
+    convertOGRFeatureDefn(poLayerIn->GetLayerDefn(), geoLayerOut);
+
+    // Read all features
+    OGRFeature* poFeature = nullptr;
+    while ((poFeature = poLayerIn->GetNextFeature()) != nullptr) {
+        GeoFeature* geoFeature = new GeoFeature(geoLayerOut);
+        if (convertOGRFeature(poFeature, geoFeature)) {
+            geoFeature->setColor(color, false);    // The features in one layer has the same color firstly
+            geoLayerOut->addFeature(geoFeature);
+        }
+        else
+            delete geoFeature;
+        OGRFeature::DestroyFeature(poFeature);
+    }
 
-    OGRFeature* poFeature = poLayerIn->GetNextFeature();
+    // The dataset may be read again
+    if (filtered) {
+        poLayerIn->SetAttributeFilter(nullptr);
+        poLayerIn->SetSpatialFilter(nullptr);
+        LInfo("{0} features passed the filters", geoLayerOut->getFeatureCount());
+    }
 
-    int fieldCount = poFeature->GetFieldCount();
+    // create spatial index
+    geoLayerOut->createGridIndex();
+
+    return true;
+}
+
+} // namespace
+
+/*****************************************/
+/*                                       */
+/*    OGRFeatureDefn -> GeoFieldDefn(s)  */
+/*                                       */
+/*****************************************/
+void convertOGRFeatureDefn(OGRFeatureDefn* poFDefn, GeoFeatureLayer* geoLayerOut)
+{
+    int fieldCount = poFDefn->GetFieldCount();
     geoLayerOut->reserveFieldCount(fieldCount);
 
-    // Read header definition of attribute table
-    OGRFeatureDefn* poFDefn = poFeature->GetDefnRef();
     OGRFieldDefn* poFieldDefn = nullptr;
     for (int i = 0; i < fieldCount; ++i) {
         poFieldDefn = poFDefn->GetFieldDefn(i);
@@ -120,26 +319,6 @@ bool convertOGRLayer(OGRLayer* poLayerIn, GeoFeatureLayer* geoLayerOut)
             break;
         }
     } // end for
-
-    unsigned int color = utils::getRandomColor();
-
-    // Read all features
-    poLayerIn->ResetReading();
-    while (poFeature = poLayerIn->GetNextFeature()) {
-        GeoFeature* geoFeature = new GeoFeature(geoLayerOut);
-        if (convertOGRFeature(poFeature, geoFeature)) {
-            geoFeature->setColor(color, false);    // The features in one layer has the same color firstly
-            geoLayerOut->addFeature(geoFeature);
-        }
-        else
-            delete geoFeature;
-        OGRFeature::DestroyFeature(poFeature);
-    }
-
-    // create spatial index
-    geoLayerOut->createGridIndex();
-
-    return true;
 }
 
 /*************************************/
@@ -180,9 +359,24 @@ bool convertOGRFeature(OGRFeature* poFeatureIn, GeoFeature* geoFeatureOut)
 
     /* Geometry */
     OGRGeometry* poGeometry = poFeatureIn->GetGeometryRef();
-    if (!poGeometry)
+    if (!poGeometry || poGeometry->IsEmpty())
         return false;
 
+    // Fast path: the geometry exported to WKB (a copy of the coordinates
+    //  arrays of OGR) and decoded at once, no per-vertex call
+    // One buffer per thread, reused by all the features
+    static thread_local std::vector<unsigned char> wkb;
+    wkb.resize(poGeometry->WkbSize());
+    if (poGeometry->exportToWkb(wkbNDR, wkb.data(), wkbVariantIso) == OGRERR_NONE) {
+        GeoGeometry* geoGeometry = convertWKB(wkb.data(), wkb.size());
+        if (geoGeometry) {
+            geoFeatureOut->setGeometry(geoGeometry);
+            geoFeatureOut->updateExtent();
+            return true;
+        }
+    }
+
+    // Types not in WKB decoder (curves, collections...)
     OGRwkbGeometryType poGeoType = poGeometry->getGeometryType();
     switch (poGeoType) {
     default:
@@ -243,7 +437,7 @@ bool convertOGRFeature(OGRFeature* poFeatureIn, GeoFeature* geoFeatureOut)
             geoFeatureOut->setGeometry(geoMultiPolygon);
         }
         else {
-            delete geoFeatureOut;
+            delete geoMultiPolygon;
             return false;
         }
         break;
@@ -414,3 +608,257 @@ bool convertOGRMultiLineString(OGRMultiLineString* poMultiLineStringIn, GeoMulti
     return true;
 }
 
+
+/*************************************/
+/*                                   */
+/*        WKB -> GeoGeometry         */
+/*                                   */
+/*************************************/
+namespace {
+
+enum WkbType {
+    kWkbPoint = 1,
+    kWkbLineString = 2,
+    kWkbPolygon = 3,
+    kWkbMultiPoint = 4,
+    kWkbMultiLineString = 5,
+    kWkbMultiPolygon = 6
+};
+
+// The parts of a multi-geometry are geometries with their own header
+const int kWkbMaxDepth = 1;
+
+class WkbReader {
+public:
+    WkbReader(const unsigned char* data, size_t size)
+        : data(data), size(size)
+    {
+        const uint16_t one = 1;
+        isLittleEndian = *reinterpret_cast<const unsigned char*>(&one) == 1;
+    }
+
+    GeoGeometry* readGeometry(int depth = 0);
+
+private:
+    struct Header {
+        bool swap;
+        uint32_t type;      // kWkbPoint...
+        int dims;           // 2, 3 (z or m), 4 (z and m)
+    };
+
+    bool readHeader(Header& header);
+    bool readUInt32(bool swap, uint32_t& value);
+    bool readDouble(bool swap, double& value);
+    bool readPoints(const Header& header, GeoLineString* lineString);
+    GeoPoint* readPoint(const Header& header);
+    GeoPolygon* readPolygon(const Header& header);
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0;
+    bool isLittleEndian = true;
+};
+
+bool WkbReader::readUInt32(bool swap, uint32_t& value)
+{
+    if (size - pos < 4)
+        return false;
+    unsigned char bytes[4];
+    memcpy(bytes, data + pos, 4);
+    if (swap)
+        std::reverse(bytes, bytes + 4);
+    memcpy(&value, bytes, 4);
+    pos += 4;
+    return true;
+}
+
+bool WkbReader::readDouble(bool swap, double& value)
+{
+    if (size - pos < 8)
+        return false;
+    unsigned char bytes[8];
+    memcpy(bytes, data + pos, 8);
+    if (swap)
+        std::reverse(bytes, bytes + 8);
+    memcpy(&value, bytes, 8);
+    pos += 8;
+    return true;
+}
+
+// ISO (1000/2000/3000 + type) and EWKB (flags in the high bits, SRID) types
+bool WkbReader::readHeader(Header& header)
+{
+    if (size - pos < 1)
+        return false;
+    unsigned char byteOrder = data[pos++];
+    if (byteOrder > 1)
+        return false;
+    header.swap = (byteOrder == 1) != isLittleEndian;
+
+    uint32_t type = 0;
+    if (!readUInt32(header.swap, type))
+        return false;
+
+    bool hasZ = (type & 0x80000000u) != 0;
+    bool hasM = (type & 0x40000000u) != 0;
+    bool hasSRID = (type & 0x20000000u) != 0;
+    type &= 0x0FFFFFFFu;
+    switch (type / 1000) {
+    default: return false;
+    case 0: break;
+    case 1: hasZ = true; break;
+    case 2: hasM = true; break;
+    case 3: hasZ = hasM = true; break;
+    }
+    header.type = type % 1000;
+    header.dims = 2 + (hasZ ? 1 : 0) + (hasM ? 1 : 0);
+
+    if (hasSRID) {
+        uint32_t srid;
+        if (!readUInt32(header.swap, srid))
+            return false;
+    }
+    return true;
+}
+
+// Packed 2D coordinates in the order of this machine are copied at once,
+//  the others (z, m, other byte order) point by point
+bool WkbReader::readPoints(const Header& header, GeoLineString* lineString)
+{
+    uint32_t count = 0;
+    if (!readUInt32(header.swap, count))
+        return false;
+    size_t pointSize = header.dims * sizeof(double);
+    if (count > (size - pos) / pointSize)
+        return false;
+
+    if (header.dims == 2 && !header.swap) {
+        lineString->setPackedPoints(data + pos, int(count));
+        pos += count * pointSize;
+        return true;
+    }
+
+    lineString->reserveNumPoints(int(count));
+    for (uint32_t i = 0; i < count; ++i) {
+        double x, y;
+        readDouble(header.swap, x);
+        readDouble(header.swap, y);
+        pos += (header.dims - 2) * sizeof(double);
+        lineString->addPoint(x, y);
+    }
+    return true;
+}
+
+GeoPoint* WkbReader::readPoint(const Header& header)
+{
+    if ((size - pos) / sizeof(double) < size_t(header.dims))
+        return nullptr;
+    double x, y;
+    readDouble(header.swap, x);
+    readDouble(header.swap, y);
+    pos += (header.dims - 2) * sizeof(double);
+    return new GeoPoint(x, y);
+}
+
+// The exterior ring is kept as it is, the interior rings are closed
+//  (as convertOGRPolygon does)
+GeoPolygon* WkbReader::readPolygon(const Header& header)
+{
+    uint32_t numRings = 0;
+    if (!readUInt32(header.swap, numRings) || numRings == 0 || numRings > (size - pos) / 4)
+        return nullptr;
+
+    GeoPolygon* polygon = new GeoPolygon();
+    polygon->reserveInteriorRingsCount(int(numRings) - 1);
+    for (uint32_t i = 0; i < numRings; ++i) {
+        GeoLinearRing* ring = new GeoLinearRing();
+        if (!readPoints(header, ring)) {
+            delete ring;
+            delete polygon;
+            return nullptr;
+        }
+        if (i == 0) {
+            polygon->setExteriorRing(ring);
+        }
+        else {
+            ring->closeRings();
+            polygon->addInteriorRing(ring);
+        }
+    }
+    return polygon;
+}
+
+GeoGeometry* WkbReader::readGeometry(int depth /*= 0*/)
+{
+    Header header;
+    if (!readHeader(header))
+        return nullptr;
+
+    switch (header.type) {
+    default:
+        return nullptr;
+    case kWkbPoint:
+        return readPoint(header);
+    case kWkbLineString:
+    {
+        GeoLineString* lineString = new GeoLineString();
+        if (!readPoints(header, lineString)) {
+            delete lineString;
+            return nullptr;
+        }
+        return lineString;
+    }
+    case kWkbPolygon:
+        return readPolygon(header);
+    case kWkbMultiPoint:
+    case kWkbMultiLineString:
+    case kWkbMultiPolygon:
+    {
+        if (depth >= kWkbMaxDepth)
+            return nullptr;
+        uint32_t numGeoms = 0;
+        if (!readUInt32(header.swap, numGeoms) || numGeoms > (size - pos) / 5)
+            return nullptr;
+
+        GeoGeometryCollection* collection = nullptr;
+        if (header.type == kWkbMultiPoint)
+            collection = new GeoMultiPoint();
+        else if (header.type == kWkbMultiLineString)
+            collection = new GeoMultiLineString();
+        else
+            collection = new GeoMultiPolygon();
+        collection->reserveNumGeoms(int(numGeoms));
+
+        // Each part must be of the type of the collection
+        uint32_t partType = header.type - 3;
+        for (uint32_t i = 0; i < numGeoms; ++i) {
+            size_t partPos = pos;
+            Header partHeader;
+            if (!readHeader(partHeader) || partHeader.type != partType) {
+                delete collection;
+                return nullptr;
+            }
+            pos = partPos;
+            GeoGeometry* part = readGeometry(depth + 1);
+            if (!part) {
+                delete collection;
+                return nullptr;
+            }
+            collection->addGeometry(part);
+        }
+        return collection;
+    }
+    }
+}
+
+} // namespace
+
+GeoGeometry* convertWKB(const unsigned char* wkbIn, size_t size)
+{
+    if (!wkbIn || size == 0)
+        return nullptr;
+
+    WkbReader reader(wkbIn, size);
+    return reader.readGeometry();
+}
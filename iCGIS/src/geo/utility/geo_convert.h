@@ -1,12 +1,15 @@
 /**********************************************************************************
 ** description: Convert data structure in GDAL to this program's data structure
 **
-** last change: 2020-02-06
+** last change: 2020-04-09
 ***********************************************************************************/
 #pragma once
 
 #include <gdal/ogrsf_frmts.h>
 
+#include <string>
+#include <vector>
+
 #include "util/memoryleakdetect.h"
 #include "geo/geometry/geogeometry.h"
 #include "geo/map/geofielddefn.h"
@@ -28,14 +31,39 @@ GeometryType convertOGRwkbGeometryType(OGRwkbGeometryType type);
 GeoFieldType convertOGRFieldType(OGRFieldType type);
 
 // GDALDataset -> GeoMap
-bool convertGDALDataset(GDALDataset* poDsIn, GeoMap* geoMapOut);
+//   extent: only the features intersecting it, nullptr: all
+//   where:  attribute filter (OGR SQL, e.g. "NAME = 'Wuhan'"), nullptr: all
+//   The filters are set on the OGRLayer before it is read, so the driver
+//   skips the other features (with the index of the file if it has one)
+bool convertGDALDataset(GDALDataset* poDsIn, GeoMap* geoMapOut,
+                        const GeoExtent* extent = nullptr, const char* where = nullptr);
+
+// Files -> GeoMap
+//   layersOut[i]: the layers of paths[i], empty if it could not be read
+//   The layers of all the files are converted at once on worker threads,
+//   one GDALDataset handle per layer (the handles are not thread-safe),
+//   then added to the map by the calling thread in the order of the
+//   files and of the layers in each file
+//   convertGDALDataset does the same with the layers of one dataset
+void convertOGRFiles(const std::vector<std::string>& paths, GeoMap* geoMapOut,
+                     std::vector<std::vector<GeoFeatureLayer*>>& layersOut,
+                     const GeoExtent* extent = nullptr, const char* where = nullptr);
 
 // OGRLayer -> GeoFeatureLayer
-bool convertOGRLayer(OGRLayer* poLayer, GeoFeatureLayer* geoLayerOut);
+bool convertOGRLayer(OGRLayer* poLayer, GeoFeatureLayer* geoLayerOut,
+                     const GeoExtent* extent = nullptr, const char* where = nullptr);
+
+// OGRFeatureDefn -> fields of GeoFeatureLayer (integer, real and string)
+void convertOGRFeatureDefn(OGRFeatureDefn* poFDefn, GeoFeatureLayer* geoLayerOut);
 
 // OGRFeature -> GeoFeature
 bool convertOGRFeature(OGRFeature* poFeatureIn, GeoFeature* geoFeatureOut);
 
+// WKB -> GeoGeometry, nullptr if invalid or not supported
+//   2D, ISO (z, m dropped) and EWKB (PostGIS, SRID skipped), both byte orders
+//   Point, LineString, Polygon and their Multi types
+GeoGeometry* convertWKB(const unsigned char* wkbIn, size_t size);
+
 // OGRGeometry ->GeoGeometry
 bool convertOGRPoint(OGRPoint* poPointIn, GeoPoint* geoPointOut);
 bool convertOGRLineString(OGRLineString* poLineStringIn, GeoLineString* geoLineStringOut);
@@ -0,0 +1,497 @@
+#include "geo/utility/geo_delaunay.h"
+#include "geo/utility/geo_predicates.h"
+#include "util/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace gm {
+
+namespace {
+
+constexpr double kMaxDouble = std::numeric_limits<double>::max();
+
+inline double distSquare(const GeoRawPoint& a, const GeoRawPoint& b) {
+    return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+// Squared radius of the circumcircle, max if degenerate
+double circumradiusSquare(const GeoRawPoint& a, const GeoRawPoint& b, const GeoRawPoint& c)
+{
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double ex = c.x - a.x, ey = c.y - a.y;
+    double bl = dx * dx + dy * dy;
+    double cl = ex * ex + ey * ey;
+    double d = dx * ey - dy * ex;
+    if (bl == 0.0 || cl == 0.0 || d == 0.0)
+        return kMaxDouble;
+    double x = (ey * bl - dy * cl) * 0.5 / d;
+    double y = (dx * cl - ex * bl) * 0.5 / d;
+    return x * x + y * y;
+}
+
+GeoRawPoint circumcenter(const GeoRawPoint& a, const GeoRawPoint& b, const GeoRawPoint& c)
+{
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double ex = c.x - a.x, ey = c.y - a.y;
+    double bl = dx * dx + dy * dy;
+    double cl = ex * ex + ey * ey;
+    double d = dx * ey - dy * ex;
+    double x = (ey * bl - dy * cl) * 0.5 / d;
+    double y = (dx * cl - ex * bl) * 0.5 / d;
+    return GeoRawPoint(a.x + x, a.y + y);
+}
+
+// Monotonically increases with the real angle, but faster to compute
+inline double pseudoAngle(double dx, double dy) {
+    double p = dx / (fabs(dx) + fabs(dy));
+    return (dy > 0.0 ? 3.0 - p : 1.0 + p) / 4.0;   // [0, 1]
+}
+
+// The edge p->q is visible from r (r on the left)
+inline bool isLeft(const GeoRawPoint& r, const GeoRawPoint& p, const GeoRawPoint& q) {
+    return orient2d(r, p, q) > 0.0;
+}
+
+// Clip a convex polygon by the half plane a*x + b*y <= c
+void clipByHalfPlane(std::vector<GeoRawPoint>& polygon, double a, double b, double c)
+{
+    std::vector<GeoRawPoint> result;
+    int count = polygon.size();
+    result.reserve(count + 1);
+    for (int i = 0; i < count; ++i) {
+        const GeoRawPoint& cur = polygon[i];
+        const GeoRawPoint& next = polygon[(i + 1) % count];
+        double dCur = a * cur.x + b * cur.y - c;
+        double dNext = a * next.x + b * next.y - c;
+        if (dCur <= 0.0)
+            result.push_back(cur);
+        if ((dCur < 0.0 && dNext > 0.0) || (dCur > 0.0 && dNext < 0.0)) {
+            double t = dCur / (dCur - dNext);
+            result.emplace_back(cur.x + t * (next.x - cur.x), cur.y + t * (next.y - cur.y));
+        }
+    }
+    polygon.swap(result);
+}
+
+} // anonymous namespace
+
+
+Delaunay::Delaunay(const std::vector<GeoRawPoint>& pointsIn)
+{
+    int n = pointsIn.size();
+    if (n < 3)
+        return;
+
+    // Bounding box
+    GeoExtent extent(pointsIn[0]);
+    for (int i = 1; i < n; ++i)
+        extent.merge(pointsIn[i].x, pointsIn[i].y);
+    GeoRawPoint boxCenter = extent.center();
+
+    // Seed triangle
+    // i0: the point closest to the center
+    // i1: the point closest to i0
+    // i2: the point forming the smallest circumcircle with i0 and i1
+    int i0 = 0, i1 = -1, i2 = -1;
+    double minDist = kMaxDouble;
+    for (int i = 0; i < n; ++i) {
+        double d = distSquare(boxCenter, pointsIn[i]);
+        if (d < minDist) {
+            i0 = i;
+            minDist = d;
+        }
+    }
+
+    minDist = kMaxDouble;
+    for (int i = 0; i < n; ++i) {
+        if (i == i0)
+            continue;
+        double d = distSquare(pointsIn[i0], pointsIn[i]);
+        if (d < minDist && d > 0.0) {
+            i1 = i;
+            minDist = d;
+        }
+    }
+    if (i1 == -1)
+        return;
+
+    double minRadius = kMaxDouble;
+    for (int i = 0; i < n; ++i) {
+        if (i == i0 || i == i1)
+            continue;
+        double r = circumradiusSquare(pointsIn[i0], pointsIn[i1], pointsIn[i]);
+        if (r < minRadius) {
+            i2 = i;
+            minRadius = r;
+        }
+    }
+    if (i2 == -1 || minRadius == kMaxDouble)
+        return;     // All points are collinear
+
+    // Clockwise seed triangle
+    if (isLeft(pointsIn[i0], pointsIn[i1], pointsIn[i2]))
+        std::swap(i1, i2);
+
+    center = circumcenter(pointsIn[i0], pointsIn[i1], pointsIn[i2]);
+
+    // Sort the points by the distance to the seed circumcenter
+    // The coordinates are copied in this order, so the points touched
+    //   by the sweep are close in memory, far fewer cache misses than
+    //   indexing the input randomly. Indices are mapped back at last.
+    struct DistId {
+        double dist;
+        int id;
+    };
+    std::vector<DistId> order(n);
+    utils::parallelFor(0, n, [&](int i) {
+        order[i].dist = distSquare(pointsIn[i], center);
+        order[i].id = i;
+    }, 4096);
+    std::sort(order.begin(), order.end(), [](const DistId& a, const DistId& b) {
+        return a.dist < b.dist || (a.dist == b.dist && a.id < b.id);
+    });
+
+    ids.resize(n);
+    points.resize(n);
+    int s0 = -1, s1 = -1, s2 = -1;
+    for (int k = 0; k < n; ++k) {
+        int id = order[k].id;
+        ids[k] = id;
+        points[k] = pointsIn[id];
+        if (id == i0) s0 = k;
+        else if (id == i1) s1 = k;
+        else if (id == i2) s2 = k;
+    }
+    std::vector<DistId>().swap(order);
+
+    // Initial hull
+    hashSize = int(ceil(sqrt(double(n))));
+    hullHash.assign(hashSize, -1);
+    hullPrev.assign(n, -1);
+    hullNext.assign(n, -1);
+    hullTri.assign(n, -1);
+
+    hullStart = s0;
+    hullNext[s0] = hullPrev[s2] = s1;
+    hullNext[s1] = hullPrev[s0] = s2;
+    hullNext[s2] = hullPrev[s1] = s0;
+    hullTri[s0] = 0;
+    hullTri[s1] = 1;
+    hullTri[s2] = 2;
+    hullHash[hashKey(points[s0].x, points[s0].y)] = s0;
+    hullHash[hashKey(points[s1].x, points[s1].y)] = s1;
+    hullHash[hashKey(points[s2].x, points[s2].y)] = s2;
+
+    int maxTriangles = 2 * n - 5;
+    triangles.reserve(maxTriangles * 3);
+    halfedges.reserve(maxTriangles * 3);
+    addTriangle(s0, s1, s2, -1, -1, -1);
+
+    for (int i = 0; i < n; ++i) {
+        const GeoRawPoint& pt = points[i];
+
+        // Skip duplicated points
+        if (i > 0 && points[i - 1].x == pt.x && points[i - 1].y == pt.y)
+            continue;
+
+        // Skip seed triangle points
+        if (i == s0 || i == s1 || i == s2)
+            continue;
+
+        // Find a visible edge on the convex hull using the hash
+        int start = 0;
+        int key = hashKey(pt.x, pt.y);
+        for (int j = 0; j < hashSize; ++j) {
+            start = hullHash[(key + j) % hashSize];
+            if (start != -1 && start != hullNext[start])
+                break;
+        }
+        start = hullPrev[start];
+
+        int e = start;
+        int q;
+        while (q = hullNext[e], !isLeft(pt, points[e], points[q])) {
+            e = q;
+            if (e == start) {
+                e = -1;
+                break;
+            }
+        }
+        // Likely a point on the hull, or a near-duplicate
+        if (e == -1)
+            continue;
+
+        // Add the first triangle from the point
+        int t = addTriangle(e, i, hullNext[e], -1, -1, hullTri[e]);
+
+        // Recursively flip triangles from the point until they satisfy
+        //   the Delaunay condition
+        hullTri[i] = legalize(t + 2);
+        hullTri[e] = t;     // keep track of boundary triangles on the hull
+
+        // Walk forward through the hull, adding more triangles and flipping recursively
+        int next = hullNext[e];
+        while (q = hullNext[next], isLeft(pt, points[next], points[q])) {
+            t = addTriangle(next, i, q, hullTri[i], -1, hullTri[next]);
+            hullTri[i] = legalize(t + 2);
+            hullNext[next] = next;  // mark as removed
+            next = q;
+        }
+
+        // Walk backward from the other side, adding more triangles and flipping
+        if (e == start) {
+            while (q = hullPrev[e], isLeft(pt, points[q], points[e])) {
+                t = addTriangle(q, i, e, -1, hullTri[e], hullTri[q]);
+                legalize(t + 2);
+                hullTri[q] = t;
+                hullNext[e] = e;    // mark as removed
+                e = q;
+            }
+        }
+
+        // Update the hull indices
+        hullStart = hullPrev[i] = e;
+        hullNext[e] = hullPrev[next] = i;
+        hullNext[i] = next;
+
+        // Save the two new edges in the hash table
+        hullHash[hashKey(pt.x, pt.y)] = i;
+        hullHash[hashKey(points[e].x, points[e].y)] = e;
+    }
+
+    // Map back to the input indices
+    int halfedgesCount = triangles.size();
+    utils::parallelFor(0, halfedgesCount, [this](int e) {
+        triangles[e] = ids[triangles[e]];
+    }, 4096);
+
+    // Release the construction buffers
+    std::vector<GeoRawPoint>().swap(points);
+    std::vector<int>().swap(hullPrev);
+    std::vector<int>().swap(hullHash);
+    std::vector<int>().swap(hullTri);
+    std::vector<int>().swap(edgeStack);
+    triangles.shrink_to_fit();
+    halfedges.shrink_to_fit();
+}
+
+std::vector<int> Delaunay::getHull() const
+{
+    std::vector<int> hull;
+    if (!isValid())
+        return hull;
+    int e = hullStart;
+    do {
+        hull.push_back(ids[e]);
+        e = hullNext[e];
+    } while (e != hullStart);
+    return hull;
+}
+
+int Delaunay::hashKey(double x, double y) const
+{
+    double angle = pseudoAngle(x - center.x, y - center.y);
+    int key = int(floor(angle * hashSize));
+    return ((key % hashSize) + hashSize) % hashSize;
+}
+
+int Delaunay::addTriangle(int i0, int i1, int i2, int a, int b, int c)
+{
+    int t = triangles.size();
+    triangles.push_back(i0);
+    triangles.push_back(i1);
+    triangles.push_back(i2);
+    link(t, a);
+    link(t + 1, b);
+    link(t + 2, c);
+    return t;
+}
+
+void Delaunay::link(int a, int b)
+{
+    int size = halfedges.size();
+    if (a == size)
+        halfedges.push_back(b);
+    else
+        halfedges[a] = b;
+
+    if (b != -1) {
+        size = halfedges.size();
+        if (b == size)
+            halfedges.push_back(a);
+        else
+            halfedges[b] = a;
+    }
+}
+
+/* Flip the edges until all triangles around satisfy the Delaunay condition
+** Use a stack instead of recursion
+**
+**           pl                    pl
+**          /||\                  /  \
+**       al/ || \bl            al/    \a
+**        /  ||  \              /      \
+**       /  a||b  \    flip    /___ar___\
+**     p0\   ||   /p1   =>   p0\---bl---/p1
+**        \  ||  /              \      /
+**       ar\ || /br             b\    /br
+**          \||/                  \  /
+**           pr                    pr
+*/
+int Delaunay::legalize(int a)
+{
+    int i = 0;
+    int ar = 0;
+    edgeStack.clear();
+
+    for (;;) {
+        int b = halfedges[a];
+        int a0 = a - a % 3;
+        ar = a0 + (a + 2) % 3;
+
+        if (b == -1) {  // convex hull edge
+            if (i == 0)
+                break;
+            a = edgeStack[--i];
+            continue;
+        }
+
+        int b0 = b - b % 3;
+        int al = a0 + (a + 1) % 3;
+        int bl = b0 + (b + 2) % 3;
+
+        int p0 = triangles[ar];
+        int pr = triangles[a];
+        int pl = triangles[al];
+        int p1 = triangles[bl];
+
+        // Clockwise triangles: inside the circumcircle if incircle < 0
+        bool illegal = incircle(points[p0], points[pr], points[pl], points[p1]) < 0.0;
+
+        if (illegal) {
+            triangles[a] = p1;
+            triangles[b] = p0;
+
+            int hbl = halfedges[bl];
+
+            // The edge swapped on the other side of the hull (rare)
+            // Fix the half-edge reference
+            if (hbl == -1) {
+                int e = hullStart;
+                do {
+                    if (hullTri[e] == bl) {
+                        hullTri[e] = a;
+                        break;
+                    }
+                    e = hullPrev[e];
+                } while (e != hullStart);
+            }
+            link(a, hbl);
+            link(b, halfedges[ar]);
+            link(ar, bl);
+
+            int br = b0 + (b + 1) % 3;
+            if (i < int(edgeStack.size()))
+                edgeStack[i] = br;
+            else
+                edgeStack.push_back(br);
+            ++i;
+        }
+        else {
+            if (i == 0)
+                break;
+            a = edgeStack[--i];
+        }
+    }
+
+    return ar;
+}
+
+
+/*****************************************/
+/*                                       */
+/*    Voronoi                            */
+/*                                       */
+/*****************************************/
+
+bool voronoiCells(const std::vector<GeoRawPoint>& pointsIn, const GeoExtent& clipExtent,
+                  std::vector<std::vector<GeoRawPoint>>& cellsOut)
+{
+    int n = pointsIn.size();
+    cellsOut.assign(n, std::vector<GeoRawPoint>());
+    if (n == 0)
+        return false;
+
+    // Four far away ghost points make the cells of all real points
+    //   bounded. Their bisectors are far outside the clip extent, so the
+    //   clipped cells are not changed.
+    GeoExtent extent(pointsIn[0]);
+    for (auto& pt : pointsIn)
+        extent.merge(pt.x, pt.y);
+    extent.merge(clipExtent);
+    double size = std::max(extent.width(), extent.height());
+    if (size == 0.0)
+        size = 1.0;
+    double far = size * 100.0;
+    GeoRawPoint mid = extent.center();
+
+    std::vector<GeoRawPoint> points;
+    points.reserve(n + 4);
+    points = pointsIn;
+    points.emplace_back(mid.x - far, mid.y - far);
+    points.emplace_back(mid.x + far, mid.y - far);
+    points.emplace_back(mid.x + far, mid.y + far);
+    points.emplace_back(mid.x - far, mid.y + far);
+
+    Delaunay delaunay(points);
+    if (!delaunay.isValid())
+        return false;
+
+    const std::vector<int>& triangles = delaunay.getTriangles();
+    const std::vector<int>& halfedges = delaunay.getHalfedges();
+    int trianglesCount = delaunay.getNumTriangles();
+    int halfedgesCount = triangles.size();
+
+    // Circumcenters of all triangles (Voronoi vertices)
+    std::vector<GeoRawPoint> centers(trianglesCount);
+    utils::parallelFor(0, trianglesCount, [&](int t) {
+        centers[t] = circumcenter(points[triangles[3 * t]], points[triangles[3 * t + 1]], points[triangles[3 * t + 2]]);
+    }, 4096);
+
+    // One incoming half-edge for each point
+    std::vector<int> inedges(points.size(), -1);
+    for (int e = 0; e < halfedgesCount; ++e) {
+        inedges[triangles[Delaunay::nextHalfedge(e)]] = e;
+    }
+
+    // Walk around each point, the centers of the triangles around it
+    //   form the cell. Triangles are clockwise, so the walk gives a
+    //   counterclockwise cell.
+    utils::parallelFor(0, n, [&](int i) {
+        int e0 = inedges[i];
+        if (e0 == -1)
+            return;     // duplicated point
+        std::vector<GeoRawPoint>& cell = cellsOut[i];
+        int e = e0;
+        do {
+            cell.push_back(centers[e / 3]);
+            e = halfedges[Delaunay::nextHalfedge(e)];
+        } while (e != e0 && e != -1);
+
+        if (orient2d(cell[0], cell[1 % cell.size()], cell[2 % cell.size()]) < 0.0)
+            std::reverse(cell.begin(), cell.end());
+
+        clipByHalfPlane(cell, -1.0, 0.0, -clipExtent.minX);
+        clipByHalfPlane(cell, 1.0, 0.0, clipExtent.maxX);
+        clipByHalfPlane(cell, 0.0, -1.0, -clipExtent.minY);
+        clipByHalfPlane(cell, 0.0, 1.0, clipExtent.maxY);
+        if (cell.size() < 3)
+            cell.clear();
+    }, 1024);
+
+    return true;
+}
+
+} // namespace gm
@@ -0,0 +1,89 @@
+/*******************************************************
+** class name:  Delaunay
+**
+** description: 2D Delaunay triangulation (sweep-hull),
+**                Voronoi diagram derived from it
+**
+**              The points are inserted by increasing distance
+**                to a seed triangle, each new point is
+**                connected to the visible edges of the current
+**                convex hull, then the edges are legalized by
+**                flipping. Robust predicates (geo_predicates.h)
+**                are used for all decisions.
+**
+**              ref: D. A. Sinclair, "S-hull: a fast radial
+**                sweep-hull routine for Delaunay triangulation"
+**                V. Agafonkin, "Delaunator"
+**
+** last change: 2020-04-05
+*******************************************************/
+#pragma once
+
+#include "geo/geo_base.hpp"
+
+#include <vector>
+
+
+namespace gm {
+
+class Delaunay {
+public:
+    explicit Delaunay(const std::vector<GeoRawPoint>& points);
+
+    // False if there are less than 3 distinct points or all collinear
+    bool isValid() const { return !triangles.empty(); }
+
+    int getNumTriangles() const { return triangles.size() / 3; }
+
+    /* Point indices of the triangles, 3 per triangle, clockwise */
+    const std::vector<int>& getTriangles() const { return triangles; }
+
+    /* Half-edge e goes from triangles[e] to triangles[nextHalfedge(e)]
+    ** halfedges[e] is the opposite half-edge in the adjacent triangle,
+    **   -1 on the convex hull */
+    const std::vector<int>& getHalfedges() const { return halfedges; }
+
+    /* Point indices of the convex hull */
+    std::vector<int> getHull() const;
+
+    static int nextHalfedge(int e) { return (e % 3 == 2) ? e - 2 : e + 1; }
+    static int prevHalfedge(int e) { return (e % 3 == 0) ? e + 2 : e - 1; }
+
+private:
+    int addTriangle(int i0, int i1, int i2, int a, int b, int c);
+    void link(int a, int b);
+    int legalize(int a);
+    int hashKey(double x, double y) const;
+
+private:
+    // Coordinates sorted by the sweep order, ids[k] is the input
+    //   index of points[k]
+    std::vector<GeoRawPoint> points;
+    std::vector<int> ids;
+
+    std::vector<int> triangles;
+    std::vector<int> halfedges;
+
+    // Convex hull as a doubly linked list
+    std::vector<int> hullPrev;
+    std::vector<int> hullNext;
+    std::vector<int> hullTri;
+    int hullStart = -1;
+
+    // Angular hash of the hull, to find a visible edge quickly
+    std::vector<int> hullHash;
+    int hashSize = 0;
+    GeoRawPoint center;
+
+    std::vector<int> edgeStack;
+};
+
+
+/* Voronoi cells of the points, clipped to the extent
+** cellsOut[i] is the cell of points[i] (counterclockwise, not closed),
+**   empty for duplicated points
+** The cells are built in parallel */
+bool voronoiCells(const std::vector<GeoRawPoint>& points, const GeoExtent& clipExtent,
+                  std::vector<std::vector<GeoRawPoint>>& cellsOut);
+
+} // namespace gm
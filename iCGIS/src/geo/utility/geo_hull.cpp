@@ -0,0 +1,265 @@
+#include "geo/utility/geo_hull.h"
+#include "geo/utility/geo_predicates.h"
+#include "util/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace gm {
+
+namespace {
+
+// Sort and remove duplicated points
+void sortUnique(GeoRawPoint* first, GeoRawPoint* last, std::vector<GeoRawPoint>& out)
+{
+    std::sort(first, last, [](const GeoRawPoint& a, const GeoRawPoint& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    out.clear();
+    for (GeoRawPoint* p = first; p != last; ++p) {
+        if (out.empty() || out.back().x != p->x || out.back().y != p->y)
+            out.push_back(*p);
+    }
+}
+
+// Andrew's monotone chain
+//   points are sorted by (x, y) and unique
+void monotoneChain(const std::vector<GeoRawPoint>& points, std::vector<GeoRawPoint>& hull)
+{
+    int n = points.size();
+    hull.clear();
+    if (n < 3) {
+        hull = points;
+        return;
+    }
+
+    hull.resize(2 * n);
+    int k = 0;
+
+    // Lower hull
+    for (int i = 0; i < n; ++i) {
+        while (k >= 2 && orientation(hull[k - 2], hull[k - 1], points[i]) <= 0)
+            --k;
+        hull[k++] = points[i];
+    }
+
+    // Upper hull
+    for (int i = n - 2, t = k + 1; i >= 0; --i) {
+        while (k >= t && orientation(hull[k - 2], hull[k - 1], points[i]) <= 0)
+            --k;
+        hull[k++] = points[i];
+    }
+
+    // The last point is the same as the first one
+    hull.resize(k - 1);
+}
+
+inline double dot(double x1, double y1, double x2, double y2) {
+    return x1 * x2 + y1 * y2;
+}
+
+inline double distance(const GeoRawPoint& a, const GeoRawPoint& b) {
+    return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+inline bool isInCircle(const GeoRawPoint& pt, const GeoRawPoint& center, double radius) {
+    // Relative tolerance, to absorb the rounding error of the circle
+    return distance(pt, center) <= radius * (1 + 1e-12) + 1e-300;
+}
+
+// Circle through three points, fall back to the circle on the longest
+//   side if they are collinear
+void circumCircle(const GeoRawPoint& a, const GeoRawPoint& b, const GeoRawPoint& c,
+                  GeoRawPoint& center, double& radius)
+{
+    double bx = b.x - a.x, by = b.y - a.y;
+    double cx = c.x - a.x, cy = c.y - a.y;
+    double d = 2 * (bx * cy - by * cx);
+    if (orientation(a, b, c) == 0 || d == 0.0) {
+        double ab = distance(a, b), bc = distance(b, c), ca = distance(c, a);
+        const GeoRawPoint* p1 = &a;
+        const GeoRawPoint* p2 = &b;
+        if (bc >= ab && bc >= ca) { p1 = &b; p2 = &c; }
+        else if (ca >= ab && ca >= bc) { p1 = &c; p2 = &a; }
+        center = GeoRawPoint((p1->x + p2->x) / 2, (p1->y + p2->y) / 2);
+        radius = distance(*p1, *p2) / 2;
+        return;
+    }
+    double b2 = bx * bx + by * by;
+    double c2 = cx * cx + cy * cy;
+    double ux = (cy * b2 - by * c2) / d;
+    double uy = (bx * c2 - cx * b2) / d;
+    center = GeoRawPoint(a.x + ux, a.y + uy);
+    radius = sqrt(ux * ux + uy * uy);
+}
+
+} // anonymous namespace
+
+
+void collectPoints(GeoGeometry* geom, std::vector<GeoRawPoint>& pointsOut)
+{
+    if (!geom)
+        return;
+
+    switch (geom->getGeometryType()) {
+    default:
+        break;
+    case kPoint:
+        pointsOut.push_back(geom->toPoint()->getXY());
+        break;
+    case kLineString:
+    case kLinearRing: {
+        GeoLineString* line = geom->toLineString();
+        pointsOut.insert(pointsOut.end(), line->begin(), line->end());
+        break;
+    }
+    case kPolygon: {
+        // The holes never contribute to the hull
+        GeoPolygon* polygon = geom->toPolygon();
+        if (!polygon->isEmpty())
+            collectPoints(polygon->getExteriorRing(), pointsOut);
+        break;
+    }
+    case kMultiPoint:
+    case kMultiLineString:
+    case kMultiPolygon: {
+        GeoGeometryCollection* collection = utils::down_cast<GeoGeometryCollection*>(geom);
+        int geomsCount = collection->getNumGeometries();
+        for (int i = 0; i < geomsCount; ++i)
+            collectPoints(collection->getGeometry(i), pointsOut);
+        break;
+    }
+    }
+}
+
+void convexHull(std::vector<GeoRawPoint>& points, std::vector<GeoRawPoint>& hullOut)
+{
+    const int chunkSize = 1 << 16;
+    int pointsCount = points.size();
+    std::vector<GeoRawPoint> sorted;
+
+    if (pointsCount <= 2 * chunkSize) {
+        sortUnique(points.data(), points.data() + pointsCount, sorted);
+        monotoneChain(sorted, hullOut);
+        return;
+    }
+
+    // Hull of each chunk in parallel
+    // The hull of all points is the hull of the chunks' hull
+    int chunksCount = (pointsCount + chunkSize - 1) / chunkSize;
+    std::vector<std::vector<GeoRawPoint>> chunkHulls(chunksCount);
+    utils::parallelFor(0, chunksCount, [&](int iChunk) {
+        int first = iChunk * chunkSize;
+        int last = std::min(first + chunkSize, pointsCount);
+        std::vector<GeoRawPoint> chunkSorted;
+        sortUnique(points.data() + first, points.data() + last, chunkSorted);
+        monotoneChain(chunkSorted, chunkHulls[iChunk]);
+    }, 1);
+
+    std::vector<GeoRawPoint> candidates;
+    for (auto& chunkHull : chunkHulls)
+        candidates.insert(candidates.end(), chunkHull.begin(), chunkHull.end());
+    sortUnique(candidates.data(), candidates.data() + candidates.size(), sorted);
+    monotoneChain(sorted, hullOut);
+}
+
+bool minAreaRect(const std::vector<GeoRawPoint>& hull, GeoRawPoint cornersOut[4])
+{
+    int n = hull.size();
+    if (n == 0)
+        return false;
+    if (n < 3) {
+        cornersOut[0] = cornersOut[3] = hull[0];
+        cornersOut[1] = cornersOut[2] = hull[n - 1];
+        return true;
+    }
+
+    double minArea = -1.0;
+    int right = 0, top = 0, left = 0;
+
+    // For each edge of the hull, the rectangle has one side on the edge
+    // The extreme points (right, top, left) only move forward while the
+    //   edge rotates, so all edges are checked in O(n)
+    for (int i = 0; i < n; ++i) {
+        const GeoRawPoint& origin = hull[i];
+        const GeoRawPoint& next = hull[(i + 1) % n];
+        double len = distance(origin, next);
+        if (len == 0.0)
+            continue;
+        double ux = (next.x - origin.x) / len;
+        double uy = (next.y - origin.y) / len;
+        // Normal pointing to the interior (left side)
+        double nx = -uy, ny = ux;
+
+        auto projU = [&](int idx) { return dot(hull[idx].x - origin.x, hull[idx].y - origin.y, ux, uy); };
+        auto projN = [&](int idx) { return dot(hull[idx].x - origin.x, hull[idx].y - origin.y, nx, ny); };
+
+        if (minArea < 0.0) {
+            right = top = left = i;
+        }
+        for (int step = 0; step < n && projU((right + 1) % n) >= projU(right); ++step)
+            right = (right + 1) % n;
+        if (minArea < 0.0)
+            top = right;
+        for (int step = 0; step < n && projN((top + 1) % n) >= projN(top); ++step)
+            top = (top + 1) % n;
+        if (minArea < 0.0)
+            left = top;
+        for (int step = 0; step < n && projU((left + 1) % n) <= projU(left); ++step)
+            left = (left + 1) % n;
+
+        double maxU = projU(right);
+        double minU = projU(left);
+        double height = projN(top);
+        double area = (maxU - minU) * height;
+
+        if (minArea < 0.0 || area < minArea) {
+            minArea = area;
+            cornersOut[0] = GeoRawPoint(origin.x + ux * minU, origin.y + uy * minU);
+            cornersOut[1] = GeoRawPoint(origin.x + ux * maxU, origin.y + uy * maxU);
+            cornersOut[2] = GeoRawPoint(cornersOut[1].x + nx * height, cornersOut[1].y + ny * height);
+            cornersOut[3] = GeoRawPoint(cornersOut[0].x + nx * height, cornersOut[0].y + ny * height);
+        }
+    }
+
+    return minArea >= 0.0;
+}
+
+bool minEnclosingCircle(const std::vector<GeoRawPoint>& pointsIn, GeoRawPoint& centerOut, double& radiusOut)
+{
+    if (pointsIn.empty())
+        return false;
+
+    // Randomized incremental (Welzl), expected O(n)
+    // A fixed seed keeps the result reproducible
+    std::vector<GeoRawPoint> points = pointsIn;
+    std::mt19937 rng(20200404);
+    std::shuffle(points.begin(), points.end(), rng);
+
+    int n = points.size();
+    GeoRawPoint center = points[0];
+    double radius = 0.0;
+    for (int i = 1; i < n; ++i) {
+        if (isInCircle(points[i], center, radius))
+            continue;
+        center = points[i];
+        radius = 0.0;
+        for (int j = 0; j < i; ++j) {
+            if (isInCircle(points[j], center, radius))
+                continue;
+            center = GeoRawPoint((points[i].x + points[j].x) / 2, (points[i].y + points[j].y) / 2);
+            radius = distance(points[i], points[j]) / 2;
+            for (int k = 0; k < j; ++k) {
+                if (!isInCircle(points[k], center, radius))
+                    circumCircle(points[i], points[j], points[k], center, radius);
+            }
+        }
+    }
+
+    centerOut = center;
+    radiusOut = radius;
+    return true;
+}
+
+} // namespace gm
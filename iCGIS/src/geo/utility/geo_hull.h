@@ -0,0 +1,40 @@
+/*******************************************************
+** description: Minimum bounding geometries
+**                convex hull (Andrew's monotone chain)
+**                minimum-area oriented bounding rectangle
+**                  (rotating calipers)
+**                minimum enclosing circle (Welzl)
+**
+** last change: 2020-04-04
+*******************************************************/
+#pragma once
+
+#include "geo/geometry/geogeometry.h"
+#include "geo/geo_base.hpp"
+
+#include <vector>
+
+
+namespace gm {
+
+/* Append all vertices of the geometry to pointsOut */
+void collectPoints(GeoGeometry* geom, std::vector<GeoRawPoint>& pointsOut);
+
+/* Convex hull
+** The vertices are returned in counterclockwise order without the
+**   repeated closing point, collinear points are removed.
+** Large inputs are split into chunks whose hulls are computed in
+**   parallel, then merged.
+** The input points are reordered */
+void convexHull(std::vector<GeoRawPoint>& points, std::vector<GeoRawPoint>& hullOut);
+
+/* Oriented rectangle of minimum area enclosing the convex hull
+** Four corners in counterclockwise order
+** Return false if the hull is empty */
+bool minAreaRect(const std::vector<GeoRawPoint>& hull, GeoRawPoint cornersOut[4]);
+
+/* Smallest circle enclosing all points
+** Return false if there are no points */
+bool minEnclosingCircle(const std::vector<GeoRawPoint>& points, GeoRawPoint& centerOut, double& radiusOut);
+
+} // namespace gm
@@ -1,4 +1,6 @@
 #include "geo/utility/geo_math.h"
+#include "geo/utility/geo_predicates.h"
+
 #include <cmath>
 
 namespace gm {
@@ -49,16 +51,9 @@ bool isPointEqPoint(const GeoRawPoint& ptA, const GeoRawPoint& ptB, double preci
 }
 
 // Point & Line
-bool isPointOnLine(const GeoRawPoint& pt, const GeoRawPoint& lineStartPt, const GeoRawPoint& lineEndPt, double precision /*= 0.001*/)
+bool isPointOnLine(const GeoRawPoint& pt, const GeoRawPoint& lineStartPt, const GeoRawPoint& lineEndPt)
 {
-    if (fabs(cross(pt, lineStartPt, pt, lineEndPt)) < precision) {
-        if ((lineStartPt.x < pt.x && lineEndPt.x > pt.x) || (lineEndPt.x < pt.x && lineStartPt.x > pt.x)) {
-            if ((lineStartPt.y < pt.y && lineEndPt.y > pt.y) || (lineEndPt.y < pt.y && lineStartPt.y > pt.y)) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return isPointOnSegment(pt, lineStartPt, lineEndPt);
 }
 
 // Point & Line
@@ -70,7 +65,7 @@ bool isPointOnLineString(const GeoRawPoint& pt, double halfEdge, GeoLineString*
 }
 
 // Point & LineString
-bool isPointOnLineString(const GeoRawPoint& pt, GeoLineString* line, double precision /*= 0.001*/)
+bool isPointOnLineString(const GeoRawPoint& pt, GeoLineString* line)
 {
     int pointCount = line->getNumPoints();
     for (int i = 0; i < pointCount - 1; ++i) {
@@ -82,42 +77,36 @@ bool isPointOnLineString(const GeoRawPoint& pt, GeoLineString* line, double prec
 }
 
 // Point & LinearRing
-bool isPointInLinearRing(const GeoRawPoint& pt, GeoLinearRing* pRing, double precision)
+//   1: inside, 0: on the boundary, -1: outside
+static int locatePointInLinearRing(const GeoRawPoint& pt, const GeoLinearRing& ring)
 {
-    const GeoLinearRing& ring = *pRing;
     int pointsCount = ring.getNumPoints();
-    double maxX = ring[0].x;
-    for (int i = 1; i < pointsCount; ++i) {
-        if (ring[i].x > maxX)
-            maxX = ring[i].x;
-    }
-    const GeoRawPoint& ptLeft = pt;
-    GeoRawPoint ptRight(maxX + 10, pt.y);   // 10 is just a postive number
+    if (pointsCount == 0)
+        return -1;
 
-    // number of intersections
-    bool flag = false;
+    // Crossing number, a horizontal ray to the right of the point
+    // Each edge is half-open in y, so a vertex on the ray is counted once
+    bool inside = false;
     for (int i = 0, j = pointsCount - 1; i < pointsCount; j = i++) {
-        if (isPointOnLine(pt, ring[i], ring[j]))
-            return true;
-        if (dcmp(ring[i].y, ring[j].y) == 0)
-            continue;
-        if (isLineIntersect(ptLeft, ptRight, ring[i], ring[j])) {
-            if (isPointOnLine(ring[i], ptLeft, ptRight)) {
-                if (ring[j].y > pt.y) {
-                    flag = !flag;
-                }
-            }
-            else if (isPointOnLine(ring[j], ptLeft, ptRight)) {
-                if (ring[i].y > pt.y) {
-                    flag = !flag;
-                }
-            }
-            else {
-                flag = !flag;
-            }
+        const GeoRawPoint& ptA = ring[j];
+        const GeoRawPoint& ptB = ring[i];
+        if (isPointOnSegment(pt, ptA, ptB))
+            return 0;
+        if ((ptA.y > pt.y) != (ptB.y > pt.y)) {
+            // The crossing is on the right if the point is on the left
+            //   of an upward edge, or on the right of a downward edge
+            int side = orientation(ptA, ptB, pt);
+            if (ptB.y > ptA.y ? side > 0 : side < 0)
+                inside = !inside;
         }
     }
-    return flag;
+    return inside ? 1 : -1;
+}
+
+// Point & LinearRing
+bool isPointInLinearRing(const GeoRawPoint& pt, GeoLinearRing* pRing)
+{
+    return locatePointInLinearRing(pt, *pRing) >= 0;
 }
 
 /* Point & Rectangle */
@@ -127,40 +116,33 @@ bool isPointInRect(const GeoRawPoint& point, const Rect& rect) {
 }
 
 /* Point & Polygon */
-bool isPointInPolygon(const GeoRawPoint& pt, GeoPolygon* pPolygon, double precision /*= 0.001*/)
+bool isPointInPolygon(const GeoRawPoint& pt, GeoPolygon* pPolygon)
 {
     const GeoPolygon& polygon = *pPolygon;
-    /* Judge if the point is in the interior ring */
-    int interiorRingsCount = polygon.getInteriorRingsCount();
-    GeoLinearRing* interiorRing;
-    for (int i = 0; i < interiorRingsCount; ++i) {
-        interiorRing = polygon.getInteriorRing(i);
-        if (isPointInLinearRing(pt, interiorRing)) {
-            return false;
-        }
-    }
 
     /* Judge if the point is int the exterior ring */
     GeoLinearRing* exteriorRing = polygon.getExteriorRing();
-    if (exteriorRing) {
-        if (isPointInLinearRing(pt, exteriorRing)) {
-            return true;
+    if (!exteriorRing || locatePointInLinearRing(pt, *exteriorRing) < 0) {
+        return false;
+    }
+
+    /* Judge if the point is in the interior ring
+    ** The boundary of the holes belongs to the polygon */
+    int interiorRingsCount = polygon.getInteriorRingsCount();
+    for (int i = 0; i < interiorRingsCount; ++i) {
+        if (locatePointInLinearRing(pt, *polygon.getInteriorRing(i)) > 0) {
+            return false;
         }
     }
 
-    return false;
+    return true;
 }
 
 
 // Line & Line
-bool isLineIntersect(const GeoRawPoint& line1Start, const GeoRawPoint& line1End, const GeoRawPoint& line2Start, const GeoRawPoint& line2End, double precision)
+bool isLineIntersect(const GeoRawPoint& line1Start, const GeoRawPoint& line1End, const GeoRawPoint& line2Start, const GeoRawPoint& line2End)
 {
-    double result1 = cross(line2Start, line1Start, line2Start, line2End) * cross(line2Start, line1End, line2Start, line2End);
-    double result2 = cross(line1Start, line2Start, line1Start, line1End) * cross(line1Start, line2End, line1Start, line1End);
-    if (result1 <= 0 && result2 <= 0)
-        return true;
-    else
-        return false;
+    return isSegmentIntersect(line1Start, line1End, line2Start, line2End);
 }
 
 
@@ -225,6 +207,11 @@ bool isPolygonRectIntersect(GeoPolygon* pPolygon, const Rect& rect)
         }
     }
 
+    // The rectangle lies inside the polygon
+    if (isPointInPolygon(rect.center(), pPolygon)) {
+        return true;
+    }
+
     return false;
 }
 
@@ -1,7 +1,7 @@
 /*******************************************************
 ** description: Topolygon analysis
 **
-** last change: 2020-03-25
+** last change: 2020-04-03
 *******************************************************/
 #pragma once
 
@@ -28,23 +28,23 @@ double distancePointToPoint(const GeoRawPoint& ptA, const GeoRawPoint& ptB);
 /* Point & Point */
 bool isPointEqPoint(const GeoRawPoint& ptA, const GeoRawPoint& ptB, double precision = 2);
 
-/* Point & Line */
-bool isPointOnLine(const GeoRawPoint& pt, const GeoRawPoint& lineStartPt, const GeoRawPoint& lineEndPt, double precision = 0.001);
+/* Point & Line (exact, see geo_predicates.h) */
+bool isPointOnLine(const GeoRawPoint& pt, const GeoRawPoint& lineStartPt, const GeoRawPoint& lineEndPt);
 bool isPointOnLineString(const GeoRawPoint& pt, double halfEdge, const GeoRawPoint& lineStartPt, const GeoRawPoint& lineEndPt);
-bool isPointOnLineString(const GeoRawPoint& pt, GeoLineString* lineString, double precision = 0.001);
+bool isPointOnLineString(const GeoRawPoint& pt, GeoLineString* lineString);
 
-/* Point & Linearing */
-bool isPointInLinearRing(const GeoRawPoint& pt, GeoLinearRing* ring, double precision = 0.001);
+/* Point & Linearing (points on the boundary are inside) */
+bool isPointInLinearRing(const GeoRawPoint& pt, GeoLinearRing* ring);
 
 /* Point & Rectangle */
 bool isPointInRect(const GeoRawPoint& point, const Rect& rect);
 
 /* Point & Polygon */
-bool isPointInPolygon(const GeoRawPoint& pt, GeoPolygon* polygon, double precision = 0.001);
+bool isPointInPolygon(const GeoRawPoint& pt, GeoPolygon* polygon);
 
-/* Line & Line */
+/* Line & Line (exact, touching segments intersect) */
 bool isLineIntersect(const GeoRawPoint& line1Start, const GeoRawPoint& line1End, 
-	const GeoRawPoint& line2Start, const GeoRawPoint& line2End, double precision = 1e-6);
+	const GeoRawPoint& line2Start, const GeoRawPoint& line2End);
 
 /* Rectangle & Rectangle */
 bool isRectIntersect(const Rect& rect1, const Rect& rect2);
@@ -52,7 +52,7 @@ bool isRectIntersect(const Rect& rect1, const Rect& rect2);
 /* LineString & Rectangle */
 bool isLineStringRectIntersect(GeoLineString* lineString, const Rect& rect);
 
-/* Polygon & Polygon */
+/* Polygon & Rectangle */
 bool isPolygonRectIntersect(GeoPolygon* polygon, const Rect& rect);
 
 
@@ -0,0 +1,568 @@
+#include "geo/utility/geo_measure.h"
+#include "geo/utility/geo_math.h"
+#include "geo/map/geolayer.h"
+#include "util/parallel.h"
+
+#include <cmath>
+#include <limits>
+
+namespace gm {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+
+// Area on the sphere of a ring (signed, counterclockwise positive)
+//   ref: Chamberlain & Duquette, "Some Algorithms for Polygons on a Sphere"
+double geodesicSignedArea(const GeoLineString* ring)
+{
+    int pointsCount = ring->getNumPoints();
+    if (pointsCount < 3)
+        return 0.0;
+
+    double sum = 0.0;
+    for (int i = 0, j = pointsCount - 1; i < pointsCount; j = i++) {
+        const GeoRawPoint& p1 = (*ring)[j];
+        const GeoRawPoint& p2 = (*ring)[i];
+        double dLon = (p2.x - p1.x) * kDegToRad;
+        // Crossing the antimeridian
+        if (dLon > kPi)
+            dLon -= 2 * kPi;
+        else if (dLon < -kPi)
+            dLon += 2 * kPi;
+        sum += dLon * (2 + sin(p1.y * kDegToRad) + sin(p2.y * kDegToRad));
+    }
+    return sum * kEarthRadius * kEarthRadius / 2.0;
+}
+
+double polygonArea(GeoPolygon* polygon, bool geodesic)
+{
+    if (polygon->isEmpty())
+        return 0.0;
+
+    auto ringArea = [geodesic](GeoLinearRing* ring) {
+        return fabs(geodesic ? geodesicSignedArea(ring) : signedArea(ring));
+    };
+
+    double result = ringArea(polygon->getExteriorRing());
+    int interiorRingsCount = polygon->getInteriorRingsCount();
+    for (int i = 0; i < interiorRingsCount; ++i) {
+        result -= ringArea(polygon->getInteriorRing(i));
+    }
+    return result > 0.0 ? result : 0.0;
+}
+
+double lineStringLength(const GeoLineString* line, bool geodesic)
+{
+    double result = 0.0;
+    int pointsCount = line->getNumPoints();
+    for (int i = 1; i < pointsCount; ++i) {
+        if (geodesic)
+            result += geodesicDistance((*line)[i - 1], (*line)[i]);
+        else
+            result += distancePointToPoint((*line)[i - 1], (*line)[i]);
+    }
+    return result;
+}
+
+// Length of the boundary of a ring (closed implicitly)
+double ringLength(const GeoLineString* ring, bool geodesic)
+{
+    double result = lineStringLength(ring, geodesic);
+    int pointsCount = ring->getNumPoints();
+    if (pointsCount > 2) {
+        const GeoRawPoint& first = (*ring)[0];
+        const GeoRawPoint& last = (*ring)[pointsCount - 1];
+        if (first.x != last.x || first.y != last.y) {
+            if (geodesic)
+                result += geodesicDistance(last, first);
+            else
+                result += distancePointToPoint(last, first);
+        }
+    }
+    return result;
+}
+
+double measureLength(GeoGeometry* geom, bool geodesic)
+{
+    switch (geom->getGeometryType()) {
+    default:
+        return 0.0;
+    case kLineString:
+        return lineStringLength(geom->toLineString(), geodesic);
+    case kLinearRing:
+        return ringLength(geom->toLinearRing(), geodesic);
+    case kPolygon: {
+        GeoPolygon* polygon = geom->toPolygon();
+        if (polygon->isEmpty())
+            return 0.0;
+        double result = ringLength(polygon->getExteriorRing(), geodesic);
+        int interiorRingsCount = polygon->getInteriorRingsCount();
+        for (int i = 0; i < interiorRingsCount; ++i)
+            result += ringLength(polygon->getInteriorRing(i), geodesic);
+        return result;
+    }
+    case kMultiLineString:
+    case kMultiPolygon: {
+        GeoGeometryCollection* collection = utils::down_cast<GeoGeometryCollection*>(geom);
+        double result = 0.0;
+        int geomsCount = collection->getNumGeometries();
+        for (int i = 0; i < geomsCount; ++i)
+            result += measureLength(collection->getGeometry(i), geodesic);
+        return result;
+    }
+    }
+}
+
+/* Accumulators of the centroid
+** Each kind of geometry has its own weight, the one with the highest
+**   dimension wins (e.g. the points of a collection are ignored if
+**   there are any polygons) */
+struct CentroidSum {
+    double areaX = 0.0, areaY = 0.0, area = 0.0;
+    double lineX = 0.0, lineY = 0.0, length = 0.0;
+    double pointX = 0.0, pointY = 0.0;
+    int pointsCount = 0;
+
+    void addPoint(const GeoRawPoint& pt) {
+        pointX += pt.x;
+        pointY += pt.y;
+        ++pointsCount;
+    }
+
+    void addLine(const GeoLineString* line, bool closed) {
+        int count = line->getNumPoints();
+        if (count == 1)
+            addPoint((*line)[0]);
+        for (int i = 1; i <= count; ++i) {
+            if (i == count && !closed)
+                break;
+            const GeoRawPoint& p1 = (*line)[i - 1];
+            const GeoRawPoint& p2 = (*line)[i % count];
+            double len = distancePointToPoint(p1, p2);
+            lineX += len * (p1.x + p2.x) / 2;
+            lineY += len * (p1.y + p2.y) / 2;
+            length += len;
+        }
+    }
+
+    // Signed: holes have the opposite sign of the exterior ring
+    void addRing(const GeoLineString* ring, bool hole) {
+        int count = ring->getNumPoints();
+        if (count < 3)
+            return;
+        // Relative to the first point to reduce the cancellation error
+        const GeoRawPoint& origin = (*ring)[0];
+        double sumA = 0.0, sumX = 0.0, sumY = 0.0;
+        for (int i = 0, j = count - 1; i < count; j = i++) {
+            double x1 = (*ring)[j].x - origin.x, y1 = (*ring)[j].y - origin.y;
+            double x2 = (*ring)[i].x - origin.x, y2 = (*ring)[i].y - origin.y;
+            double f = x1 * y2 - x2 * y1;
+            sumA += f;
+            sumX += (x1 + x2) * f;
+            sumY += (y1 + y2) * f;
+        }
+        if (sumA == 0.0)
+            return;
+        double ringArea = sumA / 2;
+        double cx = sumX / (3 * sumA) + origin.x;
+        double cy = sumY / (3 * sumA) + origin.y;
+        double weight = fabs(ringArea) * (hole ? -1 : 1);
+        areaX += weight * cx;
+        areaY += weight * cy;
+        area += weight;
+    }
+
+    void add(GeoGeometry* geom) {
+        switch (geom->getGeometryType()) {
+        default:
+            break;
+        case kPoint:
+            addPoint(geom->toPoint()->getXY());
+            break;
+        case kLineString:
+            addLine(geom->toLineString(), false);
+            break;
+        case kLinearRing:
+            addRing(geom->toLinearRing(), false);
+            addLine(geom->toLinearRing(), true);
+            break;
+        case kPolygon: {
+            GeoPolygon* polygon = geom->toPolygon();
+            if (polygon->isEmpty())
+                break;
+            addRing(polygon->getExteriorRing(), false);
+            addLine(polygon->getExteriorRing(), true);
+            int interiorRingsCount = polygon->getInteriorRingsCount();
+            for (int i = 0; i < interiorRingsCount; ++i)
+                addRing(polygon->getInteriorRing(i), true);
+            break;
+        }
+        case kMultiPoint:
+        case kMultiLineString:
+        case kMultiPolygon: {
+            GeoGeometryCollection* collection = utils::down_cast<GeoGeometryCollection*>(geom);
+            int geomsCount = collection->getNumGeometries();
+            for (int i = 0; i < geomsCount; ++i)
+                add(collection->getGeometry(i));
+            break;
+        }
+        }
+    }
+};
+
+// Longitude difference in [-180, 180], across the antimeridian
+double normalizeLongitude(double dLon)
+{
+    dLon = fmod(dLon, 360.0);
+    if (dLon > 180.0)
+        dLon -= 360.0;
+    else if (dLon < -180.0)
+        dLon += 360.0;
+    return dLon;
+}
+
+struct Vector3 {
+    double x, y, z;
+};
+
+// Unit vector of a point on the sphere (degrees)
+Vector3 toUnitVector(const GeoRawPoint& p)
+{
+    double lon = p.x * kDegToRad;
+    double lat = p.y * kDegToRad;
+    return { cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat) };
+}
+
+double dot(const Vector3& a, const Vector3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vector3 cross(const Vector3& a, const Vector3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+/* Distance on the sphere between the point and the great circle arc
+**   (the shorter one) from segStart to segEnd, in meters
+** The cross-track distance if the foot of the perpendicular is on
+**   the arc, else the distance to the nearer end */
+double geodesicDistancePointToSegment(const GeoRawPoint& pt, const GeoRawPoint& segStart, const GeoRawPoint& segEnd)
+{
+    double toEnds = std::min(geodesicDistance(pt, segStart), geodesicDistance(pt, segEnd));
+
+    Vector3 a = toUnitVector(segStart);
+    Vector3 b = toUnitVector(segEnd);
+    Vector3 p = toUnitVector(pt);
+    Vector3 n = cross(a, b);
+    double nLength = sqrt(dot(n, n));
+    // Same or antipodal ends: no single arc
+    if (nLength < 1e-12)
+        return toEnds;
+    n = { n.x / nLength, n.y / nLength, n.z / nLength };
+
+    // Foot of the perpendicular on the great circle, between the ends
+    //   if it is on the same side of both of them
+    double sinCrossTrack = dot(p, n);
+    Vector3 foot = { p.x - sinCrossTrack * n.x, p.y - sinCrossTrack * n.y, p.z - sinCrossTrack * n.z };
+    if (dot(cross(a, foot), n) < 0.0 || dot(cross(foot, b), n) < 0.0)
+        return toEnds;
+
+    double crossTrack = fabs(asin(std::max(-1.0, std::min(1.0, sinCrossTrack)))) * kEarthRadius;
+    return std::min(crossTrack, toEnds);
+}
+
+/* Minimum distance between the point and the boundary of the geometry
+**   planar: in layer units
+**   geodesic: on the sphere, in meters */
+double distanceToBoundary(const GeoRawPoint& pt, GeoGeometry* geom, bool geodesic)
+{
+    double minDis = std::numeric_limits<double>::max();
+
+    auto pointDistance = [&pt, geodesic](const GeoRawPoint& p) {
+        return geodesic ? geodesicDistance(pt, p) : distancePointToPoint(pt, p);
+    };
+    auto segmentDistance = [&pt, geodesic](const GeoRawPoint& segStart, const GeoRawPoint& segEnd) {
+        return geodesic ? geodesicDistancePointToSegment(pt, segStart, segEnd)
+                        : distancePointToSegment(pt, segStart, segEnd);
+    };
+
+    auto lineDistance = [&](const GeoLineString* line, bool closed) {
+        int count = line->getNumPoints();
+        if (count == 1)
+            minDis = std::min(minDis, pointDistance((*line)[0]));
+        for (int i = 1; i < count; ++i)
+            minDis = std::min(minDis, segmentDistance((*line)[i - 1], (*line)[i]));
+        if (closed && count > 2)
+            minDis = std::min(minDis, segmentDistance((*line)[count - 1], (*line)[0]));
+    };
+
+    switch (geom->getGeometryType()) {
+    default:
+        break;
+    case kPoint:
+        minDis = pointDistance(geom->toPoint()->getXY());
+        break;
+    case kLineString:
+        lineDistance(geom->toLineString(), false);
+        break;
+    case kLinearRing:
+        lineDistance(geom->toLinearRing(), true);
+        break;
+    case kPolygon: {
+        GeoPolygon* polygon = geom->toPolygon();
+        if (polygon->isEmpty())
+            break;
+        lineDistance(polygon->getExteriorRing(), true);
+        int interiorRingsCount = polygon->getInteriorRingsCount();
+        for (int i = 0; i < interiorRingsCount; ++i)
+            lineDistance(polygon->getInteriorRing(i), true);
+        break;
+    }
+    case kMultiPoint:
+    case kMultiLineString:
+    case kMultiPolygon: {
+        GeoGeometryCollection* collection = utils::down_cast<GeoGeometryCollection*>(geom);
+        int geomsCount = collection->getNumGeometries();
+        for (int i = 0; i < geomsCount; ++i)
+            minDis = std::min(minDis, distanceToBoundary(pt, collection->getGeometry(i), geodesic));
+        break;
+    }
+    }
+    return minDis;
+}
+
+bool isPointInAnyPolygon(const GeoRawPoint& pt, GeoGeometry* geom)
+{
+    switch (geom->getGeometryType()) {
+    default:
+        return false;
+    case kPolygon:
+        return !geom->isEmpty() && isPointInPolygon(pt, geom->toPolygon());
+    case kMultiPolygon: {
+        GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+        int polygonsCount = multiPolygon->getNumGeometries();
+        for (int i = 0; i < polygonsCount; ++i) {
+            if (isPointInAnyPolygon(pt, multiPolygon->getGeometry(i)))
+                return true;
+        }
+        return false;
+    }
+    }
+}
+
+// Add a double field, or reuse the existing one with the same name
+//   if it is already a double field
+int addDoubleField(GeoFeatureLayer* layer, const QString& name)
+{
+    QString fieldName = name;
+    for (int suffix = 1; ; ++suffix) {
+        GeoFieldDefn* fieldDefn = layer->getFieldDefn(fieldName);
+        if (!fieldDefn)
+            return layer->addField(fieldName, 20, kFieldDouble);
+        if (fieldDefn->getType() == kFieldDouble)
+            return layer->getFieldIndex(fieldName);
+        fieldName = name + "_" + QString::number(suffix);
+    }
+}
+
+} // anonymous namespace
+
+
+double signedArea(const GeoLineString* ring)
+{
+    int pointsCount = ring->getNumPoints();
+    if (pointsCount < 3)
+        return 0.0;
+
+    // Relative to the first point to reduce the cancellation error
+    const GeoRawPoint& origin = (*ring)[0];
+    double sum = 0.0;
+    for (int i = 0, j = pointsCount - 1; i < pointsCount; j = i++) {
+        sum += ((*ring)[j].x - origin.x) * ((*ring)[i].y - origin.y)
+             - ((*ring)[i].x - origin.x) * ((*ring)[j].y - origin.y);
+    }
+    return sum / 2.0;
+}
+
+double area(GeoGeometry* geom)
+{
+    switch (geom->getGeometryType()) {
+    default:
+        return 0.0;
+    case kLinearRing:
+        return fabs(signedArea(geom->toLinearRing()));
+    case kPolygon:
+        return polygonArea(geom->toPolygon(), false);
+    case kMultiPolygon: {
+        GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+        double result = 0.0;
+        int polygonsCount = multiPolygon->getNumGeometries();
+        for (int i = 0; i < polygonsCount; ++i)
+            result += polygonArea(multiPolygon->getPolygon(i), false);
+        return result;
+    }
+    }
+}
+
+double geodesicArea(GeoGeometry* geom)
+{
+    switch (geom->getGeometryType()) {
+    default:
+        return 0.0;
+    case kLinearRing:
+        return fabs(geodesicSignedArea(geom->toLinearRing()));
+    case kPolygon:
+        return polygonArea(geom->toPolygon(), true);
+    case kMultiPolygon: {
+        GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+        double result = 0.0;
+        int polygonsCount = multiPolygon->getNumGeometries();
+        for (int i = 0; i < polygonsCount; ++i)
+            result += polygonArea(multiPolygon->getPolygon(i), true);
+        return result;
+    }
+    }
+}
+
+double length(GeoGeometry* geom)
+{
+    return measureLength(geom, false);
+}
+
+double geodesicLength(GeoGeometry* geom)
+{
+    return measureLength(geom, true);
+}
+
+// Haversine formula
+double geodesicDistance(const GeoRawPoint& ptA, const GeoRawPoint& ptB)
+{
+    double lat1 = ptA.y * kDegToRad;
+    double lat2 = ptB.y * kDegToRad;
+    double sinHalfDLat = sin((lat2 - lat1) / 2);
+    double sinHalfDLon = sin(normalizeLongitude(ptB.x - ptA.x) * kDegToRad / 2);
+    double h = sinHalfDLat * sinHalfDLat + cos(lat1) * cos(lat2) * sinHalfDLon * sinHalfDLon;
+    return 2 * kEarthRadius * asin(std::min(1.0, sqrt(h)));
+}
+
+bool centroid(GeoGeometry* geom, GeoRawPoint& centroidOut)
+{
+    if (!geom || geom->isEmpty())
+        return false;
+
+    CentroidSum sum;
+    sum.add(geom);
+
+    if (sum.area != 0.0) {
+        centroidOut.x = sum.areaX / sum.area;
+        centroidOut.y = sum.areaY / sum.area;
+    }
+    else if (sum.length > 0.0) {
+        centroidOut.x = sum.lineX / sum.length;
+        centroidOut.y = sum.lineY / sum.length;
+    }
+    else if (sum.pointsCount > 0) {
+        centroidOut.x = sum.pointX / sum.pointsCount;
+        centroidOut.y = sum.pointY / sum.pointsCount;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+double distancePointToSegment(const GeoRawPoint& pt, const GeoRawPoint& segStart, const GeoRawPoint& segEnd)
+{
+    double dx = segEnd.x - segStart.x;
+    double dy = segEnd.y - segStart.y;
+    double lenSquare = dx * dx + dy * dy;
+    if (lenSquare == 0.0)
+        return distancePointToPoint(pt, segStart);
+
+    // Projection of the point onto the segment, clamped to [0, 1]
+    double t = ((pt.x - segStart.x) * dx + (pt.y - segStart.y) * dy) / lenSquare;
+    if (t <= 0.0)
+        return distancePointToPoint(pt, segStart);
+    if (t >= 1.0)
+        return distancePointToPoint(pt, segEnd);
+    return distancePointToPoint(pt, GeoRawPoint(segStart.x + t * dx, segStart.y + t * dy));
+}
+
+double distancePointToGeometry(const GeoRawPoint& pt, GeoGeometry* geom)
+{
+    if (!geom || geom->isEmpty())
+        return 0.0;
+    if (isPointInAnyPolygon(pt, geom))
+        return 0.0;
+    return distanceToBoundary(pt, geom, false);
+}
+
+
+/**********************************/
+/*                                */
+/*    Measure the whole layer     */
+/*                                */
+/**********************************/
+
+int measureLayer(GeoFeatureLayer* layer, int measureTypes, bool geodesic,
+                 const GeoRawPoint& refPoint /*= GeoRawPoint()*/)
+{
+    int featuresCount = layer->getFeatureCount();
+    if (featuresCount == 0 || measureTypes == 0)
+        return 0;
+
+    GeometryType geomType = layer->getGeometryType();
+    bool isPolygonLayer = geomType == kPolygon || geomType == kMultiPolygon;
+
+    // Create all fields first, so the workers only write values
+    int areaIdx = -1, lengthIdx = -1, centroidXIdx = -1, centroidYIdx = -1, distanceIdx = -1;
+    if ((measureTypes & kMeasureArea) && isPolygonLayer)
+        areaIdx = addDoubleField(layer, "AREA");
+    if (measureTypes & kMeasureLength)
+        lengthIdx = addDoubleField(layer, isPolygonLayer ? "PERIMETER" : "LENGTH");
+    if (measureTypes & kMeasureCentroid) {
+        centroidXIdx = addDoubleField(layer, "CENTROID_X");
+        centroidYIdx = addDoubleField(layer, "CENTROID_Y");
+    }
+    if (measureTypes & kMeasureDistance)
+        distanceIdx = addDoubleField(layer, "DISTANCE");
+
+    // Make sure all features hold the new values before writing in parallel
+    for (int i = 0; i < featuresCount; ++i)
+        layer->getFeature(i)->initNewFieldValue();
+
+    utils::parallelFor(0, featuresCount, [&](int i) {
+        GeoFeature* feature = layer->getFeature(i);
+        GeoGeometry* geom = feature->getGeometry();
+        if (!geom)
+            return;
+
+        if (areaIdx != -1)
+            feature->setField(areaIdx, geodesic ? geodesicArea(geom) : area(geom));
+
+        if (lengthIdx != -1)
+            feature->setField(lengthIdx, geodesic ? geodesicLength(geom) : length(geom));
+
+        if (centroidXIdx != -1) {
+            GeoRawPoint center;
+            if (centroid(geom, center)) {
+                feature->setField(centroidXIdx, center.x);
+                feature->setField(centroidYIdx, center.y);
+            }
+        }
+
+        if (distanceIdx != -1) {
+            double dis = 0.0;
+            if (!isPointInAnyPolygon(refPoint, geom))
+                dis = distanceToBoundary(refPoint, geom, geodesic);
+            feature->setField(distanceIdx, dis);
+        }
+    });
+
+    return featuresCount;
+}
+
+} // namespace gm
@@ -0,0 +1,76 @@
+/*******************************************************
+** description: Geometric measures
+**                area, length(perimeter), centroid, distance
+**              both planar (layer units) and geodesic
+**                (coordinates in degrees, result in meters)
+**
+** last change: 2020-04-09
+*******************************************************/
+#pragma once
+
+#include "geo/geometry/geogeometry.h"
+#include "geo/geo_base.hpp"
+
+class GeoFeatureLayer;
+
+
+namespace gm {
+
+/* Radius of the sphere which has the same area as WGS84 ellipsoid (meters) */
+constexpr double kEarthRadius = 6371007.181;
+
+/* Signed area of a ring (shoelace formula)
+** > 0 : counterclockwise
+** < 0 : clockwise */
+double signedArea(const GeoLineString* ring);
+
+/* Planar area, 0 for points and lines */
+double area(GeoGeometry* geom);
+
+/* Area on the sphere, x = longitude, y = latitude (degrees) */
+double geodesicArea(GeoGeometry* geom);
+
+/* Planar length of lines, perimeter of polygons (all rings), 0 for points */
+double length(GeoGeometry* geom);
+
+/* Great circle (haversine) length */
+double geodesicLength(GeoGeometry* geom);
+double geodesicDistance(const GeoRawPoint& ptA, const GeoRawPoint& ptB);
+
+/* True centroid
+**   polygons: area-weighted
+**   lines:    length-weighted
+**   points:   mean of all points
+** Return false if the geometry is empty */
+bool centroid(GeoGeometry* geom, GeoRawPoint& centroidOut);
+
+/* Point & Segment */
+double distancePointToSegment(const GeoRawPoint& pt, const GeoRawPoint& segStart, const GeoRawPoint& segEnd);
+
+/* Point & Geometry
+** The minimum distance to any segment (or point) of the geometry,
+**   0 if the point is inside a polygon */
+double distancePointToGeometry(const GeoRawPoint& pt, GeoGeometry* geom);
+
+
+/**********************************/
+/*                                */
+/*    Measure the whole layer     */
+/*                                */
+/**********************************/
+
+enum MeasureType {
+    kMeasureArea        = 0x01,
+    kMeasureLength      = 0x02,     // length of lines, perimeter of polygons
+    kMeasureCentroid    = 0x04,
+    kMeasureDistance    = 0x08      // distance to a reference point
+};
+
+/* Calculate measures of all features in the layer in parallel
+**   and write them to (new) double fields of the layer:
+**     AREA, LENGTH / PERIMETER, CENTROID_X, CENTROID_Y, DISTANCE
+** Return the number of features measured */
+int measureLayer(GeoFeatureLayer* layer, int measureTypes, bool geodesic,
+                 const GeoRawPoint& refPoint = GeoRawPoint());
+
+} // namespace gm
@@ -0,0 +1,973 @@
+#include "geo/utility/geo_overlay.h"
+#include "geo/utility/geo_predicates.h"
+#include "util/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gm {
+
+namespace {
+
+constexpr int kMaxNodingIterations = 8;
+
+// Input segment, wA/wB: winding weight for the operand A/B
+struct Segment {
+    GeoRawPoint a;
+    GeoRawPoint b;
+    int wA;
+    int wB;
+};
+
+// Point where a segment must be split
+struct SplitPoint {
+    int seg;
+    double t;   // position along the segment, only used for sorting
+    GeoRawPoint pt;
+};
+
+// Edge after noding, a < b (lexicographic)
+//   the weights are for the direction a -> b
+struct Edge {
+    GeoRawPoint a;
+    GeoRawPoint b;
+    int wA;
+    int wB;
+};
+
+// Directed edge of the result, the inside is on the left
+struct ResultEdge {
+    GeoRawPoint from;
+    GeoRawPoint to;
+};
+
+inline bool sameXY(const GeoRawPoint& p, const GeoRawPoint& q) {
+    return p.x == q.x && p.y == q.y;
+}
+
+inline bool lessXY(const GeoRawPoint& p, const GeoRawPoint& q) {
+    return p.x < q.x || (p.x == q.x && p.y < q.y);
+}
+
+double ringSignedArea(const std::vector<GeoRawPoint>& ring)
+{
+    double area = 0.0;
+    int n = ring.size();
+    for (int i = 0, j = n - 1; i < n; j = i++)
+        area += (ring[j].x - ring[i].x) * (ring[j].y + ring[i].y);
+    return area / 2;
+}
+
+GeoExtent ringExtent(const std::vector<GeoRawPoint>& ring)
+{
+    GeoExtent extent(ring[0]);
+    for (auto& pt : ring)
+        extent.merge(pt.x, pt.y);
+    return extent;
+}
+
+// 1: inside, 0: on the boundary, -1: outside
+int locatePointInRing(const GeoRawPoint& pt, const std::vector<GeoRawPoint>& ring)
+{
+    int wn = 0;
+    int n = ring.size();
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        const GeoRawPoint& a = ring[j];
+        const GeoRawPoint& b = ring[i];
+        double o = orient2d(a, b, pt);
+        if (o == 0.0 && std::min(a.x, b.x) <= pt.x && pt.x <= std::max(a.x, b.x)
+            && std::min(a.y, b.y) <= pt.y && pt.y <= std::max(a.y, b.y))
+            return 0;
+        if (a.y <= pt.y) {
+            if (b.y > pt.y && o > 0.0)
+                ++wn;
+        }
+        else {
+            if (b.y <= pt.y && o < 0.0)
+                --wn;
+        }
+    }
+    return wn != 0 ? 1 : -1;
+}
+
+void addRingSegments(const RingList& rings, bool isA, std::vector<Segment>& segs)
+{
+    for (auto& ring : rings) {
+        int n = ring.size();
+        if (n >= 2 && sameXY(ring[0], ring[n - 1]))
+            --n;    // closed ring
+        if (n < 3)
+            continue;
+        for (int i = 0; i < n; ++i) {
+            const GeoRawPoint& a = ring[i];
+            const GeoRawPoint& b = ring[(i + 1) % n];
+            if (!sameXY(a, b))
+                segs.push_back({ a, b, isA ? 1 : 0, isA ? 0 : 1 });
+        }
+    }
+}
+
+
+/*****************************************/
+/*                                       */
+/*    Noding                             */
+/*                                       */
+/*****************************************/
+
+// p is exactly collinear with the segment
+inline bool isStrictlyInside(const GeoRawPoint& p, const Segment& s) {
+    if (sameXY(p, s.a) || sameXY(p, s.b))
+        return false;
+    return std::min(s.a.x, s.b.x) <= p.x && p.x <= std::max(s.a.x, s.b.x)
+        && std::min(s.a.y, s.b.y) <= p.y && p.y <= std::max(s.a.y, s.b.y);
+}
+
+inline void addSplit(int seg, const GeoRawPoint& pt, const std::vector<Segment>& segs,
+                     std::vector<SplitPoint>& splits)
+{
+    const Segment& s = segs[seg];
+    double t = (pt.x - s.a.x) * (s.b.x - s.a.x) + (pt.y - s.a.y) * (s.b.y - s.a.y);
+    splits.push_back({ seg, t, pt });
+}
+
+void intersectSegments(int i, int j, const std::vector<Segment>& segs, std::vector<SplitPoint>& splits)
+{
+    const Segment& s1 = segs[i];
+    const Segment& s2 = segs[j];
+
+    double o1 = orient2d(s1.a, s1.b, s2.a);
+    double o2 = orient2d(s1.a, s1.b, s2.b);
+    if ((o1 > 0.0 && o2 > 0.0) || (o1 < 0.0 && o2 < 0.0))
+        return;
+    double o3 = orient2d(s2.a, s2.b, s1.a);
+    double o4 = orient2d(s2.a, s2.b, s1.b);
+    if ((o3 > 0.0 && o4 > 0.0) || (o3 < 0.0 && o4 < 0.0))
+        return;
+
+    if (o1 != 0.0 && o2 != 0.0 && o3 != 0.0 && o4 != 0.0) {
+        // Proper crossing
+        // The point only depends on the two lines (not on the direction
+        //   or the order of the segments), so overlapping segments are
+        //   split at exactly the same points. It is clamped to the
+        //   common bounding box and inserted into both segments.
+        GeoRawPoint p1 = s1.a, p2 = s1.b, q1 = s2.a, q2 = s2.b;
+        if (lessXY(p2, p1))
+            std::swap(p1, p2);
+        if (lessXY(q2, q1))
+            std::swap(q1, q2);
+        if (lessXY(q1, p1) || (sameXY(q1, p1) && lessXY(q2, p2))) {
+            std::swap(p1, q1);
+            std::swap(p2, q2);
+        }
+        double d1 = orient2d(q1, q2, p1);
+        double d2 = orient2d(q1, q2, p2);
+        double t = d1 / (d1 - d2);
+        double x = p1.x + t * (p2.x - p1.x);
+        double y = p1.y + t * (p2.y - p1.y);
+        x = std::max(x, std::max(std::min(s1.a.x, s1.b.x), std::min(s2.a.x, s2.b.x)));
+        x = std::min(x, std::min(std::max(s1.a.x, s1.b.x), std::max(s2.a.x, s2.b.x)));
+        y = std::max(y, std::max(std::min(s1.a.y, s1.b.y), std::min(s2.a.y, s2.b.y)));
+        y = std::min(y, std::min(std::max(s1.a.y, s1.b.y), std::max(s2.a.y, s2.b.y)));
+        GeoRawPoint pt(x, y);
+        addSplit(i, pt, segs, splits);
+        addSplit(j, pt, segs, splits);
+        return;
+    }
+
+    // Touching or collinear: split at the endpoints lying on the other one
+    if (o1 == 0.0 && isStrictlyInside(s2.a, s1))
+        addSplit(i, s2.a, segs, splits);
+    if (o2 == 0.0 && isStrictlyInside(s2.b, s1))
+        addSplit(i, s2.b, segs, splits);
+    if (o3 == 0.0 && isStrictlyInside(s1.a, s2))
+        addSplit(j, s1.a, segs, splits);
+    if (o4 == 0.0 && isStrictlyInside(s1.b, s2))
+        addSplit(j, s1.b, segs, splits);
+}
+
+inline bool isBoxOverlap(const Segment& s1, const Segment& s2) {
+    return std::max(s1.a.x, s1.b.x) >= std::min(s2.a.x, s2.b.x)
+        && std::max(s2.a.x, s2.b.x) >= std::min(s1.a.x, s1.b.x)
+        && std::max(s1.a.y, s1.b.y) >= std::min(s2.a.y, s2.b.y)
+        && std::max(s2.a.y, s2.b.y) >= std::min(s1.a.y, s1.b.y);
+}
+
+// Find all intersections, segments are bucketed into a uniform grid
+void findSplitPoints(const std::vector<Segment>& segs, std::vector<SplitPoint>& splits)
+{
+    int segsCount = segs.size();
+    if (segsCount < 64) {
+        for (int i = 0; i < segsCount; ++i) {
+            for (int j = i + 1; j < segsCount; ++j) {
+                if (isBoxOverlap(segs[i], segs[j]))
+                    intersectSegments(i, j, segs, splits);
+            }
+        }
+        return;
+    }
+
+    GeoExtent extent(segs[0].a);
+    double totalLength = 0.0;
+    for (auto& s : segs) {
+        extent.merge(s.a.x, s.a.y);
+        extent.merge(s.b.x, s.b.y);
+        totalLength += fabs(s.b.x - s.a.x) + fabs(s.b.y - s.a.y);
+    }
+
+    // About one segment per cell, but not smaller than the segments
+    double cellSize = std::max(sqrt(extent.width() * extent.height() / segsCount), totalLength / segsCount / 2);
+    if (cellSize <= 0.0)
+        cellSize = std::max(std::max(extent.width(), extent.height()), 1.0);
+    int cols = std::min(1024, int(extent.width() / cellSize) + 1);
+    int rows = std::min(1024, int(extent.height() / cellSize) + 1);
+    double cellWidth = extent.width() > 0.0 ? extent.width() / cols : 1.0;
+    double cellHeight = extent.height() > 0.0 ? extent.height() / rows : 1.0;
+
+    auto colOf = [&](double x) { return std::min(cols - 1, std::max(0, int((x - extent.minX) / cellWidth))); };
+    auto rowOf = [&](double y) { return std::min(rows - 1, std::max(0, int((y - extent.minY) / cellHeight))); };
+
+    // Bucket the segments (CSR layout)
+    std::vector<int> offsets(cols * rows + 1, 0);
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<int> items;
+        std::vector<int> cursor;
+        if (pass == 1) {
+            for (int c = 0; c < cols * rows; ++c)
+                offsets[c + 1] += offsets[c];
+            cursor.assign(offsets.begin(), offsets.end() - 1);
+            items.resize(offsets.back());
+        }
+        for (int i = 0; i < segsCount; ++i) {
+            const Segment& s = segs[i];
+            int c0 = colOf(std::min(s.a.x, s.b.x)), c1 = colOf(std::max(s.a.x, s.b.x));
+            int r0 = rowOf(std::min(s.a.y, s.b.y)), r1 = rowOf(std::max(s.a.y, s.b.y));
+            for (int r = r0; r <= r1; ++r) {
+                for (int c = c0; c <= c1; ++c) {
+                    if (pass == 0)
+                        ++offsets[r * cols + c + 1];
+                    else
+                        items[cursor[r * cols + c]++] = i;
+                }
+            }
+        }
+        if (pass == 0)
+            continue;
+
+        // Each pair is tested only in the cell containing the lower-left
+        //   corner of the overlap of their bounding boxes
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                int first = offsets[r * cols + c];
+                int last = offsets[r * cols + c + 1];
+                for (int p = first; p < last; ++p) {
+                    const Segment& s1 = segs[items[p]];
+                    for (int q = p + 1; q < last; ++q) {
+                        const Segment& s2 = segs[items[q]];
+                        if (!isBoxOverlap(s1, s2))
+                            continue;
+                        double x = std::max(std::min(s1.a.x, s1.b.x), std::min(s2.a.x, s2.b.x));
+                        double y = std::max(std::min(s1.a.y, s1.b.y), std::min(s2.a.y, s2.b.y));
+                        if (colOf(x) == c && rowOf(y) == r)
+                            intersectSegments(items[p], items[q], segs, splits);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Split the segments, merge the identical edges
+void buildEdges(const std::vector<Segment>& segs, std::vector<SplitPoint>& splits, std::vector<Edge>& edges)
+{
+    std::sort(splits.begin(), splits.end(), [](const SplitPoint& lhs, const SplitPoint& rhs) {
+        return lhs.seg < rhs.seg || (lhs.seg == rhs.seg && lhs.t < rhs.t);
+    });
+
+    std::vector<Edge> raw;
+    raw.reserve(segs.size() + splits.size());
+    auto addEdge = [&raw](const GeoRawPoint& p, const GeoRawPoint& q, int wA, int wB) {
+        if (sameXY(p, q))
+            return;
+        if (lessXY(p, q))
+            raw.push_back({ p, q, wA, wB });
+        else
+            raw.push_back({ q, p, -wA, -wB });
+    };
+
+    int segsCount = segs.size();
+    int splitsCount = splits.size();
+    for (int i = 0, k = 0; i < segsCount; ++i) {
+        const Segment& s = segs[i];
+        GeoRawPoint prev = s.a;
+        for (; k < splitsCount && splits[k].seg == i; ++k) {
+            addEdge(prev, splits[k].pt, s.wA, s.wB);
+            prev = splits[k].pt;
+        }
+        addEdge(prev, s.b, s.wA, s.wB);
+    }
+
+    std::sort(raw.begin(), raw.end(), [](const Edge& lhs, const Edge& rhs) {
+        if (!sameXY(lhs.a, rhs.a))
+            return lessXY(lhs.a, rhs.a);
+        return lessXY(lhs.b, rhs.b);
+    });
+
+    edges.clear();
+    for (auto& e : raw) {
+        if (!edges.empty() && sameXY(edges.back().a, e.a) && sameXY(edges.back().b, e.b)) {
+            edges.back().wA += e.wA;
+            edges.back().wB += e.wB;
+        }
+        else {
+            edges.push_back(e);
+        }
+    }
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [](const Edge& e) {
+        return e.wA == 0 && e.wB == 0;
+    }), edges.end());
+}
+
+/* Floating-point noding, return false if the rounded intersection
+**   points still create new crossings after maxIterations passes */
+bool nodeSegments(const std::vector<Segment>& segsIn, std::vector<Edge>& edges, int maxIterations)
+{
+    std::vector<Segment> segs = segsIn;
+    std::vector<SplitPoint> splits;
+    for (int iter = 0; iter < maxIterations; ++iter) {
+        splits.clear();
+        findSplitPoints(segs, splits);
+        buildEdges(segs, splits, edges);
+        if (splits.empty())
+            return true;
+        segs.clear();
+        for (auto& e : edges)
+            segs.push_back({ e.a, e.b, e.wA, e.wB });
+    }
+    return false;
+}
+
+inline double snapValue(double v, double gridSize) {
+    return std::round(v / gridSize) * gridSize;
+}
+
+inline GeoRawPoint snapPoint(const GeoRawPoint& pt, double gridSize) {
+    return GeoRawPoint(snapValue(pt.x, gridSize), snapValue(pt.y, gridSize));
+}
+
+// The segment passes through the square pixel (closed)
+// The corners are exact, the grid size is a power of two
+bool isSegmentInPixel(const Segment& s, const GeoRawPoint& center, double half)
+{
+    if (std::max(s.a.x, s.b.x) < center.x - half || std::min(s.a.x, s.b.x) > center.x + half
+        || std::max(s.a.y, s.b.y) < center.y - half || std::min(s.a.y, s.b.y) > center.y + half)
+        return false;
+    double o0 = orient2d(s.a, s.b, GeoRawPoint(center.x - half, center.y - half));
+    double o1 = orient2d(s.a, s.b, GeoRawPoint(center.x + half, center.y - half));
+    double o2 = orient2d(s.a, s.b, GeoRawPoint(center.x + half, center.y + half));
+    double o3 = orient2d(s.a, s.b, GeoRawPoint(center.x - half, center.y + half));
+    if (o0 > 0.0 && o1 > 0.0 && o2 > 0.0 && o3 > 0.0)
+        return false;
+    if (o0 < 0.0 && o1 < 0.0 && o2 < 0.0 && o3 < 0.0)
+        return false;
+    return true;
+}
+
+/* Snap rounding (Hobby)
+** All vertices and intersection points are rounded to a grid, every
+**   segment is routed through the centers of the grid cells (hot
+**   pixels) it passes. The result is noded whatever the rounding
+**   errors, at the price of moving the edges by half a cell at most.
+** The cell is a power of two, about 2^-36 of the coordinates. */
+void snapRound(const std::vector<Segment>& segs, std::vector<Edge>& edges)
+{
+    double maxAbs = 1.0;
+    for (auto& s : segs)
+        maxAbs = std::max(maxAbs, std::max(std::max(fabs(s.a.x), fabs(s.a.y)), std::max(fabs(s.b.x), fabs(s.b.y))));
+    int exponent = 0;
+    frexp(maxAbs, &exponent);
+    double gridSize = ldexp(1.0, exponent - 36);
+    double half = gridSize / 2;
+
+    // Hot pixels
+    std::vector<SplitPoint> crossings;
+    findSplitPoints(segs, crossings);
+    std::vector<GeoRawPoint> pixels;
+    pixels.reserve(segs.size() * 2 + crossings.size());
+    for (auto& s : segs) {
+        pixels.push_back(snapPoint(s.a, gridSize));
+        pixels.push_back(snapPoint(s.b, gridSize));
+    }
+    for (auto& c : crossings)
+        pixels.push_back(snapPoint(c.pt, gridSize));
+    std::vector<SplitPoint>().swap(crossings);
+    std::sort(pixels.begin(), pixels.end(), lessXY);
+    pixels.erase(std::unique(pixels.begin(), pixels.end(), sameXY), pixels.end());
+
+    // Pixels bucketed into a coarse grid
+    int pixelsCount = pixels.size();
+    GeoExtent extent(pixels[0]);
+    for (auto& pt : pixels)
+        extent.merge(pt.x, pt.y);
+    double cellSize = std::max(gridSize, sqrt(extent.width() * extent.height() / pixelsCount));
+    int cols = std::min(1024, int(extent.width() / cellSize) + 1);
+    int rows = std::min(1024, int(extent.height() / cellSize) + 1);
+    double cellWidth = extent.width() > 0.0 ? extent.width() / cols : 1.0;
+    double cellHeight = extent.height() > 0.0 ? extent.height() / rows : 1.0;
+    auto colOf = [&](double x) { return std::min(cols - 1, std::max(0, int((x - extent.minX) / cellWidth))); };
+    auto rowOf = [&](double y) { return std::min(rows - 1, std::max(0, int((y - extent.minY) / cellHeight))); };
+
+    std::vector<int> offsets(cols * rows + 1, 0);
+    for (auto& pt : pixels)
+        ++offsets[rowOf(pt.y) * cols + colOf(pt.x) + 1];
+    for (int c = 0; c < cols * rows; ++c)
+        offsets[c + 1] += offsets[c];
+    std::vector<int> items(pixelsCount);
+    {
+        std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for (int i = 0; i < pixelsCount; ++i)
+            items[cursor[rowOf(pixels[i].y) * cols + colOf(pixels[i].x)]++] = i;
+    }
+
+    // Route the segments
+    std::vector<Segment> snapped;
+    std::vector<SplitPoint> splits;
+    snapped.reserve(segs.size());
+    int segsCount = segs.size();
+    for (int i = 0; i < segsCount; ++i) {
+        const Segment& s = segs[i];
+        GeoRawPoint a = snapPoint(s.a, gridSize);
+        GeoRawPoint b = snapPoint(s.b, gridSize);
+        snapped.push_back({ a, b, s.wA, s.wB });
+
+        int c0 = colOf(std::min(s.a.x, s.b.x) - half), c1 = colOf(std::max(s.a.x, s.b.x) + half);
+        int r0 = rowOf(std::min(s.a.y, s.b.y) - half), r1 = rowOf(std::max(s.a.y, s.b.y) + half);
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                for (int k = offsets[r * cols + c]; k < offsets[r * cols + c + 1]; ++k) {
+                    const GeoRawPoint& pt = pixels[items[k]];
+                    if (sameXY(pt, a) || sameXY(pt, b) || !isSegmentInPixel(s, pt, half))
+                        continue;
+                    addSplit(i, pt, segs, splits);
+                }
+            }
+        }
+    }
+
+    buildEdges(snapped, splits, edges);
+}
+
+
+/*****************************************/
+/*                                       */
+/*    Winding numbers                    */
+/*                                       */
+/*****************************************/
+
+// Edges bucketed by rows of y, for casting rays to -x
+class RayIndex {
+public:
+    explicit RayIndex(const std::vector<Edge>& edgesIn)
+        : edges(edgesIn)
+    {
+        int edgesCount = edges.size();
+        minY = edges[0].a.y;
+        double maxY = minY;
+        for (auto& e : edges) {
+            minY = std::min(minY, std::min(e.a.y, e.b.y));
+            maxY = std::max(maxY, std::max(e.a.y, e.b.y));
+        }
+        rows = std::max(1, std::min(4096, int(sqrt(double(edgesCount))) * 2));
+        rowHeight = maxY > minY ? (maxY - minY) / rows : 1.0;
+
+        offsets.assign(rows + 1, 0);
+        for (auto& e : edges) {
+            for (int r = rowOf(std::min(e.a.y, e.b.y)), r1 = rowOf(std::max(e.a.y, e.b.y)); r <= r1; ++r)
+                ++offsets[r + 1];
+        }
+        for (int r = 0; r < rows; ++r)
+            offsets[r + 1] += offsets[r];
+        items.resize(offsets.back());
+        std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for (int i = 0; i < edgesCount; ++i) {
+            const Edge& e = edges[i];
+            for (int r = rowOf(std::min(e.a.y, e.b.y)), r1 = rowOf(std::max(e.a.y, e.b.y)); r <= r1; ++r)
+                items[cursor[r]++] = i;
+        }
+    }
+
+    // Winding numbers just to the west of the point
+    // The point must be the leftmost vertex of its connected component,
+    //   so the ray to -x only meets the other components
+    void westWinding(const GeoRawPoint& pt, int& wA, int& wB) const
+    {
+        wA = wB = 0;
+        int r = rowOf(pt.y);
+        for (int k = offsets[r]; k < offsets[r + 1]; ++k) {
+            const Edge& e = edges[items[k]];
+            if (e.a.x > pt.x && e.b.x > pt.x)
+                continue;
+            if (e.a.y <= pt.y) {
+                if (e.b.y > pt.y && orient2d(e.a, e.b, pt) < 0.0) {
+                    wA -= e.wA;
+                    wB -= e.wB;
+                }
+            }
+            else {
+                if (e.b.y <= pt.y && orient2d(e.a, e.b, pt) > 0.0) {
+                    wA += e.wA;
+                    wB += e.wB;
+                }
+            }
+        }
+    }
+
+private:
+    int rowOf(double y) const { return std::min(rows - 1, std::max(0, int((y - minY) / rowHeight))); }
+
+private:
+    const std::vector<Edge>& edges;
+    double minY;
+    double rowHeight;
+    int rows;
+    std::vector<int> offsets;
+    std::vector<int> items;
+};
+
+// Counterclockwise angular order of directions around the center
+inline bool isAngleLess(const GeoRawPoint& center, const GeoRawPoint& p, const GeoRawPoint& q) {
+    int hp = (p.y < center.y || (p.y == center.y && p.x < center.x)) ? 1 : 0;
+    int hq = (q.y < center.y || (q.y == center.y && q.x < center.x)) ? 1 : 0;
+    if (hp != hq)
+        return hp < hq;
+    return orient2d(center, p, q) > 0.0;
+}
+
+inline bool isInside(int wA, int wB, OverlayOp op) {
+    switch (op) {
+    default:
+    case kOverlayUnion:         return wA != 0 || wB != 0;
+    case kOverlayIntersection:  return wA != 0 && wB != 0;
+    case kOverlayDifference:    return wA != 0 && wB == 0;
+    }
+}
+
+/* Winding numbers of both sides of every edge, then keep the edges
+**   between an inside face and an outside face
+**
+** Around a vertex, the winding numbers of two neighboring sectors
+**   differ by the weight of the edge between them, so the numbers are
+**   propagated through each connected component from its leftmost
+**   vertex, whose western sector is found by one ray casting.
+** Only exact predicates and integers are involved, no point is
+**   computed (a midpoint may not exist between two close vertices). */
+void selectResultEdges(const std::vector<Edge>& edges, OverlayOp op, std::vector<ResultEdge>& result)
+{
+    int edgesCount = edges.size();
+
+    // Vertices in lexicographic order
+    std::vector<GeoRawPoint> vertices;
+    vertices.reserve(edgesCount * 2);
+    for (auto& e : edges) {
+        vertices.push_back(e.a);
+        vertices.push_back(e.b);
+    }
+    std::sort(vertices.begin(), vertices.end(), lessXY);
+    vertices.erase(std::unique(vertices.begin(), vertices.end(), sameXY), vertices.end());
+    int verticesCount = vertices.size();
+    auto vertexId = [&vertices](const GeoRawPoint& pt) {
+        return int(std::lower_bound(vertices.begin(), vertices.end(), pt, lessXY) - vertices.begin());
+    };
+
+    // Incident edges of each vertex, in counterclockwise order
+    // Item: edge index * 2 + (1 if the edge ends at the vertex)
+    std::vector<int> edgeA(edgesCount), edgeB(edgesCount);
+    std::vector<int> offsets(verticesCount + 1, 0);
+    for (int i = 0; i < edgesCount; ++i) {
+        edgeA[i] = vertexId(edges[i].a);
+        edgeB[i] = vertexId(edges[i].b);
+        ++offsets[edgeA[i] + 1];
+        ++offsets[edgeB[i] + 1];
+    }
+    for (int v = 0; v < verticesCount; ++v)
+        offsets[v + 1] += offsets[v];
+    std::vector<int> items(offsets.back());
+    {
+        std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for (int i = 0; i < edgesCount; ++i) {
+            items[cursor[edgeA[i]]++] = i * 2;
+            items[cursor[edgeB[i]]++] = i * 2 + 1;
+        }
+    }
+    auto otherEnd = [&edges](int item) -> const GeoRawPoint& {
+        return (item & 1) ? edges[item >> 1].a : edges[item >> 1].b;
+    };
+    for (int v = 0; v < verticesCount; ++v) {
+        const GeoRawPoint& center = vertices[v];
+        std::sort(items.begin() + offsets[v], items.begin() + offsets[v + 1], [&](int lhs, int rhs) {
+            return isAngleLess(center, otherEnd(lhs), otherEnd(rhs));
+        });
+    }
+
+    // Winding numbers on the left and right of the edges
+    std::vector<int> leftA(edgesCount), leftB(edgesCount), rightA(edgesCount), rightB(edgesCount);
+    std::vector<char> visited(verticesCount, 0);
+    std::vector<int> stack;
+    RayIndex rayIndex(edges);
+
+    // Sweep counterclockwise around v starting after position `first`,
+    //   where the sector winding numbers are (wA, wB)
+    auto sweepVertex = [&](int v, int first, int wA, int wB) {
+        int begin = offsets[v];
+        int count = offsets[v + 1] - begin;
+        for (int k = 1; k <= count; ++k) {
+            int item = items[begin + (first + k) % count];
+            int e = item >> 1;
+            bool isIncoming = item & 1;
+            if (!isIncoming) {
+                rightA[e] = wA;  rightB[e] = wB;
+                wA += edges[e].wA;  wB += edges[e].wB;
+                leftA[e] = wA;   leftB[e] = wB;
+            }
+            else {
+                leftA[e] = wA;   leftB[e] = wB;
+                wA -= edges[e].wA;  wB -= edges[e].wB;
+                rightA[e] = wA;  rightB[e] = wB;
+            }
+            int other = isIncoming ? edgeA[e] : edgeB[e];
+            if (!visited[other]) {
+                visited[other] = 1;
+                stack.push_back(e * 2 + (isIncoming ? 0 : 1));     // item of e at the other end
+            }
+        }
+    };
+
+    for (int v0 = 0; v0 < verticesCount; ++v0) {
+        if (visited[v0])
+            continue;
+
+        // The leftmost vertex of a new component
+        // Its edges all point to the east, the western sector is after
+        //   the last edge in the upper half (or after the last one if
+        //   all are in the lower half)
+        visited[v0] = 1;
+        int wA, wB;
+        rayIndex.westWinding(vertices[v0], wA, wB);
+        int begin = offsets[v0];
+        int count = offsets[v0 + 1] - begin;
+        int last = count - 1;
+        for (int k = 0; k < count; ++k) {
+            const GeoRawPoint& q = otherEnd(items[begin + k]);
+            if (q.y < vertices[v0].y)
+                break;
+            last = k;
+        }
+        sweepVertex(v0, last, wA, wB);
+
+        // Other vertices of the component: the sides of the edge we
+        //   came from are known
+        while (!stack.empty()) {
+            int item = stack.back();
+            stack.pop_back();
+            int e = item >> 1;
+            int v = (item & 1) ? edgeB[e] : edgeA[e];
+            int vBegin = offsets[v];
+            int vCount = offsets[v + 1] - vBegin;
+            int pos = std::find(items.begin() + vBegin, items.begin() + vBegin + vCount, item) - items.begin() - vBegin;
+            // The sector after e (counterclockwise)
+            if (item & 1)
+                sweepVertex(v, pos, rightA[e], rightB[e]);
+            else
+                sweepVertex(v, pos, leftA[e], leftB[e]);
+        }
+    }
+
+    for (int i = 0; i < edgesCount; ++i) {
+        bool leftIn = isInside(leftA[i], leftB[i], op);
+        bool rightIn = isInside(rightA[i], rightB[i], op);
+        if (leftIn && !rightIn)
+            result.push_back({ edges[i].a, edges[i].b });
+        else if (!leftIn && rightIn)
+            result.push_back({ edges[i].b, edges[i].a });
+    }
+}
+
+
+/*****************************************/
+/*                                       */
+/*    Rings                              */
+/*                                       */
+/*****************************************/
+
+// Remove the vertices in the middle of straight runs
+void removeCollinearPoints(std::vector<GeoRawPoint>& ring)
+{
+    int n = ring.size();
+    std::vector<GeoRawPoint> result;
+    result.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        const GeoRawPoint& prev = ring[(i + n - 1) % n];
+        const GeoRawPoint& cur = ring[i];
+        const GeoRawPoint& next = ring[(i + 1) % n];
+        if (orient2d(prev, cur, next) == 0.0
+            && (cur.x - prev.x) * (next.x - cur.x) + (cur.y - prev.y) * (next.y - cur.y) > 0.0)
+            continue;
+        result.push_back(cur);
+    }
+    ring.swap(result);
+}
+
+// Link the edges into rings, the inside on the left
+// At a vertex, take the first outgoing edge clockwise from the
+//   reversed incoming edge, so the rings touching at a vertex
+//   are separated
+void traceRings(std::vector<ResultEdge>& edges, RingList& rings)
+{
+    std::sort(edges.begin(), edges.end(), [](const ResultEdge& lhs, const ResultEdge& rhs) {
+        if (!sameXY(lhs.from, rhs.from))
+            return lessXY(lhs.from, rhs.from);
+        return isAngleLess(lhs.from, lhs.to, rhs.to);
+    });
+
+    int edgesCount = edges.size();
+    std::vector<char> used(edgesCount, 0);
+
+    // Range of the outgoing edges of a vertex
+    auto outgoing = [&edges](const GeoRawPoint& pt, int& first, int& last) {
+        auto cmp = [](const ResultEdge& e, const GeoRawPoint& p) { return lessXY(e.from, p); };
+        auto cmp2 = [](const GeoRawPoint& p, const ResultEdge& e) { return lessXY(p, e.from); };
+        first = std::lower_bound(edges.begin(), edges.end(), pt, cmp) - edges.begin();
+        last = std::upper_bound(edges.begin() + first, edges.end(), pt, cmp2) - edges.begin();
+    };
+
+    for (int start = 0; start < edgesCount; ++start) {
+        if (used[start])
+            continue;
+        std::vector<GeoRawPoint> ring;
+        int e = start;
+        bool closed = false;
+        for (int step = 0; step <= edgesCount; ++step) {
+            used[e] = 1;
+            ring.push_back(edges[e].from);
+
+            const GeoRawPoint& v = edges[e].to;
+            const GeoRawPoint& u = edges[e].from;
+            int first, last;
+            outgoing(v, first, last);
+            if (first == last)
+                break;
+
+            // Largest angle smaller than the reversed incoming edge,
+            //   or the largest one (wrap around)
+            int next = last - 1;
+            for (int k = last - 1; k >= first; --k) {
+                if (isAngleLess(v, edges[k].to, u)) {
+                    next = k;
+                    break;
+                }
+            }
+            if (next == start) {
+                closed = true;
+                break;
+            }
+            if (used[next])
+                break;
+            e = next;
+        }
+        if (closed)
+            removeCollinearPoints(ring);
+        if (closed && ring.size() >= 3)
+            rings.push_back(std::move(ring));
+    }
+}
+
+GeoLinearRing* createLinearRing(const std::vector<GeoRawPoint>& points)
+{
+    GeoLinearRing* ring = new GeoLinearRing();
+    ring->reserveNumPoints(points.size() + 1);
+    for (auto& pt : points)
+        ring->addPoint(pt);
+    ring->closeRings();
+    return ring;
+}
+
+// Assign the holes to the shells, build the geometry
+GeoGeometry* assembleRings(RingList& rings)
+{
+    std::vector<int> shells;
+    std::vector<int> holes;
+    std::vector<double> areas(rings.size());
+    for (int i = 0; i < int(rings.size()); ++i) {
+        areas[i] = ringSignedArea(rings[i]);
+        if (areas[i] > 0.0)
+            shells.push_back(i);
+        else if (areas[i] < 0.0)
+            holes.push_back(i);
+    }
+    if (shells.empty())
+        return nullptr;
+
+    std::vector<GeoExtent> shellExtents;
+    for (int s : shells)
+        shellExtents.push_back(ringExtent(rings[s]));
+
+    std::vector<std::vector<int>> shellHoles(shells.size());
+    for (int h : holes) {
+        const std::vector<GeoRawPoint>& hole = rings[h];
+        GeoExtent holeExtent = ringExtent(hole);
+        int owner = -1;
+        for (int k = 0; k < int(shells.size()); ++k) {
+            const GeoExtent& ext = shellExtents[k];
+            if (holeExtent.minX < ext.minX || holeExtent.maxX > ext.maxX
+                || holeExtent.minY < ext.minY || holeExtent.maxY > ext.maxY)
+                continue;
+            if (owner != -1 && areas[shells[k]] >= areas[shells[owner]])
+                continue;
+            // The first vertex not on the boundary decides
+            int location = 0;
+            for (int p = 0; p < int(hole.size()) && location == 0; ++p)
+                location = locatePointInRing(hole[p], rings[shells[k]]);
+            if (location == 0) {
+                const GeoRawPoint& a = hole[0];
+                const GeoRawPoint& b = hole[1];
+                location = locatePointInRing(GeoRawPoint((a.x + b.x) / 2, (a.y + b.y) / 2), rings[shells[k]]);
+            }
+            if (location >= 0)
+                owner = k;
+        }
+        if (owner != -1)
+            shellHoles[owner].push_back(h);
+    }
+
+    std::vector<GeoPolygon*> polygons;
+    for (int k = 0; k < int(shells.size()); ++k) {
+        GeoPolygon* polygon = new GeoPolygon();
+        polygon->setExteriorRing(createLinearRing(rings[shells[k]]));
+        polygon->reserveInteriorRingsCount(shellHoles[k].size());
+        for (int h : shellHoles[k])
+            polygon->addInteriorRing(createLinearRing(rings[h]));
+        polygons.push_back(polygon);
+    }
+
+    if (polygons.size() == 1)
+        return polygons[0];
+
+    GeoMultiPolygon* multiPolygon = new GeoMultiPolygon();
+    multiPolygon->reserveNumGeoms(polygons.size());
+    for (auto polygon : polygons)
+        multiPolygon->addGeometry(polygon);
+    return multiPolygon;
+}
+
+void addPolygonRings(GeoPolygon* polygon, RingList& ringsOut)
+{
+    int ringsCount = polygon->getInteriorRingsCount() + 1;
+    for (int i = 0; i < ringsCount; ++i) {
+        GeoLinearRing* ring = (i == 0) ? polygon->getExteriorRing() : polygon->getInteriorRing(i - 1);
+        std::vector<GeoRawPoint> points(ring->begin(), ring->end());
+        if (points.size() >= 2 && sameXY(points.front(), points.back()))
+            points.pop_back();
+        if (points.size() < 3)
+            continue;
+        double area = ringSignedArea(points);
+        if ((i == 0 && area < 0.0) || (i > 0 && area > 0.0))
+            std::reverse(points.begin(), points.end());
+        ringsOut.push_back(std::move(points));
+    }
+}
+
+} // anonymous namespace
+
+
+void collectRings(GeoGeometry* geom, RingList& ringsOut)
+{
+    if (!geom)
+        return;
+
+    switch (geom->getGeometryType()) {
+    default:
+        break;
+    case kPolygon:
+        if (!geom->isEmpty())
+            addPolygonRings(geom->toPolygon(), ringsOut);
+        break;
+    case kMultiPolygon: {
+        GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+        int polygonsCount = multiPolygon->getNumGeometries();
+        for (int i = 0; i < polygonsCount; ++i)
+            collectRings(multiPolygon->getPolygon(i), ringsOut);
+        break;
+    }
+    }
+}
+
+GeoGeometry* overlayRings(const RingList& ringsA, const RingList& ringsB, OverlayOp op)
+{
+    std::vector<Segment> segs;
+    addRingSegments(ringsA, true, segs);
+    addRingSegments(ringsB, false, segs);
+    if (segs.empty())
+        return nullptr;
+
+    // Floating-point noding first. Near a point where many lines meet,
+    //   the rounded intersection points may keep creating new
+    //   crossings, then fall back to snap rounding.
+    std::vector<Edge> edges;
+    if (!nodeSegments(segs, edges, 2)) {
+        snapRound(segs, edges);
+        segs.clear();
+        for (auto& e : edges)
+            segs.push_back({ e.a, e.b, e.wA, e.wB });
+        nodeSegments(segs, edges, kMaxNodingIterations);
+    }
+    std::vector<Segment>().swap(segs);
+    if (edges.empty())
+        return nullptr;
+
+    std::vector<ResultEdge> resultEdges;
+    selectResultEdges(edges, op, resultEdges);
+    std::vector<Edge>().swap(edges);
+
+    RingList rings;
+    traceRings(resultEdges, rings);
+    return assembleRings(rings);
+}
+
+GeoGeometry* unionRings(const RingList& rings)
+{
+    return overlayRings(rings, RingList(), kOverlayUnion);
+}
+
+GeoGeometry* unionPolygons(const std::vector<GeoGeometry*>& polygons)
+{
+    // Rings of each input, the merged results replace them level by level
+    std::vector<RingList> level;
+    for (auto geom : polygons) {
+        RingList rings;
+        collectRings(geom, rings);
+        if (!rings.empty())
+            level.push_back(std::move(rings));
+    }
+    if (level.empty())
+        return nullptr;
+
+    if (level.size() == 1)
+        return unionRings(level[0]);
+
+    // The last two are merged into the result directly
+    while (level.size() > 2) {
+        int pairsCount = level.size() / 2;
+        std::vector<RingList> nextLevel(pairsCount + level.size() % 2);
+        utils::parallelFor(0, pairsCount, [&](int i) {
+            GeoGeometry* merged = overlayRings(level[2 * i], level[2 * i + 1], kOverlayUnion);
+            collectRings(merged, nextLevel[i]);
+            delete merged;
+        }, 1);
+        if (level.size() % 2)
+            nextLevel.back() = std::move(level.back());
+        level.swap(nextLevel);
+    }
+
+    return overlayRings(level[0], level[1], kOverlayUnion);
+}
+
+} // namespace gm
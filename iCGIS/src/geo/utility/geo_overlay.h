@@ -0,0 +1,61 @@
+/*******************************************************
+** description: Polygon overlay (union, intersection,
+**                difference) of two sets of rings
+**
+**              All segments are split at their intersections
+**                (noding), the winding numbers of both sides
+**                of every split edge are propagated around the
+**                vertices (they change by the weight of each edge
+**                crossed) from the leftmost vertex of each
+**                connected component, found by a single ray cast
+**                to the west. Only the robust predicates are used.
+**                The edges between an inside and an outside face
+**                are kept and linked into rings.
+**
+**              A point is inside an operand if its winding
+**                number is not zero (non-zero rule), so the
+**                union of overlapping counterclockwise rings
+**                (self-union) needs no special treatment.
+**
+** last change: 2020-04-09
+*******************************************************/
+#pragma once
+
+#include "geo/geometry/geogeometry.h"
+#include "geo/geo_base.hpp"
+
+#include <vector>
+
+
+namespace gm {
+
+// Rings without the repeated closing point
+// Counterclockwise rings count +1, clockwise rings -1
+using RingList = std::vector<std::vector<GeoRawPoint>>;
+
+enum OverlayOp {
+    kOverlayUnion           = 0,
+    kOverlayIntersection    = 1,
+    kOverlayDifference      = 2     // A - B
+};
+
+/* Append the rings of a polygon or multipolygon
+** Exterior rings are made counterclockwise, holes clockwise */
+void collectRings(GeoGeometry* geom, RingList& ringsOut);
+
+/* Overlay of the regions of ringsA and ringsB
+** Return a GeoPolygon, a GeoMultiPolygon if there are several
+**   parts, or nullptr if the result is empty.
+** Exterior rings are counterclockwise, holes clockwise */
+GeoGeometry* overlayRings(const RingList& ringsA, const RingList& ringsB, OverlayOp op);
+
+/* Union of all rings (self-union) */
+GeoGeometry* unionRings(const RingList& rings);
+
+/* Union of many polygons
+** Pairs are merged level by level (cascaded union), the merges
+**   of one level run in parallel.
+** The input geometries are not modified */
+GeoGeometry* unionPolygons(const std::vector<GeoGeometry*>& polygons);
+
+} // namespace gm
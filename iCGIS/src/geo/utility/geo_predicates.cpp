@@ -0,0 +1,313 @@
+#include "geo/utility/geo_predicates.h"
+
+#include <cmath>
+#include <vector>
+
+namespace gm {
+
+namespace {
+
+/*****************************************************************/
+/*                                                               */
+/*    Expansion arithmetic                                       */
+/*      An expansion is a sum of doubles, nonoverlapping and     */
+/*      sorted by increasing magnitude, the exact value is       */
+/*      kept without any rounding error.                         */
+/*      The intermediate results must be rounded to double       */
+/*      (do not compile with fused multiply-add contraction)     */
+/*                                                               */
+/*****************************************************************/
+
+using Expansion = std::vector<double>;
+
+constexpr double kEpsilon = 1.1102230246251565e-16;     // 2^-53
+constexpr double kSplitter = 134217729.0;               // 2^27 + 1
+
+// Error bounds of the fast filters
+constexpr double kCcwErrBoundA = (3.0 + 16.0 * kEpsilon) * kEpsilon;
+constexpr double kIccErrBoundA = (10.0 + 96.0 * kEpsilon) * kEpsilon;
+
+// a + b = x + y exactly, |a| >= |b|
+inline void fastTwoSum(double a, double b, double& x, double& y) {
+    x = a + b;
+    double bvirt = x - a;
+    y = b - bvirt;
+}
+
+// a + b = x + y exactly
+inline void twoSum(double a, double b, double& x, double& y) {
+    x = a + b;
+    double bvirt = x - a;
+    double avirt = x - bvirt;
+    double bround = b - bvirt;
+    double around = a - avirt;
+    y = around + bround;
+}
+
+// a - b = x + y exactly
+inline void twoDiff(double a, double b, double& x, double& y) {
+    x = a - b;
+    double bvirt = a - x;
+    double avirt = x + bvirt;
+    double bround = bvirt - b;
+    double around = a - avirt;
+    y = around + bround;
+}
+
+// Split a into two 26-bit halves
+inline void split(double a, double& hi, double& lo) {
+    double c = kSplitter * a;
+    double abig = c - a;
+    hi = c - abig;
+    lo = a - hi;
+}
+
+// a * b = x + y exactly
+inline void twoProduct(double a, double b, double& x, double& y) {
+    x = a * b;
+    double ahi, alo, bhi, blo;
+    split(a, ahi, alo);
+    split(b, bhi, blo);
+    double err1 = x - (ahi * bhi);
+    double err2 = err1 - (alo * bhi);
+    double err3 = err2 - (ahi * blo);
+    y = (alo * blo) - err3;
+}
+
+Expansion makeProduct(double a, double b) {
+    double x, y;
+    twoProduct(a, b, x, y);
+    return { y, x };
+}
+
+Expansion makeDiff(double a, double b) {
+    double x, y;
+    twoDiff(a, b, x, y);
+    return { y, x };
+}
+
+// e + b, zero components eliminated
+Expansion growExpansion(const Expansion& e, double b) {
+    Expansion h;
+    h.reserve(e.size() + 1);
+    double q = b;
+    for (double enow : e) {
+        double qNew, hh;
+        twoSum(q, enow, qNew, hh);
+        q = qNew;
+        if (hh != 0.0)
+            h.push_back(hh);
+    }
+    if (q != 0.0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+// e + f
+Expansion expansionSum(const Expansion& e, const Expansion& f) {
+    Expansion h = e;
+    for (double fnow : f)
+        h = growExpansion(h, fnow);
+    return h;
+}
+
+// e * b, zero components eliminated
+Expansion scaleExpansion(const Expansion& e, double b) {
+    Expansion h;
+    h.reserve(e.size() * 2);
+    double q, hh;
+    twoProduct(e[0], b, q, hh);
+    if (hh != 0.0)
+        h.push_back(hh);
+    for (size_t i = 1; i < e.size(); ++i) {
+        double product1, product0, sum;
+        twoProduct(e[i], b, product1, product0);
+        twoSum(q, product0, sum, hh);
+        if (hh != 0.0)
+            h.push_back(hh);
+        fastTwoSum(product1, sum, q, hh);
+        if (hh != 0.0)
+            h.push_back(hh);
+    }
+    if (q != 0.0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+// e * f
+Expansion expansionProduct(const Expansion& e, const Expansion& f) {
+    Expansion h = { 0.0 };
+    for (double fnow : f) {
+        if (fnow != 0.0)
+            h = expansionSum(h, scaleExpansion(e, fnow));
+    }
+    return h;
+}
+
+Expansion negate(Expansion e) {
+    for (double& v : e)
+        v = -v;
+    return e;
+}
+
+// Approximate value, the sign is exact
+double estimate(const Expansion& e) {
+    double sum = 0.0;
+    for (double v : e)
+        sum += v;
+    return sum;
+}
+
+/* Exact orient2d
+**   ax*by - ax*cy - cx*by - ay*bx + ay*cx + cy*bx
+** (the cx*cy terms cancel) */
+double orient2dExact(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc)
+{
+    Expansion det = makeProduct(pa.x, pb.y);
+    det = expansionSum(det, makeProduct(-pa.x, pc.y));
+    det = expansionSum(det, makeProduct(-pc.x, pb.y));
+    det = expansionSum(det, makeProduct(-pa.y, pb.x));
+    det = expansionSum(det, makeProduct(pa.y, pc.x));
+    det = expansionSum(det, makeProduct(pc.y, pb.x));
+    return estimate(det);
+}
+
+/* Exact incircle
+** The differences relative to pd are kept as two-component
+**   expansions, so no rounding error is introduced */
+double incircleExact(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc, const GeoRawPoint& pd)
+{
+    Expansion adx = makeDiff(pa.x, pd.x), ady = makeDiff(pa.y, pd.y);
+    Expansion bdx = makeDiff(pb.x, pd.x), bdy = makeDiff(pb.y, pd.y);
+    Expansion cdx = makeDiff(pc.x, pd.x), cdy = makeDiff(pc.y, pd.y);
+
+    auto cross = [](const Expansion& x1, const Expansion& y1, const Expansion& x2, const Expansion& y2) {
+        return expansionSum(expansionProduct(x1, y2), negate(expansionProduct(x2, y1)));
+    };
+    auto lift = [](const Expansion& dx, const Expansion& dy) {
+        return expansionSum(expansionProduct(dx, dx), expansionProduct(dy, dy));
+    };
+
+    Expansion det = expansionProduct(lift(adx, ady), cross(bdx, bdy, cdx, cdy));
+    det = expansionSum(det, expansionProduct(lift(bdx, bdy), cross(cdx, cdy, adx, ady)));
+    det = expansionSum(det, expansionProduct(lift(cdx, cdy), cross(adx, ady, bdx, bdy)));
+    return estimate(det);
+}
+
+inline int sign(double value) {
+    return (value > 0.0) - (value < 0.0);
+}
+
+} // anonymous namespace
+
+
+double orient2d(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc)
+{
+    double detLeft = (pa.x - pc.x) * (pb.y - pc.y);
+    double detRight = (pa.y - pc.y) * (pb.x - pc.x);
+    double det = detLeft - detRight;
+    double detSum;
+
+    if (detLeft > 0.0) {
+        if (detRight <= 0.0)
+            return det;
+        detSum = detLeft + detRight;
+    }
+    else if (detLeft < 0.0) {
+        if (detRight >= 0.0)
+            return det;
+        detSum = -detLeft - detRight;
+    }
+    else {
+        return det;
+    }
+
+    double errBound = kCcwErrBoundA * detSum;
+    if (det >= errBound || -det >= errBound)
+        return det;
+
+    return orient2dExact(pa, pb, pc);
+}
+
+double incircle(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc, const GeoRawPoint& pd)
+{
+    double adx = pa.x - pd.x, ady = pa.y - pd.y;
+    double bdx = pb.x - pd.x, bdy = pb.y - pd.y;
+    double cdx = pc.x - pd.x, cdy = pc.y - pd.y;
+
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double alift = adx * adx + ady * ady;
+
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double blift = bdx * bdx + bdy * bdy;
+
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+    double clift = cdx * cdx + cdy * cdy;
+
+    double det = alift * (bdxcdy - cdxbdy)
+               + blift * (cdxady - adxcdy)
+               + clift * (adxbdy - bdxady);
+
+    double permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * alift
+                     + (fabs(cdxady) + fabs(adxcdy)) * blift
+                     + (fabs(adxbdy) + fabs(bdxady)) * clift;
+    double errBound = kIccErrBoundA * permanent;
+    if (det > errBound || -det > errBound)
+        return det;
+
+    return incircleExact(pa, pb, pc, pd);
+}
+
+int orientation(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc)
+{
+    return sign(orient2d(pa, pb, pc));
+}
+
+int inCircleSign(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc, const GeoRawPoint& pd)
+{
+    return sign(incircle(pa, pb, pc, pd));
+}
+
+bool isPointOnSegment(const GeoRawPoint& pt, const GeoRawPoint& segStart, const GeoRawPoint& segEnd)
+{
+    if (pt.x < std::fmin(segStart.x, segEnd.x) || pt.x > std::fmax(segStart.x, segEnd.x)
+        || pt.y < std::fmin(segStart.y, segEnd.y) || pt.y > std::fmax(segStart.y, segEnd.y))
+    {
+        return false;
+    }
+    return orient2d(segStart, segEnd, pt) == 0.0;
+}
+
+bool isSegmentIntersect(const GeoRawPoint& p1, const GeoRawPoint& p2,
+                        const GeoRawPoint& q1, const GeoRawPoint& q2)
+{
+    // Quick rejection by the bounding boxes
+    if (std::fmax(p1.x, p2.x) < std::fmin(q1.x, q2.x) || std::fmax(q1.x, q2.x) < std::fmin(p1.x, p2.x)
+        || std::fmax(p1.y, p2.y) < std::fmin(q1.y, q2.y) || std::fmax(q1.y, q2.y) < std::fmin(p1.y, p2.y))
+    {
+        return false;
+    }
+
+    int o1 = orientation(p1, p2, q1);
+    int o2 = orientation(p1, p2, q2);
+    int o3 = orientation(q1, q2, p1);
+    int o4 = orientation(q1, q2, p2);
+
+    // Proper crossing
+    if (o1 * o2 < 0 && o3 * o4 < 0)
+        return true;
+
+    // Touching or collinear
+    if (o1 == 0 && isPointOnSegment(q1, p1, p2))
+        return true;
+    if (o2 == 0 && isPointOnSegment(q2, p1, p2))
+        return true;
+    if (o3 == 0 && isPointOnSegment(p1, q1, q2))
+        return true;
+    if (o4 == 0 && isPointOnSegment(p2, q1, q2))
+        return true;
+
+    return false;
+}
+
+} // namespace gm
@@ -0,0 +1,50 @@
+/*******************************************************
+** description: Robust geometric predicates
+**                orient2d, incircle
+**
+**              Adaptive: a fast floating-point filter decides
+**                most cases, the exact (expansion arithmetic)
+**                evaluation runs only when the result is
+**                too close to zero to be trusted.
+**
+**              ref: J. R. Shewchuk, "Adaptive Precision
+**                Floating-Point Arithmetic and Fast Robust
+**                Geometric Predicates", 1997
+**
+** last change: 2020-04-03
+*******************************************************/
+#pragma once
+
+#include "geo/geo_base.hpp"
+
+namespace gm {
+
+/* orient2d
+**  > 0 : pa, pb, pc are in counterclockwise order (pc on the left of pa->pb)
+**  < 0 : clockwise (pc on the right)
+**  = 0 : collinear
+** The sign is always correct, the magnitude is an approximation of
+**   twice the signed area of the triangle */
+double orient2d(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc);
+
+/* incircle
+**  > 0 : pd lies inside the circle through pa, pb, pc
+**  < 0 : outside
+**  = 0 : cocircular
+** pa, pb, pc must be in counterclockwise order,
+**   otherwise the sign is reversed */
+double incircle(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc, const GeoRawPoint& pd);
+
+/* Sign of the predicates: -1, 0, 1 */
+int orientation(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc);
+int inCircleSign(const GeoRawPoint& pa, const GeoRawPoint& pb, const GeoRawPoint& pc, const GeoRawPoint& pd);
+
+/* pt lies on the closed segment [segStart, segEnd] (exact) */
+bool isPointOnSegment(const GeoRawPoint& pt, const GeoRawPoint& segStart, const GeoRawPoint& segEnd);
+
+/* Two closed segments share at least one point (exact),
+**   touching and collinear overlapping segments intersect */
+bool isSegmentIntersect(const GeoRawPoint& p1, const GeoRawPoint& p2,
+                        const GeoRawPoint& q1, const GeoRawPoint& q2);
+
+} // namespace gm
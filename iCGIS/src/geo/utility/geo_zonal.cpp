@@ -0,0 +1,313 @@
+#include "geo_zonal.h"
+
+#include "util/logger.h"
+#include "util/parallel.h"
+#include "geo/utility/geo_overlay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace gm {
+
+namespace {
+
+// Blocks per thread between two progress reports
+const int kBlocksPerThread = 4;
+
+// The pixels of a polygon (or of its part in a block)
+struct Zone {
+    long long count = 0;
+    double sum = 0.0;
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = std::numeric_limits<double>::lowest();
+
+    void add(float value) {
+        ++count;
+        sum += value;
+        minValue = std::min(minValue, double(value));
+        maxValue = std::max(maxValue, double(value));
+    }
+
+    void merge(const Zone& rhs) {
+        count += rhs.count;
+        sum += rhs.sum;
+        minValue = std::min(minValue, rhs.minValue);
+        maxValue = std::max(maxValue, rhs.maxValue);
+    }
+};
+
+// Pixels per value, for the majority
+using ValueCounts = std::unordered_map<float, long long>;
+
+// An edge of a ring, in pixels of the block
+struct Edge {
+    double x0, y0;
+    double x1, y1;
+};
+
+// Call func(offset) for every pixel of the block whose center is inside
+//  the rings (even-odd rule)
+// The edges out of the block on the left or right are needed: they
+//  change the parity of the crossings
+template<typename Func>
+void scanRings(const std::vector<Edge>& edges, int width, int height, Func func)
+{
+    double minY = std::numeric_limits<double>::max();
+    double maxY = std::numeric_limits<double>::lowest();
+    for (const Edge& edge : edges) {
+        minY = std::min(minY, std::min(edge.y0, edge.y1));
+        maxY = std::max(maxY, std::max(edge.y0, edge.y1));
+    }
+    int firstRow = int(std::max(0.0, std::floor(minY)));
+    int lastRow = int(std::min(double(height), std::ceil(maxY)));
+
+    std::vector<double> crossings;
+    for (int j = firstRow; j < lastRow; ++j) {
+        double y = j + 0.5;
+        crossings.clear();
+        for (const Edge& edge : edges) {
+            // Half-open, a vertex on the scanline is counted once
+            if ((edge.y0 <= y) != (edge.y1 <= y))
+                crossings.push_back(edge.x0 + (y - edge.y0) * (edge.x1 - edge.x0) / (edge.y1 - edge.y0));
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        size_t rowOffset = size_t(j) * width;
+        for (size_t k = 0; k + 1 < crossings.size(); k += 2) {
+            // The pixels whose center is in [crossings[k], crossings[k + 1])
+            int i0 = int(std::min(double(width), std::max(0.0, std::ceil(crossings[k] - 0.5))));
+            int i1 = int(std::min(double(width), std::max(0.0, std::ceil(crossings[k + 1] - 0.5))));
+            for (int i = i0; i < i1; ++i)
+                func(rowOffset + i);
+        }
+    }
+}
+
+// Add a field, or reuse the existing one with the same name if it has
+//   the same type
+int addTypedField(GeoFeatureLayer* layer, const QString& name, GeoFieldType type)
+{
+    QString fieldName = name;
+    for (int suffix = 1; ; ++suffix) {
+        GeoFieldDefn* fieldDefn = layer->getFieldDefn(fieldName);
+        if (!fieldDefn)
+            return layer->addField(fieldName, 20, type);
+        if (fieldDefn->getType() == type)
+            return layer->getFieldIndex(fieldName);
+        fieldName = name + "_" + QString::number(suffix);
+    }
+}
+
+} // anonymous namespace
+
+
+int zonalStatistics(GeoFeatureLayer* layer, const GeoRasterBand* band, int statistics,
+                    const QString& prefix /*= "ZS_"*/,
+                    GDALProgressFunc progress /*= nullptr*/, void* progressArg /*= nullptr*/)
+{
+    if (!layer || !band || statistics == 0)
+        return -1;
+
+    const double* gt = band->geoTransform;
+    if (gt[2] != 0.0 || gt[4] != 0.0 || gt[1] == 0.0 || gt[5] == 0.0) {
+        LError("Zonal statistics: rotated rasters are not supported");
+        return -1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    GeoRasterSource::Level level = band->getLevel(0);
+    int blocksX = level.getBlocksX();
+    int blocksY = level.getBlocksY();
+    int featuresCount = layer->getFeatureCount();
+
+    // The polygons in each block, by their extents
+    std::vector<std::vector<int>> blockFeatures(size_t(blocksX) * blocksY);
+    for (int f = 0; f < featuresCount; ++f) {
+        GeoFeature* feature = layer->getFeature(f);
+        GeometryType type = feature->getGeometryType();
+        if (feature->isDeleted() || (type != kPolygon && type != kMultiPolygon))
+            continue;
+
+        const GeoExtent& extent = feature->getExtent();
+        double col0 = (extent.minX - gt[0]) / gt[1];
+        double col1 = (extent.maxX - gt[0]) / gt[1];
+        double row0 = (extent.maxY - gt[3]) / gt[5];
+        double row1 = (extent.minY - gt[3]) / gt[5];
+        double minCol = std::min(col0, col1), maxCol = std::max(col0, col1);
+        double minRow = std::min(row0, row1), maxRow = std::max(row0, row1);
+        if (maxCol < 0.0 || minCol >= level.width || maxRow < 0.0 || minRow >= level.height)
+            continue;
+
+        int firstBlockX = int(std::max(0.0, minCol)) / level.blockXSize;
+        int lastBlockX = int(std::min(level.width - 1.0, maxCol)) / level.blockXSize;
+        int firstBlockY = int(std::max(0.0, minRow)) / level.blockYSize;
+        int lastBlockY = int(std::min(level.height - 1.0, maxRow)) / level.blockYSize;
+        for (int by = firstBlockY; by <= lastBlockY; ++by) {
+            for (int bx = firstBlockX; bx <= lastBlockX; ++bx)
+                blockFeatures[size_t(by) * blocksX + bx].push_back(f);
+        }
+    }
+
+    // Only the blocks under a polygon are read
+    std::vector<int> blocks;
+    for (size_t b = 0; b < blockFeatures.size(); ++b) {
+        if (!blockFeatures[b].empty())
+            blocks.push_back(int(b));
+    }
+
+    bool majority = (statistics & kZonalMajority) != 0;
+    std::vector<Zone> zones(featuresCount);
+    std::vector<ValueCounts> valueCounts(majority ? featuresCount : 0);
+    std::mutex mergeMutex;
+
+    int blocksCount = int(blocks.size());
+    int batchSize = utils::getNumThreads() * kBlocksPerThread;
+    bool ok = true;
+    bool canceled = false;
+    for (int first = 0; first < blocksCount && ok && !canceled; first += batchSize) {
+        int last = std::min(blocksCount, first + batchSize);
+        std::vector<char> blocksOk(last - first, 0);
+        utils::parallelFor(first, last, [&](int k) {
+            int blockIndex = blocks[k];
+            int blockX = blockIndex % blocksX;
+            int blockY = blockIndex / blocksX;
+            std::vector<float> pixels;
+            int blockWidth = 0, blockHeight = 0;
+            if (!band->readBlock(0, blockX, blockY, pixels, blockWidth, blockHeight, false))
+                return;
+
+            // The pixels of the block: (column - xOff, row - yOff)
+            double xOff = double(blockX) * level.blockXSize;
+            double yOff = double(blockY) * level.blockYSize;
+            const std::vector<int>& featureIndices = blockFeatures[blockIndex];
+            std::vector<Zone> blockZones(featureIndices.size());
+            std::vector<ValueCounts> blockCounts(majority ? featureIndices.size() : 0);
+            RingList rings;
+            std::vector<Edge> edges;
+            for (size_t n = 0; n < featureIndices.size(); ++n) {
+                rings.clear();
+                collectRings(layer->getFeature(featureIndices[n])->getGeometry(), rings);
+                edges.clear();
+                for (const auto& ring : rings) {
+                    size_t pointsCount = ring.size();
+                    for (size_t p = 0; p < pointsCount; ++p) {
+                        const GeoRawPoint& a = ring[p];
+                        const GeoRawPoint& b = ring[(p + 1) % pointsCount];
+                        Edge edge = { (a.x - gt[0]) / gt[1] - xOff, (a.y - gt[3]) / gt[5] - yOff,
+                                      (b.x - gt[0]) / gt[1] - xOff, (b.y - gt[3]) / gt[5] - yOff };
+                        // Crosses no scanline of the block
+                        if (std::max(edge.y0, edge.y1) < 0.0 || std::min(edge.y0, edge.y1) > blockHeight)
+                            continue;
+                        edges.push_back(edge);
+                    }
+                }
+                if (edges.empty())
+                    continue;
+
+                Zone& zone = blockZones[n];
+                scanRings(edges, blockWidth, blockHeight, [&](size_t offset) {
+                    float value = pixels[offset];
+                    if (std::isnan(value))
+                        return;
+                    zone.add(value);
+                    if (majority)
+                        ++blockCounts[n][value];
+                });
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                for (size_t n = 0; n < featureIndices.size(); ++n) {
+                    int f = featureIndices[n];
+                    zones[f].merge(blockZones[n]);
+                    if (majority) {
+                        for (const auto& valueCount : blockCounts[n])
+                            valueCounts[f][valueCount.first] += valueCount.second;
+                    }
+                }
+            }
+            blocksOk[k - first] = 1;
+        }, 1);
+
+        if (std::find(blocksOk.begin(), blocksOk.end(), 0) != blocksOk.end()) {
+            LError("Zonal statistics: read the blocks of the raster failed");
+            ok = false;
+        }
+        if (progress && !progress(double(last) / blocksCount, "", progressArg))
+            canceled = true;
+    }
+    if (!ok || canceled) {
+        if (canceled)
+            LInfo("Zonal statistics canceled");
+        return -1;
+    }
+
+    // Create all fields first, so the workers only write values
+    int countIdx = -1, sumIdx = -1, meanIdx = -1, minIdx = -1, maxIdx = -1, majorityIdx = -1;
+    if (statistics & kZonalCount)
+        countIdx = addTypedField(layer, prefix + "COUNT", kFieldInt);
+    if (statistics & kZonalSum)
+        sumIdx = addTypedField(layer, prefix + "SUM", kFieldDouble);
+    if (statistics & kZonalMean)
+        meanIdx = addTypedField(layer, prefix + "MEAN", kFieldDouble);
+    if (statistics & kZonalMin)
+        minIdx = addTypedField(layer, prefix + "MIN", kFieldDouble);
+    if (statistics & kZonalMax)
+        maxIdx = addTypedField(layer, prefix + "MAX", kFieldDouble);
+    if (majority)
+        majorityIdx = addTypedField(layer, prefix + "MAJOR", kFieldDouble);
+
+    // Make sure all features hold the new values before writing in parallel
+    for (int f = 0; f < featuresCount; ++f)
+        layer->getFeature(f)->initNewFieldValue();
+
+    utils::parallelFor(0, featuresCount, [&](int f) {
+        GeoFeature* feature = layer->getFeature(f);
+        const Zone& zone = zones[f];
+        bool empty = zone.count == 0;
+
+        if (countIdx != -1)
+            feature->setField(countIdx, int(std::min<long long>(zone.count, INT_MAX)));
+        if (sumIdx != -1)
+            feature->setField(sumIdx, zone.sum);
+        if (meanIdx != -1)
+            feature->setField(meanIdx, empty ? 0.0 : zone.sum / zone.count);
+        if (minIdx != -1)
+            feature->setField(minIdx, empty ? 0.0 : zone.minValue);
+        if (maxIdx != -1)
+            feature->setField(maxIdx, empty ? 0.0 : zone.maxValue);
+        if (majorityIdx != -1) {
+            // The smallest of the most frequent values
+            double majorityValue = 0.0;
+            long long majorityCount = 0;
+            for (const auto& valueCount : valueCounts[f]) {
+                if (valueCount.second > majorityCount
+                    || (valueCount.second == majorityCount && valueCount.first < majorityValue))
+                {
+                    majorityValue = valueCount.first;
+                    majorityCount = valueCount.second;
+                }
+            }
+            feature->setField(majorityIdx, majorityValue);
+        }
+    });
+
+    int zonesCount = int(std::count_if(zones.begin(), zones.end(),
+                                       [](const Zone& zone) { return zone.count > 0; }));
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("Zonal statistics: {0} features, {1} of {2} blocks read, in {3} ms", zonesCount,
+          blocksCount, blocksX * blocksY,
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+    return zonesCount;
+}
+
+} // namespace gm
@@ -0,0 +1,49 @@
+/*******************************************************
+** description: Zonal statistics, the values of a raster
+**                band summarized per polygon feature
+**
+**              The band is walked by its blocks. The features
+**                are first bucketed into the blocks their extents
+**                touch, the blocks without a feature are never
+**                read. The blocks are processed in parallel: a
+**                block is read once, every polygon over it is
+**                rasterized by scanlines (even-odd rule, a pixel
+**                belongs to a polygon if its center does) and its
+**                pixels accumulated
+**
+**              The polygons must be in the coordinate system of
+**                the raster, nodata pixels are skipped
+**
+** last change: 2020-04-09
+*******************************************************/
+#pragma once
+
+#include "geo/map/geolayer.h"
+
+#include <gdal/gdal.h>
+
+
+namespace gm {
+
+enum ZonalStatistic {
+    kZonalCount     = 0x01,
+    kZonalSum       = 0x02,
+    kZonalMean      = 0x04,
+    kZonalMin       = 0x08,
+    kZonalMax       = 0x10,
+    kZonalMajority  = 0x20,     // the most frequent value, for classes
+    kZonalAll       = 0x3F
+};
+
+/* Statistics of the pixels of `band` inside every polygon of `layer`
+**   written to (new) fields of the layer, `prefix` + COUNT (int),
+**   SUM, MEAN, MIN, MAX, MAJOR (double)
+** A feature without a pixel gets a count of 0 and 0 elsewhere
+** Canceled if the progress returns FALSE
+** Return the number of features with at least one pixel, -1 on
+**   error or if canceled (the fields are then not written) */
+int zonalStatistics(GeoFeatureLayer* layer, const GeoRasterBand* band, int statistics,
+                    const QString& prefix = "ZS_",
+                    GDALProgressFunc progress = nullptr, void* progressArg = nullptr);
+
+} // namespace gm
@@ -1,299 +1,999 @@
 #include "geo/utility/geojson.h"
+#include "geo/utility/json_sax.h"
 #include "geo/map/geolayer.h"
 #include "util/logger.h"
+#include "util/mappedfile.h"
+#include "util/parallel.h"
 
+#include <cstring>
 #include <fstream>
-#include <QDebug>
-
-
-bool GeoJson::parse(const std::string& filename, GeoFeatureLayer* layer)
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+/* Builds the features from the parsing events
+**
+** The path in the document is tracked with a stack of frames,
+**   only the values under root / features[] / geometry and
+**   properties are used, everything else is skipped.
+**
+** The coordinates are collected as a flat list of (x, y) plus the
+**   number of children of every array at each nesting level, the
+**   geometry is built when its object ends (the "type" key may come
+**   after "coordinates"). */
+class GeoJsonHandler : public JsonSaxHandler {
+public:
+    /* The features are added to the layer, or to featuresOut if given
+    **   (then every root object is taken as a feature) */
+    explicit GeoJsonHandler(GeoFeatureLayer* layerIn, std::vector<GeoFeature*>* featuresOutIn = nullptr)
+        : layer(layerIn), featuresOut(featuresOutIn) {}
+    ~GeoJsonHandler() { delete geometry; }
+
+    /* Use the fields already in the layer instead of those of the
+    **   first feature */
+    void useLayerFields();
+
+    bool startObject() override;
+    bool endObject() override;
+    bool startArray() override;
+    bool endArray() override;
+    bool key(const char* str, int len) override;
+    bool string(const char* str, int len) override;
+    bool number(double value, bool isInteger) override;
+    bool boolean(bool value) override;
+    bool null() override;
+
+    int getNumRoots() const { return rootsCount; }
+    int getNumSkipped() const { return skippedCount; }
+    // Type of the first root which is neither a Feature nor a FeatureCollection
+    const std::string& getUnsupportedType() const { return unsupportedType; }
+
+private:
+    enum FrameType {
+        kFrameRoot,
+        kFrameFeatures,
+        kFrameFeature,
+        kFrameGeometry,
+        kFrameCoordinates,
+        kFrameProperties,
+        kFrameIgnore
+    };
+
+    struct Frame {
+        FrameType type;
+        int level;      // nesting level of coordinates arrays, from 1
+        int count;      // child arrays
+        int numbers;    // child numbers
+    };
+
+    enum PropertyType {
+        kPropertyInt,
+        kPropertyDouble,
+        kPropertyText,
+        kPropertyBool,
+        kPropertyOther
+    };
+
+    struct Property {
+        std::string key;
+        PropertyType type;
+        double number;
+        std::string text;
+    };
+
+    static constexpr int kMaxCoordinatesLevel = 4;
+
+    // A value (scalar or container) is met in the current frame
+    Frame* top() { return frames.empty() ? nullptr : &frames.back(); }
+    bool isFeatureFrame(const Frame* frame) const
+        { return frame && (frame->type == kFrameFeature || frame->type == kFrameRoot); }
+    Property* addProperty(PropertyType type);
+
+    void resetFeature();
+    bool buildGeometry();
+    void finishFeature();
+    void createFields();
+
+private:
+    GeoFeatureLayer* layer = nullptr;
+    std::vector<GeoFeature*>* featuresOut = nullptr;
+
+    std::vector<Frame> frames;
+    std::string lastKey;
+    std::string rootType;
+    int rootsCount = 0;
+    std::string unsupportedType;
+
+    // Current feature
+    std::string geometryType;
+    GeoGeometry* geometry = nullptr;
+    std::vector<double> coords;
+    std::vector<int> counts[kMaxCoordinatesLevel + 1];
+    int positionLevel = 0;
+    bool isCoordinatesValid = true;
+    std::vector<Property> properties;
+    int propertiesCount = 0;
+
+    // Fields, from the first feature
+    bool isSchemaReady = false;
+    std::vector<std::string> fieldNames;
+    std::vector<int> fieldIndices;
+    std::unordered_map<std::string, int> fieldIndexByName;
+
+    int skippedCount = 0;
+};
+
+
+bool GeoJsonHandler::startObject()
 {
-    if (!layer) {
-        LError("Input layer is null");
-        return false;
+    Frame* frame = top();
+    if (!frame) {
+        frames.push_back({ kFrameRoot, 0, 0, 0 });
+        rootType.clear();
+        resetFeature();
     }
-
-    std::ifstream ifs(filename);
-    if (!ifs.is_open()) {
-        LError("Open GeoJson Error");
-        return false;
+    else if (frame->type == kFrameFeatures) {
+        frames.push_back({ kFrameFeature, 0, 0, 0 });
+        resetFeature();
     }
+    else if (isFeatureFrame(frame) && lastKey == "geometry") {
+        frames.push_back({ kFrameGeometry, 0, 0, 0 });
+    }
+    else if (isFeatureFrame(frame) && lastKey == "properties") {
+        frames.push_back({ kFrameProperties, 0, 0, 0 });
+    }
+    else {
+        if (frame->type == kFrameCoordinates)
+            isCoordinatesValid = false;
+        else if (frame->type == kFrameProperties)
+            addProperty(kPropertyOther);
+        frames.push_back({ kFrameIgnore, 0, 0, 0 });
+    }
+    return true;
+}
 
-    Json::Reader reader;
-    Json::Value  root;
-    bool ret = false;
-
-    do {
-        if (!reader.parse(ifs, root, false))
-            break;
-        if (root["type"].isNull())
-            break;
+bool GeoJsonHandler::endObject()
+{
+    Frame frame = frames.back();
+    frames.pop_back();
+    switch (frame.type) {
+    default:
+        break;
+    case kFrameGeometry:
+        delete geometry;
+        geometry = nullptr;
+        if (!buildGeometry()) {
+            delete geometry;
+            geometry = nullptr;
+        }
+        break;
+    case kFrameFeature:
+        finishFeature();
+        break;
+    case kFrameRoot:
+        ++rootsCount;
+        if (rootType == "Feature" || (featuresOut && rootType != "FeatureCollection"))
+            finishFeature();
+        else if (rootType != "FeatureCollection" && unsupportedType.empty())
+            unsupportedType = rootType.empty() ? "unknown" : rootType;
+        break;
+    }
+    return true;
+}
 
-        std::string type = root["type"].asString();
+bool GeoJsonHandler::startArray()
+{
+    Frame* frame = top();
+    if (!frame) {
+        frames.push_back({ kFrameIgnore, 0, 0, 0 });    // not an object
+    }
+    else if (frame->type == kFrameRoot && lastKey == "features") {
+        frames.push_back({ kFrameFeatures, 0, 0, 0 });
+    }
+    else if (frame->type == kFrameGeometry && lastKey == "coordinates") {
+        coords.clear();
+        for (auto& levelCounts : counts)
+            levelCounts.clear();
+        positionLevel = 0;
+        isCoordinatesValid = true;
+        frames.push_back({ kFrameCoordinates, 1, 0, 0 });
+    }
+    else if (frame->type == kFrameCoordinates && frame->level < kMaxCoordinatesLevel) {
+        if (frame->numbers > 0)
+            isCoordinatesValid = false;
+        ++frame->count;
+        frames.push_back({ kFrameCoordinates, frame->level + 1, 0, 0 });
+    }
+    else {
+        if (frame->type == kFrameCoordinates)
+            isCoordinatesValid = false;
+        else if (frame->type == kFrameProperties)
+            addProperty(kPropertyOther);
+        frames.push_back({ kFrameIgnore, 0, 0, 0 });
+    }
+    return true;
+}
 
-        if (type == "FeatureCollection") {
-            ret = parseGeoJsonTypeFeatureCollection(root, layer);
-        }
-        else if (type == "GeometryCollection") {
-            //ret = parseGeoJsonTypeGeometryCollection(root, layer);
-        }
-        else if (type == "feature") {
-            GeoFeature* feature = new GeoFeature(layer);
-            if (ret = parseGeoJsonTypeFeature(root, layer, feature))
-                layer->addFeature(feature);
-            else
-                delete feature;
+bool GeoJsonHandler::endArray()
+{
+    Frame frame = frames.back();
+    frames.pop_back();
+    if (frame.type == kFrameCoordinates) {
+        if (frame.numbers > 0) {
+            // Position: x, y [, z ...]
+            if (frame.numbers < 2 || frame.count > 0)
+                isCoordinatesValid = false;
         }
         else {
-            break;
+            counts[frame.level].push_back(frame.count);
         }
-
-        ret = true;
-    } while (false);
-
-    if (!ret) {
-        LError("Parse GeoJson Error");
     }
-
-    ifs.close();
-    return ret;
+    return true;
 }
 
+bool GeoJsonHandler::key(const char* str, int len)
+{
+    lastKey.assign(str, len);
+    return true;
+}
 
-bool GeoJson::parseGeoJsonTypePoint(const Json::Value& root, GeoPoint* pointOut)
+bool GeoJsonHandler::string(const char* str, int len)
 {
-    if (root["coordinates"].isNull() || !pointOut)
-        return false;
-    else {
-        Json::Value coordinates = root["coordinates"];
-        pointOut->setXY(coordinates[0].asDouble(), coordinates[1].asDouble());
+    Frame* frame = top();
+    if (!frame)
         return true;
+
+    switch (frame->type) {
+    default:
+        break;
+    case kFrameRoot:
+        if (lastKey == "type")
+            rootType.assign(str, len);
+        break;
+    case kFrameGeometry:
+        if (lastKey == "type")
+            geometryType.assign(str, len);
+        break;
+    case kFrameCoordinates:
+        isCoordinatesValid = false;
+        break;
+    case kFrameProperties:
+        addProperty(kPropertyText)->text.assign(str, len);
+        break;
     }
-}
-bool GeoJson::parseGeoJsonTypeMultiPoint(const Json::Value& root, GeoMultiPoint* multiPointOut)
-{
     return true;
 }
 
-bool GeoJson::parseGeoJsonTypeLineString(const Json::Value& coordinates, GeoLineString* lineStringOut)
+bool GeoJsonHandler::number(double value, bool isInteger)
 {
-    if (coordinates.isNull() || !coordinates.isArray() || !lineStringOut)
-        return false;
+    Frame* frame = top();
+    if (!frame)
+        return true;
 
-    for (const Json::Value& coordinate : coordinates) {
-        lineStringOut->addPoint(coordinate[0].asDouble(), coordinate[1].asDouble());
+    if (frame->type == kFrameCoordinates) {
+        if (positionLevel == 0)
+            positionLevel = frame->level;
+        else if (positionLevel != frame->level)
+            isCoordinatesValid = false;
+        // Only x and y are kept
+        if (++frame->numbers <= 2)
+            coords.push_back(value);
+    }
+    else if (frame->type == kFrameProperties) {
+        bool isInt = isInteger && value >= -2147483648.0 && value <= 2147483647.0;
+        addProperty(isInt ? kPropertyInt : kPropertyDouble)->number = value;
     }
     return true;
 }
 
-
-bool GeoJson::parseGeoJsonTypeMultiLineString(const Json::Value& root, GeoMultiLineString* multiLineStringOut)
+bool GeoJsonHandler::boolean(bool value)
 {
-    if (root["coordinates"].isNull() || !root["coordinates"].isArray() || !multiLineStringOut)
-        return false;
-    else {
-        Json::Value coordinates = root["coordinates"];
-        for (const Json::Value& lineString : coordinates) {
-            GeoLineString* geoLineString = nullptr;
-            parseGeoJsonTypeLineString(lineString, geoLineString);
-            multiLineStringOut->addGeometry(geoLineString);
-        }
-        return true;
-    }
+    Frame* frame = top();
+    if (frame && frame->type == kFrameProperties)
+        addProperty(kPropertyBool)->number = value ? 1.0 : 0.0;
+    else if (frame && frame->type == kFrameCoordinates)
+        isCoordinatesValid = false;
+    return true;
 }
 
+bool GeoJsonHandler::null()
+{
+    Frame* frame = top();
+    if (frame && frame->type == kFrameProperties)
+        addProperty(kPropertyOther);
+    else if (frame && frame->type == kFrameCoordinates)
+        isCoordinatesValid = false;
+    return true;
+}
 
-bool GeoJson::parseGeoJsonTypePolygon(const Json::Value& coordinates, GeoPolygon* polygonOut)
+/* The property objects are reused from one feature to the next */
+GeoJsonHandler::Property* GeoJsonHandler::addProperty(PropertyType type)
 {
-    if (coordinates.isNull() || !coordinates.isArray() || !polygonOut)
-        return false;
+    if (propertiesCount == int(properties.size()))
+        properties.emplace_back();
+    Property* property = &properties[propertiesCount++];
+    property->key = lastKey;
+    property->type = type;
+    return property;
+}
 
-    int numRings = coordinates.size();
-    if (numRings == 1) {	// No hole
-        GeoLinearRing* exteriorRing = new GeoLinearRing();
-        for (const Json::Value& coordinate : coordinates[0])
-            exteriorRing->addPoint(coordinate[0].asDouble(), coordinate[1].asDouble());
-        polygonOut->setExteriorRing(exteriorRing);
-    }
-    else {		// With hole
-        polygonOut->reserveInteriorRingsCount(numRings - 1);
-        GeoLinearRing* exteriorRing = new GeoLinearRing();
-        for (const Json::Value& coordinate : coordinates[0])
-            exteriorRing->addPoint(coordinate[0].asDouble(), coordinate[1].asDouble());
-        polygonOut->setExteriorRing(exteriorRing);
-        for (int i = 1; i < numRings; ++i) {
-            GeoLinearRing* interiorRing = new GeoLinearRing();
-            for (const Json::Value& coordinate : coordinates[i])
-                interiorRing->addPoint(coordinate[0].asDouble(), coordinate[1].asDouble());
-            polygonOut->addInteriorRing(interiorRing);
-        }
-    }
-    return true;
+void GeoJsonHandler::resetFeature()
+{
+    geometryType.clear();
+    delete geometry;
+    geometry = nullptr;
+    propertiesCount = 0;
 }
 
 
-bool GeoJson::parseGeoJsonTypeMultiPolygon(const Json::Value& coordinates, GeoMultiPolygon* multiPolygonOut)
+/****************************************/
+/*                                      */
+/*     Geometry                         */
+/*                                      */
+/****************************************/
+
+bool GeoJsonHandler::buildGeometry()
 {
-    if (coordinates.isNull() || !coordinates.isArray() || !multiPolygonOut)
+    int expectedLevel = 0;
+    if (geometryType == "Point")
+        expectedLevel = 1;
+    else if (geometryType == "MultiPoint" || geometryType == "LineString")
+        expectedLevel = 2;
+    else if (geometryType == "Polygon" || geometryType == "MultiLineString")
+        expectedLevel = 3;
+    else if (geometryType == "MultiPolygon")
+        expectedLevel = 4;
+    if (expectedLevel == 0 || !isCoordinatesValid || positionLevel != expectedLevel)
         return false;
 
-    int polygonSize = coordinates.size();
-    multiPolygonOut->reserveNumGeoms(polygonSize);
-    for (const Json::Value& polygonI : coordinates) {
-        GeoPolygon* geoPolygon = new GeoPolygon();
-        parseGeoJsonTypePolygon(polygonI, geoPolygon);
-        multiPolygonOut->addGeometry(geoPolygon);
+    const double* xy = coords.data();
+    auto newRing = [&xy](int pointsCount, GeoLineString* ring) {
+        ring->reserveNumPoints(pointsCount);
+        for (int i = 0; i < pointsCount; ++i, xy += 2)
+            ring->addPoint(xy[0], xy[1]);
+    };
+
+    switch (expectedLevel) {
+    case 1:
+        geometry = new GeoPoint(xy[0], xy[1]);
+        break;
+    case 2: {
+        int pointsCount = counts[1][0];
+        if (geometryType == "LineString") {
+            GeoLineString* lineString = new GeoLineString();
+            newRing(pointsCount, lineString);
+            geometry = lineString;
+        }
+        else {
+            GeoMultiPoint* multiPoint = new GeoMultiPoint();
+            multiPoint->reserveNumGeoms(pointsCount);
+            for (int i = 0; i < pointsCount; ++i, xy += 2)
+                multiPoint->addPoint(new GeoPoint(xy[0], xy[1]));
+            geometry = multiPoint;
+        }
+        break;
+    }
+    case 3: {
+        int partsCount = counts[1][0];
+        if (geometryType == "Polygon") {
+            if (partsCount == 0)
+                return false;
+            GeoPolygon* polygon = new GeoPolygon();
+            geometry = polygon;
+            polygon->reserveInteriorRingsCount(partsCount - 1);
+            for (int i = 0; i < partsCount; ++i) {
+                GeoLinearRing* ring = new GeoLinearRing();
+                newRing(counts[2][i], ring);
+                if (i == 0)
+                    polygon->setExteriorRing(ring);
+                else
+                    polygon->addInteriorRing(ring);
+            }
+        }
+        else {
+            GeoMultiLineString* multiLineString = new GeoMultiLineString();
+            geometry = multiLineString;
+            multiLineString->reserveNumGeoms(partsCount);
+            for (int i = 0; i < partsCount; ++i) {
+                GeoLineString* lineString = new GeoLineString();
+                newRing(counts[2][i], lineString);
+                multiLineString->addGeometry(lineString);
+            }
+        }
+        break;
+    }
+    case 4: {
+        int polygonsCount = counts[1][0];
+        GeoMultiPolygon* multiPolygon = new GeoMultiPolygon();
+        geometry = multiPolygon;
+        multiPolygon->reserveNumGeoms(polygonsCount);
+        int ringIdx = 0;
+        for (int i = 0; i < polygonsCount; ++i) {
+            int ringsCount = counts[2][i];
+            if (ringsCount == 0)
+                return false;
+            GeoPolygon* polygon = new GeoPolygon();
+            multiPolygon->addGeometry(polygon);
+            polygon->reserveInteriorRingsCount(ringsCount - 1);
+            for (int k = 0; k < ringsCount; ++k, ++ringIdx) {
+                GeoLinearRing* ring = new GeoLinearRing();
+                newRing(counts[3][ringIdx], ring);
+                if (k == 0)
+                    polygon->setExteriorRing(ring);
+                else
+                    polygon->addInteriorRing(ring);
+            }
+        }
+        break;
+    }
     }
 
-    return true;
+    return !geometry->isEmpty();
 }
 
 
-bool GeoJson::parseGeoJsonTypeGeometryCollection(const Json::Value& root, GeoGeometryCollection* geometryCollectionOut)
+/****************************************/
+/*                                      */
+/*     Feature                          */
+/*                                      */
+/****************************************/
+
+void GeoJsonHandler::useLayerFields()
 {
-    if (root["geometries"].isNull() || !root["geometries"].isArray() || !geometryCollectionOut) {
-        return false;
+    int fieldsCount = layer->getNumFields();
+    for (int i = 0; i < fieldsCount; ++i) {
+        QByteArray bytes = layer->getFieldDefn(i)->getName().toUtf8();
+        std::string name(bytes.data());
+        fieldIndexByName.emplace(name, i);
+        fieldNames.push_back(name);
+        fieldIndices.push_back(i);
     }
-    else {
-        Json::Value geometries = root["geometries"];
-        for (const Json::Value& geometry : geometries) {
+    isSchemaReady = true;
+}
 
+/* Fields from the properties of the first feature */
+void GeoJsonHandler::createFields()
+{
+    for (int i = 0; i < propertiesCount; ++i) {
+        const Property& property = properties[i];
+        GeoFieldType fieldType;
+        int width = 0;
+        switch (property.type) {
+        default:
+            continue;
+        case kPropertyInt:
+        case kPropertyBool:     // 0 / 1
+            fieldType = kFieldInt;
+            break;
+        case kPropertyDouble:
+            fieldType = kFieldDouble;
+            break;
+        case kPropertyText:
+            fieldType = kFieldText;
+            width = 16;
+            break;
         }
-        return true;
+        QString name = QString::fromUtf8(property.key.data(), property.key.size());
+        int index = layer->addField(new GeoFieldDefn(name, width, fieldType));
+        fieldIndexByName.emplace(property.key, index);
+        fieldNames.push_back(property.key);
+        fieldIndices.push_back(index);
     }
+    isSchemaReady = true;
 }
 
-
-bool GeoJson::parseGeoJsonTypeFeature(const Json::Value& root, GeoFeatureLayer* geoLayerIn, GeoFeature* geoFeatureOut)
+void GeoJsonHandler::finishFeature()
 {
-    if (root["geometry"].isNull() || root["properties"].isNull() || !geoLayerIn)
-        return false;
-    else {
-        Json::Value geometry = root["geometry"];
-        Json::Value properties = root["properties"];
-        if (geometry.isNull() || properties.isNull() || geometry["type"].isNull())
-            return false;
-        std::string geometryType = geometry["type"].asString();
+    if (!isSchemaReady)
+        createFields();
 
-        if (!geoFeatureOut)
-            return false;
+    if (!geometry) {
+        ++skippedCount;
+        return;
+    }
 
-        /* Properties Table */
-        int fieldsCount = geoFeatureOut->getNumFields();
-        for (int i = 0; i < fieldsCount; ++i) {
-            QByteArray bytes = geoFeatureOut->getFieldName(i).toLocal8Bit();
-            const char* fieldName = bytes.data();
-            if (properties[fieldName].isNull())
-                continue;
-            switch (geoFeatureOut->getFieldType(i)) {
-            default:
-                break;
-            case kFieldInt:
-                geoFeatureOut->setField(fieldName, properties[fieldName].asInt());
-                break;
-            case kFieldDouble:
-                geoFeatureOut->setField(fieldName, properties[fieldName].asDouble());
-                break;
-            case kFieldText:
-                geoFeatureOut->setField(fieldName, QString::fromStdString(properties[fieldName].asString()));
-                break;
-            }
-        }
+    GeoFeature* feature = new GeoFeature(layer);
+    feature->setGeometry(geometry);
+    geometry = nullptr;
 
-        /* Geometry */
-        bool ret = false;
-        if (geometryType == "Point") {
-            GeoPoint* geoPoint = new GeoPoint();
-            ret = parseGeoJsonTypePoint(geometry["coordinates"], geoPoint);
-            geoFeatureOut->setGeometry(geoPoint);
-        }
-        else if (geometryType == "LineString") {
-            GeoLineString* geoLineString = new GeoLineString();
-            ret = parseGeoJsonTypeLineString(geometry["coordinates"], geoLineString);
-            geoFeatureOut->setGeometry(geoLineString);
+    for (int i = 0; i < propertiesCount; ++i) {
+        const Property& property = properties[i];
+        if (property.type == kPropertyOther)
+            continue;
+
+        // Most files keep the same order of keys in all features
+        int fieldIdx = -1;
+        if (i < int(fieldNames.size()) && fieldNames[i] == property.key) {
+            fieldIdx = fieldIndices[i];
         }
-        else if (geometryType == "Polygon") {
-            GeoPolygon* geoPolygon = new GeoPolygon();
-            ret = parseGeoJsonTypePolygon(geometry["coordinates"], geoPolygon);
-            geoFeatureOut->setGeometry(geoPolygon);
+        else {
+            auto it = fieldIndexByName.find(property.key);
+            if (it == fieldIndexByName.end())
+                continue;
+            fieldIdx = it->second;
         }
-        else if (geometryType == "MultiPoint") {
-            GeoMultiPoint* geoMultiPoint = new GeoMultiPoint();
-            ret = parseGeoJsonTypeMultiPoint(geometry["coordinates"], geoMultiPoint);
-            geoFeatureOut->setGeometry(geoMultiPoint);
+
+        switch (feature->getFieldType(fieldIdx)) {
+        default:
+            break;
+        case kFieldInt:
+            if (property.type != kPropertyText)
+                feature->setField(fieldIdx, int(property.number));
+            break;
+        case kFieldDouble:
+            if (property.type != kPropertyText)
+                feature->setField(fieldIdx, property.number);
+            break;
+        case kFieldText:
+            if (property.type == kPropertyText)
+                feature->setField(fieldIdx, QString::fromUtf8(property.text.data(), property.text.size()));
+            else
+                feature->setField(fieldIdx, QString::number(property.number, 'g', 17));
+            break;
         }
-        else if (geometryType == "MultiLineString") {
-            GeoMultiLineString* geoMultiLineString = new GeoMultiLineString();
-            ret = parseGeoJsonTypeMultiLineString(geometry["coordinates"], geoMultiLineString);
-            geoFeatureOut->setGeometry(geoMultiLineString);
+    }
+
+    feature->updateExtent();
+    if (featuresOut)
+        featuresOut->push_back(feature);
+    else
+        layer->addFeature(feature);
+}
+
+
+
+/****************************************/
+/*                                      */
+/*     Structural scan                  */
+/*                                      */
+/****************************************/
+
+// '"', '{', '}', '[', ']'
+struct StructuralTable {
+    bool values[256] = {};
+    StructuralTable() {
+        for (unsigned char c : { '"', '{', '}', '[', ']' })
+            values[c] = true;
+    }
+    bool operator[](unsigned char c) const { return values[c]; }
+};
+const StructuralTable kStructural;
+
+// Byte range of one feature in the file
+struct FeatureRange {
+    size_t begin;
+    size_t end;
+};
+
+/* Finds the features without parsing them, only the brackets and
+**   the strings are followed (about ten times faster than parsing).
+**
+** A feature is an element of the "features" array of a root object,
+**   or a root object without "features" (a Feature, or one line of a
+**   GeoJSON text sequence).
+**
+** The input can be given block by block. */
+class GeoJsonScanner {
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    /* Scan [data, data + size), which is at `offset` in the file */
+    void scan(const char* data, size_t size, size_t offset, std::vector<FeatureRange>& rangesOut);
+
+    // Start of the feature being scanned (incomplete), npos if none
+    size_t getOpenBegin() const;
+
+    bool isComplete() const { return depth == 0 && !inString; }
+    int getNumRoots() const { return rootsCount; }
+    const std::string& getUnsupportedType() const { return unsupportedType; }
+
+private:
+    void onRootString();
+
+private:
+    int depth = 0;
+    bool inString = false;
+    bool isEscaped = false;
+
+    // Root object
+    size_t rootBegin = npos;
+    bool hasFeatures = false;
+    bool inFeatures = false;
+    std::string rootType;
+    int rootsCount = 0;
+    std::string unsupportedType;
+
+    // Strings of the root object (keys and values), truncated
+    std::string str;
+    std::string lastString;
+    std::string key;
+
+    size_t featureBegin = npos;
+};
+
+void GeoJsonScanner::scan(const char* data, size_t size, size_t offset, std::vector<FeatureRange>& rangesOut)
+{
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        if (inString) {
+            if (depth == 1) {
+                // Keep the beginning of the strings of the root object
+                for (; p < end; ++p) {
+                    char c = *p;
+                    if (isEscaped)
+                        isEscaped = false;
+                    else if (c == '\\')
+                        isEscaped = true;
+                    else if (c == '"')
+                        break;
+                    if (str.size() < 32)
+                        str.push_back(c);
+                }
+            }
+            else {
+                for (; p < end; ++p) {
+                    char c = *p;
+                    if (isEscaped)
+                        isEscaped = false;
+                    else if (c == '\\')
+                        isEscaped = true;
+                    else if (c == '"')
+                        break;
+                }
+            }
+            if (p == end)
+                break;
+            inString = false;
+            if (depth == 1)
+                onRootString();
+            ++p;
+            continue;
         }
-        else if (geometryType == "MultiPolygon") {
-            GeoMultiPolygon* geoMultiPolygon = new GeoMultiPolygon();
-            ret = parseGeoJsonTypeMultiPolygon(geometry["coordinates"], geoMultiPolygon);
-            geoFeatureOut->setGeometry(geoMultiPolygon);
+
+        // Skip the numbers, the commas and ':' below the root object
+        if (depth != 1) {
+            while (p < end && !kStructural[(unsigned char)*p])
+                ++p;
+            if (p == end)
+                break;
         }
-        else
-            ret = false;
 
-        return ret;
+        switch (*p) {
+        default:
+            break;
+        case '"':
+            inString = true;
+            str.clear();
+            break;
+        case '{':
+            if (depth == 0) {
+                rootBegin = offset + (p - data);
+                hasFeatures = false;
+                rootType.clear();
+                key.clear();
+            }
+            else if (depth == 2 && inFeatures) {
+                featureBegin = offset + (p - data);
+            }
+            ++depth;
+            break;
+        case '[':
+            if (depth == 1 && key == "features") {
+                inFeatures = true;
+                hasFeatures = true;
+            }
+            ++depth;
+            break;
+        case '}':
+            --depth;
+            if (depth == 2 && inFeatures && featureBegin != npos) {
+                rangesOut.push_back({ featureBegin, offset + (p - data) + 1 });
+                featureBegin = npos;
+            }
+            else if (depth == 0) {
+                ++rootsCount;
+                if (!hasFeatures)
+                    rangesOut.push_back({ rootBegin, offset + (p - data) + 1 });
+                if (rootType != "Feature" && rootType != "FeatureCollection" && unsupportedType.empty())
+                    unsupportedType = rootType.empty() ? "unknown" : rootType;
+                rootBegin = npos;
+            }
+            break;
+        case ']':
+            --depth;
+            if (depth == 1)
+                inFeatures = false;
+            break;
+        case ':':
+            if (depth == 1)
+                key = lastString;
+            break;
+        case ',':
+            if (depth == 1)
+                key.clear();
+            break;
+        }
+        ++p;
     }
 }
 
-bool GeoJson::parseGeoJsonTypeFeatureCollection(const Json::Value& root, GeoFeatureLayer* layerOut, Json::Value* property /*= nullptr*/)
+/* A key (before ':') or a value (after ':') of the root object */
+void GeoJsonScanner::onRootString()
 {
-    if (root["features"].isNull() || !root["features"].isArray() || !layerOut)
+    if (key.empty())
+        lastString = str;
+    else if (key == "type")
+        rootType = str;
+}
+
+size_t GeoJsonScanner::getOpenBegin() const
+{
+    if (featureBegin != npos)
+        return featureBegin;
+    if (depth > 0 && !hasFeatures)
+        return rootBegin;
+    return npos;
+}
+
+// -1 if the file can't be opened
+long long getFileSize(const std::string& filename)
+{
+    std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+    if (!ifs.is_open())
+        return -1;
+    return (long long)ifs.tellg();
+}
+
+} // anonymous namespace
+
+
+bool GeoJson::parse(const std::string& filename, GeoFeatureLayer* layer)
+{
+    int threadsCount = utils::getNumThreads();
+    if (threadsCount > 1 && getFileSize(filename) >= kParallelThreshold)
+        return parseParallel(filename, layer, threadsCount);
+    else
+        return parseStream(filename, layer);
+}
+
+bool GeoJson::parseStream(const std::string& filename, GeoFeatureLayer* layer)
+{
+    if (!layer) {
+        LError("Input layer is null");
         return false;
+    }
 
-    Json::Value features = root["features"];
-    if (features.isNull() || !features.isArray())
+    GeoJsonHandler handler(layer);
+    JsonSaxParser parser(&handler);
+    parser.setMultipleValues(true);
+
+    // Parse straight from the mapping if possible, block by block otherwise
+    MappedFile mappedFile;
+    bool ok;
+    if (mappedFile.open(filename)) {
+        mappedFile.adviseSequential();
+        if (prefault)
+            mappedFile.startPrefault(kPrefaultAhead);
+
+        // Give back the pages already parsed, so the resident memory
+        //   doesn't grow with the file
+        const size_t pageSize = MappedFile::getPageSize();
+        size_t releasedTo = 0;
+        parser.setProgressCallback([&](size_t offset) {
+            mappedFile.setReadPosition(offset);
+            if (offset > releasedTo + 2 * JsonSaxParser::kBlockSize) {
+                size_t to = (offset - JsonSaxParser::kBlockSize) / pageSize * pageSize;
+                mappedFile.release(releasedTo, to - releasedTo);
+                releasedTo = to;
+            }
+            return true;
+        });
+        ok = parser.parse(mappedFile.data(), mappedFile.size());
+    }
+    else {
+        ok = parser.parseFile(filename);
+    }
+
+    if (!ok) {
+        LError("Parse GeoJson Error: {0}", parser.getError());
         return false;
-    int featureCount = features.size();
-    if (featureCount == 0)
-        return true;
+    }
 
-    /* Properties Table */
-    Json::Value propertyFields = features[0]["properties"];
-    if (propertyFields.isNull())
+    if (handler.getNumRoots() == 0) {
+        LError("Parse GeoJson Error: empty file");
         return false;
+    }
+    if (!handler.getUnsupportedType().empty()) {
+        LError("Parse GeoJson Error: unsupported type \"{0}\"", handler.getUnsupportedType());
+        return false;
+    }
 
-    Json::Value::Members mem = propertyFields.getMemberNames();
-    for (auto it = mem.begin(); it != mem.end(); ++it) {
-        const std::string& keyName = *it;
-        switch (propertyFields[keyName].type()) {
-        default:
-            break;
-        case Json::objectValue:
-            break;
-        case Json::arrayValue:
-            break;
-        case Json::intValue:
-        case Json::uintValue: {
-            GeoFieldDefn* fieldDefn = new GeoFieldDefn(keyName.c_str(), 0, kFieldInt);
-            layerOut->addField(fieldDefn);
-            break;
+    if (handler.getNumSkipped() > 0)
+        LWarn("GeoJson: {0} features skipped (null or unsupported geometry)", handler.getNumSkipped());
+
+    return true;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Parallel                         */
+/*                                      */
+/****************************************/
+bool GeoJson::parseParallel(const std::string& filename, GeoFeatureLayer* layer, int threadsCount)
+{
+    if (!layer) {
+        LError("Input layer is null");
+        return false;
+    }
+
+    // The file is mapped if possible, read with fread otherwise
+    MappedFile mappedFile;
+    bool isMapped = mappedFile.open(filename);
+    FILE* fp = nullptr;
+    if (!isMapped) {
+        fp = fopen(filename.c_str(), "rb");
+        if (!fp) {
+            LError("Open GeoJson Error: {0}", filename);
+            return false;
         }
-        case Json::realValue: {
-            GeoFieldDefn* fieldDefn = new GeoFieldDefn(keyName.c_str(), 0, kFieldDouble);
-            layerOut->addField(fieldDefn);
-            break;
+    }
+
+    threadsCount = std::max(threadsCount, 1);
+    const int tasksPerThread = 4;
+
+    // The file is read window by window, the complete features of a window
+    //   are parsed in parallel, the incomplete one is moved to the next
+    size_t windowSize = threadsCount * kWindowSizePerThread;
+    long long fileSize = isMapped ? (long long)mappedFile.size() : getFileSize(filename);
+    if (fileSize >= 0 && (unsigned long long)fileSize < windowSize)
+        windowSize = size_t(fileSize) + 1;
+    std::vector<char> window(isMapped ? 0 : windowSize);
+    size_t windowOffset = 0;    // offset of the window in the file
+    size_t windowUsed = 0;
+    size_t releasedTo = 0;      // the mapped pages before it are given back
+    GeoJsonScanner scanner;
+    std::vector<FeatureRange> ranges;
+    bool isSchemaReady = false;
+    int skippedCount = 0;
+    std::string errorMsg;
+
+    if (isMapped) {
+        mappedFile.adviseSequential();
+        if (prefault)
+            mappedFile.startPrefault(windowSize);
+    }
+
+    for (;;) {
+        size_t readOffset = windowOffset + windowUsed;
+        size_t bytesRead;
+        if (isMapped) {
+            // The window is a view of the mapping, nothing is copied
+            bytesRead = std::min(windowSize, mappedFile.size() - readOffset);
+            mappedFile.adviseWillNeed(readOffset + bytesRead, windowSize);
+        }
+        else {
+            bytesRead = fread(window.data() + windowUsed, 1, window.size() - windowUsed, fp);
         }
-        case Json::stringValue: {
-            GeoFieldDefn* fieldDefn = new GeoFieldDefn(keyName.c_str(), 16, kFieldText);
-            layerOut->addField(fieldDefn);
+        const char* windowData = isMapped ? mappedFile.data() + windowOffset : window.data();
+        scanner.scan(windowData + windowUsed, bytesRead, readOffset, ranges);
+        windowUsed += bytesRead;
+        auto at = [windowData, windowOffset](size_t offset) {
+            return windowData + (offset - windowOffset);
+        };
+
+        // The fields come from the first feature, parse it alone
+        if (!isSchemaReady && !ranges.empty()) {
+            std::vector<GeoFeature*> features;
+            GeoJsonHandler handler(layer, &features);
+            JsonSaxParser parser(&handler);
+            if (!parser.parse(at(ranges[0].begin), ranges[0].end - ranges[0].begin)) {
+                errorMsg = parser.getError();
+                break;
+            }
+            for (auto& feature : features)
+                layer->addFeature(feature);
+            skippedCount += handler.getNumSkipped();
+            ranges.erase(ranges.begin());
+            isSchemaReady = true;
+        }
+
+        // Consecutive features in one task, about the same number of bytes
+        int rangesCount = ranges.size();
+        int tasksCount = std::min(rangesCount, threadsCount * tasksPerThread);
+        if (tasksCount > 0) {
+            std::vector<int> taskBegins(tasksCount + 1, rangesCount);
+            size_t totalBytes = ranges.back().end - ranges.front().begin;
+            for (int t = 0, k = 0; t < tasksCount; ++t) {
+                size_t target = ranges.front().begin + totalBytes * t / tasksCount;
+                while (k < rangesCount && ranges[k].end <= target)
+                    ++k;
+                taskBegins[t] = t == 0 ? 0 : std::max(k, taskBegins[t - 1]);
+            }
+
+            std::vector<std::vector<GeoFeature*>> taskFeatures(tasksCount);
+            std::vector<std::string> taskErrors(tasksCount);
+            std::vector<int> taskSkipped(tasksCount, 0);
+            utils::parallelFor(0, tasksCount, [&](int t) {
+                int first = taskBegins[t];
+                int last = taskBegins[t + 1];
+                if (first >= last)
+                    return;
+                GeoJsonHandler handler(layer, &taskFeatures[t]);
+                handler.useLayerFields();
+                JsonSaxParser parser(&handler);
+                parser.setMultipleValues(true);     // the commas between features
+                size_t begin = ranges[first].begin;
+                if (!parser.parse(at(begin), ranges[last - 1].end - begin))
+                    taskErrors[t] = parser.getError() + " (from offset " + std::to_string(begin) + ")";
+                taskSkipped[t] = handler.getNumSkipped();
+            }, 1);
+
+            // Merge in order, so the FIDs don't depend on the threads
+            for (int t = 0; t < tasksCount; ++t) {
+                if (errorMsg.empty() && !taskErrors[t].empty())
+                    errorMsg = taskErrors[t];
+                for (auto& feature : taskFeatures[t]) {
+                    if (errorMsg.empty())
+                        layer->addFeature(feature);
+                    else
+                        delete feature;
+                }
+                skippedCount += taskSkipped[t];
+            }
+            if (!errorMsg.empty())
+                break;
+        }
+        ranges.clear();
+
+        if (bytesRead == 0)
             break;
+
+        // Keep the incomplete feature, a larger window if it is too long
+        size_t keepFrom = scanner.getOpenBegin();
+        if (keepFrom == GeoJsonScanner::npos)
+            keepFrom = windowOffset + windowUsed;
+        size_t keep = windowOffset + windowUsed - keepFrom;
+        if (isMapped) {
+            static const size_t pageSize = MappedFile::getPageSize();
+            size_t to = keepFrom / pageSize * pageSize;
+            if (to > releasedTo) {
+                mappedFile.release(releasedTo, to - releasedTo);
+                releasedTo = to;
+            }
+            mappedFile.setReadPosition(keepFrom);
         }
+        else {
+            if (keep > 0)
+                memmove(window.data(), window.data() + (keepFrom - windowOffset), keep);
+            if (keep > window.size() / 2)
+                window.resize(window.size() * 2);
         }
+        windowOffset = keepFrom;
+        windowUsed = keep;
     }
 
-    for (const Json::Value& feature : features) {
-        GeoFeature* geoFeature = new GeoFeature(layerOut);
-        if (!parseGeoJsonTypeFeature(feature, layerOut, geoFeature)) {
-            delete geoFeature;
-            return false;
-        }
-        geoFeature->updateExtent();
-        layerOut->addFeature(geoFeature);
+    if (fp)
+        fclose(fp);
+
+    if (errorMsg.empty()) {
+        if (!scanner.isComplete())
+            errorMsg = "Unexpected end of file";
+        else if (scanner.getNumRoots() == 0)
+            errorMsg = "empty file";
+        else if (!scanner.getUnsupportedType().empty())
+            errorMsg = "unsupported type \"" + scanner.getUnsupportedType() + "\"";
     }
+    if (!errorMsg.empty()) {
+        LError("Parse GeoJson Error: {0}", errorMsg);
+        return false;
+    }
+
+    if (skippedCount > 0)
+        LWarn("GeoJson: {0} features skipped (null or unsupported geometry)", skippedCount);
 
     return true;
 }
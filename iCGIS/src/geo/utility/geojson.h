@@ -1,14 +1,36 @@
 /*************************************************************
 ** class name:  GeoJson
 **
-** description: Parse json file using JsonCPP library
+** description: Read GeoJSON file (FeatureCollection or Feature)
 **
-** last change: 2020-01-02
+**              The file is parsed as a stream of events
+**                (json_sax.h), each feature is converted into
+**                a GeoFeature as soon as it is complete, so the
+**                whole document is never held in memory.
+**
+**              Large files are parsed in parallel: a quick scan of
+**                the brackets finds the features, consecutive
+**                features are parsed by several threads, then
+**                added to the layer in the order of the file, so
+**                the FIDs are the same as with one thread.
+**
+**              The file is memory-mapped (mappedfile.h) and parsed
+**                in place, the pages already parsed are given back,
+**                so the memory used doesn't grow with the file.
+**                Files that can't be mapped are read block by block.
+**
+**              GeoJSON text sequences (one feature per line, or
+**                separated by 0x1E) are read as well.
+**
+**              The fields are those of the first feature's
+**                properties (int, double, text). Features with
+**                a null or unsupported geometry are skipped.
+**
+** last change: 2020-04-08
 *************************************************************/
 #pragma once
 
 #include <string>
-#include <jsoncpp/json/json.h>
 
 #include "geo/map/geolayer.h"
 #include "geo/geometry/geogeometry.h"
@@ -16,16 +38,31 @@
 
 class GeoJson {
 public:
+    /* In parallel if the file is large and there are several cores */
     bool parse(const std::string& filename, GeoFeatureLayer* layer);
 
+    /* One thread, parsed from the mapping or read block by block */
+    bool parseStream(const std::string& filename, GeoFeatureLayer* layer);
+
+    /* Scan, then parse the features with threadsCount threads */
+    bool parseParallel(const std::string& filename, GeoFeatureLayer* layer, int threadsCount);
+
+    /* Touch the pages in a background thread ahead of the parser,
+    **   faster on cold files (not yet in the page cache) */
+    void setPrefault(bool b) { prefault = b; }
+
+    // Files larger than this are parsed in parallel
+    static constexpr long long kParallelThreshold = 64LL << 20;
+
+    // Bytes read at once for each thread
+    static constexpr size_t kWindowSizePerThread = 16 << 20;
+
+    // How far the pre-fault thread may go ahead of the parser
+    static constexpr size_t kPrefaultAhead = 32 << 20;
+
+    // Files larger than this are pre-faulted (see FileReader)
+    static constexpr long long kPrefaultThreshold = 16LL << 20;
+
 private:
-    bool parseGeoJsonTypePoint(const Json::Value& root, GeoPoint* pointOut);
-    bool parseGeoJsonTypeMultiPoint(const Json::Value& root, GeoMultiPoint* multiPointOut);
-    bool parseGeoJsonTypeLineString(const Json::Value& root, GeoLineString* lineStringOut);
-    bool parseGeoJsonTypeMultiLineString(const Json::Value& root, GeoMultiLineString* multiLineStringOut);
-    bool parseGeoJsonTypePolygon(const Json::Value& root, GeoPolygon* polygonOut);
-    bool parseGeoJsonTypeMultiPolygon(const Json::Value& root, GeoMultiPolygon* multiPolygonOut);
-    bool parseGeoJsonTypeGeometryCollection(const Json::Value& root, GeoGeometryCollection* geometryCollectionOut);
-    bool parseGeoJsonTypeFeature(const Json::Value& root, GeoFeatureLayer* geoLayerIn, GeoFeature* geoFeatureOut);
-    bool parseGeoJsonTypeFeatureCollection(const Json::Value& root, GeoFeatureLayer* layer, Json::Value* property = nullptr);
+    bool prefault = false;
 };
@@ -0,0 +1,524 @@
+#include "geo/utility/json_sax.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace {
+
+// Exactly representable powers of ten
+const double kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool isNumberChar(char c) {
+    return isDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 4 hex digits, -1 if invalid
+int parseHex4(const char* p) {
+    int value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int h = hexValue(p[i]);
+        if (h < 0)
+            return -1;
+        value = (value << 4) | h;
+    }
+    return value;
+}
+
+void appendUtf8(unsigned int code, std::string& out) {
+    if (code < 0x80) {
+        out.push_back(char(code));
+    }
+    else if (code < 0x800) {
+        out.push_back(char(0xC0 | (code >> 6)));
+        out.push_back(char(0x80 | (code & 0x3F)));
+    }
+    else if (code < 0x10000) {
+        out.push_back(char(0xE0 | (code >> 12)));
+        out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (code & 0x3F)));
+    }
+    else {
+        out.push_back(char(0xF0 | (code >> 18)));
+        out.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (code & 0x3F)));
+    }
+}
+
+// Decode the escapes of [p, end) (without the quotes)
+bool unescape(const char* p, const char* end, std::string& out) {
+    out.clear();
+    while (p < end) {
+        const char* q = p;
+        while (q < end && *q != '\\')
+            ++q;
+        out.append(p, q);
+        if (q == end)
+            break;
+        if (q + 1 >= end)
+            return false;
+        switch (q[1]) {
+        default:  return false;
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '/': out.push_back('/'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+            if (end - q < 6)
+                return false;
+            int code = parseHex4(q + 2);
+            if (code < 0)
+                return false;
+            q += 4;
+            // Surrogate pair
+            if (code >= 0xD800 && code <= 0xDBFF && end - q >= 8 && q[2] == '\\' && q[3] == 'u') {
+                int low = parseHex4(q + 4);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    q += 6;
+                }
+            }
+            appendUtf8(code, out);
+            break;
+        }
+        }
+        p = q + 2;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+
+bool JsonSaxParser::parseFile(const std::string& filename)
+{
+    fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+        errorMsg = "Open file error: " + filename;
+        return false;
+    }
+
+    buffer.resize(kBlockSize);
+    base = cur = end = buffer.data();
+    consumed = 0;
+    fill();
+
+    bool ret = run();
+
+    fclose(fp);
+    fp = nullptr;
+    std::vector<char>().swap(buffer);
+    return ret;
+}
+
+bool JsonSaxParser::parse(const char* data, size_t size)
+{
+    fp = nullptr;
+    base = cur = data;
+    end = data + size;
+    consumed = 0;
+    return run();
+}
+
+/* Move the unread bytes to the front of the buffer, read the next block
+** Return false if nothing more can be read */
+bool JsonSaxParser::fill()
+{
+    if (!fp)
+        return false;
+
+    size_t keep = end - cur;
+    size_t offset = cur - buffer.data();
+    if (keep > 0 && offset > 0)
+        memmove(buffer.data(), cur, keep);
+    consumed += offset;
+
+    // A token longer than half of the buffer
+    if (keep + kBlockSize / 2 > buffer.size())
+        buffer.resize(buffer.size() * 2);
+
+    size_t bytesRead = fread(buffer.data() + keep, 1, buffer.size() - keep, fp);
+    base = cur = buffer.data();
+    end = cur + keep + bytesRead;
+    return bytesRead > 0;
+}
+
+/* Skip the white spaces, return false at the end of the input */
+bool JsonSaxParser::skipSpaces()
+{
+    for (;;) {
+        while (cur < end && isSpace(*cur))
+            ++cur;
+        if (cur < end)
+            return true;
+        if (!fill())
+            return false;
+    }
+}
+
+bool JsonSaxParser::fail(const char* msg)
+{
+    errorMsg = std::string(msg) + " at offset " + std::to_string(consumed + (cur - base));
+    return false;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Main loop                        */
+/*                                      */
+/****************************************/
+bool JsonSaxParser::run()
+{
+    stack.clear();
+    state = kValue;
+    errorMsg.clear();
+    nextProgress = progressInterval;
+
+    // UTF-8 BOM
+    if (end - cur < 3)
+        fill();
+    if (end - cur >= 3 && memcmp(cur, "\xEF\xBB\xBF", 3) == 0)
+        cur += 3;
+
+    for (;;) {
+        if (!skipSpaces()) {
+            if (state == kDone || (multipleValues && state == kValue && stack.empty()))
+                return true;
+            return fail("Unexpected end of input");
+        }
+
+        char c = *cur;
+        if (multipleValues && stack.empty()) {
+            // Between two root values
+            if (c == ',' || c == '\x1E') {
+                ++cur;
+                state = kValue;
+                continue;
+            }
+            if (state == kDone)
+                state = kValue;
+        }
+
+        switch (state) {
+        case kDone:
+            return fail("Unexpected character after the root value");
+
+        case kObjectKeyOrEnd:
+            if (c == '}') {
+                if (!endContainer(c))
+                    return false;
+                break;
+            }
+            // fall through
+        case kObjectKey:
+            if (c != '"')
+                return fail("Expected a key");
+            if (!parseString(true))
+                return false;
+            state = kColon;
+            break;
+
+        case kColon:
+            if (c != ':')
+                return fail("Expected ':'");
+            ++cur;
+            state = kValue;
+            break;
+
+        case kObjectCommaOrEnd:
+            if (c == ',') {
+                ++cur;
+                state = kObjectKey;
+            }
+            else if (c == '}') {
+                if (!endContainer(c))
+                    return false;
+            }
+            else {
+                return fail("Expected ',' or '}'");
+            }
+            break;
+
+        case kArrayCommaOrEnd:
+            if (c == ',') {
+                ++cur;
+                state = kValue;
+            }
+            else if (c == ']') {
+                if (!endContainer(c))
+                    return false;
+            }
+            else {
+                return fail("Expected ',' or ']'");
+            }
+            break;
+
+        case kArrayValueOrEnd:
+            if (c == ']') {
+                if (!endContainer(c))
+                    return false;
+                break;
+            }
+            // fall through
+        case kValue:
+            switch (c) {
+            case '{':
+                ++cur;
+                if (!handler->startObject())
+                    return fail("Stopped by the handler");
+                stack.push_back('{');
+                state = kObjectKeyOrEnd;
+                continue;
+            case '[':
+                ++cur;
+                if (!handler->startArray())
+                    return fail("Stopped by the handler");
+                stack.push_back('[');
+                state = kArrayValueOrEnd;
+                continue;
+            case '"':
+                if (!parseString(false))
+                    return false;
+                break;
+            case 't':
+            case 'f':
+            case 'n':
+                if (!parseLiteral())
+                    return false;
+                break;
+            default:
+                if (!parseNumber())
+                    return false;
+                break;
+            }
+            // A scalar value is done
+            if (stack.empty())
+                state = kDone;
+            else
+                state = stack.back() == '{' ? kObjectCommaOrEnd : kArrayCommaOrEnd;
+            break;
+        }
+    }
+}
+
+bool JsonSaxParser::endContainer(char c)
+{
+    ++cur;
+    bool ok = (c == '}') ? handler->endObject() : handler->endArray();
+    if (!ok)
+        return fail("Stopped by the handler");
+
+    if (progressCallback) {
+        size_t offset = consumed + (cur - base);
+        if (offset >= nextProgress) {
+            nextProgress = offset + progressInterval;
+            if (!progressCallback(offset))
+                return fail("Stopped by the progress callback");
+        }
+    }
+
+    stack.pop_back();
+    if (stack.empty())
+        state = kDone;
+    else
+        state = stack.back() == '{' ? kObjectCommaOrEnd : kArrayCommaOrEnd;
+    return true;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Tokens                           */
+/*                                      */
+/****************************************/
+
+bool JsonSaxParser::parseString(bool isKey)
+{
+    for (;;) {
+        // Fast path: no escape
+        const char* p = cur + 1;
+        while (p < end && *p != '"' && *p != '\\')
+            ++p;
+        if (p == end) {
+            if (!fill())
+                return fail("Unterminated string");
+            continue;
+        }
+
+        const char* str = cur + 1;
+        const char* strEnd = p;
+        if (*p == '\\') {
+            // Find the closing quote, then decode
+            while (p < end && *p != '"')
+                p += (*p == '\\') ? 2 : 1;
+            if (p >= end) {
+                if (!fill())
+                    return fail("Unterminated string");
+                continue;
+            }
+            if (!unescape(cur + 1, p, scratch))
+                return fail("Invalid escape sequence");
+            str = scratch.data();
+            strEnd = str + scratch.size();
+        }
+
+        cur = p + 1;
+        int len = int(strEnd - str);
+        bool ok = isKey ? handler->key(str, len) : handler->string(str, len);
+        if (!ok)
+            return fail("Stopped by the handler");
+        return true;
+    }
+}
+
+bool JsonSaxParser::parseNumber()
+{
+    const char* p = cur;
+    for (;;) {
+        while (p < end && isNumberChar(*p))
+            ++p;
+        if (p < end)
+            break;
+        size_t len = p - cur;
+        bool more = fill();
+        p = cur + len;
+        if (!more)
+            break;
+    }
+
+    const char* s = cur;
+    bool negative = false;
+    if (s < p && *s == '-') {
+        negative = true;
+        ++s;
+    }
+    if (s == p || !isDigit(*s))
+        return fail("Invalid value");
+
+    // Up to 19 significant digits in the mantissa
+    uint64_t mantissa = 0;
+    int digitsCount = 0;
+    int exp10 = 0;
+    bool isTruncated = false;
+    bool isInteger = true;
+    for (; s < p && isDigit(*s); ++s) {
+        if (digitsCount < 19) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa != 0)
+                ++digitsCount;
+        }
+        else {
+            ++exp10;
+            isTruncated |= (*s != '0');
+        }
+    }
+    if (s < p && *s == '.') {
+        isInteger = false;
+        ++s;
+        if (s == p || !isDigit(*s))
+            return fail("Invalid number");
+        for (; s < p && isDigit(*s); ++s) {
+            if (digitsCount < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa != 0)
+                    ++digitsCount;
+                --exp10;
+            }
+            else {
+                isTruncated |= (*s != '0');
+            }
+        }
+    }
+    if (s < p && (*s == 'e' || *s == 'E')) {
+        isInteger = false;
+        ++s;
+        bool expNegative = false;
+        if (s < p && (*s == '+' || *s == '-'))
+            expNegative = (*s++ == '-');
+        if (s == p || !isDigit(*s))
+            return fail("Invalid number");
+        int exponent = 0;
+        for (; s < p && isDigit(*s); ++s) {
+            if (exponent < 100000)
+                exponent = exponent * 10 + (*s - '0');
+        }
+        exp10 += expNegative ? -exponent : exponent;
+    }
+    if (s != p)
+        return fail("Invalid number");
+
+    // Exact when the mantissa and the power of ten are both exact
+    //   (Clinger's fast path), strtod otherwise
+    double value;
+    if (mantissa == 0) {
+        value = 0.0;
+    }
+    else if (!isTruncated && mantissa <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+        value = double(mantissa);
+        value = exp10 < 0 ? value / kPow10[-exp10] : value * kPow10[exp10];
+    }
+    else {
+        scratch.assign(cur + (negative ? 1 : 0), p);
+        value = strtod(scratch.c_str(), nullptr);
+    }
+    if (negative)
+        value = -value;
+
+    cur = p;
+    if (!handler->number(value, isInteger))
+        return fail("Stopped by the handler");
+    return true;
+}
+
+bool JsonSaxParser::parseLiteral()
+{
+    if (end - cur < 5)
+        fill();
+
+    size_t avail = end - cur;
+    bool ok;
+    if (avail >= 4 && memcmp(cur, "true", 4) == 0) {
+        cur += 4;
+        ok = handler->boolean(true);
+    }
+    else if (avail >= 5 && memcmp(cur, "false", 5) == 0) {
+        cur += 5;
+        ok = handler->boolean(false);
+    }
+    else if (avail >= 4 && memcmp(cur, "null", 4) == 0) {
+        cur += 4;
+        ok = handler->null();
+    }
+    else {
+        return fail("Invalid value");
+    }
+    if (!ok)
+        return fail("Stopped by the handler");
+    return true;
+}
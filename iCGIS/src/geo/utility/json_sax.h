@@ -0,0 +1,117 @@
+/*************************************************************
+** class name:  JsonSaxParser
+**
+** description: Event-driven (SAX) JSON parser
+**
+**              The input is read block by block, every token
+**                is reported to a JsonSaxHandler as soon as it
+**                is complete, nothing is kept after that. So
+**                the memory used doesn't depend on the size of
+**                the file (only on the longest token).
+**
+**              Strings without escapes are passed as pointers
+**                into the read buffer (no copy), they are only
+**                valid during the call.
+**
+** last change: 2020-04-07
+*************************************************************/
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+class JsonSaxHandler {
+public:
+    virtual ~JsonSaxHandler() = default;
+
+    // Return false to stop parsing
+    virtual bool startObject() = 0;
+    virtual bool endObject() = 0;
+    virtual bool startArray() = 0;
+    virtual bool endArray() = 0;
+    virtual bool key(const char* str, int len) = 0;
+    virtual bool string(const char* str, int len) = 0;
+    // isInteger: no fraction and no exponent
+    virtual bool number(double value, bool isInteger) = 0;
+    virtual bool boolean(bool value) = 0;
+    virtual bool null() = 0;
+};
+
+
+class JsonSaxParser {
+public:
+    JsonSaxParser(JsonSaxHandler* handlerIn) : handler(handlerIn) {}
+
+    /* Parse a file, read by blocks */
+    bool parseFile(const std::string& filename);
+
+    /* Parse a buffer in memory */
+    bool parse(const char* data, size_t size);
+
+    /* Accept several root values, separated by white spaces, commas or
+    **   record separators (0x1E), e.g. GeoJSON text sequences or a slice
+    **   of the elements of an array */
+    void setMultipleValues(bool b) { multipleValues = b; }
+
+    /* Called about every `interval` bytes with the number of bytes
+    **   parsed, return false to stop parsing */
+    void setProgressCallback(std::function<bool(size_t)> callback, size_t interval = kBlockSize)
+        { progressCallback = std::move(callback); progressInterval = interval; }
+
+    // Description of the error, with the offset in the input
+    const std::string& getError() const { return errorMsg; }
+
+    // Size of the read blocks
+    static constexpr size_t kBlockSize = 1 << 20;
+
+private:
+    enum State {
+        kValue,
+        kObjectKeyOrEnd,
+        kObjectKey,
+        kColon,
+        kObjectCommaOrEnd,
+        kArrayValueOrEnd,
+        kArrayCommaOrEnd,
+        kDone
+    };
+
+    bool run();
+    bool fill();
+    bool skipSpaces();
+    bool parseString(bool isKey);
+    bool parseNumber();
+    bool parseLiteral();
+    bool endContainer(char c);
+    bool fail(const char* msg);
+
+private:
+    JsonSaxHandler* handler = nullptr;
+
+    // Current position in the buffer
+    const char* base = nullptr;
+    const char* cur = nullptr;
+    const char* end = nullptr;
+
+    // Block reading (nullptr when parsing a buffer in memory)
+    FILE* fp = nullptr;
+    std::vector<char> buffer;
+    size_t consumed = 0;    // bytes before the buffer (for error offsets)
+
+    // Open containers, '{' or '['
+    std::vector<char> stack;
+    State state = kValue;
+    bool multipleValues = false;
+
+    std::function<bool(size_t)> progressCallback;
+    size_t progressInterval = kBlockSize;
+    size_t nextProgress = 0;
+
+    // Unescaped strings
+    std::string scratch;
+
+    std::string errorMsg;
+};
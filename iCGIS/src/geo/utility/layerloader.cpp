@@ -0,0 +1,358 @@
+#include "geo/utility/layerloader.h"
+
+#include "geo/utility/geo_convert.h"
+#include "util/logger.h"
+#include "util/parallel.h"
+
+#include <gdal/gdal_frmts.h>
+
+#include <QColor>
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+
+
+// Features read by the worker, waiting for the converter thread
+struct LayerLoader::RawBatches {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::vector<OGRFeature*>> batches;
+    bool finished = false;                      // no more batch
+
+    GeoFeatureLayer* layer = nullptr;
+    unsigned int color = 0;
+    std::vector<GeoFeature*> layerFeatures;     // converted, in order
+    GeoExtent layerExtent;
+};
+
+
+namespace {
+
+// Features posted at once: a batch, or what was read in kBatchTimeMs
+const int kBatchTimeMs = 100;
+// Batches read and waiting to be converted, bounds the memory when
+//  reading is faster than converting
+const size_t kMaxRawBatches = 2;
+
+} // namespace
+
+
+LayerLoader::LayerLoader(const std::string& path, const GeoExtent* extentIn /*= nullptr*/,
+                         const std::string& where /*= ""*/)
+    : path(path), where(where), colorEngine(unsigned(std::rand()))
+{
+    if (extentIn) {
+        filterExtent = true;
+        extent = *extentIn;
+    }
+
+    // PG:dbname=... password=...
+    logPath = path;
+    size_t pos = logPath.find("password=");
+    if (pos != std::string::npos) {
+        pos += 9;
+        size_t end = logPath.find(' ', pos);
+        logPath.replace(pos, end == std::string::npos ? std::string::npos : end - pos, "******");
+    }
+}
+
+LayerLoader::~LayerLoader()
+{
+    stop();
+}
+
+void LayerLoader::start()
+{
+    if (worker.joinable())
+        return;
+    worker = std::thread(&LayerLoader::run, this);
+}
+
+void LayerLoader::stop()
+{
+    canceled = true;
+    stopped = true;
+    if (worker.joinable())
+        worker.join();
+
+    std::vector<Event> eventsLeft;
+    takeEvents(eventsLeft);
+
+    // The features refer to the field definitions of their layer
+    for (auto& event : eventsLeft) {
+        for (GeoFeature* feature : event.features)
+            delete feature;
+        delete event.index;
+    }
+    for (auto& event : eventsLeft) {
+        if (event.type == kLayerReady)
+            delete event.layer;
+    }
+}
+
+void LayerLoader::stopLayer(GeoFeatureLayer* layer)
+{
+    // Its batches are dropped and its index is not built
+    std::unique_lock<std::mutex> lock(layerMutex);
+    stoppedLayer = layer;
+    layerCond.wait(lock, [&] { return readingLayer != layer; });
+    stoppedLayer = nullptr;
+    lock.unlock();
+
+    // All its events are posted
+    std::vector<Event> eventsLeft;
+    {
+        std::lock_guard<std::mutex> eventsLock(eventsMutex);
+        std::vector<Event> eventsKept;
+        for (auto& event : events) {
+            if (event.layer == layer)
+                eventsLeft.push_back(std::move(event));
+            else
+                eventsKept.push_back(std::move(event));
+        }
+        events.swap(eventsKept);
+    }
+    for (auto& event : eventsLeft) {
+        for (GeoFeature* feature : event.features)
+            delete feature;
+        delete event.index;
+    }
+}
+
+void LayerLoader::takeEvents(std::vector<Event>& eventsOut)
+{
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    for (auto& event : events)
+        eventsOut.push_back(std::move(event));
+    events.clear();
+}
+
+bool LayerLoader::isFinished()
+{
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    return workerFinished && events.empty();
+}
+
+void LayerLoader::postEvent(Event&& event)
+{
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    events.push_back(std::move(event));
+}
+
+// Same range as utils::getRandomColor()
+unsigned int LayerLoader::getLayerColor()
+{
+    std::uniform_int_distribution<int> distribution(50, 200);
+    int r = distribution(colorEngine);
+    int g = distribution(colorEngine);
+    int b = distribution(colorEngine);
+    return qRgb(r, g, b);
+}
+
+
+/*************************************************/
+/*                                               */
+/*           The worker thread                   */
+/*                                               */
+/*************************************************/
+void LayerLoader::run()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    Event finished;
+    finished.type = kFinished;
+
+    // Rows fetched at once by the cursor of the PostgreSQL driver
+    CPLSetThreadLocalConfigOption("OGR_PG_CURSOR_PAGE", std::to_string(batchSize).c_str());
+
+    GDALAllRegister();
+    GDALDataset* poDS = (GDALDataset*)GDALOpenEx(path.c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY,
+                                                 nullptr, nullptr, nullptr);
+    if (!poDS) {
+        LError("Open {0} error", logPath);
+        finished.ok = false;
+    }
+    else {
+        int layerCount = layerNames.empty() ? poDS->GetLayerCount() : int(layerNames.size());
+        for (int i = 0; i < layerCount && !canceled; ++i) {
+            OGRLayer* poLayer = layerNames.empty() ? poDS->GetLayer(i) : poDS->GetLayerByName(layerNames[i].c_str());
+            if (!poLayer || !readLayer(poLayer)) {
+                LError("Read layer {0} of {1} error", layerNames.empty() ? std::to_string(i) : layerNames[i], logPath);
+                finished.ok = false;
+                break;
+            }
+        }
+        GDALClose(poDS);
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("{0}: {1} features read in {2} ms{3}", logPath, numFeaturesRead,
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count(),
+          canceled ? " (canceled)" : "");
+
+    postEvent(std::move(finished));
+    workerFinished = true;
+}
+
+bool LayerLoader::readLayer(OGRLayer* poLayer)
+{
+    // The filters are applied by the driver, as in convertOGRLayer
+    if (filterExtent)
+        poLayer->SetSpatialFilterRect(extent.minX, extent.minY, extent.maxX, extent.maxY);
+    if (!where.empty() && poLayer->SetAttributeFilter(where.c_str()) != OGRERR_NONE) {
+        LError("Invalid attribute filter: {0}", where);
+        poLayer->SetSpatialFilter(nullptr);
+        return false;
+    }
+    bool filtered = filterExtent || !where.empty();
+    poLayer->ResetReading();
+
+    // The layer is only read here until it is posted
+    GeoFeatureLayer* layer = new GeoFeatureLayer();
+    layer->setName(poLayer->GetName());
+    layer->setGeometryType(convertOGRwkbGeometryType(poLayer->GetGeomType()));
+    convertOGRFeatureDefn(poLayer->GetLayerDefn(), layer);
+
+    // The map is zoomed to the layer before its first feature
+    OGREnvelope envelope;
+    if (poLayer->GetExtent(&envelope, TRUE) == OGRERR_NONE)
+        layer->setExtent(GeoExtent(envelope.MinX, envelope.MaxX, envelope.MinY, envelope.MaxY));
+    GIntBig featureCount = poLayer->GetFeatureCount(filtered ? FALSE : TRUE);
+    if (featureCount > 0) {
+        layer->reserveFeatureCount(int(featureCount));
+        if (numFeaturesTotal >= 0)
+            numFeaturesTotal += featureCount;
+    }
+    else if (featureCount < 0) {
+        numFeaturesTotal = -1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(layerMutex);
+        readingLayer = layer;
+    }
+    Event ready;
+    ready.type = kLayerReady;
+    ready.layer = layer;
+    postEvent(std::move(ready));
+
+    RawBatches raw;
+    raw.layer = layer;
+    raw.color = getLayerColor();
+    if (featureCount > 0)
+        raw.layerFeatures.reserve(size_t(featureCount));
+
+    // Reading (the driver, e.g. the cursor of PostgreSQL) and converting
+    //  overlap: the converter thread converts a batch while the next one
+    //  is read here
+    std::thread converter(&LayerLoader::convertBatches, this, std::ref(raw));
+
+    std::vector<OGRFeature*> batch;
+    batch.reserve(size_t(batchSize));
+    auto batchTime = std::chrono::steady_clock::now();
+
+    OGRFeature* poFeature = nullptr;
+    while (!canceled && stoppedLayer != layer && (poFeature = poLayer->GetNextFeature()) != nullptr) {
+        batch.push_back(poFeature);
+        if (batch.size() >= size_t(batchSize)
+            || std::chrono::steady_clock::now() - batchTime > std::chrono::milliseconds(kBatchTimeMs))
+        {
+            pushRawBatch(raw, batch);
+            batch.reserve(size_t(batchSize));
+            batchTime = std::chrono::steady_clock::now();
+        }
+    }
+    if (!batch.empty())
+        pushRawBatch(raw, batch);
+
+    {
+        std::lock_guard<std::mutex> lock(raw.mutex);
+        raw.finished = true;
+    }
+    raw.cond.notify_all();
+    converter.join();
+
+    if (filtered) {
+        poLayer->SetAttributeFilter(nullptr);
+        poLayer->SetSpatialFilter(nullptr);
+    }
+
+    // Canceled by the user: the features read are indexed
+    // Stopped: nobody takes the index
+    Event done;
+    done.type = kLayerDone;
+    done.layer = layer;
+    if (!isLayerStopped(layer))
+        done.index = GeoFeatureLayer::buildGridIndex(raw.layerFeatures, raw.layerExtent);
+    postEvent(std::move(done));
+
+    {
+        std::lock_guard<std::mutex> lock(layerMutex);
+        readingLayer = nullptr;
+    }
+    layerCond.notify_all();
+
+    return true;
+}
+
+// Waits while kMaxRawBatches batches are waiting, `batch` is emptied
+void LayerLoader::pushRawBatch(RawBatches& raw, std::vector<OGRFeature*>& batch)
+{
+    std::unique_lock<std::mutex> lock(raw.mutex);
+    raw.cond.wait(lock, [&] { return raw.batches.size() < kMaxRawBatches || isLayerStopped(raw.layer); });
+    raw.batches.push_back(std::move(batch));
+    batch.clear();
+    lock.unlock();
+    raw.cond.notify_all();
+}
+
+// The converter thread, the features of a batch are converted in parallel
+void LayerLoader::convertBatches(RawBatches& raw)
+{
+    for (;;) {
+        std::vector<OGRFeature*> batch;
+        {
+            std::unique_lock<std::mutex> lock(raw.mutex);
+            raw.cond.wait(lock, [&] { return !raw.batches.empty() || raw.finished; });
+            if (raw.batches.empty())
+                break;
+            batch = std::move(raw.batches.front());
+            raw.batches.pop_front();
+        }
+        raw.cond.notify_all();  // room for the next batch
+
+        // Stopped: only destroyed
+        int count = int(batch.size());
+        std::vector<GeoFeature*> converted(count, nullptr);
+        utils::parallelFor(0, count, [&](int i) {
+            if (!isLayerStopped(raw.layer)) {
+                GeoFeature* geoFeature = new GeoFeature(raw.layer);
+                if (convertOGRFeature(batch[i], geoFeature))
+                    converted[i] = geoFeature;
+                else
+                    delete geoFeature;
+            }
+            OGRFeature::DestroyFeature(batch[i]);
+        }, 256);
+
+        Event event;
+        event.type = kFeaturesRead;
+        event.layer = raw.layer;
+        for (GeoFeature* geoFeature : converted) {
+            if (!geoFeature)
+                continue;
+            geoFeature->setColor(raw.color, false);
+            // Same as GeoFeatureLayer::addFeature
+            if (raw.layerFeatures.empty())
+                raw.layerExtent = geoFeature->getExtent();
+            else
+                raw.layerExtent.merge(geoFeature->getExtent());
+            raw.layerFeatures.push_back(geoFeature);
+            event.features.push_back(geoFeature);
+        }
+        numFeaturesRead += event.features.size();
+        if (!event.features.empty())
+            postEvent(std::move(event));
+    }
+}
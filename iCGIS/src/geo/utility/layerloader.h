@@ -0,0 +1,139 @@
+/*************************************************************
+** class name:  LayerLoader
+**
+** description: Read the layers of a file through GDAL on a
+**                background thread
+**
+**              The worker opens the file, then for each layer:
+**                - creates an empty GeoFeatureLayer (name, fields,
+**                  extent of the source) and posts it
+**                - posts the features read in batches
+**                - builds the grid index of the layer and posts it
+**              The GUI thread takes the events (takeEvents) and
+**                adds the layer to the map at once, then the
+**                features batch by batch, so the layer is drawn
+**                while it is read
+**
+**              Reading and converting overlap: the worker reads a
+**                batch of OGR features (the rows fetched by the
+**                cursor of the PostgreSQL driver, see setBatchSize)
+**                while a converter thread converts the previous one
+**                in parallel, at most 2 batches wait
+**
+**              Once posted, a layer is only read by the worker
+**                (the field definitions and the features it has
+**                posted), the layer keeps the loader until its index
+**                is taken and stops reading it when destroyed
+**                (stopLayer), the other layers go on
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gdal/ogrsf_frmts.h>
+
+#include "geo/map/geolayer.h"
+
+
+class LayerLoader {
+public:
+    enum EventType {
+        kLayerReady,        // a new empty layer, to be added to the map
+        kFeaturesRead,      // features of the layer, to be added to it
+        kLayerDone,         // all the features of the layer, with its index
+        kFinished           // the last event, ok: the file was read
+    };
+
+    struct Event {
+        EventType type;
+        GeoFeatureLayer* layer = nullptr;
+        std::vector<GeoFeature*> features;
+        GridIndex* index = nullptr;
+        bool ok = true;
+    };
+
+public:
+    // extent: only the features intersecting it, nullptr: all
+    // where:  attribute filter (OGR SQL), empty: all
+    LayerLoader(const std::string& path, const GeoExtent* extent = nullptr, const std::string& where = "");
+    ~LayerLoader();
+
+    // Before start()
+    // Only these layers (e.g. tables of a database), empty: all
+    void setLayerNames(const std::vector<std::string>& names) { layerNames = names; }
+    // Features in a batch, the rows fetched at once from PostgreSQL
+    void setBatchSize(int size) { batchSize = size > 0 ? size : 4096; }
+
+    void start();
+
+    // Stop reading, the features read are still posted and indexed
+    void cancel() { canceled = true; }
+    bool isCanceled() const { return canceled; }
+
+    // Cancel and wait for the worker, the events not taken are dropped
+    //  (the layers not added to the map are deleted)
+    void stop();
+
+    // The layer is being destroyed: wait until the worker no longer
+    //  reads it, drop its events not taken, the other layers go on
+    void stopLayer(GeoFeatureLayer* layer);
+
+    // Move the events posted so far to `eventsOut`, in order
+    void takeEvents(std::vector<Event>& eventsOut);
+
+    // The worker has finished and all its events were taken
+    bool isFinished();
+
+    // The password of a connection string is hidden
+    const std::string& getPath() const { return logPath; }
+    long long getNumFeaturesRead() const { return numFeaturesRead; }
+    // -1: unknown, counting would scan the file
+    long long getNumFeaturesTotal() const { return numFeaturesTotal; }
+
+private:
+    struct RawBatches;
+
+    void run();
+    bool readLayer(OGRLayer* poLayer);
+    void pushRawBatch(RawBatches& raw, std::vector<OGRFeature*>& batch);
+    void convertBatches(RawBatches& raw);
+    void postEvent(Event&& event);
+    bool isLayerStopped(GeoFeatureLayer* layer) const { return stopped || stoppedLayer == layer; }
+    unsigned int getLayerColor();
+
+private:
+    std::string path;
+    std::string logPath;
+    bool filterExtent = false;
+    GeoExtent extent;
+    std::string where;
+    std::vector<std::string> layerNames;
+    int batchSize = 4096;
+
+    std::thread worker;
+    std::atomic<bool> canceled{ false };
+    std::atomic<bool> stopped{ false };
+    std::atomic<bool> workerFinished{ false };
+    std::atomic<long long> numFeaturesRead{ 0 };
+    std::atomic<long long> numFeaturesTotal{ 0 };
+
+    std::mutex eventsMutex;
+    std::vector<Event> events;
+
+    // The layer read by the worker, and the one stopped by stopLayer
+    std::mutex layerMutex;
+    std::condition_variable layerCond;
+    GeoFeatureLayer* readingLayer = nullptr;
+    std::atomic<GeoFeatureLayer*> stoppedLayer{ nullptr };
+
+    // Seeded by the creating thread, rand() is per thread
+    std::minstd_rand colorEngine;
+};
@@ -0,0 +1,1215 @@
+#include "geo/utility/snapshot.h"
+#include "geo/utility/filereader.h"
+#include "util/logger.h"
+#include "util/mappedfile.h"
+#include "util/parallel.h"
+
+#include <mapbox/earcut.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+/****************************************/
+/*                                      */
+/*     File layout                      */
+/*                                      */
+/****************************************/
+
+// All the sections start at a multiple of 8 bytes (from the start of
+//   the layer), so the arrays can be read in place from the mapping
+enum SectionId {
+    kSectionMeta = 0,           // name, spatial reference, fields
+    kSectionGeomTypes,          // uint8[features]
+    kSectionGeomOffsets,        // uint64[features + 1], first part of each feature
+    kSectionPartOffsets,        // uint64[parts + 1], first ring of each part
+    kSectionRingOffsets,        // uint64[rings + 1], first point of each ring
+    kSectionPoints,             // GeoRawPoint[points]
+    kSectionExtents,            // double[features * 4], minX, maxX, minY, maxY
+    kSectionColors,             // uint32[features * 2], color, border color
+    kSectionColumns,            // one column per field
+    kSectionTriangleOffsets,    // uint64[parts + 1], first index of each part
+    kSectionTriangles,          // uint32[], indices of the points of the part
+    kSectionGridExtents,        // double[grids * 4]
+    kSectionGridOffsets,        // uint64[grids + 1], first feature of each grid
+    kSectionGridFeatures,       // uint32[], indices of the features
+    kSectionsCount
+};
+
+struct Section {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct LayerHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    int32_t geometryType;
+    int32_t styleMode;
+    int32_t visible;
+    int32_t fieldsCount;
+    uint64_t featuresCount;
+    uint64_t partsCount;
+    uint64_t ringsCount;
+    uint64_t pointsCount;
+    uint64_t gridsCount;
+    double extent[4];
+    Section sections[kSectionsCount];
+};
+
+struct ProjectHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t layersCount;
+    uint32_t reserved;
+};
+
+// Followed by `size` bytes: a layer snapshot, or the raster layer's
+//   visibility, name and source file
+struct ProjectEntry {
+    int32_t layerType;
+    int32_t reserved;
+    uint64_t size;
+};
+
+const char kLayerMagic[8] = { 'I', 'C', 'G', 'L', 'A', 'Y', 'E', 'R' };
+const char kProjectMagic[8] = { 'I', 'C', 'G', 'P', 'R', 'O', 'J', 'T' };
+const uint32_t kByteOrder = 0x01020304;
+const uint32_t kVersion = 1;
+
+inline uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+
+/****************************************/
+/*                                      */
+/*     Bytes                            */
+/*                                      */
+/****************************************/
+
+class ByteWriter {
+public:
+    template<typename T>
+    void put(T value) {
+        const char* p = reinterpret_cast<const char*>(&value);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+    void putString(const QString& str) {
+        QByteArray utf8 = str.toUtf8();
+        put<uint32_t>(uint32_t(utf8.size()));
+        bytes.insert(bytes.end(), utf8.constData(), utf8.constData() + utf8.size());
+    }
+    std::vector<char> bytes;
+};
+
+class ByteReader {
+public:
+    ByteReader(const char* data, uint64_t size) : begin(data), cur(data), end(data + size) {}
+
+    template<typename T>
+    T get() {
+        T value = T();
+        if (uint64_t(end - cur) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, cur, sizeof(T));
+        cur += sizeof(T);
+        return value;
+    }
+    QString getString() {
+        uint32_t length = get<uint32_t>();
+        if (!ok || uint64_t(end - cur) < length) {
+            ok = false;
+            return QString();
+        }
+        QString str = QString::fromUtf8(cur, int(length));
+        cur += length;
+        return str;
+    }
+    bool isOk() const { return ok; }
+    uint64_t getPosition() const { return cur - begin; }
+
+private:
+    const char* begin;
+    const char* cur;
+    const char* end;
+    bool ok = true;
+};
+
+/* Keeps count of the bytes written, writes zeros up to an offset */
+class FileWriter {
+public:
+    explicit FileWriter(FILE* fpIn) : fp(fpIn) {}
+
+    bool write(const void* data, uint64_t size) {
+        if (size > 0 && fwrite(data, 1, size_t(size), fp) != size_t(size))
+            ok = false;
+        written += size;
+        return ok;
+    }
+    bool padTo(uint64_t offset) {
+        static const char zeros[8] = { 0 };
+        while (ok && written < offset)
+            write(zeros, std::min<uint64_t>(offset - written, sizeof(zeros)));
+        return ok;
+    }
+    uint64_t getWritten() const { return written; }
+    bool isOk() const { return ok; }
+
+private:
+    FILE* fp;
+    uint64_t written = 0;
+    bool ok = true;
+};
+
+
+/****************************************/
+/*                                      */
+/*     Geometry as parts/rings/points   */
+/*                                      */
+/****************************************/
+
+/* onPart() at the start of every part, then onRing(points, count) for
+**   every ring of the part
+** Point:           1 part,  1 ring of 1 point
+** LineString:      1 part,  1 ring
+** Polygon:         1 part,  exterior ring + interior rings
+** MultiXXX:        1 part for each geometry, as above */
+template<typename PartFunc, typename RingFunc>
+void visitGeometry(GeoGeometry* geom, PartFunc&& onPart, RingFunc&& onRing)
+{
+    auto visitLineString = [&](GeoLineString* lineString) {
+        int count = lineString->getNumPoints();
+        onRing(count > 0 ? &(*lineString)[0] : nullptr, count);
+    };
+    auto visitPolygon = [&](GeoPolygon* polygon) {
+        onPart();
+        if (polygon->isEmpty())
+            return;
+        visitLineString(polygon->getExteriorRing());
+        int interiorRingsCount = polygon->getInteriorRingsCount();
+        for (int i = 0; i < interiorRingsCount; ++i)
+            visitLineString(polygon->getInteriorRing(i));
+    };
+
+    switch (geom->getGeometryType()) {
+    default:
+        break;
+    case kPoint: {
+        GeoRawPoint point = geom->toPoint()->getXY();
+        onPart();
+        onRing(&point, 1);
+        break;
+    }
+    case kLineString:
+        onPart();
+        visitLineString(geom->toLineString());
+        break;
+    case kPolygon:
+        visitPolygon(geom->toPolygon());
+        break;
+    case kMultiPoint: {
+        GeoMultiPoint* multiPoint = geom->toMultiPoint();
+        int pointsCount = multiPoint->getNumGeometries();
+        for (int i = 0; i < pointsCount; ++i) {
+            GeoRawPoint point = multiPoint->getPoint(i)->getXY();
+            onPart();
+            onRing(&point, 1);
+        }
+        break;
+    }
+    case kMultiLineString: {
+        GeoMultiLineString* multiLineString = geom->toMultiLineString();
+        int linesCount = multiLineString->getNumGeometries();
+        for (int i = 0; i < linesCount; ++i) {
+            onPart();
+            visitLineString(multiLineString->getLineString(i));
+        }
+        break;
+    }
+    case kMultiPolygon: {
+        GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+        int polygonsCount = multiPolygon->getNumGeometries();
+        for (int i = 0; i < polygonsCount; ++i)
+            visitPolygon(multiPolygon->getPolygon(i));
+        break;
+    }
+    }
+}
+
+// Same triangles as the renderer's earcut: points of the exterior ring,
+//   then of the interior rings
+void triangulatePolygon(GeoPolygon* polygon, std::vector<uint32_t>& indicesOut)
+{
+    if (polygon->isEmpty())
+        return;
+
+    using Point = std::array<double, 2>;
+    std::vector<std::vector<Point>> rings(polygon->getInteriorRingsCount() + 1);
+    for (int i = 0; i < int(rings.size()); ++i) {
+        GeoLinearRing* ring = (i == 0) ? polygon->getExteriorRing() : polygon->getInteriorRing(i - 1);
+        int pointsCount = ring->getNumPoints();
+        rings[i].reserve(pointsCount);
+        for (int k = 0; k < pointsCount; ++k)
+            rings[i].push_back({ ring->getX(k), ring->getY(k) });
+    }
+
+    std::vector<uint32_t> indices = mapbox::earcut<uint32_t>(rings);
+    indicesOut.insert(indicesOut.end(), indices.begin(), indices.end());
+}
+
+
+/****************************************/
+/*                                      */
+/*     Write a layer                    */
+/*                                      */
+/****************************************/
+
+class LayerWriter {
+public:
+    LayerWriter(GeoFeatureLayer* layerIn, bool withTrianglesIn)
+        : layer(layerIn), withTriangles(withTrianglesIn) {}
+
+    /* Pack everything except the points, compute the layout */
+    bool prepare();
+    uint64_t getSize() const { return totalSize; }
+
+    /* Write the snapshot, the points are written straight from the geometries */
+    bool write(FileWriter& writer);
+
+private:
+    void packGeometries();
+    void packColumns();
+    void packTriangles();
+    void packGridIndex();
+
+private:
+    GeoFeatureLayer* layer;
+    bool withTriangles;
+    std::vector<GeoFeature*> features;  // deleted features are not saved
+
+    LayerHeader header;
+    std::vector<const void*> sectionData;
+    uint64_t totalSize = 0;
+
+    ByteWriter meta;
+    std::vector<uint8_t> geomTypes;
+    std::vector<uint64_t> geomOffsets;
+    std::vector<uint64_t> partOffsets;
+    std::vector<uint64_t> ringOffsets;
+    std::vector<double> extents;
+    std::vector<uint32_t> colors;
+    std::vector<char> columns;
+    std::vector<uint64_t> triangleOffsets;
+    std::vector<uint32_t> triangles;
+    std::vector<double> gridExtents;
+    std::vector<uint64_t> gridOffsets;
+    std::vector<uint32_t> gridFeatures;
+};
+
+bool LayerWriter::prepare()
+{
+    for (auto& feature : *layer) {
+        if (feature->isDeleted() || !feature->getGeometry())
+            continue;
+        switch (feature->getGeometryType()) {
+        default:
+            LWarn("Feature {0} not saved, unsupported geometry", feature->getFID());
+            break;
+        case kPoint:
+        case kLineString:
+        case kPolygon:
+        case kMultiPoint:
+        case kMultiLineString:
+        case kMultiPolygon:
+            features.push_back(feature);
+            break;
+        }
+    }
+    if (features.size() > size_t(INT_MAX)) {
+        LError("Too many features to save: {0}", features.size());
+        return false;
+    }
+
+    // Properties, then the fields with their columns
+    meta.putString(layer->getName());
+    meta.putString(layer->getSpatialRef());
+
+    packGeometries();
+    packColumns();
+    if (withTriangles)
+        packTriangles();
+    packGridIndex();
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kLayerMagic, sizeof(kLayerMagic));
+    header.byteOrder = kByteOrder;
+    header.version = kVersion;
+    header.geometryType = layer->getGeometryType();
+    header.styleMode = layer->getStyleMode();
+    header.visible = layer->isVisible() ? 1 : 0;
+    header.fieldsCount = layer->getNumFields();
+    header.featuresCount = features.size();
+    header.partsCount = partOffsets.size() - 1;
+    header.ringsCount = ringOffsets.size() - 1;
+    header.pointsCount = ringOffsets.back();
+    header.gridsCount = gridOffsets.size() - 1;
+    GeoExtent extent = layer->getExtent();
+    header.extent[0] = extent.minX;
+    header.extent[1] = extent.maxX;
+    header.extent[2] = extent.minY;
+    header.extent[3] = extent.maxY;
+
+    uint64_t sizes[kSectionsCount] = {
+        meta.bytes.size(),
+        geomTypes.size(),
+        geomOffsets.size() * sizeof(uint64_t),
+        partOffsets.size() * sizeof(uint64_t),
+        ringOffsets.size() * sizeof(uint64_t),
+        header.pointsCount * sizeof(GeoRawPoint),
+        extents.size() * sizeof(double),
+        colors.size() * sizeof(uint32_t),
+        columns.size(),
+        triangleOffsets.size() * sizeof(uint64_t),
+        triangles.size() * sizeof(uint32_t),
+        gridExtents.size() * sizeof(double),
+        gridOffsets.size() * sizeof(uint64_t),
+        gridFeatures.size() * sizeof(uint32_t)
+    };
+    sectionData = {
+        meta.bytes.data(), geomTypes.data(), geomOffsets.data(), partOffsets.data(),
+        ringOffsets.data(), nullptr, extents.data(), colors.data(), columns.data(),
+        triangleOffsets.data(), triangles.data(), gridExtents.data(), gridOffsets.data(),
+        gridFeatures.data()
+    };
+
+    uint64_t offset = align8(sizeof(LayerHeader));
+    for (int i = 0; i < kSectionsCount; ++i) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset = align8(offset + sizes[i]);
+    }
+    totalSize = offset;
+    return true;
+}
+
+void LayerWriter::packGeometries()
+{
+    int featuresCount = features.size();
+    geomTypes.reserve(featuresCount);
+    geomOffsets.reserve(featuresCount + 1);
+    extents.reserve(featuresCount * 4);
+    colors.reserve(featuresCount * 2);
+
+    uint64_t pointsCount = 0;
+    for (auto& feature : features) {
+        geomTypes.push_back(uint8_t(feature->getGeometryType()));
+        geomOffsets.push_back(partOffsets.size());
+        visitGeometry(feature->getGeometry(),
+            [this]() { partOffsets.push_back(ringOffsets.size()); },
+            [this, &pointsCount](const GeoRawPoint*, int count) {
+                ringOffsets.push_back(pointsCount);
+                pointsCount += count;
+            });
+
+        const GeoExtent& extent = feature->getExtent();
+        extents.push_back(extent.minX);
+        extents.push_back(extent.maxX);
+        extents.push_back(extent.minY);
+        extents.push_back(extent.maxY);
+        colors.push_back(feature->getColor());
+        colors.push_back(feature->getBorderColor());
+    }
+    geomOffsets.push_back(partOffsets.size());
+    partOffsets.push_back(ringOffsets.size());
+    ringOffsets.push_back(pointsCount);
+}
+
+// Columns one after another, each starting at a multiple of 8 bytes
+void LayerWriter::packColumns()
+{
+    int featuresCount = features.size();
+    int fieldsCount = layer->getNumFields();
+    for (int iField = 0; iField < fieldsCount; ++iField) {
+        GeoFieldDefn* fieldDefn = layer->getFieldDefn(iField);
+        columns.resize(align8(columns.size()));
+        uint64_t columnBegin = columns.size();
+
+        switch (fieldDefn->getType()) {
+        default:
+            break;
+        case kFieldInt: {
+            columns.resize(columnBegin + featuresCount * sizeof(int32_t));
+            int32_t* values = reinterpret_cast<int32_t*>(columns.data() + columnBegin);
+            for (int i = 0; i < featuresCount; ++i) {
+                int value;
+                features[i]->getField(iField, &value);
+                values[i] = value;
+            }
+            break;
+        }
+        case kFieldDouble: {
+            columns.resize(columnBegin + featuresCount * sizeof(double));
+            double* values = reinterpret_cast<double*>(columns.data() + columnBegin);
+            for (int i = 0; i < featuresCount; ++i)
+                features[i]->getField(iField, &values[i]);
+            break;
+        }
+        case kFieldText: {
+            // Offsets of the strings, then the UTF-8 bytes
+            std::vector<uint64_t> offsets(featuresCount + 1, 0);
+            std::vector<char> text;
+            for (int i = 0; i < featuresCount; ++i) {
+                QString value;
+                features[i]->getField(iField, &value);
+                QByteArray utf8 = value.toUtf8();
+                text.insert(text.end(), utf8.constData(), utf8.constData() + utf8.size());
+                offsets[i + 1] = text.size();
+            }
+            const char* p = reinterpret_cast<const char*>(offsets.data());
+            columns.insert(columns.end(), p, p + offsets.size() * sizeof(uint64_t));
+            columns.insert(columns.end(), text.begin(), text.end());
+            break;
+        }
+        }
+
+        meta.put<int32_t>(fieldDefn->getType());
+        meta.put<int32_t>(fieldDefn->getWidth());
+        meta.putString(fieldDefn->getName());
+        meta.put<uint64_t>(columnBegin);
+        meta.put<uint64_t>(columns.size() - columnBegin);
+    }
+}
+
+// earcut on every polygon, in parallel
+void LayerWriter::packTriangles()
+{
+    bool hasPolygons = std::any_of(features.begin(), features.end(), [](GeoFeature* feature) {
+        GeometryType type = feature->getGeometryType();
+        return type == kPolygon || type == kMultiPolygon;
+    });
+    if (!hasPolygons)
+        return;
+
+    // Consecutive features in one task, merged in order
+    int featuresCount = features.size();
+    const int featuresPerTask = 256;
+    int tasksCount = (featuresCount + featuresPerTask - 1) / featuresPerTask;
+    std::vector<std::vector<uint32_t>> taskIndices(tasksCount);
+    std::vector<std::vector<uint64_t>> taskCounts(tasksCount);   // indices of each part
+
+    utils::parallelFor(0, tasksCount, [&](int t) {
+        int first = t * featuresPerTask;
+        int last = std::min(first + featuresPerTask, featuresCount);
+        auto& indices = taskIndices[t];
+        auto& counts = taskCounts[t];
+        for (int i = first; i < last; ++i) {
+            GeoGeometry* geom = features[i]->getGeometry();
+            size_t before = indices.size();
+            switch (geom->getGeometryType()) {
+            default:
+                // no triangles, but the parts are counted
+                visitGeometry(geom, [&counts]() { counts.push_back(0); },
+                              [](const GeoRawPoint*, int) {});
+                break;
+            case kPolygon:
+                triangulatePolygon(geom->toPolygon(), indices);
+                counts.push_back(indices.size() - before);
+                break;
+            case kMultiPolygon: {
+                GeoMultiPolygon* multiPolygon = geom->toMultiPolygon();
+                int polygonsCount = multiPolygon->getNumGeometries();
+                for (int k = 0; k < polygonsCount; ++k) {
+                    before = indices.size();
+                    triangulatePolygon(multiPolygon->getPolygon(k), indices);
+                    counts.push_back(indices.size() - before);
+                }
+                break;
+            }
+            }
+        }
+    }, 1);
+
+    triangleOffsets.reserve(partOffsets.size());
+    triangleOffsets.push_back(0);
+    for (int t = 0; t < tasksCount; ++t) {
+        for (auto& count : taskCounts[t])
+            triangleOffsets.push_back(triangleOffsets.back() + count);
+        triangles.insert(triangles.end(), taskIndices[t].begin(), taskIndices[t].end());
+        std::vector<uint32_t>().swap(taskIndices[t]);
+    }
+}
+
+void LayerWriter::packGridIndex()
+{
+    if (!layer->getGridIndex())
+        layer->createGridIndex();
+    GridIndex* gridIndex = layer->getGridIndex();
+
+    gridOffsets.push_back(0);
+    if (!gridIndex)
+        return;
+
+    std::unordered_map<GeoFeature*, uint32_t> indexOfFeature;
+    indexOfFeature.reserve(features.size());
+    for (size_t i = 0; i < features.size(); ++i)
+        indexOfFeature.emplace(features[i], uint32_t(i));
+
+    int gridsCount = gridIndex->getNumGrids();
+    for (int i = 0; i < gridsCount; ++i) {
+        Grid* grid = gridIndex->getGrid(i);
+        const GeoExtent& extent = grid->getExtent();
+        gridExtents.push_back(extent.minX);
+        gridExtents.push_back(extent.maxX);
+        gridExtents.push_back(extent.minY);
+        gridExtents.push_back(extent.maxY);
+        int count = grid->getFeatureCount();
+        for (int k = 0; k < count; ++k) {
+            auto iter = indexOfFeature.find(grid->getFeature(k));
+            if (iter != indexOfFeature.end())
+                gridFeatures.push_back(iter->second);
+        }
+        gridOffsets.push_back(gridFeatures.size());
+    }
+}
+
+bool LayerWriter::write(FileWriter& writer)
+{
+    // The offsets are from the start of the layer
+    uint64_t layerBegin = writer.getWritten();
+    writer.write(&header, sizeof(header));
+
+    for (int i = 0; i < kSectionsCount && writer.isOk(); ++i) {
+        writer.padTo(layerBegin + header.sections[i].offset);
+        if (i != kSectionPoints) {
+            writer.write(sectionData[i], header.sections[i].size);
+            continue;
+        }
+        // The points, ring by ring
+        for (auto& feature : features) {
+            visitGeometry(feature->getGeometry(), []() {},
+                [&writer](const GeoRawPoint* points, int count) {
+                    writer.write(points, count * sizeof(GeoRawPoint));
+                });
+        }
+    }
+    writer.padTo(layerBegin + totalSize);
+
+    return writer.isOk();
+}
+
+
+/****************************************/
+/*                                      */
+/*     Read a layer                     */
+/*                                      */
+/****************************************/
+
+template<typename T>
+const T* sectionArray(const char* data, const LayerHeader& header, int id, uint64_t count)
+{
+    if (header.sections[id].size != count * sizeof(T))
+        return nullptr;
+    return reinterpret_cast<const T*>(data + header.sections[id].offset);
+}
+
+// Start at 0, never decrease, end at `total`
+bool checkOffsets(const uint64_t* offsets, uint64_t count, uint64_t total)
+{
+    if (!offsets || offsets[0] != 0 || offsets[count] != total)
+        return false;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (offsets[i + 1] < offsets[i])
+            return false;
+    }
+    return true;
+}
+
+/* data: the layer snapshot (8-byte aligned), in a mapping or in memory
+** nullptr if the snapshot is invalid */
+GeoFeatureLayer* readLayer(const char* data, uint64_t size)
+{
+    LayerHeader header;
+    if (size < sizeof(header)) {
+        LError("Invalid snapshot: too small");
+        return nullptr;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kLayerMagic, sizeof(kLayerMagic)) != 0) {
+        LError("Invalid snapshot: not a layer snapshot");
+        return nullptr;
+    }
+    if (header.byteOrder != kByteOrder || header.version != kVersion) {
+        LError("Unsupported snapshot: version {0}", header.version);
+        return nullptr;
+    }
+    for (int i = 0; i < kSectionsCount; ++i) {
+        const Section& section = header.sections[i];
+        if (section.offset % 8 != 0 || section.offset > size || section.size > size - section.offset) {
+            LError("Invalid snapshot: section {0} out of the file", i);
+            return nullptr;
+        }
+    }
+    // Each element takes at least one byte
+    if (header.featuresCount > uint64_t(INT_MAX) || header.fieldsCount < 0
+        || header.partsCount > size || header.ringsCount > size
+        || header.pointsCount > size || header.gridsCount > size)
+    {
+        LError("Invalid snapshot: counts");
+        return nullptr;
+    }
+    // Unknown to the switches on them
+    if (header.geometryType < kPoint || header.geometryType > kGeometryTypeUnknown
+        || header.styleMode < kSingleStyle || header.styleMode > kRuleBased)
+    {
+        LWarn("Snapshot layer skipped: geometry type {0}, style mode {1}", header.geometryType, header.styleMode);
+        return nullptr;
+    }
+
+    int featuresCount = int(header.featuresCount);
+    uint64_t partsCount = header.partsCount;
+    uint64_t ringsCount = header.ringsCount;
+    uint64_t pointsCount = header.pointsCount;
+    auto geomTypes = sectionArray<uint8_t>(data, header, kSectionGeomTypes, featuresCount);
+    auto geomOffsets = sectionArray<uint64_t>(data, header, kSectionGeomOffsets, featuresCount + 1ULL);
+    auto partOffsets = sectionArray<uint64_t>(data, header, kSectionPartOffsets, partsCount + 1);
+    auto ringOffsets = sectionArray<uint64_t>(data, header, kSectionRingOffsets, ringsCount + 1);
+    auto points = sectionArray<GeoRawPoint>(data, header, kSectionPoints, pointsCount);
+    auto extents = sectionArray<double>(data, header, kSectionExtents, featuresCount * 4ULL);
+    auto colors = sectionArray<uint32_t>(data, header, kSectionColors, featuresCount * 2ULL);
+    if (!geomTypes || !extents || !colors || (pointsCount > 0 && !points)
+        || !checkOffsets(geomOffsets, featuresCount, partsCount)
+        || !checkOffsets(partOffsets, partsCount, ringsCount)
+        || !checkOffsets(ringOffsets, ringsCount, pointsCount))
+    {
+        LError("Invalid snapshot: geometries");
+        return nullptr;
+    }
+
+    // Triangles, optional
+    auto triangleOffsets = sectionArray<uint64_t>(data, header, kSectionTriangleOffsets, partsCount + 1);
+    uint64_t trianglesCount = header.sections[kSectionTriangles].size / sizeof(uint32_t);
+    auto triangles = sectionArray<uint32_t>(data, header, kSectionTriangles, trianglesCount);
+    bool hasTriangles = header.sections[kSectionTriangleOffsets].size > 0;
+    if (hasTriangles && (!checkOffsets(triangleOffsets, partsCount, trianglesCount)
+                         || (trianglesCount > 0 && !triangles))) {
+        LError("Invalid snapshot: triangles");
+        return nullptr;
+    }
+
+    // Properties and fields
+    const Section& metaSection = header.sections[kSectionMeta];
+    ByteReader meta(data + metaSection.offset, metaSection.size);
+    QString name = meta.getString();
+    QString spatialRef = meta.getString();
+
+    GeoFeatureLayer* layer = new GeoFeatureLayer();
+    struct Column {
+        GeoFieldType type;
+        const char* data;
+        uint64_t size;
+    };
+    std::vector<Column> columns;
+    const Section& columnsSection = header.sections[kSectionColumns];
+    for (int i = 0; i < header.fieldsCount; ++i) {
+        Column column;
+        column.type = GeoFieldType(meta.get<int32_t>());
+        int width = meta.get<int32_t>();
+        QString fieldName = meta.getString();
+        uint64_t columnOffset = meta.get<uint64_t>();
+        column.size = meta.get<uint64_t>();
+        column.data = data + columnsSection.offset + columnOffset;
+
+        bool ok = meta.isOk() && columnOffset <= columnsSection.size
+            && column.size <= columnsSection.size - columnOffset && columnOffset % 8 == 0;
+        switch (column.type) {
+        default:
+            ok = false;
+            break;
+        case kFieldInt:
+            ok = ok && column.size == featuresCount * sizeof(int32_t);
+            break;
+        case kFieldDouble:
+            ok = ok && column.size == featuresCount * sizeof(double);
+            break;
+        case kFieldText: {
+            uint64_t offsetsSize = (featuresCount + 1ULL) * sizeof(uint64_t);
+            ok = ok && column.size >= offsetsSize
+                && checkOffsets(reinterpret_cast<const uint64_t*>(column.data), featuresCount,
+                                column.size - offsetsSize);
+            break;
+        }
+        }
+        if (!ok) {
+            LError("Invalid snapshot: field {0}", i);
+            delete layer;
+            return nullptr;
+        }
+        layer->addField(new GeoFieldDefn(fieldName, width, column.type));
+        columns.push_back(column);
+    }
+
+    // Features, in parallel
+    std::vector<GeoFeature*> features(featuresCount, nullptr);
+    std::atomic<bool> failed(false);
+    utils::parallelFor(0, featuresCount, [&](int i) {
+        if (failed)
+            return;
+
+        auto makeRing = [&](uint64_t iRing, GeoLineString* lineString) {
+            uint64_t first = ringOffsets[iRing];
+            uint64_t count = ringOffsets[iRing + 1] - first;
+            if (count > uint64_t(INT_MAX))
+                return false;
+            lineString->setPoints(points + first, int(count));
+            return true;
+        };
+        auto makePolygon = [&](uint64_t iPart) -> GeoPolygon* {
+            GeoPolygon* polygon = new GeoPolygon();
+            uint64_t firstRing = partOffsets[iPart];
+            uint64_t lastRing = partOffsets[iPart + 1];
+            if (lastRing > firstRing)
+                polygon->reserveInteriorRingsCount(int(lastRing - firstRing - 1));
+            for (uint64_t r = firstRing; r < lastRing; ++r) {
+                GeoLinearRing* ring = new GeoLinearRing();
+                if (r == firstRing)
+                    polygon->setExteriorRing(ring);
+                else
+                    polygon->addInteriorRing(ring);
+                if (!makeRing(r, ring)) {
+                    delete polygon;
+                    return nullptr;
+                }
+            }
+            return polygon;
+        };
+        // Point: 1 ring of 1 point
+        auto isPointPart = [&](uint64_t iPart) {
+            uint64_t iRing = partOffsets[iPart];
+            return partOffsets[iPart + 1] == iRing + 1 && ringOffsets[iRing + 1] == ringOffsets[iRing] + 1;
+        };
+        // LineString: 1 ring
+        auto isLinePart = [&](uint64_t iPart) {
+            return partOffsets[iPart + 1] == partOffsets[iPart] + 1;
+        };
+
+        uint64_t firstPart = geomOffsets[i];
+        uint64_t lastPart = geomOffsets[i + 1];
+        uint64_t partsOfFeature = lastPart - firstPart;
+        GeoGeometry* geom = nullptr;
+        switch (geomTypes[i]) {
+        default:
+            break;
+        case kPoint:
+            if (partsOfFeature == 1 && isPointPart(firstPart)) {
+                const GeoRawPoint& point = points[ringOffsets[partOffsets[firstPart]]];
+                geom = new GeoPoint(point.x, point.y);
+            }
+            break;
+        case kLineString:
+            if (partsOfFeature == 1 && isLinePart(firstPart)) {
+                GeoLineString* lineString = new GeoLineString();
+                if (makeRing(partOffsets[firstPart], lineString))
+                    geom = lineString;
+                else
+                    delete lineString;
+            }
+            break;
+        case kPolygon:
+            if (partsOfFeature == 1)
+                geom = makePolygon(firstPart);
+            break;
+        case kMultiPoint: {
+            GeoMultiPoint* multiPoint = new GeoMultiPoint();
+            multiPoint->reserveNumGeoms(int(partsOfFeature));
+            geom = multiPoint;
+            for (uint64_t p = firstPart; p < lastPart; ++p) {
+                if (!isPointPart(p)) {
+                    delete multiPoint;
+                    geom = nullptr;
+                    break;
+                }
+                const GeoRawPoint& point = points[ringOffsets[partOffsets[p]]];
+                multiPoint->addPoint(new GeoPoint(point.x, point.y));
+            }
+            break;
+        }
+        case kMultiLineString: {
+            GeoMultiLineString* multiLineString = new GeoMultiLineString();
+            multiLineString->reserveNumGeoms(int(partsOfFeature));
+            geom = multiLineString;
+            for (uint64_t p = firstPart; p < lastPart; ++p) {
+                GeoLineString* lineString = new GeoLineString();
+                multiLineString->addLineString(lineString);
+                if (!isLinePart(p) || !makeRing(partOffsets[p], lineString)) {
+                    delete multiLineString;
+                    geom = nullptr;
+                    break;
+                }
+            }
+            break;
+        }
+        case kMultiPolygon: {
+            GeoMultiPolygon* multiPolygon = new GeoMultiPolygon();
+            multiPolygon->reserveNumGeoms(int(partsOfFeature));
+            geom = multiPolygon;
+            for (uint64_t p = firstPart; p < lastPart; ++p) {
+                GeoPolygon* polygon = makePolygon(p);
+                if (!polygon) {
+                    delete multiPolygon;
+                    geom = nullptr;
+                    break;
+                }
+                multiPolygon->addPolygon(polygon);
+            }
+            break;
+        }
+        }
+
+        // The triangles must refer to the points of their part
+        if (geom && hasTriangles) {
+            for (uint64_t p = firstPart; p < lastPart; ++p) {
+                uint64_t partPoints = ringOffsets[partOffsets[p + 1]] - ringOffsets[partOffsets[p]];
+                for (uint64_t k = triangleOffsets[p]; k < triangleOffsets[p + 1]; ++k) {
+                    if (triangles[k] >= partPoints) {
+                        delete geom;
+                        geom = nullptr;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!geom) {
+            failed = true;
+            return;
+        }
+
+        GeoFeature* feature = new GeoFeature(layer);
+        feature->setGeometry(geom);
+        const double* extent = extents + i * 4ULL;
+        feature->setExtent(GeoExtent(extent[0], extent[1], extent[2], extent[3]));
+        feature->setColor(colors[i * 2ULL], false);
+        feature->setBorderColor(int(colors[i * 2ULL + 1]), false);
+
+        int fieldsCount = columns.size();
+        for (int iField = 0; iField < fieldsCount; ++iField) {
+            const Column& column = columns[iField];
+            switch (column.type) {
+            default:
+                break;
+            case kFieldInt: {
+                int32_t value;
+                memcpy(&value, column.data + i * sizeof(int32_t), sizeof(value));
+                feature->setField(iField, int(value));
+                break;
+            }
+            case kFieldDouble: {
+                double value;
+                memcpy(&value, column.data + i * sizeof(double), sizeof(value));
+                feature->setField(iField, value);
+                break;
+            }
+            case kFieldText: {
+                const uint64_t* offsets = reinterpret_cast<const uint64_t*>(column.data);
+                const char* text = column.data + (featuresCount + 1ULL) * sizeof(uint64_t);
+                feature->setField(iField, QString::fromUtf8(text + offsets[i], int(offsets[i + 1] - offsets[i])));
+                break;
+            }
+            }
+        }
+        features[i] = feature;
+    }, 256);
+
+    if (failed) {
+        LError("Invalid snapshot: geometries");
+        for (auto& feature : features)
+            delete feature;
+        delete layer;
+        return nullptr;
+    }
+
+    // In the order of the file, the FIDs are 0, 1, 2, ...
+    layer->reserveFeatureCount(featuresCount);
+    for (auto& feature : features)
+        layer->addFeature(feature);
+    layer->setName(name);
+    layer->setSpatialRef(spatialRef);
+    layer->setGeometryType(GeometryType(header.geometryType));
+    layer->setStyleMode(LayerStyleMode(header.styleMode));
+    layer->setVisible(header.visible != 0);
+    layer->setExtent(GeoExtent(header.extent[0], header.extent[1], header.extent[2], header.extent[3]));
+
+    // Grid index
+    uint64_t gridsCount = header.gridsCount;
+    auto gridExtents = sectionArray<double>(data, header, kSectionGridExtents, gridsCount * 4);
+    auto gridOffsets = sectionArray<uint64_t>(data, header, kSectionGridOffsets, gridsCount + 1);
+    uint64_t gridFeaturesCount = header.sections[kSectionGridFeatures].size / sizeof(uint32_t);
+    auto gridFeatures = sectionArray<uint32_t>(data, header, kSectionGridFeatures, gridFeaturesCount);
+    bool gridOk = gridsCount > 0 && gridsCount <= uint64_t(INT_MAX) && gridExtents
+        && checkOffsets(gridOffsets, gridsCount, gridFeaturesCount);
+    for (uint64_t k = 0; gridOk && k < gridFeaturesCount; ++k)
+        gridOk = gridFeatures[k] < uint32_t(featuresCount);
+    if (gridOk) {
+        GridIndex* gridIndex = new GridIndex();
+        gridIndex->reserve(int(gridsCount));
+        for (uint64_t g = 0; g < gridsCount; ++g) {
+            const double* extent = gridExtents + g * 4;
+            Grid* grid = new Grid(int(g), GeoExtent(extent[0], extent[1], extent[2], extent[3]));
+            for (uint64_t k = gridOffsets[g]; k < gridOffsets[g + 1]; ++k)
+                grid->addFeature(features[gridFeatures[k]]);
+            grid->adjustToFit();
+            gridIndex->addGrid(grid);
+        }
+        layer->setGridIndex(gridIndex);
+    }
+    else {
+        layer->createGridIndex();
+    }
+
+    if (hasTriangles) {
+        auto cache = std::make_shared<GeoTriangleCache>();
+        cache->featureParts.assign(geomOffsets, geomOffsets + featuresCount + 1);
+        cache->partOffsets.assign(triangleOffsets, triangleOffsets + partsCount + 1);
+        cache->indices.assign(triangles, triangles + trianglesCount);
+        layer->setTriangleCache(cache);
+    }
+
+    return layer;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Files                            */
+/*                                      */
+/****************************************/
+
+/* Written to a temporary file first, so the old file is kept
+**   if something goes wrong */
+template<typename WriteFunc>
+bool writeFile(const std::string& filename, WriteFunc&& writeFunc)
+{
+    std::string tempFilename = filename + ".tmp";
+    FILE* fp = fopen(tempFilename.c_str(), "wb");
+    if (!fp) {
+        LError("Open file to write error: {0}", tempFilename);
+        return false;
+    }
+    setvbuf(fp, nullptr, _IOFBF, 1 << 20);
+
+    bool ok = writeFunc(fp);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) {
+        LError("Write file error: {0}", tempFilename);
+        remove(tempFilename.c_str());
+        return false;
+    }
+
+    remove(filename.c_str());
+    if (rename(tempFilename.c_str(), filename.c_str()) != 0) {
+        LError("Rename {0} to {1} error", tempFilename, filename);
+        return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+
+/****************************************/
+/*                                      */
+/*     Layer snapshot                   */
+/*                                      */
+/****************************************/
+
+bool Snapshot::saveLayer(GeoFeatureLayer* layer, const std::string& filename, bool withTriangles /*= true*/)
+{
+    if (!layer) {
+        LError("Input layer is null");
+        return false;
+    }
+
+    LayerWriter writer(layer, withTriangles);
+    if (!writer.prepare())
+        return false;
+
+    return writeFile(filename, [&writer](FILE* fp) {
+        FileWriter fileWriter(fp);
+        return writer.write(fileWriter);
+    });
+}
+
+GeoFeatureLayer* Snapshot::loadLayer(const std::string& filename)
+{
+    MappedFile mappedFile;
+    if (!mappedFile.open(filename)) {
+        LError("Open snapshot error: {0}", filename);
+        return nullptr;
+    }
+    mappedFile.adviseSequential();
+    return readLayer(mappedFile.data(), mappedFile.size());
+}
+
+
+/****************************************/
+/*                                      */
+/*     Project                          */
+/*                                      */
+/****************************************/
+
+bool Snapshot::saveMap(GeoMap* map, const std::string& filename)
+{
+    if (!map) {
+        LError("Input map is null");
+        return false;
+    }
+
+    return writeFile(filename, [map](FILE* fp) {
+        FileWriter writer(fp);
+
+        ProjectHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kProjectMagic, sizeof(kProjectMagic));
+        header.byteOrder = kByteOrder;
+        header.version = kVersion;
+        // The rasters only in memory (outputs of the tools) have no file
+        //  to refer to, they are not saved
+        header.layersCount = 0;
+        for (int order = 0; order < map->getNumLayers(); ++order) {
+            GeoLayer* layer = map->getLayerByOrder(order);
+            if (layer->getLayerType() == kRasterLayer && layer->toRasterLayer()->getSourcePath().isEmpty())
+                LWarn("Raster layer {0} not saved, only in memory", layer->getName().toStdString());
+            else
+                ++header.layersCount;
+        }
+        writer.write(&header, sizeof(header));
+
+        ByteWriter mapName;
+        mapName.putString(map->getName());
+        writer.write(mapName.bytes.data(), mapName.bytes.size());
+        writer.padTo(align8(writer.getWritten()));
+
+        // From the bottom to the top, the layers are added again in this order
+        for (int order = map->getNumLayers() - 1; order >= 0 && writer.isOk(); --order) {
+            GeoLayer* layer = map->getLayerByOrder(order);
+            ProjectEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.layerType = layer->getLayerType();
+
+            if (layer->getLayerType() == kFeatureLayer) {
+                LayerWriter layerWriter(layer->toFeatureLayer(), true);
+                if (!layerWriter.prepare())
+                    return false;
+                entry.size = layerWriter.getSize();
+                writer.write(&entry, sizeof(entry));
+                if (!layerWriter.write(writer))
+                    return false;
+            }
+            else {
+                GeoRasterLayer* rasterLayer = layer->toRasterLayer();
+                if (rasterLayer->getSourcePath().isEmpty())
+                    continue;
+                ByteWriter raster;
+                raster.put<int32_t>(rasterLayer->isVisible() ? 1 : 0);
+                raster.putString(rasterLayer->getName());
+                raster.putString(rasterLayer->getSourcePath());
+                entry.size = align8(raster.bytes.size());
+                writer.write(&entry, sizeof(entry));
+                writer.write(raster.bytes.data(), raster.bytes.size());
+                writer.padTo(align8(writer.getWritten()));
+            }
+        }
+        return writer.isOk();
+    });
+}
+
+GeoMap* Snapshot::loadMap(const std::string& filename)
+{
+    MappedFile mappedFile;
+    if (!mappedFile.open(filename)) {
+        LError("Open project error: {0}", filename);
+        return nullptr;
+    }
+    mappedFile.adviseSequential();
+    const char* data = mappedFile.data();
+    uint64_t size = mappedFile.size();
+
+    ProjectHeader header;
+    if (size < sizeof(header)) {
+        LError("Invalid project: too small");
+        return nullptr;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kProjectMagic, sizeof(kProjectMagic)) != 0
+        || header.byteOrder != kByteOrder || header.version != kVersion)
+    {
+        LError("Invalid project: {0}", filename);
+        return nullptr;
+    }
+
+    ByteReader nameReader(data + sizeof(header), size - sizeof(header));
+    QString mapName = nameReader.getString();
+    if (!nameReader.isOk()) {
+        LError("Invalid project: map's name");
+        return nullptr;
+    }
+    uint64_t offset = align8(sizeof(header) + nameReader.getPosition());
+
+    GeoMap* map = new GeoMap();
+    map->setName(mapName);
+    for (uint32_t i = 0; i < header.layersCount; ++i) {
+        ProjectEntry entry;
+        if (offset > size || size - offset < sizeof(entry)) {
+            LError("Invalid project: layer {0} out of the file", i);
+            delete map;
+            return nullptr;
+        }
+        memcpy(&entry, data + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (entry.size > size - offset) {
+            LError("Invalid project: layer {0} out of the file", i);
+            delete map;
+            return nullptr;
+        }
+
+        if (entry.layerType == kFeatureLayer) {
+            // The entry is in the file, the next ones can still be read
+            GeoFeatureLayer* layer = readLayer(data + offset, entry.size);
+            if (layer)
+                map->addLayer(layer);
+            else
+                LWarn("Feature layer {0} of the project skipped", i);
+        }
+        else {
+            // Read from its source file again
+            ByteReader raster(data + offset, entry.size);
+            bool visible = raster.get<int32_t>() != 0;
+            QString name = raster.getString();
+            QString sourcePath = raster.getString();
+            GeoRasterLayer* layer = raster.isOk() ? FileReader::readTiff(sourcePath, map) : nullptr;
+            if (layer) {
+                layer->setName(name);
+                layer->setVisible(visible);
+            }
+            else {
+                LWarn("Raster layer {0} skipped, can't read {1}", name.toStdString(), sourcePath.toStdString());
+            }
+        }
+        offset = align8(offset + entry.size);
+    }
+
+    return map;
+}
@@ -0,0 +1,46 @@
+/*************************************************************
+** class name:  Snapshot
+**
+** description: Native binary files of iCGIS
+**
+**              Layer snapshot (*.icgl): one feature layer,
+**                stored the way it is loaded
+**                - packed coordinates, with offsets of the
+**                  parts, rings and points of every feature
+**                - the extents of the features
+**                - one column per field (text: offsets + bytes)
+**                - the colors of the features (style)
+**                - the grid index
+**                - optionally the triangles of the polygons
+**
+**              The file is memory-mapped and the arrays are
+**                copied straight into the layer, nothing is
+**                parsed or computed again (no extent, no grid
+**                index, no earcut).
+**
+**              Project (*.icgp): the whole map, the layers
+**                from the bottom to the top with their styles.
+**                Feature layers are embedded as snapshots,
+**                raster layers refer to their source file
+**                (the rasters only in memory are left out).
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <string>
+
+#include "geo/map/geomap.h"
+
+
+class Snapshot {
+public:
+    /* Layer snapshot
+    ** withTriangles: save the triangles of the polygons as well */
+    static bool saveLayer(GeoFeatureLayer* layer, const std::string& filename, bool withTriangles = true);
+    static GeoFeatureLayer* loadLayer(const std::string& filename);
+
+    /* Project */
+    static bool saveMap(GeoMap* map, const std::string& filename);
+    static GeoMap* loadMap(const std::string& filename);
+};
@@ -0,0 +1,289 @@
+#include "geo/utility/virtuallayer.h"
+
+#include "geo/utility/geo_convert.h"
+#include "util/logger.h"
+#include "util/utility.h"
+
+#include <gdal/gdal_frmts.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+namespace {
+
+// Features per tile wanted, sets the size of the grid
+const GIntBig kFeaturesPerTile = 1024;
+// At most kMaxGridSize x kMaxGridSize tiles
+const int kMaxGridSize = 1024;
+
+} // namespace
+
+
+VirtualLayerSource::~VirtualLayerSource()
+{
+    // The features belong to the layer
+    if (poDS)
+        GDALClose(poDS);
+}
+
+
+/*************************************************/
+/*                                               */
+/*                 Open the source               */
+/*                                               */
+/*************************************************/
+VirtualLayerSource* VirtualLayerSource::open(const char* path, GeoFeatureLayer* layerOut,
+                                             const char* where /*= nullptr*/, int maxTiles /*= 64*/)
+{
+    if (!path || !layerOut)
+        return nullptr;
+
+    GDALAllRegister();
+    CPLSetConfigOption("GDAL_FILENAME_IS_UTF8", "NO");
+    CPLSetConfigOption("SHAPE_ENCODING", "");
+    GDALDataset* poDS = (GDALDataset*)GDALOpenEx(path, GDAL_OF_VECTOR, nullptr, nullptr, nullptr);
+    if (!poDS) {
+        LError("Open {0} error", path);
+        return nullptr;
+    }
+    if (poDS->GetLayerCount() < 1) {
+        LError("No layer in {0}", path);
+        GDALClose(poDS);
+        return nullptr;
+    }
+
+    OGRLayer* poLayer = poDS->GetLayer(0);
+    OGREnvelope envelope;
+    if (poLayer->GetExtent(&envelope, TRUE) != OGRERR_NONE) {
+        LError("Get the extent of {0} error", path);
+        GDALClose(poDS);
+        return nullptr;
+    }
+    // Without the attribute filter, cheap for most drivers
+    GIntBig featureCount = poLayer->GetFeatureCount(TRUE);
+
+    if (where && where[0] != '\0' && poLayer->SetAttributeFilter(where) != OGRERR_NONE) {
+        LError("Invalid attribute filter: {0}", where);
+        GDALClose(poDS);
+        return nullptr;
+    }
+
+    VirtualLayerSource* source = new VirtualLayerSource();
+    source->poDS = poDS;
+    source->poLayer = poLayer;
+    source->layer = layerOut;
+    source->maxTiles = std::max(1, maxTiles);
+    source->color = utils::getRandomColor();
+    source->extent = GeoExtent(envelope.MinX, envelope.MaxX, envelope.MinY, envelope.MaxY);
+
+    // Square grid, about kFeaturesPerTile features per tile if they are spread evenly
+    GIntBig numTiles = std::max<GIntBig>(1, featureCount / kFeaturesPerTile);
+    int gridSize = std::min(kMaxGridSize, int(std::ceil(std::sqrt(double(numTiles)))));
+    source->cols = source->extent.width() > 0.0 ? gridSize : 1;
+    source->rows = source->extent.height() > 0.0 ? gridSize : 1;
+    source->tileWidth = source->extent.width() > 0.0 ? source->extent.width() / source->cols : 1.0;
+    source->tileHeight = source->extent.height() > 0.0 ? source->extent.height() / source->rows : 1.0;
+
+    layerOut->setName(poLayer->GetName());
+    layerOut->setGeometryType(convertOGRwkbGeometryType(poLayer->GetGeomType()));
+    convertOGRFeatureDefn(poLayer->GetLayerDefn(), layerOut);
+    layerOut->setExtent(source->extent);
+
+    LInfo("Virtual layer {0}: {1} features, {2}x{3} tiles",
+          path, featureCount, source->cols, source->rows);
+
+    return source;
+}
+
+
+/*************************************************/
+/*                                               */
+/*              Follow the view                  */
+/*                                               */
+/*************************************************/
+bool VirtualLayerSource::update(const GeoExtent& viewExtent,
+                                std::vector<GeoFeature*>& featuresAdded, bool& featuresRemoved)
+{
+    featuresRemoved = false;
+    if (!viewExtent.isIntersect(extent))
+        return false;
+
+    // Tiles covered by the view
+    int colBegin = toCol(viewExtent.minX), colEnd = toCol(viewExtent.maxX);
+    int rowBegin = toRow(viewExtent.minY), rowEnd = toRow(viewExtent.maxY);
+
+    std::vector<int> visible;
+    visible.reserve((colEnd - colBegin + 1) * (rowEnd - rowBegin + 1));
+    for (int row = rowBegin; row <= rowEnd; ++row)
+        for (int col = colBegin; col <= colEnd; ++col)
+            visible.push_back(row * cols + col);
+
+    // Too many: the ones nearest to the center of the view
+    if (int(visible.size()) > maxTiles) {
+        double cx = viewExtent.centerX(), cy = viewExtent.centerY();
+        auto distance = [&](int key) {
+            GeoExtent tileExtent = getTileExtent(key);
+            double dx = tileExtent.centerX() - cx, dy = tileExtent.centerY() - cy;
+            return dx * dx + dy * dy;
+        };
+        std::partial_sort(visible.begin(), visible.begin() + maxTiles, visible.end(),
+                          [&](int a, int b) { return distance(a) < distance(b); });
+        visible.resize(maxTiles);
+    }
+
+    // The cached ones become the most recently used
+    std::vector<Tile> newTiles;
+    for (int key : visible) {
+        auto findIt = tiles.find(key);
+        if (findIt != tiles.end())
+            lruTiles.splice(lruTiles.begin(), lruTiles, findIt->second);
+        else
+            newTiles.push_back({ key, {} });
+    }
+    if (newTiles.empty())
+        return false;
+
+    readTiles(newTiles, featuresAdded);
+    for (auto& tile : newTiles) {
+        lruTiles.push_front(std::move(tile));
+        tiles[lruTiles.front().key] = lruTiles.begin();
+    }
+
+    std::vector<GeoFeature*> featuresEvicted;
+    evictTiles(featuresEvicted);
+    if (!featuresEvicted.empty()) {
+        layer->deleteFeatures(featuresEvicted, false);
+        featuresRemoved = true;
+    }
+
+    // Index the cached features only, the extent stays the one of the source
+    layer->updateExtent();
+    if (!layer->createGridIndex())
+        layer->setGridIndex(nullptr);   // empty, the old index holds deleted features
+    layer->setExtent(extent);
+
+    return !featuresAdded.empty() || featuresRemoved;
+}
+
+int VirtualLayerSource::toCol(double x) const
+{
+    return std::min(cols - 1, std::max(0, int(std::floor((x - extent.minX) / tileWidth))));
+}
+
+int VirtualLayerSource::toRow(double y) const
+{
+    return std::min(rows - 1, std::max(0, int(std::floor((y - extent.minY) / tileHeight))));
+}
+
+GeoExtent VirtualLayerSource::getTileExtent(int key) const
+{
+    int row = key / cols;
+    int col = key % cols;
+    return GeoExtent(extent.minX + col * tileWidth, extent.minX + (col + 1) * tileWidth,
+                     extent.minY + row * tileHeight, extent.minY + (row + 1) * tileHeight);
+}
+
+// One spatial filter for all the new tiles, each feature is then given
+//  to the new tiles its box intersects
+// A feature without FID can't be matched with the one read for another
+//  tile, it is only given to the tile holding the center of its box
+void VirtualLayerSource::readTiles(std::vector<Tile>& newTiles, std::vector<GeoFeature*>& featuresAdded)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<GeoExtent> tileExtents;
+    tileExtents.reserve(newTiles.size());
+    GeoExtent filterExtent = getTileExtent(newTiles[0].key);
+    for (auto& tile : newTiles) {
+        tileExtents.push_back(getTileExtent(tile.key));
+        filterExtent.merge(tileExtents.back());
+    }
+
+    poLayer->SetSpatialFilterRect(filterExtent.minX, filterExtent.minY, filterExtent.maxX, filterExtent.maxY);
+    poLayer->ResetReading();
+
+    int numRead = 0;
+    OGRFeature* poFeature = nullptr;
+    while ((poFeature = poLayer->GetNextFeature()) != nullptr) {
+        OGRGeometry* poGeometry = poFeature->GetGeometryRef();
+        if (!poGeometry) {
+            OGRFeature::DestroyFeature(poFeature);
+            continue;
+        }
+        OGREnvelope envelope;
+        poGeometry->getEnvelope(&envelope);
+        GeoExtent featureExtent(envelope.MinX, envelope.MaxX, envelope.MinY, envelope.MaxY);
+
+        // The rectangle of the filter may cover tiles that are not new
+        GIntBig fid = poFeature->GetFID();
+        std::vector<Tile*> owners;
+        if (fid == OGRNullFID) {
+            int centerKey = toRow(featureExtent.centerY()) * cols + toCol(featureExtent.centerX());
+            for (auto& tile : newTiles) {
+                if (tile.key == centerKey) {
+                    owners.push_back(&tile);
+                    break;
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < newTiles.size(); ++i) {
+                if (tileExtents[i].isIntersect(featureExtent))
+                    owners.push_back(&newTiles[i]);
+            }
+        }
+        if (owners.empty()) {
+            OGRFeature::DestroyFeature(poFeature);
+            continue;
+        }
+
+        // Already decoded for another tile?
+        if (fid == OGRNullFID)
+            fid = nextFakeFID--;
+        auto findIt = features.find(fid);
+        if (findIt == features.end()) {
+            GeoFeature* geoFeature = new GeoFeature(layer);
+            if (!convertOGRFeature(poFeature, geoFeature)) {
+                delete geoFeature;
+                OGRFeature::DestroyFeature(poFeature);
+                continue;
+            }
+            geoFeature->setColor(color, false);
+            layer->addFeature(geoFeature);
+            featuresAdded.push_back(geoFeature);
+            findIt = features.emplace(fid, CachedFeature{ geoFeature, 0 }).first;
+            ++numRead;
+        }
+        for (Tile* tile : owners) {
+            tile->fids.push_back(fid);
+            ++findIt->second.refs;
+        }
+        OGRFeature::DestroyFeature(poFeature);
+    }
+
+    poLayer->SetSpatialFilter(nullptr);
+
+    auto endTime = std::chrono::steady_clock::now();
+    LInfo("Virtual layer: {0} tiles, {1} new features, {2} ms", newTiles.size(), numRead,
+          std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+}
+
+void VirtualLayerSource::evictTiles(std::vector<GeoFeature*>& featuresRemoved)
+{
+    while (int(lruTiles.size()) > maxTiles) {
+        Tile& tile = lruTiles.back();
+        for (GIntBig fid : tile.fids) {
+            auto findIt = features.find(fid);
+            if (findIt == features.end())
+                continue;
+            if (--findIt->second.refs == 0) {
+                featuresRemoved.push_back(findIt->second.feature);
+                features.erase(findIt);
+            }
+        }
+        tiles.erase(tile.key);
+        lruTiles.pop_back();
+    }
+}
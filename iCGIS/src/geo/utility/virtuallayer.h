@@ -0,0 +1,99 @@
+/*************************************************************
+** class name:  VirtualLayerSource
+**
+** description: Features of a layer read lazily through GDAL,
+**              only where the view is
+**
+**              The extent of the source is cut into a grid of
+**                tiles (about 1024 features each). When the view
+**                moves, the tiles it covers and that are not in
+**                the cache are read with one spatial filter (the
+**                driver uses the index of the file, e.g. *.qix
+**                of a shapefile, if there is one)
+**              The decoded tiles are kept in a LRU cache of at
+**                most `maxTiles` tiles, the least recently used
+**                ones are dropped from the layer
+**              A feature in several tiles is decoded once, it is
+**                removed with the last tile holding it
+**              A feature without FID in the source is only held
+**                by the tile of the center of its box
+**
+**              The layer is a normal GeoFeatureLayer holding the
+**                features of the cached tiles, its extent is the
+**                extent of the whole source
+**
+** last change: 2020-04-09
+*************************************************************/
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <gdal/ogrsf_frmts.h>
+
+#include "geo/map/geolayer.h"
+
+
+class VirtualLayerSource {
+public:
+    ~VirtualLayerSource();
+
+    // Open the first layer of `path`, set the name, fields and extent
+    //  of `layerOut`, no feature is read yet
+    // where: attribute filter (OGR SQL), nullptr: all the features
+    static VirtualLayerSource* open(const char* path, GeoFeatureLayer* layerOut,
+                                    const char* where = nullptr, int maxTiles = 64);
+
+    // Read the tiles in `viewExtent` missing from the cache, drop the
+    //  least recently used ones over the limit
+    // A view covering more than `maxTiles` tiles reads those nearest
+    //  to its center
+    // featuresAdded: the new features of the layer (to be sent to GPU)
+    // featuresRemoved: some features were deleted from the layer
+    // return: false if the features of the layer did not change
+    bool update(const GeoExtent& viewExtent, std::vector<GeoFeature*>& featuresAdded, bool& featuresRemoved);
+
+    int getNumCachedTiles() const { return int(lruTiles.size()); }
+
+private:
+    VirtualLayerSource() {}
+
+    struct Tile {
+        int key;                        // row * cols + col
+        std::vector<GIntBig> fids;      // FIDs in the source
+    };
+
+    struct CachedFeature {
+        GeoFeature* feature;
+        int refs;                       // number of tiles holding it
+    };
+
+    // Column/row of the tile holding x/y, clamped to the grid
+    int toCol(double x) const;
+    int toRow(double y) const;
+    GeoExtent getTileExtent(int key) const;
+    void readTiles(std::vector<Tile>& newTiles, std::vector<GeoFeature*>& featuresAdded);
+    void evictTiles(std::vector<GeoFeature*>& featuresRemoved);
+
+private:
+    GDALDataset* poDS = nullptr;
+    OGRLayer* poLayer = nullptr;
+    GeoFeatureLayer* layer = nullptr;
+
+    GeoExtent extent;
+    int cols = 1;
+    int rows = 1;
+    double tileWidth = 1.0;
+    double tileHeight = 1.0;
+    int maxTiles = 64;
+    unsigned int color = 0;
+
+    // Most recently used at the front
+    std::list<Tile> lruTiles;
+    std::unordered_map<int, std::list<Tile>::iterator> tiles;
+    std::unordered_map<GIntBig, CachedFeature> features;
+
+    // FIDs for the features without one in the source
+    GIntBig nextFakeFID = -2;
+};
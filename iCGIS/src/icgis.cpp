@@ -5,13 +5,17 @@
 #include "util/logger.h"
 #include "geo/utility/filereader.h"
 #include "geo/utility/geo_math.h"
+#include "geo/utility/snapshot.h"
 #include "dialog/aboutdialog.h"
 #include "dialog/newmapdialog.h"
 
+#include <algorithm>
+
 #include <QDebug>
 #include <QFileDialog>
 #include <QHBoxLayout>
 #include <QIcon>
+#include <QInputDialog>
 #include <QLabel>
 #include <QMessageBox>
 #include <QMetaType>
@@ -97,6 +101,12 @@ void ICGis::createToolBar() {
 void ICGis::createStatusBar() {
     this->statusBar()->setStyleSheet("QStatusBar::item{border: 0px}");
     statusbar = new StatusBar(this->statusBar());
+
+    // The files being loaded, see openVectorFiles()
+    layerLoadersTimer = new QTimer(this);
+    layerLoadersTimer->setInterval(50);
+    connect(layerLoadersTimer, &QTimer::timeout, this, &ICGis::onPollLayerLoaders);
+    connect(statusbar, &StatusBar::sigCancelProgress, this, &ICGis::onCancelLoading);
 }
 
 void ICGis::createWidgets() {
@@ -132,20 +142,47 @@ void ICGis::createActions() {
     openShapfileAction =
         new QAction(tr("Shapefile"), this); // file -> open -> Shapefile
     openShapfileAction->setIcon(QIcon("res/icons/shapefile.ico"));
+    openGeoPackageAction = new QAction(tr("GeoPackage"), this);
+    openGeoPackageAction->setIcon(QIcon("res/icons/layer.ico"));
     openTiffAction = new QAction(tr("Tiff"), this);
     openTiffAction->setIcon(QIcon("res/icons/tiff.ico"));
     openFileMenu->addAction(openGeoJsonMineAction);
     openFileMenu->addSeparator();
     openFileMenu->addAction(openGeoJsonUsingGDALAction);
     openFileMenu->addAction(openShapfileAction);
+    openFileMenu->addAction(openGeoPackageAction);
     openFileMenu->addAction(openTiffAction);
+    openSnapshotAction = new QAction(tr("Snapshot"), this);
+    openSnapshotAction->setIcon(QIcon("res/icons/layer.ico"));
+    openFileMenu->addAction(openSnapshotAction);
+    openFlatGeobufAction = new QAction(tr("FlatGeobuf"), this);
+    openFlatGeobufAction->setIcon(QIcon("res/icons/layer.ico"));
+    openFileMenu->addAction(openFlatGeobufAction);
+    openVirtualLayerAction = new QAction(tr("Virtual Layer"), this);
+    openVirtualLayerAction->setIcon(QIcon("res/icons/layer.ico"));
+    openFileMenu->addAction(openVirtualLayerAction);
     connect(openGeoJsonMineAction, &QAction::triggered, this,
             &ICGis::onOpenGeoJsonMine);
     connect(openGeoJsonUsingGDALAction, &QAction::triggered, this,
             &ICGis::onOpenGeoJsonUsingGDAL);
     connect(openShapfileAction, &QAction::triggered, this,
             &ICGis::onOpenGeoShapefile);
+    connect(openGeoPackageAction, &QAction::triggered, this, &ICGis::onOpenGeoPackage);
     connect(openTiffAction, &QAction::triggered, this, &ICGis::onOpenTiff);
+    connect(openSnapshotAction, &QAction::triggered, this, &ICGis::onOpenSnapshot);
+    connect(openFlatGeobufAction, &QAction::triggered, this, &ICGis::onOpenFlatGeobuf);
+    connect(openVirtualLayerAction, &QAction::triggered, this, &ICGis::onOpenVirtualLayer);
+
+    // menu: File -> Open Project, Save Project
+    openProjectAction = new QAction(tr("Open Project"), this);
+    openProjectAction->setIcon(QIcon("res/icons/open.ico"));
+    saveProjectAction = new QAction(tr("Save Project"), this);
+    saveProjectAction->setIcon(QIcon("res/icons/save.ico"));
+    fileMenu->addSeparator();
+    fileMenu->addAction(openProjectAction);
+    fileMenu->addAction(saveProjectAction);
+    connect(openProjectAction, &QAction::triggered, this, &ICGis::onOpenProject);
+    connect(saveProjectAction, &QAction::triggered, this, &ICGis::onSaveProject);
 
     // menu: File -> Connect
     connectPostgresqlAction = new QAction(tr("PostgreSQL"), this);
@@ -204,7 +241,7 @@ void ICGis::onNewMap() {
 
 
 // menu: file->open->GeoJson
-// Method1: Parse GeoJson file using JsonCpp library
+// Method1: Parse GeoJson file using our own SAX parser (see GeoJson)
 void ICGis::onOpenGeoJsonMine() {
     QStringList files = QFileDialog::getOpenFileNames(
         this, tr("Open File"), "", tr("json files(*.json)"), nullptr,
@@ -241,10 +278,183 @@ void ICGis::onOpenGeoJsonUsingGDAL() {
         return;
     }
 
+    openVectorFiles(files);
+}
+
+// menu: file->open->Shapefile
+void ICGis::onOpenGeoShapefile() {
+    QStringList files = QFileDialog::getOpenFileNames(
+        this, tr("Open File"), "", tr("shapefile(*.shp)"), nullptr,
+        QFileDialog::DontUseNativeDialog);
+
+    if (files.isEmpty())
+        return;
+
+    // Large files: only the features in the view, filtered by GDAL
+    GeoExtent viewExtent;
+    bool inView = false;
+    if (map->getNumLayers() > 0) {
+        int button = QMessageBox::question(this, "Prompt", "Only read the features in the current view?",
+                                           QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+        if (button == QMessageBox::Cancel)
+            return;
+        inView = (button == QMessageBox::Yes);
+        viewExtent = openGLWidget->getViewExtent();
+    }
+
+    openVectorFiles(files, inView ? &viewExtent : nullptr);
+}
+
+// menu: file->open->GeoPackage
+void ICGis::onOpenGeoPackage() {
+    QStringList files = QFileDialog::getOpenFileNames(
+        this, tr("Open File"), "", tr("GeoPackage(*.gpkg)"), nullptr,
+        QFileDialog::DontUseNativeDialog);
+
+    if (files.isEmpty())
+        return;
+
+    openVectorFiles(files);
+}
+
+// Each file is read by a LayerLoader, the layers can be panned and
+//  zoomed while they are read
+void ICGis::openVectorFiles(const QStringList& files, const GeoExtent* extent /*= nullptr*/) {
+    for (const QString& file : files)
+        addLayerLoader(FileReader::loadVectorFile(file, extent));
+}
+
+void ICGis::addLayerLoader(std::shared_ptr<LayerLoader> loader) {
+    layerLoaders.push_back(loader);
+    if (!layerLoadersTimer->isActive())
+        layerLoadersTimer->start();
+}
+
+void ICGis::onPollLayerLoaders() {
+    // A message box below runs the event loop
+    if (pollingLayerLoaders)
+        return;
+    pollingLayerLoaders = true;
+
+    QStringList failedFiles;
+    bool changed = false;
+    for (auto& loader : layerLoaders) {
+        std::vector<LayerLoader::Event> events;
+        loader->takeEvents(events);
+        for (auto& event : events) {
+            switch (event.type) {
+            case LayerLoader::kLayerReady:
+                // Destroying the layer stops the loader
+                event.layer->setLoader(loader);
+                map->addLayer(event.layer);
+                layersTreeWidget->onAddNewLayer(event.layer);
+                openGLWidget->onSendFeatureLayerToGPU(event.layer, false);    // no feature yet, set the view
+                changed = true;
+                break;
+            case LayerLoader::kFeaturesRead:
+                for (GeoFeature* feature : event.features) {
+                    event.layer->addFeature(feature);
+                    openGLWidget->onSendFeatureToGPU(feature);
+                }
+                changed = true;
+                break;
+            case LayerLoader::kLayerDone:
+                event.layer->setGridIndex(event.index);
+                event.layer->setLoader(nullptr);
+                map->updateExtent();
+                break;
+            case LayerLoader::kFinished:
+                if (!event.ok)
+                    failedFiles.push_back(QString::fromLocal8Bit(loader->getPath().c_str()));
+                break;
+            }
+        }
+    }
+
+    // Progress of all the files
+    long long numRead = 0;
+    long long numTotal = 0;
+    for (auto& loader : layerLoaders) {
+        numRead += loader->getNumFeaturesRead();
+        if (numTotal >= 0)
+            numTotal = loader->getNumFeaturesTotal() < 0 ? -1 : numTotal + loader->getNumFeaturesTotal();
+    }
+    int filesCount = int(layerLoaders.size());
+    layerLoaders.erase(std::remove_if(layerLoaders.begin(), layerLoaders.end(),
+                                      [](const std::shared_ptr<LayerLoader>& loader) { return loader->isFinished(); }),
+                       layerLoaders.end());
+
+    if (layerLoaders.empty()) {
+        layerLoadersTimer->stop();
+        statusbar->hideProgress();
+        statusbar->showMsg(QString("%1 features loaded").arg(numRead), 3000);
+        searchWidget->updateCompleterList();
+    }
+    else {
+        QString msg = QString("Loading %1 file(s): %2").arg(filesCount).arg(numRead);
+        int value = 0;
+        if (numTotal > 0) {
+            msg += QString(" / %1").arg(numTotal);
+            value = int(std::min(1000LL, numRead * 1000 / numTotal));
+        }
+        statusbar->showProgress(msg + " features", value, numTotal > 0 ? 1000 : 0);
+    }
+    if (changed)
+        openGLWidget->update();
+
+    for (const QString& file : failedFiles) {
+        QString errmsg = "Read and parse file failed: " + file;
+        QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
+        LError(errmsg.toStdString());
+    }
+
+    pollingLayerLoaders = false;
+}
+
+// The features read so far are kept and indexed
+void ICGis::onCancelLoading() {
+    for (auto& loader : layerLoaders)
+        loader->cancel();
+    statusbar->showMsg("Canceling...");
+}
+
+// file->open->Tiff
+void ICGis::onOpenTiff() {
+    QStringList files = QFileDialog::getOpenFileNames(
+        this, tr("Open File"), "", tr("TIFF(*.tif)"), nullptr,
+        QFileDialog::DontUseNativeDialog);
+
+    if (files.isEmpty())
+        return;
+
+    for (auto iter = files.begin(); iter != files.end(); ++iter) {
+        GeoRasterLayer *newRasterLayer = FileReader::readTiff(*iter, map);
+        if (!newRasterLayer) {
+            QString errmsg = "Read and parse TIFF image failed: " + *iter;
+            QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
+            LError(errmsg.toStdString());
+            return;
+        }
+        layersTreeWidget->onAddNewLayer(newRasterLayer);
+        openGLWidget->onSendRasterLayerToGPU(newRasterLayer, false); // not update immediately
+    }
+
+    searchWidget->updateCompleterList();
+    openGLWidget->update();
+}
+
+// file->open->Snapshot
+void ICGis::onOpenSnapshot() {
+    QStringList files = QFileDialog::getOpenFileNames(
+        this, tr("Open File"), "", tr("layer snapshot(*.icgl)"), nullptr,
+        QFileDialog::DontUseNativeDialog);
+    if (files.isEmpty())
+        return;
+
     for (auto iter = files.begin(); iter != files.end(); ++iter) {
-        GeoFeatureLayer *newFeatureLayer = FileReader::readGeoJsonUsingGDAL(*iter, map);
+        GeoFeatureLayer *newFeatureLayer = FileReader::readSnapshot(*iter, map);
         if (!newFeatureLayer) {
-            QString errmsg = "Read and parse geoJson failed: " + *iter;
+            QString errmsg = "Read layer snapshot failed: " + *iter;
             QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
             LError(errmsg.toStdString());
             continue;
@@ -257,19 +467,30 @@ void ICGis::onOpenGeoJsonUsingGDAL() {
     openGLWidget->update();
 }
 
-// menu: file->open->Shapefile
-void ICGis::onOpenGeoShapefile() {
+// file->open->FlatGeobuf
+void ICGis::onOpenFlatGeobuf() {
     QStringList files = QFileDialog::getOpenFileNames(
-        this, tr("Open File"), "", tr("shapefile(*.shp)"), nullptr,
+        this, tr("Open File"), "", tr("FlatGeobuf(*.fgb)"), nullptr,
         QFileDialog::DontUseNativeDialog);
-
     if (files.isEmpty())
         return;
 
+    // Large files: only the features in the view, found with the index of the file
+    GeoExtent viewExtent;
+    bool inView = false;
+    if (map->getNumLayers() > 0) {
+        int button = QMessageBox::question(this, "Prompt", "Only read the features in the current view?",
+                                           QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+        if (button == QMessageBox::Cancel)
+            return;
+        inView = (button == QMessageBox::Yes);
+        viewExtent = openGLWidget->getViewExtent();
+    }
+
     for (auto iter = files.begin(); iter != files.end(); ++iter) {
-        GeoFeatureLayer *newFeatureLayer = FileReader::readShapefile(*iter, map);
+        GeoFeatureLayer *newFeatureLayer = FileReader::readFlatGeobuf(*iter, map, inView ? &viewExtent : nullptr);
         if (!newFeatureLayer) {
-            QString errmsg = "Read and parse shapefile failed: " + *iter;
+            QString errmsg = "Read FlatGeobuf failed: " + *iter;
             QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
             LError(errmsg.toStdString());
             continue;
@@ -282,31 +503,108 @@ void ICGis::onOpenGeoShapefile() {
     openGLWidget->update();
 }
 
-// file->open->Tiff
-void ICGis::onOpenTiff() {
+// file->open->Virtual Layer
+void ICGis::onOpenVirtualLayer() {
     QStringList files = QFileDialog::getOpenFileNames(
-        this, tr("Open File"), "", tr("TIFF(*.tif)"), nullptr,
+        this, tr("Open File"), "", tr("Vector(*.shp *.fgb *.gpkg *.geojson *.json)"), nullptr,
         QFileDialog::DontUseNativeDialog);
-
     if (files.isEmpty())
         return;
 
+    bool ok = false;
+    QString where = QInputDialog::getText(this, "Attribute Filter",
+                                          "Only the features where (e.g. POP > 10000), empty for all:",
+                                          QLineEdit::Normal, "", &ok);
+    if (!ok)
+        return;
+
     for (auto iter = files.begin(); iter != files.end(); ++iter) {
-        GeoRasterLayer *newRasterLayer = FileReader::readTiff(*iter, map);
-        if (!newRasterLayer) {
-            QString errmsg = "Read and parse TIFF image failed: " + *iter;
+        GeoFeatureLayer *newFeatureLayer = FileReader::readVirtualLayer(*iter, map, where.trimmed());
+        if (!newFeatureLayer) {
+            QString errmsg = "Open virtual layer failed: " + *iter;
             QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
             LError(errmsg.toStdString());
-            return;
+            continue;
         }
-        layersTreeWidget->onAddNewLayer(newRasterLayer);
-        openGLWidget->onSendRasterLayerToGPU(newRasterLayer, false); // not update immediately
+        layersTreeWidget->onAddNewLayer(newFeatureLayer);
+        // No feature yet, they are read once the view is known
+        openGLWidget->onSendFeatureLayerToGPU(newFeatureLayer, false);
+    }
+
+    searchWidget->updateCompleterList();
+    openGLWidget->update();
+}
+
+// file->Open Project
+void ICGis::onOpenProject() {
+    QString filepath = QFileDialog::getOpenFileName(
+        this, tr("Open Project"), "", tr("iCGIS project(*.icgp)"), nullptr,
+        QFileDialog::DontUseNativeDialog);
+    if (filepath.isEmpty())
+        return;
+
+    QByteArray bytes = filepath.toLocal8Bit();
+    GeoMap* newMap = Snapshot::loadMap(bytes.data());
+    if (!newMap) {
+        QString errmsg = "Open project failed: " + filepath;
+        QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
+        LError(errmsg.toStdString());
+        return;
     }
 
+    // Replace the whole map
+    delete map;
+    map = newMap;
+    projectPath = filepath;
+    LInfo("Open project: {0}", bytes.data());
+
+    layersTreeWidget->onUpdateLayersTree();
+    openGLWidget->onSendMapToGPU(false);
+    openGLWidget->onZoomToMap();
     searchWidget->updateCompleterList();
     openGLWidget->update();
 }
 
+// file->Save Project
+// Return false if the project was not saved
+bool ICGis::onSaveProject() {
+    // The rasters only in memory can't be saved in the project
+    QStringList memoryRasters;
+    for (auto iter = map->begin(); iter != map->end(); ++iter) {
+        if ((*iter)->getLayerType() == kRasterLayer && (*iter)->toRasterLayer()->getSourcePath().isEmpty())
+            memoryRasters.push_back((*iter)->getName());
+    }
+    if (!memoryRasters.isEmpty()) {
+        int button = QMessageBox::warning(
+            this, "Warning",
+            "These raster layers are only in memory and will not be saved:\n" + memoryRasters.join("\n")
+                + "\nSave the project without them?",
+            QMessageBox::Yes | QMessageBox::No);
+        if (button != QMessageBox::Yes)
+            return false;
+    }
+
+    QString filepath = projectPath;
+    if (filepath.isEmpty()) {
+        filepath = QFileDialog::getSaveFileName(
+            this, tr("Save Project"), map->getName() + ".icgp", tr("iCGIS project(*.icgp)"),
+            nullptr, QFileDialog::DontUseNativeDialog);
+        if (filepath.isEmpty())
+            return false;
+    }
+
+    QByteArray bytes = filepath.toLocal8Bit();
+    if (!Snapshot::saveMap(map, bytes.data())) {
+        QString errmsg = "Save project failed: " + filepath;
+        QMessageBox::critical(this, "Error", errmsg, QMessageBox::Ok);
+        LError(errmsg.toStdString());
+        return false;
+    }
+    projectPath = filepath;
+    LInfo("Save project: {0}", bytes.data());
+    return true;
+}
+
 // file->connect->Postgresql
 void ICGis::onConnectPostgresql() {
     postgresqlConnectDialog = new PostgresqlConnect(this);
@@ -314,12 +612,16 @@ void ICGis::onConnectPostgresql() {
     postgresqlConnectDialog->setModal(true);
 
     postgresqlTableSelectDialog = new PostgresqlTableSelect(this);
-    postgresqlTableSelectDialog->setFixedSize(500, 300);
+    postgresqlTableSelectDialog->setFixedSize(500, 400);
     postgresqlTableSelectDialog->setModal(true);
     postgresqlTableSelectDialog->map = this->map;
+    if (!map->isEmpty())
+        postgresqlTableSelectDialog->setViewExtent(openGLWidget->getViewExtent());
 
     connect(postgresqlConnectDialog, &PostgresqlConnect::btnConnectClicked,
             postgresqlTableSelectDialog, &PostgresqlTableSelect::onConnectPostgresql);
+    connect(postgresqlTableSelectDialog, &PostgresqlTableSelect::sigLoadLayers,
+            this, &ICGis::addLayerLoader);
 
     postgresqlConnectDialog->show();
 }
@@ -345,7 +647,12 @@ void ICGis::closeEvent(QCloseEvent *event) {
         return;
     }
     else if (button == QMessageBox::Yes) {
-
+        // Not saved: stay open
+        if (!onSaveProject()) {
+            event->ignore();
+            return;
+        }
+        QMainWindow::closeEvent(event);
     }
     else {
         QMainWindow::closeEvent(event);
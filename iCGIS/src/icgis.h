@@ -12,11 +12,14 @@
 #include <QMainWindow>
 #include <QMenu>
 #include <QMenuBar>
+#include <QTimer>
 #include <QToolBar>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "dialog/postgresqlconnect.h"
 #include "dialog/postgresqltableselect.h"
@@ -28,6 +31,7 @@
 #include "widget/toolbar.h"
 #include "widget/toolboxtreewidget.h"
 #include "geo/map/geomap.h"
+#include "geo/utility/layerloader.h"
 
 
 class ICGis : public QMainWindow {
@@ -52,17 +56,37 @@ public slots:
     void onOpenGeoJsonUsingGDAL();
     void onOpenGeoJsonMine();
     void onOpenGeoShapefile();
+    void onOpenGeoPackage();
     void onOpenTiff();
+    void onOpenSnapshot();
+    void onOpenFlatGeobuf();
+    void onOpenVirtualLayer();
+    void onOpenProject();
+    bool onSaveProject();
     void onConnectPostgresql();
     void onShowLogDialog();
     void onAbout();
 
+    // The layers of the loader are added as they are read
+    void addLayerLoader(std::shared_ptr<LayerLoader> loader);
+    // Add the layers and the features read by the loaders so far
+    void onPollLayerLoaders();
+    void onCancelLoading();
+
 protected:
     virtual void closeEvent(QCloseEvent*) override;
 
+private:
+    // Read the files through GDAL on background threads, their layers are
+    //  added to the layers tree and sent to GPU as they are read
+    void openVectorFiles(const QStringList& files, const GeoExtent* extent = nullptr);
+
 private:
     GeoMap*& map;
 
+    // The project file opened or saved last
+    QString projectPath;
+
     /* Dialog */
     PostgresqlConnect* postgresqlConnectDialog;
     PostgresqlTableSelect* postgresqlTableSelectDialog;
@@ -80,6 +104,11 @@ private:
     /* Status bar */
     StatusBar* statusbar;
 
+    /* Files being loaded */
+    std::vector<std::shared_ptr<LayerLoader>> layerLoaders;
+    QTimer* layerLoadersTimer;
+    bool pollingLayerLoaders = false;
+
     /* MenuBar */
     QMenu* fileMenu;      // File
     QMenu* newFileMenu;   //  File -> New
@@ -95,7 +124,13 @@ private:
     QAction* openGeoJsonUsingGDALAction;
     QAction* openGeoJsonMineAction;
     QAction* openShapfileAction;
+    QAction* openGeoPackageAction;
     QAction* openTiffAction;
+    QAction* openSnapshotAction;
+    QAction* openFlatGeobufAction;
+    QAction* openVirtualLayerAction;
+    QAction* openProjectAction;
+    QAction* saveProjectAction;
     QAction* connectPostgresqlAction;
     QAction* newMapAction;
     QAction* newLayerAction;
@@ -3,7 +3,7 @@
 **
 ** description: A collection of VAO, VBO, IBO(s) for raster data
 **
-** last change: 2020-03-25
+** last change: 2020-04-09
 ********************************************************************/
 #ifndef OPENGLRASTERDESCRIPTOR_H
 #define OPENGLRASTERDESCRIPTOR_H
@@ -24,6 +24,29 @@ public:
     VertexArray*  vao = nullptr;
     IndexBuffer*  ibo = nullptr;
     std::vector<Texture*>  texs;
+
+    // The window of the band in the texture, and the size of the texture
+    int xOff = 0;
+    int yOff = 0;
+    int xSize = 0;
+    int ySize = 0;
+    int texWidth = 0;
+    int texHeight = 0;
+    int level = 0;          // read from, 0: full resolution
+    std::vector<int> bands; // packed in the texture
+
+    // texs[0]: the raw values, texs[1]: the equalization tables,
+    //  texs[2]: the color ramp
+    // [minimum, maximum] of each band, the domain of the equalization
+    std::vector<double> valueRanges;
+    // Of the uniforms and the color ramp
+    int styleVersion = 0;
+
+    // Uniforms of the texture shader: [low, high] of each band mapped
+    //  to [0, 1], histogram equalized after
+    float stretchLow[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float stretchHigh[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    bool equalize = false;
 };
 
 #endif // OPENGLRASTERDESCRIPTOR_H
@@ -71,10 +71,20 @@ void Renderer::DrawTexture(const VertexArray* vao, const IndexBuffer* ibo,
 
     GLCall(glActiveTexture(GL_TEXTURE0));
     GLCall(glBindTexture(GL_TEXTURE_2D, texs[0]->getID()));
+    // Lookup tables of a raster: equalization, color ramp
+    if (texs.size() > 2) {
+        GLCall(glActiveTexture(GL_TEXTURE1));
+        GLCall(glBindTexture(GL_TEXTURE_2D, texs[1]->getID()));
+        GLCall(glActiveTexture(GL_TEXTURE2));
+        GLCall(glBindTexture(GL_TEXTURE_2D, texs[2]->getID()));
+    }
 
     textureShader.Bind();
     textureShader.SetUniform1i("ourTexture", 0);
+    textureShader.SetUniform1i("lutTexture", 1);
+    textureShader.SetUniform1i("rampTexture", 2);
     vao->Bind();
     ibo->Bind();
     GLCall(glDrawElements(GL_TRIANGLES, ibo->getCount(), GL_UNSIGNED_INT, nullptr));
+    GLCall(glActiveTexture(GL_TEXTURE0));
 }
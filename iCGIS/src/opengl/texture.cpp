@@ -25,6 +25,14 @@ Texture::~Texture()
     GLCall(glDeleteTextures(1, &textureID));
 }
 
+void Texture::setData(const void* data, int width, int height, unsigned int dataTypeIn, unsigned int formatIn)
+{
+    GLCall(glBindTexture(GL_TEXTURE_2D, textureID));
+    GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, formatIn, dataTypeIn, data));
+    GLCall(glGenerateMipmap(GL_TEXTURE_2D));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
 void Texture::Bind() const
 {
     GLCall(glBindTexture(GL_TEXTURE_2D, textureID));
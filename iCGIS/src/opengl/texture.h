@@ -1,7 +1,7 @@
 /*******************************************************
 ** class name:  Texture
 **
-** last change: 2020-01-05
+** last change: 2020-04-09
 *******************************************************/
 #pragma once
 
@@ -12,6 +12,10 @@ public:
             unsigned int internalFormatIn, unsigned int formatIn);
     ~Texture();
 
+    // Replace the pixels, same size and format, without a new texture
+    void setData(const void* data, int width, int height,
+                 unsigned int dataTypeIn, unsigned int formatIn);
+
     void Bind() const;
     void UnBind() const;
 
@@ -0,0 +1,212 @@
+#include "util/mappedfile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+size_t MappedFile::getPageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                               OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize) || (unsigned long long)fileSize.QuadPart > SIZE_MAX) {
+        CloseHandle(hFile);
+        return false;
+    }
+    fileHandle = hFile;
+    mapSize = size_t(fileSize.QuadPart);
+
+    if (mapSize > 0) {
+        HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!hMapping) {
+            close();
+            return false;
+        }
+        mappingHandle = hMapping;
+        mapData = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (!mapData) {
+            close();
+            return false;
+        }
+    }
+#else
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close();
+        return false;
+    }
+    mapSize = size_t(st.st_size);
+
+    if (mapSize > 0) {
+        void* addr = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close();
+            return false;
+        }
+        mapData = (const char*)addr;
+    }
+#endif
+
+    opened = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    stopPrefault();
+
+#ifdef _WIN32
+    if (mapData)
+        UnmapViewOfFile(mapData);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapData)
+        munmap((void*)mapData, mapSize);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+
+    mapData = nullptr;
+    mapSize = 0;
+    opened = false;
+}
+
+
+/****************************************/
+/*                                      */
+/*     Access hints                     */
+/*                                      */
+/****************************************/
+
+void MappedFile::adviseSequential()
+{
+#ifndef _WIN32
+    if (mapData)
+        madvise((void*)mapData, mapSize, MADV_SEQUENTIAL);
+#endif
+    // Windows: FILE_FLAG_SEQUENTIAL_SCAN is set when opening
+}
+
+void MappedFile::adviseWillNeed(size_t offset, size_t length)
+{
+    if (!mapData || offset >= mapSize)
+        return;
+    length = std::min(length, mapSize - offset);
+
+    // Align the start to a page
+    size_t pageSize = getPageSize();
+    size_t begin = offset / pageSize * pageSize;
+    length += offset - begin;
+
+#ifdef _WIN32
+    // PrefetchVirtualMemory is only available since Windows 8
+    typedef BOOL (WINAPI *PrefetchFunc)(HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+    static PrefetchFunc prefetch = (PrefetchFunc)GetProcAddress(
+        GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+    if (prefetch) {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = (PVOID)(mapData + begin);
+        range.NumberOfBytes = length;
+        prefetch(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    madvise((void*)(mapData + begin), length, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::release(size_t offset, size_t length)
+{
+    if (!mapData || offset >= mapSize)
+        return;
+    length = std::min(length, mapSize - offset);
+
+    // Only the whole pages inside the range
+    size_t pageSize = getPageSize();
+    size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+    size_t end = (offset + length) / pageSize * pageSize;
+    if (offset + length == mapSize)
+        end = offset + length;
+    if (end <= begin)
+        return;
+
+#ifdef _WIN32
+    // The pages are removed from the working set, they stay in the
+    //   standby list (page cache)
+    VirtualUnlock((LPVOID)(mapData + begin), end - begin);
+#else
+    madvise((void*)(mapData + begin), end - begin, MADV_DONTNEED);
+#endif
+}
+
+
+/****************************************/
+/*                                      */
+/*     Pre-fault                        */
+/*                                      */
+/****************************************/
+
+void MappedFile::startPrefault(size_t aheadBytes /*= 0*/)
+{
+    if (!mapData || prefaultThread.joinable())
+        return;
+
+    stopFlag = false;
+    prefaultThread = std::thread([this, aheadBytes]() {
+        size_t pageSize = getPageSize();
+        volatile char sink = 0;
+        for (size_t offset = 0; offset < mapSize && !stopFlag; offset += pageSize) {
+            while (aheadBytes > 0 && offset > readPosition + aheadBytes && !stopFlag)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            sink += mapData[offset];
+        }
+        (void)sink;
+    });
+}
+
+void MappedFile::stopPrefault()
+{
+    if (prefaultThread.joinable()) {
+        stopFlag = true;
+        prefaultThread.join();
+    }
+}
@@ -0,0 +1,82 @@
+/*******************************************************
+** class name:  MappedFile
+**
+** description: Read-only memory-mapped file
+**
+**              The readers parse the file straight from the
+**                mapping, the bytes are never copied into
+**                buffers of their own. The pages belong to the
+**                page cache: a file opened again is read at
+**                memory speed, and the pages already parsed can
+**                be given back (release) so that the resident
+**                memory doesn't grow with the size of the file.
+**
+**              Access hints: sequential read-ahead, will-need,
+**                and an optional thread touching the pages ahead
+**                of the reader (pre-fault), useful on cold files
+**                and on systems without read-ahead hints.
+**
+** last change: 2020-04-08
+*******************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    /* Map the whole file, false if it can't be opened or mapped
+    ** An empty file is opened successfully (data() is nullptr) */
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return mapData; }
+    size_t size() const { return mapSize; }
+
+    /* The file will be read from the beginning to the end */
+    void adviseSequential();
+
+    /* [offset, offset + length) will be read soon, start reading it */
+    void adviseWillNeed(size_t offset, size_t length);
+
+    /* [offset, offset + length) won't be read again, drop the pages
+    **   from the resident memory (they stay in the page cache) */
+    void release(size_t offset, size_t length);
+
+    /* Touch one byte of every page in a background thread
+    ** aheadBytes > 0: stay at most that far after the read position
+    **   (setReadPosition), so the resident memory stays bounded
+    ** Stopped by close() */
+    void startPrefault(size_t aheadBytes = 0);
+    void setReadPosition(size_t offset) { readPosition = offset; }
+
+    static size_t getPageSize();
+
+private:
+    void stopPrefault();
+
+private:
+    bool opened = false;
+    const char* mapData = nullptr;
+    size_t mapSize = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    std::thread prefaultThread;
+    std::atomic<bool> stopFlag{ false };
+    std::atomic<size_t> readPosition{ 0 };
+};
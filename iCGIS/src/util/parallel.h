@@ -0,0 +1,66 @@
+/*******************************************************
+** namespace:   utils
+**
+** description: Simple data-parallel helpers built on
+**              std::thread (no external dependency)
+**
+** last change: 2020-04-02
+*******************************************************/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+namespace utils {
+
+// Number of worker threads to use, at least 1
+inline int getNumThreads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : int(n);
+}
+
+/* Call func(i) for every i in [begin, end)
+** The range is handed out in chunks of `grain` indices through an atomic
+**   counter, so uneven work (e.g. features with very different numbers of
+**   vertices) is balanced between threads.
+** func must be safe to be called concurrently for different indices. */
+template<typename Func>
+void parallelFor(int begin, int end, Func&& func, int grain = 64)
+{
+    int count = end - begin;
+    if (count <= 0)
+        return;
+    grain = std::max(grain, 1);
+
+    int threadsCount = std::min(getNumThreads(), (count + grain - 1) / grain);
+    if (threadsCount <= 1) {
+        for (int i = begin; i < end; ++i)
+            func(i);
+        return;
+    }
+
+    std::atomic<int> next(begin);
+    auto worker = [&]() {
+        for (;;) {
+            int first = next.fetch_add(grain);
+            if (first >= end)
+                break;
+            int last = std::min(first + grain, end);
+            for (int i = first; i < last; ++i)
+                func(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadsCount - 1);
+    for (int i = 0; i < threadsCount - 1; ++i)
+        threads.emplace_back(worker);
+    worker();   // The calling thread works too
+    for (auto& t : threads)
+        t.join();
+}
+
+} // namespace utils
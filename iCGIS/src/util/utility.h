@@ -35,7 +35,9 @@ enum DataType {
     kInt		= 2,
     kUInt		= 3,
     kFloat		= 4,
-    kDouble		= 5
+    kDouble		= 5,
+    kInt16		= 6,
+    kUInt16		= 7
 };
 
 template<typename To, typename From>
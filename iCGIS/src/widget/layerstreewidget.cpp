@@ -5,15 +5,22 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QDrag>
+#include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QProgressDialog>
 #include <QString>
 
 #include "util/env.h"
 #include "util/logger.h"
 #include "util/appevent.h"
 #include "geo/map/geomap.h"
+#include "geo/utility/snapshot.h"
+#include "geo/utility/flatgeobuf.h"
+#include "geo/raster/georastersource.h"
+#include "geo/tool/geotool.h"
 
 
 LayersTreeWidget::LayersTreeWidget(QWidget* parent /*= nullptr*/)
@@ -225,6 +232,50 @@ void LayersTreeWidget::createActions()
     popMenuOnFeatureLayer->addAction(showStyleDialog);
     connect(showStyleDialog, &QAction::triggered,
             this, &LayersTreeWidget::onShowStyleDialog);
+
+    // save as a snapshot, opened quickly next time
+    saveSnapshotAction = new QAction(tr("Save As Snapshot"), this);
+    saveSnapshotAction->setIcon(QIcon("res/icons/save.ico"));
+    popMenuOnFeatureLayer->addAction(saveSnapshotAction);
+    connect(saveSnapshotAction, &QAction::triggered,
+            this, &LayersTreeWidget::onSaveSnapshot);
+
+    // export to FlatGeobuf, with a spatial index
+    exportFlatGeobufAction = new QAction(tr("Export As FlatGeobuf"), this);
+    exportFlatGeobufAction->setIcon(QIcon("res/icons/save.ico"));
+    popMenuOnFeatureLayer->addAction(exportFlatGeobufAction);
+    connect(exportFlatGeobufAction, &QAction::triggered,
+            this, &LayersTreeWidget::onExportFlatGeobuf);
+
+    // overviews of a raster file, read when zoomed out
+    buildOverviewsAction = new QAction(tr("Build Overviews"), this);
+    popMenuOnRasterLayer->addAction(buildOverviewsAction);
+    connect(buildOverviewsAction, &QAction::triggered,
+            this, &LayersTreeWidget::onBuildOverviews);
+
+    // bands drawn: gray, or an RGB(A) composite
+    renderBandsAction = new QAction(tr("Render Bands"), this);
+    popMenuOnRasterLayer->addAction(renderBandsAction);
+    connect(renderBandsAction, &QAction::triggered,
+            this, &LayersTreeWidget::onSetRenderBands);
+
+    // stretch of the bands drawn, applied on the GPU
+    stretchAction = new QAction(tr("Stretch"), this);
+    popMenuOnRasterLayer->addAction(stretchAction);
+    connect(stretchAction, &QAction::triggered,
+            this, &LayersTreeWidget::onSetStretch);
+
+    // colors of a band drawn alone, applied on the GPU
+    colorRampAction = new QAction(tr("Color Ramp"), this);
+    popMenuOnRasterLayer->addAction(colorRampAction);
+    connect(colorRampAction, &QAction::triggered,
+            this, &LayersTreeWidget::onSetColorRamp);
+
+    // exact statistics of the bands
+    rasterStatsAction = new QAction(tr("Statistics"), this);
+    popMenuOnRasterLayer->addAction(rasterStatsAction);
+    connect(rasterStatsAction, &QAction::triggered,
+            this, &LayersTreeWidget::onShowRasterStats);
 }
 
 
@@ -335,7 +386,8 @@ void LayersTreeWidget::contextMenuEvent(QContextMenuEvent* /*event*/)
                 stopEditingAction->setEnabled(true);
             }
             else {
-                startEditingAction->setEnabled(true);
+                // The features are still added by the loaders
+                startEditingAction->setEnabled(!map->isLoading());
                 saveEditsAction->setEnabled(false);
                 stopEditingAction->setEnabled(false);
             }
@@ -358,10 +410,17 @@ void LayersTreeWidget::contextMenuEvent(QContextMenuEvent* /*event*/)
                     stopEditingAction->setEnabled(true);
                 }
                 else {
-                    startEditingAction->setEnabled(true);
+                    startEditingAction->setEnabled(!map->isLoading());
                     saveEditsAction->setEnabled(false);
                     stopEditingAction->setEnabled(false);
                 }
+                // The loader reads the fields and adds the features until
+                //  the layer is done, removing it stops the loader
+                bool loading = layer->toFeatureLayer()->isLoading();
+                openAttributeTableAction->setEnabled(!loading);
+                showStyleDialog->setEnabled(!loading);
+                saveSnapshotAction->setEnabled(!loading);
+                exportFlatGeobufAction->setEnabled(!loading);
                 popMenuOnFeatureLayer->exec(QCursor::pos());
             }
             // raster layer
@@ -458,6 +517,237 @@ void LayersTreeWidget::onShowStyleDialog()
     }
 }
 
+void LayersTreeWidget::onSaveSnapshot()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kFeatureLayer)
+        return;
+
+    QString filepath = QFileDialog::getSaveFileName(
+        this, tr("Save As Snapshot"), layer->getName() + ".icgl", tr("layer snapshot(*.icgl)"),
+        nullptr, QFileDialog::DontUseNativeDialog);
+    if (filepath.isEmpty())
+        return;
+
+    QByteArray bytes = filepath.toLocal8Bit();
+    if (Snapshot::saveLayer(layer->toFeatureLayer(), bytes.data())) {
+        LInfo("Save snapshot: {0}", bytes.data());
+    }
+    else {
+        QMessageBox::critical(this, "Error", "Save snapshot failed: " + filepath, QMessageBox::Ok);
+    }
+}
+
+void LayersTreeWidget::onExportFlatGeobuf()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kFeatureLayer)
+        return;
+
+    QString filepath = QFileDialog::getSaveFileName(
+        this, tr("Export As FlatGeobuf"), layer->getName() + ".fgb", tr("FlatGeobuf(*.fgb)"),
+        nullptr, QFileDialog::DontUseNativeDialog);
+    if (filepath.isEmpty())
+        return;
+
+    QByteArray bytes = filepath.toLocal8Bit();
+    if (FlatGeobuf::writeLayer(layer->toFeatureLayer(), bytes.data())) {
+        LInfo("Export FlatGeobuf: {0}", bytes.data());
+    }
+    else {
+        QMessageBox::critical(this, "Error", "Export FlatGeobuf failed: " + filepath, QMessageBox::Ok);
+    }
+}
+
+void LayersTreeWidget::onBuildOverviews()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kRasterLayer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    if (!rasterData || rasterData->getBandsCount() < 1 || !rasterData->getBand(0)->isTiled()) {
+        QMessageBox::information(this, "Info", "The raster is not read from a file", QMessageBox::Ok);
+        return;
+    }
+    // The bands of the file share the source
+    GeoRasterSource* source = rasterData->getBand(0)->getSource();
+
+    // Average for continuous data, mode for classes
+    QStringList resamplings = { "AVERAGE", "MODE", "NEAREST" };
+    bool ok = false;
+    QString resampling = QInputDialog::getItem(this, tr("Build Overviews"), tr("Resampling:"),
+                                               resamplings, 0, false, &ok);
+    if (!ok)
+        return;
+
+    QProgressDialog* progressDlg = GeoTool::createProgressDialog(this, tr("Build Overviews"), tr("Building......"));
+
+    QByteArray bytes = resampling.toLocal8Bit();
+    bool built = GeoRasterSource::buildOverviews(source->getPath(), bytes.data(),
+                                                 GeoTool::dialogProgress, progressDlg);
+    bool canceled = progressDlg->wasCanceled();
+    progressDlg->close();
+
+    if (!built) {
+        if (!canceled)
+            QMessageBox::critical(this, "Error", "Build overviews failed", QMessageBox::Ok);
+        return;
+    }
+    if (source->reopen())
+        emit AppEvent::getInstance()->sigUpdateOpengl();
+}
+
+void LayersTreeWidget::onSetRenderBands()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kRasterLayer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    if (!rasterData)
+        return;
+
+    // 1-based in the dialog, as GDAL
+    QStringList current;
+    for (int idx : rasterData->getRenderBands())
+        current.append(QString::number(idx + 1));
+    bool ok = false;
+    QString text = QInputDialog::getText(
+        this, tr("Render Bands"),
+        tr("Bands (1 to %1): one for gray, three for RGB, four for RGBA").arg(rasterData->getBandsCount()),
+        QLineEdit::Normal, current.join(' '), &ok);
+    if (!ok)
+        return;
+
+    std::vector<int> renderBands;
+    for (const QString& item : text.split(' ', QString::SkipEmptyParts)) {
+        int idx = item.toInt(&ok);
+        if (!ok)
+            break;
+        renderBands.push_back(idx - 1);
+    }
+    if (!ok || !rasterData->setRenderBands(renderBands)) {
+        QMessageBox::critical(this, "Error", "Invalid bands: " + text, QMessageBox::Ok);
+        return;
+    }
+    emit AppEvent::getInstance()->sigUpdateOpengl();
+}
+
+void LayersTreeWidget::onSetStretch()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kRasterLayer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    if (!rasterData)
+        return;
+
+    // In the order of GeoRasterStretch::Mode
+    QStringList modes = { tr("Minimum - Maximum"), tr("Percentile"), tr("Histogram Equalization") };
+    GeoRasterStretch stretch = rasterData->getStretch();
+    bool ok = false;
+    QString mode = QInputDialog::getItem(this, tr("Stretch"), tr("Stretch:"),
+                                         modes, int(stretch.mode), false, &ok);
+    if (!ok)
+        return;
+    stretch.mode = GeoRasterStretch::Mode(modes.indexOf(mode));
+
+    if (stretch.mode == GeoRasterStretch::kPercentile) {
+        // The same cut at both ends
+        double lowPercent = QInputDialog::getDouble(this, tr("Stretch"), tr("Cut at each end (%):"),
+                                                    stretch.lowPercent, 0.0, 49.0, 1, &ok);
+        if (!ok)
+            return;
+        stretch.lowPercent = lowPercent;
+        stretch.highPercent = 100.0 - lowPercent;
+    }
+
+    rasterData->setStretch(stretch);
+    emit AppEvent::getInstance()->sigUpdateOpengl();
+}
+
+void LayersTreeWidget::onSetColorRamp()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kRasterLayer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    if (!rasterData)
+        return;
+    if (rasterData->getRenderBands().size() != 1) {
+        QMessageBox::information(this, tr("Color Ramp"), tr("The color ramp applies to a band drawn alone"), QMessageBox::Ok);
+        return;
+    }
+
+    // In the order of GeoRasterColorRamp::Preset
+    QStringList presets;
+    for (const char* name : GeoRasterColorRamp::getPresetNames())
+        presets << tr(name);
+    GeoRasterColorRamp colorRamp = rasterData->getColorRamp();
+    bool ok = false;
+    QString preset = QInputDialog::getItem(this, tr("Color Ramp"), tr("Color ramp:"),
+                                           presets, int(colorRamp.preset), false, &ok);
+    if (!ok)
+        return;
+    colorRamp.preset = GeoRasterColorRamp::Preset(presets.indexOf(preset));
+
+    auto reply = QMessageBox::question(this, tr("Color Ramp"), tr("Invert the color ramp?"),
+                                       QMessageBox::Yes | QMessageBox::No,
+                                       colorRamp.inverted ? QMessageBox::Yes : QMessageBox::No);
+    colorRamp.inverted = (reply == QMessageBox::Yes);
+
+    rasterData->setColorRamp(colorRamp);
+    emit AppEvent::getInstance()->sigUpdateOpengl();
+}
+
+void LayersTreeWidget::onShowRasterStats()
+{
+    LayersTreeWidgetItem* layerItem = toLayerItem(this->currentItem());
+    if (!layerItem)
+        return;
+    GeoLayer* layer = map->getLayerByLID(layerItem->getLID());
+    if (!layer || layer->getLayerType() != kRasterLayer)
+        return;
+    GeoRasterData* rasterData = layer->toRasterLayer()->getData();
+    if (!rasterData)
+        return;
+
+    // One pass over all the blocks of each band
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QString text;
+    int bandsCount = rasterData->getBandsCount();
+    for (int i = 0; i < bandsCount; ++i) {
+        std::shared_ptr<const GeoRasterStats> stats = rasterData->getBand(i)->getStats(false);
+        if (!stats) {
+            text += tr("Band %1: no data\n").arg(i + 1);
+            continue;
+        }
+        text += tr("Band %1: min %2, max %3, mean %4, std dev %5 (%6 pixels)\n")
+                .arg(i + 1).arg(stats->minValue).arg(stats->maxValue)
+                .arg(stats->mean).arg(stats->stdDev).arg(qulonglong(stats->count));
+    }
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox::information(this, tr("Statistics"), text, QMessageBox::Ok);
+}
+
 void LayersTreeWidget::onStartEditing()
 {
     // backup map
@@ -46,6 +46,13 @@ public slots:
     void onRenameItem();
     void onOpenAttributeTable();
     void onShowStyleDialog();
+    void onSaveSnapshot();
+    void onExportFlatGeobuf();
+    void onBuildOverviews();
+    void onSetRenderBands();
+    void onSetStretch();
+    void onSetColorRamp();
+    void onShowRasterStats();
     void onStartEditing();
     void onSaveEdits();
     void onStopEditing();
@@ -92,6 +99,13 @@ private:
     QAction* saveEditsAction;
     QAction* stopEditingAction;
     QAction* showStyleDialog;
+    QAction* saveSnapshotAction;
+    QAction* exportFlatGeobufAction;
+    QAction* buildOverviewsAction;
+    QAction* renderBandsAction;
+    QAction* stretchAction;
+    QAction* colorRampAction;
+    QAction* rasterStatsAction;
 
     // menus
     QMenu* popMenuOnFeatureLayer;
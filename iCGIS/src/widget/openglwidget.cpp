@@ -11,11 +11,14 @@
 #include "geo/utility/geo_utility.h"
 #include "util/utility.h"
 #include "util/env.h"
+#include "util/logger.h"
 #include "util/appevent.h"
+#include "util/parallel.h"
 
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <QDebug>
 
@@ -38,14 +41,20 @@ OpenGLWidget::OpenGLWidget(QWidget* parent /*= 0*/)
             this, &OpenGLWidget::onZoomToMap);
     connect(AppEvent::getInstance(), &AppEvent::sigZoomToLayer,
             this, &OpenGLWidget::onZoomToLayer);
+    // The windows of the rasters too, e.g. their overviews were built
     connect(AppEvent::getInstance(), &AppEvent::sigUpdateOpengl,
-            this, [this]{ update(); });
+            this, [this]{ update(); viewChangedTimer->start(); });
     connect(AppEvent::getInstance(), &AppEvent::sigSendMapToGPU,
             this, &OpenGLWidget::onSendMapToGPU);
     connect(AppEvent::getInstance(), &AppEvent::sigSendLayerToGPU,
             this, &OpenGLWidget::onSendLayerToGPU);
     connect(AppEvent::getInstance(), &AppEvent::sigSendFeatureToGPU,
             this, &OpenGLWidget::onSendFeatureToGPU);
+
+    viewChangedTimer = new QTimer(this);
+    viewChangedTimer->setSingleShot(true);
+    viewChangedTimer->setInterval(150);
+    connect(viewChangedTimer, &QTimer::timeout, this, &OpenGLWidget::onViewChanged);
 }
 
 OpenGLWidget::~OpenGLWidget()
@@ -156,6 +165,19 @@ GeoRawPoint OpenGLWidget::screen2xy(int screenX, int screenY)
 }
 
 
+// Corners of the widget in WCS
+GeoExtent OpenGLWidget::getViewExtent()
+{
+    auto toX = [this](double stdX) {
+        return (stdX * adjustedMapExtent.width() + adjustedMapExtent.minX + adjustedMapExtent.maxX - 2 * xOffset) / (2 * zoom);
+    };
+    auto toY = [this](double stdY) {
+        return (stdY * adjustedMapExtent.height() + adjustedMapExtent.minY + adjustedMapExtent.maxY - 2 * yOffset) / (2 * zoom);
+    };
+    return GeoExtent(toX(-1.0), toX(1.0), toY(-1.0), toY(1.0));
+}
+
+
 // SCS ==> NDC
 GeoRawPoint OpenGLWidget::screen2stdxy(int screenX, int screenY)
 {
@@ -234,6 +256,10 @@ void OpenGLWidget::setMVP()
 
     Env::textureShader.Bind();
     Env::textureShader.SetUniformMat4f("u_MVP", mvp);
+
+    // The view changed
+    if (viewChangedTimer)
+        viewChangedTimer->start();
 }
 
 /**************************************************/
@@ -574,6 +600,44 @@ void OpenGLWidget::onZoomToMap() {
 /*                                                */
 /**************************************************/
 
+// The tiles of the virtual layers in the view are read, the least
+//  recently used ones are dropped
+void OpenGLWidget::updateVirtualLayers()
+{
+    if (!isRunning || !map || map->isEmpty())
+        return;
+
+    GeoExtent viewExtent = getViewExtent();
+    bool changed = false;
+    bool removed = false;
+    for (auto layerIter = map->begin(); layerIter != map->end(); ++layerIter) {
+        if ((*layerIter)->getLayerType() != kFeatureLayer)
+            continue;
+        GeoFeatureLayer* featureLayer = (*layerIter)->toFeatureLayer();
+        if (!featureLayer->isVirtual() || !featureLayer->isVisible())
+            continue;
+
+        makeCurrent();
+        std::vector<GeoFeature*> featuresAdded;
+        bool featuresRemoved = false;
+        if (!featureLayer->getVirtualSource()->update(viewExtent, featuresAdded, featuresRemoved))
+            continue;
+        for (GeoFeature* feature : featuresAdded)
+            sendFeatureToGPU(feature, nullptr);
+        changed = true;
+        removed = removed || featuresRemoved;
+    }
+
+    // The operations and the dialog may hold the features deleted
+    if (removed) {
+        opList.clear();
+        if (whatIsThisDialog)
+            whatIsThisDialog->close();
+    }
+    if (changed)
+        update();
+}
+
 void OpenGLWidget::clearSelected()
 {
     // get opengl contex
@@ -657,83 +721,240 @@ void OpenGLWidget::onSendRasterLayerToGPU(GeoRasterLayer *rasterLayer, bool bUpd
 
     makeCurrent();
 
-    GeoExtent extent = rasterLayer->getExtent();
+    // The view first, only its window of the bands is read
+    if (map->getNumLayers() == 1)
+        updateMVP(true, false, true);
+    else
+        updateMVP(false, false, true);
+
+    setMVP();
+
     GeoRasterData* rasterData = rasterLayer->getData();
+    if (rasterData)
+        sendRasterDataToGPU(rasterData, getViewExtent());
 
-    for (auto bandIter = rasterData->begin(); bandIter != rasterData->end(); ++bandIter) {
-        OpenglRasterDescriptor* rasterDesc = new OpenglRasterDescriptor();
-        (*bandIter)->setOpenglRasterDescriptor(rasterDesc);
+    if (bUpdate) {
+        update();
+    }
+}
 
-        auto& vao = rasterDesc->vao;
-        auto& vbo = rasterDesc->vbo;
-        auto& ibo = rasterDesc->ibo;
-        auto& texs = rasterDesc->texs;
+bool OpenGLWidget::sendRasterDataToGPU(GeoRasterData* rasterData, const GeoExtent& viewExtent)
+{
+    const std::vector<int>& renderBands = rasterData->getRenderBands();
+    if (renderBands.empty())
+        return false;
+    // All the bands have the same size and transform
+    GeoRasterBand* band = rasterData->getBand(renderBands[0]);
+
+    // Pixels of the band in the view (north up)
+    GeoExtent bandExtent = band->getExtent();
+    if (!viewExtent.isIntersect(bandExtent) || band->width < 1 || band->height < 1)
+        return false;
+    double minX = std::max(viewExtent.minX, bandExtent.minX);
+    double maxX = std::min(viewExtent.maxX, bandExtent.maxX);
+    double minY = std::max(viewExtent.minY, bandExtent.minY);
+    double maxY = std::min(viewExtent.maxY, bandExtent.maxY);
+    const double* gt = band->geoTransform;
+    int xOff = std::max(0, int(std::floor((minX - gt[0]) / gt[1])));
+    int xEnd = std::min(band->width, int(std::ceil((maxX - gt[0]) / gt[1])));
+    int yOff = std::max(0, int(std::floor((maxY - gt[3]) / gt[5])));
+    int yEnd = std::min(band->height, int(std::ceil((minY - gt[3]) / gt[5])));
+    int xSize = xEnd - xOff;
+    int ySize = yEnd - yOff;
+    if (xSize < 1 || ySize < 1)
+        return false;
+
+    // No more pixels than the screen shows
+    const int maxTextureSize = 4096;
+    int texWidth = int(std::ceil(xSize * std::abs(gt[1]) / viewExtent.width() * this->width()));
+    int texHeight = int(std::ceil(ySize * std::abs(gt[5]) / viewExtent.height() * this->height()));
+    texWidth = std::max(1, std::min({ texWidth, xSize, maxTextureSize }));
+    texHeight = std::max(1, std::min({ texHeight, ySize, maxTextureSize }));
+
+    // Zoomed out: an overview, as many pixels as the texture at most
+    double pixelsPerTexel = std::min(double(xSize) / texWidth, double(ySize) / texHeight);
+    int level = band->getLevelForScale(pixelsPerTexel);
+
+    // The statistics of the bands, computed at the first upload
+    int bandsCount = int(renderBands.size());
+    std::vector<double> valueRanges;
+    for (int i = 0; i < bandsCount; ++i) {
+        std::shared_ptr<const GeoRasterStats> stats = rasterData->getBand(renderBands[i])->getStats();
+        if (!stats) {
+            LError("Compute the statistics of the raster bands error");
+            return false;
+        }
+        valueRanges.push_back(stats->minValue);
+        valueRanges.push_back(stats->maxValue);
+    }
 
-        // VAO
-        vao = new VertexArray();
+    OpenglRasterDescriptor* oldDesc = rasterData->getOpenglRasterDescriptor();
+    if (oldDesc && oldDesc->xOff == xOff && oldDesc->yOff == yOff && oldDesc->xSize == xSize
+        && oldDesc->ySize == ySize && oldDesc->texWidth == texWidth && oldDesc->texHeight == texHeight
+        && oldDesc->level == level && oldDesc->bands == renderBands)
+    {
+        if (oldDesc->valueRanges == valueRanges && oldDesc->styleVersion == rasterData->getStyleVersion())
+            return false;
+        // Stretched again, another color ramp, or the exact statistics:
+        //  the pixels are the same
+        makeCurrent();
+        if (oldDesc->valueRanges != valueRanges) {
+            std::vector<unsigned char> lut;
+            if (!rasterData->buildEqualizeLut(lut))
+                return false;
+            oldDesc->texs[1]->setData(lut.data(), GeoRasterStretch::kLutSize, 1, GL_UNSIGNED_BYTE, GL_RGBA);
+            oldDesc->valueRanges = valueRanges;
+        }
+        return sendRasterStyleToGPU(rasterData, oldDesc);
+    }
 
-        // VBO
-        float vertices[] = {
-            // position					            // texture coords
-            float(extent.maxX), float(extent.minY),   1.0f, 1.0f,
-            float(extent.maxX), float(extent.maxY),   1.0f, 0.0f,
-            float(extent.minX), float(extent.maxY),   0.0f, 0.0f,
-            float(extent.minX), float(extent.minY),   0.0f, 1.0f
-        };
-        vbo = new VertexBuffer(vertices, 16 * sizeof(float));
-
-        // Data layout
-        VertexBufferLayout layout;
-        layout.Push<float>(2);	// x, y
-        layout.Push<float>(2);	// coordX, coordY
-        vao->addBuffer(*vbo, layout);
+    // The window of each band, read in parallel (the blocks cached are
+    //  converted at the same time)
+    size_t pixelsCount = size_t(texWidth) * texHeight;
+    std::vector<std::vector<float>> pixels(bandsCount, std::vector<float>(pixelsCount));
+    std::vector<char> readOk(bandsCount, 0);
+    utils::parallelFor(0, bandsCount, [&](int i) {
+        GeoRasterBand* renderBand = rasterData->getBand(renderBands[i]);
+        readOk[i] = renderBand->readWindow(xOff, yOff, xSize, ySize, pixels[i].data(),
+                                           texWidth, texHeight, level);
+    }, 1);
+    if (std::find(readOk.begin(), readOk.end(), 0) != readOk.end()) {
+        LError("Read the window of the raster bands error");
+        return false;
+    }
 
-        // IBO
-        unsigned int indices[] = {
-            0, 1, 3,
-            1, 2, 3
-        };
-        ibo = new IndexBuffer(indices, 6, GL_TRIANGLES);
-
-        // Texture
-        GeoRasterData* rasterData = rasterLayer->getData();
-        int bandsCount = rasterData->getBandsCount();
+    std::vector<unsigned char> lut;
+    if (!rasterData->buildEqualizeLut(lut))
+        return false;
+
+    // The raw values, nodata stays NaN: a band alone as it was read,
+    //  else the bands interleaved in RGB(A)
+    const float* texData = pixels[0].data();
+    std::vector<float> interleaved;
+    if (bandsCount > 1) {
+        interleaved.resize(pixelsCount * bandsCount);
         for (int i = 0; i < bandsCount; ++i) {
-            GeoRasterBand* band = rasterData->getBand(i);
-            Texture* texture = nullptr;
-            switch (band->getDataType()) {
-            default:
-                break;
-            case utils::DataType::kFloat:
-            {
-                int count = band->width * band->height;
-                // normalize to: [0, 1]
-                float maxValue = *(std::max_element((float*)(band->pData), (float*)(band->pData) + count));
-                float* pixels = (float*)(band->pData);
-                float* buff = new float[count];
-                for (int i = 0; i < count; ++i) {
-                    buff[i] = pixels[i] / maxValue;
-                }
-                texture = new Texture(buff, band->width, band->height,
-                                      GL_FLOAT, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT);
-                delete[] buff;
-                texs.push_back(texture);
-                break;
-            }
-            }
+            const float* src = pixels[i].data();
+            float* dst = interleaved.data() + i;
+            for (size_t k = 0; k < pixelsCount; ++k)
+                dst[k * bandsCount] = src[k];
         }
+        texData = interleaved.data();
+    }
+    unsigned int internalFormat = GL_R32F, format = GL_RED;
+    if (bandsCount == 3) {
+        internalFormat = GL_RGB32F;
+        format = GL_RGB;
+    }
+    else if (bandsCount == 4) {
+        internalFormat = GL_RGBA32F;
+        format = GL_RGBA;
     }
 
-    if (map->getNumLayers() == 1)
-        updateMVP(true, false, true);
-    else
-        updateMVP(false, false, true);
+    makeCurrent();
+    OpenglRasterDescriptor* rasterDesc = new OpenglRasterDescriptor();
+    rasterDesc->xOff = xOff;
+    rasterDesc->yOff = yOff;
+    rasterDesc->xSize = xSize;
+    rasterDesc->ySize = ySize;
+    rasterDesc->texWidth = texWidth;
+    rasterDesc->texHeight = texHeight;
+    rasterDesc->level = level;
+    rasterDesc->bands = renderBands;
+    rasterDesc->valueRanges = valueRanges;
+
+    auto& vao = rasterDesc->vao;
+    auto& vbo = rasterDesc->vbo;
+    auto& ibo = rasterDesc->ibo;
+    auto& texs = rasterDesc->texs;
 
-    setMVP();
+    // VAO
+    vao = new VertexArray();
 
-    if (bUpdate) {
-        update();
+    // VBO, the window
+    GeoExtent windowExtent(band->getGeoX(xOff), band->getGeoX(xOff + xSize),
+                           band->getGeoY(yOff + ySize), band->getGeoY(yOff));
+    float vertices[] = {
+        // position					            // texture coords
+        float(windowExtent.maxX), float(windowExtent.minY),   1.0f, 1.0f,
+        float(windowExtent.maxX), float(windowExtent.maxY),   1.0f, 0.0f,
+        float(windowExtent.minX), float(windowExtent.maxY),   0.0f, 0.0f,
+        float(windowExtent.minX), float(windowExtent.minY),   0.0f, 1.0f
+    };
+    vbo = new VertexBuffer(vertices, 16 * sizeof(float));
+
+    // Data layout
+    VertexBufferLayout layout;
+    layout.Push<float>(2);	// x, y
+    layout.Push<float>(2);	// coordX, coordY
+    vao->addBuffer(*vbo, layout);
+
+    // IBO
+    unsigned int indices[] = {
+        0, 1, 3,
+        1, 2, 3
+    };
+    ibo = new IndexBuffer(indices, 6, GL_TRIANGLES);
+
+    // Texture
+    texs.push_back(new Texture(const_cast<float*>(texData), texWidth, texHeight,
+                               GL_FLOAT, internalFormat, format));
+    // Lookup table of the equalization
+    texs.push_back(new Texture(lut.data(), GeoRasterStretch::kLutSize, 1,
+                               GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA));
+    // Lookup table of the color ramp, filled with the uniforms
+    texs.push_back(new Texture(nullptr, GeoRasterColorRamp::kLutSize, 1,
+                               GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA));
+
+    rasterData->setOpenglRasterDescriptor(rasterDesc);
+    sendRasterStyleToGPU(rasterData, rasterDesc);
+    return true;
+}
+
+bool OpenGLWidget::sendRasterStyleToGPU(GeoRasterData* rasterData, OpenglRasterDescriptor* rasterDesc)
+{
+    std::vector<double> lowHighs;
+    if (!rasterData->getStretchRanges(lowHighs))
+        return false;
+    int bandsCount = int(lowHighs.size() / 2);
+    for (int i = 0; i < 4; ++i) {
+        rasterDesc->stretchLow[i] = i < bandsCount ? float(lowHighs[i * 2]) : 0.0f;
+        rasterDesc->stretchHigh[i] = i < bandsCount ? float(lowHighs[i * 2 + 1]) : 1.0f;
     }
+    rasterDesc->equalize = rasterData->getStretch().mode == GeoRasterStretch::kEqualize;
+
+    std::vector<unsigned char> rampLut;
+    rasterData->getColorRamp().buildLut(rampLut);
+    rasterDesc->texs[2]->setData(rampLut.data(), GeoRasterColorRamp::kLutSize, 1, GL_UNSIGNED_BYTE, GL_RGBA);
+
+    rasterDesc->styleVersion = rasterData->getStyleVersion();
+    return true;
+}
+
+void OpenGLWidget::updateRasterLayers()
+{
+    if (!isRunning || !map || map->isEmpty())
+        return;
+
+    GeoExtent viewExtent = getViewExtent();
+    bool changed = false;
+    for (auto layerIter = map->begin(); layerIter != map->end(); ++layerIter) {
+        if ((*layerIter)->getLayerType() != kRasterLayer || !(*layerIter)->isVisible())
+            continue;
+        GeoRasterData* rasterData = (*layerIter)->toRasterLayer()->getData();
+        if (!rasterData)
+            continue;
+        changed = sendRasterDataToGPU(rasterData, viewExtent) || changed;
+    }
+
+    if (changed)
+        update();
+}
+
+void OpenGLWidget::onViewChanged()
+{
+    updateVirtualLayers();
+    updateRasterLayers();
 }
 
 
@@ -749,8 +970,9 @@ void OpenGLWidget::onSendFeatureLayerToGPU(GeoFeatureLayer* featureLayer, bool b
         return;
     makeCurrent();
 
+    const GeoTriangleCache* triangles = featureLayer->getTriangleCache();
     for (auto featureIter = featureLayer->begin(); featureIter != featureLayer->end(); ++featureIter) {
-        onSendFeatureToGPU(*featureIter);
+        sendFeatureToGPU(*featureIter, triangles);
     }
 
     if (map->getNumLayers() == 1)
@@ -767,6 +989,11 @@ void OpenGLWidget::onSendFeatureLayerToGPU(GeoFeatureLayer* featureLayer, bool b
 
 
 void OpenGLWidget::onSendFeatureToGPU(GeoFeature *feature) {
+    sendFeatureToGPU(feature, nullptr);
+}
+
+// triangles: cached triangles of the layer's polygons, nullptr to run earcut
+void OpenGLWidget::sendFeatureToGPU(GeoFeature* feature, const GeoTriangleCache* triangles) {
     GeometryType geomType = feature->getGeometryType();
 
     float r, g, b;
@@ -787,7 +1014,7 @@ void OpenGLWidget::onSendFeatureToGPU(GeoFeature *feature) {
     case kPolygon:
     {
         GeoPolygon* polygon = feature->getGeometry()->toPolygon();
-        featureDesc = sendPolygonToGPU(polygon, r, g, b);
+        featureDesc = sendPolygonToGPU(polygon, r, g, b, triangles, feature->getFID());
         break;
     }
     case kLineString:
@@ -805,7 +1032,7 @@ void OpenGLWidget::onSendFeatureToGPU(GeoFeature *feature) {
     case kMultiPolygon:
     {
         GeoMultiPolygon* multiPolygon = feature->getGeometry()->toMultiPolygon();
-        featureDesc = sendMultiPolygonToGPU(multiPolygon, r, g, b);
+        featureDesc = sendMultiPolygonToGPU(multiPolygon, r, g, b, triangles, feature->getFID());
         break;
     }
     case kMultiLineString:
@@ -975,7 +1202,8 @@ OpenglFeatureDescriptor* OpenGLWidget::sendMultiLineStringToGPU(GeoMultiLineStri
     return featureDesc;
 }
 
-OpenglFeatureDescriptor* OpenGLWidget::sendPolygonToGPU(GeoPolygon* geoPolygon, float r,float g, float b)
+OpenglFeatureDescriptor* OpenGLWidget::sendPolygonToGPU(GeoPolygon* geoPolygon, float r,float g, float b,
+                                                        const GeoTriangleCache* triangles /*= nullptr*/, int nFID /*= -1*/)
 {
     OpenglFeatureDescriptor* featureDesc = new OpenglFeatureDescriptor(8);
     int polygonPointsCount = geoPolygon->getNumPoints();
@@ -1048,8 +1276,14 @@ OpenglFeatureDescriptor* OpenGLWidget::sendPolygonToGPU(GeoPolygon* geoPolygon,
         polygon.emplace_back(interiorRing);
     }
 
-    // Triangulation
-    std::vector<unsigned int> indices = mapbox::earcut<unsigned int>(polygon);
+    // Triangulation, cached or by earcut
+    std::vector<unsigned int> indices;
+    int cachedCount = 0;
+    const unsigned int* cached = triangles ? triangles->getTriangles(nFID, 0, cachedCount) : nullptr;
+    if (cached)
+        indices.assign(cached, cached + cachedCount);
+    else
+        indices = mapbox::earcut<unsigned int>(polygon);
     //std::reverse(indices.begin(), indices.end());
 
     // VBO
@@ -1071,7 +1305,8 @@ OpenglFeatureDescriptor* OpenGLWidget::sendPolygonToGPU(GeoPolygon* geoPolygon,
 }
 
 
-OpenglFeatureDescriptor* OpenGLWidget::sendMultiPolygonToGPU(GeoMultiPolygon* multiPolygon, float r,float g, float b)
+OpenglFeatureDescriptor* OpenGLWidget::sendMultiPolygonToGPU(GeoMultiPolygon* multiPolygon, float r,float g, float b,
+                                                             const GeoTriangleCache* triangles /*= nullptr*/, int nFID /*= -1*/)
 {
     OpenglFeatureDescriptor* featureDesc = new OpenglFeatureDescriptor(8);
     int pointsCount = multiPolygon->getNumPoints();
@@ -1157,8 +1392,14 @@ OpenglFeatureDescriptor* OpenGLWidget::sendMultiPolygonToGPU(GeoMultiPolygon* mu
             polygon.emplace_back(interiorRing);
         }
 
-        // Triangulation
-        std::vector<unsigned int> indices = mapbox::earcut<unsigned int>(polygon);
+        // Triangulation, cached or by earcut
+        std::vector<unsigned int> indices;
+        int cachedCount = 0;
+        const unsigned int* cached = triangles ? triangles->getTriangles(nFID, i, cachedCount) : nullptr;
+        if (cached)
+            indices.assign(cached, cached + cachedCount);
+        else
+            indices = mapbox::earcut<unsigned int>(polygon);
         //std::reverse(indices.begin(), indices.end());
 
         if (countOffset > 0)
@@ -3,7 +3,7 @@
 **
 ** description: OpenGL widget, public inherited from QOpengGLWidget
 **
-** last change: 2020-03-27
+** last change: 2020-04-09
 **************************************************************************/
 #pragma once
 
@@ -16,6 +16,7 @@
 #include "operation/operationlist.h"
 
 #include <QOpenGLWidget>
+#include <QTimer>
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QKeyEvent>
@@ -33,6 +34,9 @@ public:
     explicit OpenGLWidget(QWidget* parent = nullptr);
     ~OpenGLWidget();
 
+    // The part of the map shown in the widget (WCS)
+    GeoExtent getViewExtent();
+
 signals:
     // Status bar
     // Change the cursor position at the world system timely in real time.
@@ -97,12 +101,28 @@ protected:
     virtual void keyPressEvent(QKeyEvent* ev) override;
 
 private:
+    // The view has not moved for a while
+    void onViewChanged();
+    // Read the features of the virtual layers in the view
+    void updateVirtualLayers();
+    // Read the windows of the rasters in the view
+    void updateRasterLayers();
+    // The window of the bands drawn in the view at the resolution of the
+    //  screen, raw values in one float texture, the equalization and the
+    //  color ramp in lookup tables, false if nothing changed
+    // A new stretch or color ramp uploads no pixel
+    bool sendRasterDataToGPU(GeoRasterData* rasterData, const GeoExtent& viewExtent);
+    // The uniforms of the stretch and the table of the color ramp
+    bool sendRasterStyleToGPU(GeoRasterData* rasterData, OpenglRasterDescriptor* rasterDesc);
+    void sendFeatureToGPU(GeoFeature* feature, const GeoTriangleCache* triangles);
     OpenglFeatureDescriptor* sendPointToGPU(GeoPoint* point, float r, float g, float b);
     OpenglFeatureDescriptor* sendMultiPointToGPU(GeoMultiPoint* mutliPoint, float r, float g, float b);
     OpenglFeatureDescriptor* sendLineStringToGPU(GeoLineString* lineString, float r, float g, float b);
     OpenglFeatureDescriptor* sendMultiLineStringToGPU(GeoMultiLineString* multiLineString, float r, float g, float b);
-    OpenglFeatureDescriptor* sendPolygonToGPU(GeoPolygon* polygon, float r, float g, float b);
-    OpenglFeatureDescriptor* sendMultiPolygonToGPU(GeoMultiPolygon* multiPolygon, float r, float g, float b);
+    OpenglFeatureDescriptor* sendPolygonToGPU(GeoPolygon* polygon, float r, float g, float b,
+                                              const GeoTriangleCache* triangles = nullptr, int nFID = -1);
+    OpenglFeatureDescriptor* sendMultiPolygonToGPU(GeoMultiPolygon* multiPolygon, float r, float g, float b,
+                                                   const GeoTriangleCache* triangles = nullptr, int nFID = -1);
 
 private:
     /************************* MVP **************************/
@@ -138,4 +158,8 @@ private:
 
     // What is this
     WhatIsThisDialog* whatIsThisDialog = nullptr;
+
+    // Restarted by every change of the view, the virtual layers are
+    //  updated once the view stops moving
+    QTimer* viewChangedTimer = nullptr;
 };
@@ -12,6 +12,8 @@ StatusBar::StatusBar(QStatusBar *statusBarIn)
 
     connect(AppEvent::getInstance(), &AppEvent::sigUpdateCoord,
             this, &StatusBar::onUpdateCoord);
+    connect(btnCancelProgress, &QPushButton::clicked,
+            this, &StatusBar::sigCancelProgress);
 }
 
 StatusBar::~StatusBar() {}
@@ -55,12 +57,39 @@ void StatusBar::showMsg(const QString &msg, int timeMs)
     statusBar->showMessage(msg, timeMs);
 }
 
+// show progress (e.g. of loading files) until hideProgress() is called
+void StatusBar::showProgress(const QString& msg, int value, int maximum)
+{
+    labelProgress->setText(msg);
+    progressBar->setRange(0, maximum);
+    progressBar->setValue(value);
+    labelProgress->show();
+    progressBar->show();
+    btnCancelProgress->show();
+}
+
+void StatusBar::hideProgress()
+{
+    labelProgress->hide();
+    progressBar->hide();
+    btnCancelProgress->hide();
+}
+
 void StatusBar::createWidgets() {
     labelCoord = new QLabel();
     labelUnit = new QLabel();
+    labelProgress = new QLabel();
+    progressBar = new QProgressBar();
+    progressBar->setMaximumWidth(200);
+    progressBar->setTextVisible(false);
+    btnCancelProgress = new QPushButton("Cancel");
+    hideProgress();
 }
 
 void StatusBar::setupLayout() {
+    this->statusBar->addPermanentWidget(labelProgress);
+    this->statusBar->addPermanentWidget(progressBar);
+    this->statusBar->addPermanentWidget(btnCancelProgress);
     this->statusBar->addPermanentWidget(labelCoord);
     this->statusBar->addPermanentWidget(labelUnit);
 }
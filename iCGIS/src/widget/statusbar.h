@@ -7,6 +7,8 @@
 
 #include <QLabel>
 #include <QObject>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QStatusBar>
 
 enum CoordUint {
@@ -22,6 +24,10 @@ public:
     StatusBar(QStatusBar* statusBarIn);
     ~StatusBar();
 
+signals:
+    // The cancel button of the progress was clicked
+    void sigCancelProgress();
+
 public slots:
     void onUpdateCoord(double x, double y);
 
@@ -29,6 +35,11 @@ public:
     void setUnit(CoordUint unit);
     void showMsg(const QString& msg, int timeMs = 0);
 
+    // Progress and a cancel button in the right area
+    // maximum: 0 if unknown (busy indicator)
+    void showProgress(const QString& msg, int value, int maximum);
+    void hideProgress();
+
 private:
     void createWidgets();
     void setupLayout();
@@ -37,5 +48,8 @@ private:
     QStatusBar* statusBar;
     QLabel* labelCoord;
     QLabel* labelUnit;
+    QLabel* labelProgress;
+    QProgressBar* progressBar;
+    QPushButton* btnCancelProgress;
     CoordUint unit = kDegree;
 };
@@ -33,6 +33,42 @@ void ToolBoxTreeWidget::createToolItems()
 	QTreeWidgetItem* kernelDensityItem = new QTreeWidgetItem(toolboxRootItem);
 	kernelDensityItem->setIcon(0, QIcon("res/icons/tool.ico"));
 	kernelDensityItem->setText(0, tr("Kernel Density"));
+
+	QTreeWidgetItem* geometryMeasureItem = new QTreeWidgetItem(toolboxRootItem);
+	geometryMeasureItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	geometryMeasureItem->setText(0, tr("Geometry Measures"));
+
+	QTreeWidgetItem* minimumBoundingItem = new QTreeWidgetItem(toolboxRootItem);
+	minimumBoundingItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	minimumBoundingItem->setText(0, tr("Minimum Bounding Geometry"));
+
+	QTreeWidgetItem* delaunayTriangulationItem = new QTreeWidgetItem(toolboxRootItem);
+	delaunayTriangulationItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	delaunayTriangulationItem->setText(0, tr("Delaunay Triangulation"));
+
+	QTreeWidgetItem* voronoiDiagramItem = new QTreeWidgetItem(toolboxRootItem);
+	voronoiDiagramItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	voronoiDiagramItem->setText(0, tr("Voronoi Diagram"));
+
+	QTreeWidgetItem* bufferItem = new QTreeWidgetItem(toolboxRootItem);
+	bufferItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	bufferItem->setText(0, tr("Buffer"));
+
+	QTreeWidgetItem* rasterCalculatorItem = new QTreeWidgetItem(toolboxRootItem);
+	rasterCalculatorItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	rasterCalculatorItem->setText(0, tr("Raster Calculator"));
+
+	QTreeWidgetItem* reprojectRasterItem = new QTreeWidgetItem(toolboxRootItem);
+	reprojectRasterItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	reprojectRasterItem->setText(0, tr("Reproject Raster"));
+
+	QTreeWidgetItem* zonalStatisticsItem = new QTreeWidgetItem(toolboxRootItem);
+	zonalStatisticsItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	zonalStatisticsItem->setText(0, tr("Zonal Statistics"));
+
+	QTreeWidgetItem* terrainAnalysisItem = new QTreeWidgetItem(toolboxRootItem);
+	terrainAnalysisItem->setIcon(0, QIcon("res/icons/tool.ico"));
+	terrainAnalysisItem->setText(0, tr("Terrain Analysis"));
 }
 
 void ToolBoxTreeWidget::onDoubleClicked(QTreeWidgetItem* item, int col)
@@ -43,4 +79,40 @@ void ToolBoxTreeWidget::onDoubleClicked(QTreeWidgetItem* item, int col)
         KernelDensityTool* kernelDensityTool = new KernelDensityTool(this);
         kernelDensityTool->show();
 	}
+	else if (toolName == "Geometry Measures") {
+        GeometryMeasureTool* geometryMeasureTool = new GeometryMeasureTool(this);
+        geometryMeasureTool->show();
+	}
+	else if (toolName == "Minimum Bounding Geometry") {
+        MinimumBoundingTool* minimumBoundingTool = new MinimumBoundingTool(this);
+        minimumBoundingTool->show();
+	}
+	else if (toolName == "Delaunay Triangulation") {
+        DelaunayTriangulationTool* delaunayTriangulationTool = new DelaunayTriangulationTool(this);
+        delaunayTriangulationTool->show();
+	}
+	else if (toolName == "Voronoi Diagram") {
+        VoronoiDiagramTool* voronoiDiagramTool = new VoronoiDiagramTool(this);
+        voronoiDiagramTool->show();
+	}
+	else if (toolName == "Buffer") {
+        BufferTool* bufferTool = new BufferTool(this);
+        bufferTool->show();
+	}
+	else if (toolName == "Raster Calculator") {
+        RasterCalculatorTool* rasterCalculatorTool = new RasterCalculatorTool(this);
+        rasterCalculatorTool->show();
+	}
+	else if (toolName == "Reproject Raster") {
+        ReprojectRasterTool* reprojectRasterTool = new ReprojectRasterTool(this);
+        reprojectRasterTool->show();
+	}
+	else if (toolName == "Zonal Statistics") {
+        ZonalStatisticsTool* zonalStatisticsTool = new ZonalStatisticsTool(this);
+        zonalStatisticsTool->show();
+	}
+	else if (toolName == "Terrain Analysis") {
+        TerrainAnalysisTool* terrainAnalysisTool = new TerrainAnalysisTool(this);
+        terrainAnalysisTool->show();
+	}
 }
@@ -11,7 +11,16 @@
 #include <QTreeWidgetItem>
 
 #include "geo/map/geomap.h"
+#include "geo/tool/buffer.h"
+#include "geo/tool/delaunay_triangulation.h"
+#include "geo/tool/geometry_measure.h"
 #include "geo/tool/kernel_density.h"
+#include "geo/tool/minimum_bounding.h"
+#include "geo/tool/raster_calculator.h"
+#include "geo/tool/reproject_raster.h"
+#include "geo/tool/terrain_analysis.h"
+#include "geo/tool/voronoi_diagram.h"
+#include "geo/tool/zonal_statistics.h"
 
 
 class ToolBoxTreeWidget : public QTreeWidget